@@ -0,0 +1,90 @@
+#pragma once
+
+// Bounded FIFO of fixed-size items between tasks; send blocks while it is
+// full, receive while it is empty, each up to a timeout (UINT32_MAX waits
+// forever).
+//
+// On the ESP32 this is a FreeRTOS queue (items copied in and out). Host
+// builds (tools/) get a mutex and condition variables with the same
+// interface, so modules that use it can be tested with real threads; there
+// the timeouts are real milliseconds, not the simulated clock.
+//
+//   static BlockQueue q;
+//   q.create(8, sizeof(Item));
+//   q.send(&item, 100);  ...  q.receive(&item, UINT32_MAX);
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+struct BlockQueue {
+  QueueHandle_t q = nullptr;
+
+  bool create(int depth, size_t item_size) {
+    q = xQueueCreate(depth, item_size);
+    return q != nullptr;
+  }
+  bool send(const void* item, uint32_t timeout_ms) {
+    return xQueueSend(q, item, ticks(timeout_ms)) == pdTRUE;
+  }
+  bool receive(void* item, uint32_t timeout_ms) {
+    return xQueueReceive(q, item, ticks(timeout_ms)) == pdTRUE;
+  }
+
+  static TickType_t ticks(uint32_t ms) {
+    return (ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(ms);
+  }
+};
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <vector>
+
+struct BlockQueue {
+  std::mutex mux;
+  std::condition_variable not_full, not_empty;
+  std::vector<uint8_t> ring;
+  size_t item = 0;
+  int depth = 0, head = 0, count = 0;
+
+  bool create(int d, size_t item_size) {
+    if (d <= 0 || item_size == 0) return false;
+    depth = d;
+    item = item_size;
+    ring.assign((size_t)d * item_size, 0);
+    head = count = 0;
+    return true;
+  }
+  bool send(const void* p, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(mux);
+    if (!wait(lock, not_full, timeout_ms, [this] { return count < depth; })) return false;
+    memcpy(&ring[(size_t)((head + count) % depth) * item], p, item);
+    count++;
+    not_empty.notify_one();
+    return true;
+  }
+  bool receive(void* p, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(mux);
+    if (!wait(lock, not_empty, timeout_ms, [this] { return count > 0; })) return false;
+    memcpy(p, &ring[(size_t)head * item], item);
+    head = (head + 1) % depth;
+    count--;
+    not_full.notify_one();
+    return true;
+  }
+
+  template <typename Pred>
+  static bool wait(std::unique_lock<std::mutex>& lock, std::condition_variable& cv,
+                   uint32_t timeout_ms, Pred ready) {
+    if (timeout_ms == UINT32_MAX) {
+      cv.wait(lock, ready);
+      return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+  }
+};
+#endif
@@ -0,0 +1,197 @@
+#pragma once
+
+// Landscape drawing canvas over the panel's portrait 2bpp frame buffer.
+// Pure C++ (no Arduino), so it also builds on the host for profiling.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sparkline.h"
+
+// ===================== GEOMETRY =====================
+// Physical panel (portrait) and logical canvas (landscape, 90° clockwise)
+static const int PANEL_W = 184;
+static const int PANEL_H = 360;
+static const int ROW_BYTES = (PANEL_W % 4 == 0) ? (PANEL_W / 4) : (PANEL_W / 4 + 1);
+static const int FRAME_BYTES = ROW_BYTES * PANEL_H;
+
+static const int CANVAS_W = PANEL_H;   // 360
+static const int CANVAS_H = PANEL_W;   // 184
+
+// Waveshare 2.66G color codes (same values as epd2in66g.h)
+static const uint8_t C_BLACK  = 0x0;
+static const uint8_t C_WHITE  = 0x1;
+static const uint8_t C_YELLOW = 0x2;
+static const uint8_t C_RED    = 0x3;
+
+// Frame buffer in panel RAM order
+extern uint8_t img[FRAME_BYTES];
+
+// Draw into another FRAME_BYTES buffer from now on (nullptr = img).
+void canvas_set_target(uint8_t* target);
+
+// ===================== PRIMITIVES =====================
+void fill(uint8_t c);
+void rect_l(int x, int y, int w, int h, uint8_t c);
+void hline_l(int x, int y, int w, uint8_t c);
+void vline_l(int x, int y, int h, uint8_t c);
+void border_l(uint8_t c);
+
+void draw_char_5x7_l(int x, int y, char ch, int scale, uint8_t c);
+int text_width_5x7(const char* s, int scale, int spacing);
+void draw_text_5x7_l(int x, int y, const char* s, int scale, int spacing, uint8_t c);
+
+void draw_digit7seg_l(int x, int y, int s, int d, uint8_t c);
+void draw_degC_icon_l(int x, int y, uint8_t fg, uint8_t bg);
+
+enum ArrowDir : uint8_t { ARROW_NONE=0, ARROW_UP=1, ARROW_DOWN=2, ARROW_UP_FAST=3, ARROW_DOWN_FAST=4 };
+
+void draw_arrow_up_l(int x, int y, int size, uint8_t c);
+void draw_arrow_down_l(int x, int y, int size, uint8_t c);
+
+// ===================== SCREEN =====================
+struct Theme { uint8_t header_bg; uint8_t header_fg; };
+
+// Header turns yellow above WARM, red above HOT (°C)
+static const int THEME_WARM_ABOVE = 36;
+static const int THEME_HOT_ABOVE = 41;
+
+Theme theme_for_temp(int t);
+
+// Small labelled value in the left column (tank, outdoor, setpoint, ...);
+// label uses the 5x7 font (A-Z subset, digits, '-').
+struct SideValue {
+  const char* label;
+  int value;
+  bool valid;   // false shows "--"
+};
+
+// Renders the whole screen into the target buffer. batteryPct < 0 hides
+// the battery icon; header_bg_override != 255 replaces the theme header
+// color; a non-empty spark adds the 24 h graph under the digits; side lists
+// up to 3 secondary values for the left column.
+void draw_screen_frame(int tempC, int batteryPct, ArrowDir dir, uint8_t header_bg_override = 255,
+                       const SparkState* spark = nullptr, const SideValue* side = nullptr,
+                       int side_count = 0);
+
+// Keep the static part of the screen (everything but the digits, sparkline,
+// side values, arrow and battery) per header color pair and copy it in
+// instead of drawing it. Off by default; the output is identical.
+static const int CANVAS_BG_SLOTS = 2;
+static const int CANVAS_BG_MAX_ROWS = 64;   // distinct panel rows per layer
+
+struct CanvasCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t bytes;   // held by the cached layers
+};
+
+void canvas_set_layer_cache(bool on);
+const CanvasCacheStats& canvas_cache_stats();
+
+// ===================== DISPLAY LIST =====================
+// The screen as the ops that draw it, recorded instead of rasterized. Two
+// lists compare without touching pixels: equal hashes mean equal frames,
+// and the ops one has and the other lacks bound the area that changed.
+static const int DL_MAX_OPS = 64;   // the full screen is ~50
+static const int DL_MAX_BOXES = 16;
+
+enum DrawOpKind : uint8_t { OP_FILL = 0, OP_RECT, OP_GLYPH, OP_DIGIT, OP_TRIANGLE, OP_SPARK };
+
+struct CanvasRect { int16_t x, y, w, h; };
+
+struct DrawOp {
+  uint8_t kind;
+  uint8_t color;
+  uint8_t arg;       // glyph: char; digit: value; triangle: 1 = apex down
+  uint8_t scale;     // glyph scale, digit segment, triangle size
+  CanvasRect box;    // everything the op can touch, logical coords
+  uint32_t data;     // sparkline: hash of its spans
+#ifdef CANVAS_PROFILE
+  const char* site;
+#endif
+};
+
+struct DisplayList {
+  uint16_t count;
+  uint16_t static_count;   // leading ops that make the static layer
+  uint8_t bg_key;          // its header color pair (background cache)
+  bool overflow;           // ops were dropped: draw_screen_frame() instead
+  DrawOp ops[DL_MAX_OPS];
+  SparkSpans spark;        // what the OP_SPARK op draws
+};
+
+// Records what draw_screen_frame() would draw with the same arguments.
+void build_screen_list(DisplayList& dl, int tempC, int batteryPct, ArrowDir dir,
+                       uint8_t header_bg_override = 255, const SparkState* spark = nullptr,
+                       const SideValue* side = nullptr, int side_count = 0);
+
+// Rasterizes dl into the target buffer, only inside clip if given. Ops
+// outside the clip or entirely under a later opaque rect are skipped.
+void draw_list(const DisplayList& dl, const CanvasRect* clip = nullptr);
+
+uint32_t list_hash(const DisplayList& dl);
+
+struct ListDiff {
+  int changed;        // ops in one list without an equal op in the other
+  int box_count;      // boxes used; 0 with changed > 0: too many, see bounds
+  CanvasRect boxes[DL_MAX_BOXES];
+  CanvasRect bounds;  // union of the changed ops' boxes
+};
+
+// A changed sparkline adds boxes around the runs of columns whose span
+// changed rather than its whole strip. false if either list overflowed
+// (no usable diff).
+bool list_diff(const DisplayList& prev, const DisplayList& cur, ListDiff& out);
+
+// Brings a target holding prev's frame to cur's by redrawing only the
+// changed boxes. Returns the changed op count, -1 if it drew everything.
+int canvas_repaint(const DisplayList& prev, const DisplayList& cur);
+
+struct CanvasListStats {
+  uint32_t drawn;      // ops rasterized
+  uint32_t clipped;    // skipped, outside the clip
+  uint32_t occluded;   // skipped, under a later opaque rect
+};
+
+const CanvasListStats& canvas_list_stats();
+
+// ===================== PROFILING (host only) =====================
+// With -D CANVAS_PROFILE every pixel write is attributed to the innermost
+// CANVAS_SITE() scope; see tools/render_profile.
+#ifdef CANVAS_PROFILE
+static const int CANVAS_PROFILE_MAX_SITES = 32;
+
+struct CanvasSiteStats {
+  const char* name;
+  uint32_t calls;
+  uint32_t writes;       // pixel writes issued
+  uint32_t unchanged;    // writes that stored the color already there
+  uint32_t overdrawn;    // writes later overwritten in the same frame
+};
+
+struct CanvasProfile {
+  CanvasSiteStats sites[CANVAS_PROFILE_MAX_SITES];
+  int site_count;
+  uint16_t writes[CANVAS_W * CANVAS_H];   // per logical pixel
+  uint8_t last_site[CANVAS_W * CANVAS_H]; // 0xFF = not written this frame
+};
+
+extern CanvasProfile canvas_profile;
+
+void canvas_profile_reset();
+void canvas_profile_enter(const char* site);
+void canvas_profile_leave();
+const char* canvas_profile_site();                // innermost scope, for recorded ops
+void canvas_profile_raster_site(const char* site);   // attribute writes to site (nullptr: scopes)
+
+struct CanvasSiteScope {
+  explicit CanvasSiteScope(const char* site) { canvas_profile_enter(site); }
+  ~CanvasSiteScope() { canvas_profile_leave(); }
+};
+#define CANVAS_SITE_CAT2(a, b) a##b
+#define CANVAS_SITE_CAT(a, b) CANVAS_SITE_CAT2(a, b)
+#define CANVAS_SITE(name) CanvasSiteScope CANVAS_SITE_CAT(canvas_site_, __LINE__)(name)
+#else
+#define CANVAS_SITE(name) do {} while (0)
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+// Short critical section around a few words shared between tasks.
+//
+// On the ESP32 this is a portMUX spinlock (both cores, interrupts masked
+// while held), so keep the section to a handful of loads and stores. Host
+// builds (tools/) get a std::mutex with the same interface, so modules that
+// use it can be tested with real threads.
+//
+//   static CritSection mux;
+//   { CritLock lock(mux); ...shared state... }
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+struct CritSection {
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  void enter() { portENTER_CRITICAL(&mux); }
+  void exit() { portEXIT_CRITICAL(&mux); }
+};
+#else
+#include <mutex>
+
+struct CritSection {
+  std::mutex mux;
+  void enter() { mux.lock(); }
+  void exit() { mux.unlock(); }
+};
+#endif
+
+struct CritLock {
+  CritSection& cs;
+  explicit CritLock(CritSection& c) : cs(c) { cs.enter(); }
+  ~CritLock() { cs.exit(); }
+  CritLock(const CritLock&) = delete;
+  CritLock& operator=(const CritLock&) = delete;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+// Payload decoders that work in place on the MQTT byte span: no copy, no
+// heap, no NUL terminator needed.
+//
+// Numbers are returned as fixed-point tenths (42.75 -> 428, rounded half
+// away from zero) so decimal sensor values keep one digit without floats.
+// Home Assistant's "unknown" / "unavailable" / "None" / "null" / "nan"
+// states decode as invalid.
+//
+// Pure C++ (no Arduino).
+
+#include <stdint.h>
+
+// Single pass over the span: true for the non-value states above.
+bool decode_is_sentinel(const uint8_t* p, unsigned int len);
+
+// Leading number, like strtol but with decimals and exponent:
+// "42", "-3.5", "4.25e1", " 42 " ... Trailing text after the number is
+// ignored. False if there is no digit or the value is out of range.
+bool decode_tenths(const uint8_t* p, unsigned int len, int32_t& tenths);
+
+// Plain integer (a decimal payload is accepted and rounded).
+bool decode_int(const uint8_t* p, unsigned int len, int& out);
+
+// Streaming JSON object-key path: "$.temperature", "$.attributes.temp"
+// ("$." is optional). Sets value/value_len to the raw member value (string
+// contents without quotes). Array indexing is not supported.
+bool decode_json_path(const uint8_t* p, unsigned int len, const char* path,
+                      const uint8_t*& value, unsigned int& value_len);
+
+// Number at a JSON path (number or numeric string), as tenths.
+bool decode_json_tenths(const uint8_t* p, unsigned int len, const char* path, int32_t& tenths);
+
+// Number in a CBOR item: the item itself when path is empty/null, otherwise
+// the member at a map key path (same syntax as JSON). Integers, half/single/
+// double floats and tags are handled; indefinite-length items are not.
+bool decode_cbor_tenths(const uint8_t* p, unsigned int len, const char* path, int32_t& tenths);
+
+// Route decoders (see topic_router.h): whole units, arg is the JSON/CBOR
+// path and ignored for plain numbers.
+bool decode_number_route(const uint8_t* p, unsigned int len, const char* arg, int& out);
+bool decode_json_route(const uint8_t* p, unsigned int len, const char* arg, int& out);
+bool decode_cbor_route(const uint8_t* p, unsigned int len, const char* arg, int& out);
+
+// Tenths -> whole units, rounded half away from zero.
+static inline int tenths_round(int32_t tenths) {
+  return (tenths >= 0) ? (int)((tenths + 5) / 10) : -(int)((-tenths + 5) / 10);
+}
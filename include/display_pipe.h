@@ -0,0 +1,60 @@
+#pragma once
+
+// Hand-off between the tasks that produce frames (render, network for
+// remote frames) and the display task, which alone talks to the panel.
+//
+// Frame buffers move by ownership: a producer takes a free buffer from the
+// pool (blocking while all of them are queued or on the wire, which is the
+// backpressure), fills it and submits it; the display task sends it to the
+// panel and returns it to the pool as soon as the SPI transfer is done,
+// before the multi-second refresh, so the next frame can be drawn while the
+// panel is still busy. Streamed frames travel as small data blocks through
+// the same bounded queue, so ordering is kept.
+
+#include <stdint.h>
+
+static const int DISPLAY_MAX_BUFFERS = 2;
+static const int DISPLAY_BLOCK_BYTES = 64;
+
+enum DisplayOp : uint8_t {
+  DISP_FRAME = 0,      // send fb
+  DISP_STREAM_BEGIN,   // power up, start a frame RAM write
+  DISP_STREAM_DATA,    // next len bytes of it in data
+  DISP_STREAM_END,     // refresh and power down
+  DISP_STREAM_ABORT,   // power down without refreshing
+  DISP_POWER_UP,       // power up ahead of the first frame
+  DISP_POWER_DOWN,     // power down if still up (nothing was shown)
+};
+
+enum DisplayFlags : uint8_t {
+  DISP_INIT = 0x01,      // power up + reset first, unless still powered
+  DISP_CLEAR = 0x02,     // full white refresh before the frame
+  DISP_SLEEP = 0x04,     // power down afterwards (last frame of an update)
+  DISP_RELEASE = 0x08,   // return fb to the pool after sending it
+};
+
+struct DisplayJob {
+  uint8_t op;
+  uint8_t flags;
+  uint16_t delay_ms;     // wait before sending (transition effect)
+  uint16_t len;
+  uint32_t hash;         // frame_hash() of the frame (FRAME, STREAM_END), 0 = unknown
+  uint32_t list;         // display list hash it was drawn from (FRAME), 0 = none
+  uint8_t* fb;
+  uint8_t data[DISPLAY_BLOCK_BYTES];
+};
+
+// buffers: the pool (all free); depth: queued jobs before submit blocks.
+bool display_pipe_begin(uint8_t* const* buffers, int count, int depth);
+
+// Producer side. acquire blocks up to timeout_ms for a free buffer.
+uint8_t* display_acquire(uint32_t timeout_ms);
+void display_release(uint8_t* fb);
+bool display_submit(const DisplayJob& job, uint32_t timeout_ms);
+
+// Display task side: next job, and display_done() once it is handled.
+bool display_next(DisplayJob& job, uint32_t timeout_ms);
+void display_done();
+
+// Nothing queued or being shown.
+bool display_idle();
@@ -0,0 +1,50 @@
+#pragma once
+
+// Append-only reading log in the "history" flash partition
+// (see partitions.csv), for history that survives power loss.
+//
+// The partition is used as a ring of 4 KB sectors (the erase unit). Each
+// sector starts with a header carrying a sequence number, followed by
+// fixed-size 8-byte records (time, value, CRC16). Sectors are filled and
+// erased strictly in order, so every sector sees the same number of erase
+// cycles (wear levelling) and the oldest sector is dropped when the ring
+// wraps.
+//
+// Crash consistency: a record is a single 8-byte write. A write cut short
+// by a reset leaves a slot that is neither erased nor CRC-valid; it is
+// skipped on read and appending continues after it. A sector whose header
+// is invalid (reset during erase) ends the chain and is erased again.
+//
+// Mounting reads the sector headers and binary-searches the head sector
+// for its first erased slot; time seeks binary-search the sectors by their
+// first record and then the records within one sector, O(log n) reads.
+//
+// Record times must not go backwards; after a clock restart the log shifts
+// new times to continue after its newest record.
+
+#include <stdint.h>
+
+struct FlogSample {
+  uint32_t t_s;
+  int16_t value;
+};
+
+struct FlogCursor {
+  uint16_t sector;   // logical index, 0 = oldest
+  uint16_t slot;
+};
+
+// Finds and mounts the partition. Returns false if it is missing.
+bool flog_begin();
+
+bool flog_append(uint32_t t_s, int value);
+
+// Positions the cursor at the first record with time >= t_s.
+void flog_seek(FlogCursor& c, uint32_t t_s);
+bool flog_next(FlogCursor& c, FlogSample& out);
+
+// Time of the newest record in log time (0 if empty).
+uint32_t flog_last_time();
+uint32_t flog_record_count();
+uint32_t flog_sector_count();
+uint32_t flog_erase_cycles();   // sector erases since the partition was new
@@ -0,0 +1,20 @@
+#pragma once
+
+// The raw partition access the reading log (flash_log.cpp) needs. On the
+// ESP32 these map to esp_partition_* (src/flash_part.cpp); host tools link
+// a RAM partition with NOR flash behaviour and power-cut injection instead
+// (tools/host/flash_part_ram.cpp).
+//
+// Offsets are relative to the partition. Erase works on whole 4 KB
+// sectors and sets every bit; a write can only clear bits.
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Finds the data partition by label and subtype. Returns its size in
+// bytes, 0 if there is none. The other calls act on the partition found.
+uint32_t flash_part_open(const char* label, uint8_t subtype);
+
+bool flash_part_read(uint32_t off, void* buf, size_t len);
+bool flash_part_write(uint32_t off, const void* buf, size_t len);
+bool flash_part_erase(uint32_t off, size_t len);
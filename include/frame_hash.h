@@ -0,0 +1,26 @@
+#pragma once
+
+// xxHash32 of frame buffer contents, to tell whether a frame would change
+// what the panel shows. Fast enough to run over every frame (a few
+// hundred microseconds for 16.5 KB on the ESP32); not for anything that
+// needs collision resistance.
+//
+// Streaming use (frames that arrive in pieces): init, update with the
+// bytes in order, final. Pure C++ (no Arduino).
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct FrameHash {
+  uint32_t v[4];       // lane accumulators
+  uint32_t total;      // bytes seen
+  uint8_t buf[16];     // partial stripe
+  uint8_t buf_len;
+};
+
+void frame_hash_init(FrameHash& h, uint32_t seed = 0);
+void frame_hash_update(FrameHash& h, const uint8_t* p, size_t n);
+uint32_t frame_hash_final(const FrameHash& h);
+
+// One-shot; same result as the streaming calls over the same bytes.
+uint32_t frame_hash(const uint8_t* p, size_t n, uint32_t seed = 0);
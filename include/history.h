@@ -0,0 +1,87 @@
+#pragma once
+
+// Compressed time series of readings for RTC memory.
+//
+// Samples go into a ring of fixed-size blocks. Each block header holds the
+// first sample and running min/max/sum/count; the following samples are
+// stored Gorilla-style as zigzag varints of the delta-of-delta of the
+// timestamp and the delta of the value. A reading every 15 minutes that
+// changes by a degree or less costs about 2 bytes, 2.4 with the block
+// headers, so the default 20 x 128-byte blocks (~3 KB) hold about 12 days
+// (tools/history_bench). When all blocks are full the oldest one is
+// dropped.
+//
+// Window queries use the block headers for blocks that lie entirely inside
+// the window and decode only the (at most two) blocks cut by its edges.
+//
+// Pure C++ with the store passed in; the firmware keeps it in RTC memory.
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const int HISTORY_BLOCKS = 20;
+static const int HISTORY_BLOCK_BYTES = 128;
+
+struct HistoryBlock {
+  uint32_t t0;          // first sample
+  uint32_t t_last;
+  int32_t last_dt;      // previous time delta (for the delta-of-delta)
+  int32_t sum;
+  int16_t v0;
+  int16_t v_last;
+  int16_t vmin;
+  int16_t vmax;
+  uint16_t count;
+  uint16_t used;        // bytes of data[] in use
+  uint8_t data[HISTORY_BLOCK_BYTES];
+};
+
+struct HistoryStore {
+  uint32_t magic;
+  uint8_t head;         // block being appended to
+  uint8_t blocks_used;
+  HistoryBlock blocks[HISTORY_BLOCKS];
+};
+
+struct HistoryStats {
+  uint32_t count;
+  int16_t min;
+  int16_t max;
+  int32_t sum;
+};
+
+struct HistorySample {
+  uint32_t t_s;
+  int16_t value;
+};
+
+void history_init(HistoryStore& h);
+void history_reset(HistoryStore& h);
+
+// Appends a reading. A timestamp older than the newest sample (clock
+// restarted) clears the store first.
+void history_append(HistoryStore& h, uint32_t t_s, int value);
+
+uint32_t history_count(const HistoryStore& h);
+size_t history_bytes_used(const HistoryStore& h);   // encoded bytes incl. headers
+bool history_newest(const HistoryStore& h, HistorySample& out);
+
+// min/max/sum/count over samples with from_s <= t <= to_s.
+HistoryStats history_query(const HistoryStore& h, uint32_t from_s, uint32_t to_s);
+
+// Streams samples oldest first without decoding into a buffer:
+//   HistoryReader r; history_reader_begin(r, store, from_s);
+//   while (history_reader_next(r, s)) ...
+struct HistoryReader {
+  const HistoryStore* h;
+  uint8_t block;        // blocks visited so far (0 = oldest)
+  uint16_t pos;         // byte offset in the current block
+  uint16_t index;       // sample index in the current block
+  uint32_t from_s;
+  uint32_t t;
+  int32_t dt;
+  int16_t v;
+};
+
+void history_reader_begin(HistoryReader& r, const HistoryStore& h, uint32_t from_s);
+bool history_reader_next(HistoryReader& r, HistorySample& out);
@@ -0,0 +1,118 @@
+#pragma once
+
+// Leveled, deferred logging.
+//
+// LOGE/LOGW/LOGI/LOGD calls above LOG_LEVEL compile to nothing (arguments
+// are not evaluated, but still type-checked and counted as used). Enabled calls only push a small binary
+// record (format-string address + raw args) into a RAM ring buffer; the text
+// is produced later by log_drain()/log_flush(), so hot paths never wait on
+// the 115200 baud UART.
+//
+// Supported conversions: %d %i %u %x %X %o %c %s %f %e %g %p %% (flags,
+// width/precision and l/h/z modifiers are accepted). Floating point
+// arguments are stored as 32-bit floats. A %s argument is stored as a
+// pointer, so it must still be valid when the record is drained: use
+// literals or static buffers, never String::c_str() of a temporary.
+//
+// Any task may log; draining is serialized (one consumer at a time).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class Print;
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+static const int LOG_MAX_ARGS = 4;
+static const int LOG_RING_SIZE = 64;   // records, power of two
+
+typedef uintptr_t log_arg_t;
+
+struct LogRecord {
+  uint32_t ms;
+  const char* fmt;        // literal in flash; its address is the format id
+  uint8_t level;
+  uint8_t nargs;
+  log_arg_t args[LOG_MAX_ARGS];
+};
+
+// Raw push; use the LOGx macros instead.
+void log_push(uint8_t level, const char* fmt, const log_arg_t* args, uint8_t nargs);
+
+// Format and print up to max_records pending records. Stops early when the
+// next line does not fit the UART TX buffer (Serial.availableForWrite(),
+// so size it with Serial.setTxBufferSize()) so an idle-time drain never
+// blocks, and returns 0
+// at once if another task is draining. Returns the number of records
+// written.
+int log_drain(Print& out, int max_records = LOG_RING_SIZE);
+
+// Drain everything with blocking writes and wait for the UART (call before
+// deep sleep).
+void log_flush();
+
+// Records waiting to be drained.
+int log_pending();
+
+#ifdef LOG_BENCHMARK
+// Prints per-call cost of compiled-out, deferred and synchronous logging.
+void log_benchmark(Print& out);
+#endif
+
+// ---- argument packing ----
+static inline log_arg_t log_arg(int v)           { return (log_arg_t)(intptr_t)v; }
+static inline log_arg_t log_arg(long v)          { return (log_arg_t)(intptr_t)v; }
+static inline log_arg_t log_arg(unsigned v)      { return (log_arg_t)v; }
+static inline log_arg_t log_arg(unsigned long v) { return (log_arg_t)v; }
+static inline log_arg_t log_arg(const char* s)   { return (log_arg_t)s; }
+static inline log_arg_t log_arg(const void* p)   { return (log_arg_t)p; }
+static inline log_arg_t log_arg(double v) {
+  float f = (float)v;
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return (log_arg_t)bits;
+}
+
+static inline void log_write(uint8_t level, const char* fmt) {
+  log_push(level, fmt, nullptr, 0);
+}
+
+template <typename... A>
+static inline void log_write(uint8_t level, const char* fmt, A... a) {
+  static_assert(sizeof...(A) <= LOG_MAX_ARGS, "too many log arguments");
+  const log_arg_t args[] = { log_arg(a)... };
+  log_push(level, fmt, args, (uint8_t)sizeof...(A));
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(...) log_write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOGE(...) do { if (0) log_write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(...) log_write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOGW(...) do { if (0) log_write(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(...) log_write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOGI(...) do { if (0) log_write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(...) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOGD(...) do { if (0) log_write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
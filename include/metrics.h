@@ -0,0 +1,133 @@
+#pragma once
+
+// Fixed-memory metrics: counters, gauges and log2-bucketed histograms.
+//
+// Everything lives in one statically allocated struct in RTC slow memory,
+// so values accumulate across deep sleep (they reset on power loss or when
+// the layout version changes). Updates are unlocked read-modify-writes, so
+// each metric must have a single writer: one task owns every update of a
+// given counter, gauge or histogram (different metrics may be owned by
+// different tasks). Other tasks may read any metric; they can see a value
+// that is one update behind, and a histogram's count, sum and buckets are
+// not read as one snapshot.
+// metrics_to_json() renders the whole registry for one batched publish.
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum MetricCounter : uint8_t {
+  M_WAKES = 0,
+  M_WIFI_CONNECTS,
+  M_MQTT_CONNECTS,
+  M_MQTT_CONNECT_FAILS,
+  M_MSGS_RECEIVED,
+  M_PAYLOAD_INVALID,
+  M_VALUE_UNCHANGED,
+  M_REFRESHES,
+  M_BUSY_WAIT_MS_TOTAL,
+  M_WIFI_FAST_FALLBACKS,   // cached BSSID/IP reconnect failed, full scan used
+  M_UPDATES_COALESCED,     // values replaced before they were rendered
+  M_REFRESH_BYPASSES,      // threshold crossings shown inside the min interval
+  M_FILTER_HELD,           // changes held back by deadband or hysteresis
+  M_REMOTE_FRAMES,         // server-rendered frames shown
+  M_REMOTE_FRAME_ERRORS,   // remote frames dropped (bad base, CRC, ...)
+  M_REMOTE_FRAME_RESENDS,  // chunk gaps recovered by asking for a resend
+  M_SPEC_HITS,             // refreshes served from pre-rendered frames
+  M_SPEC_MISSES,           // ...that had pre-rendered frames but none matched
+  M_REFRESH_SAME,          // refreshes skipped: the panel already shows the frame
+  M_METRICS_DROPPED,       // metrics publishes skipped: JSON did not fit
+  M_COUNTER_COUNT
+};
+
+enum MetricGauge : uint8_t {
+  M_HEAP_MIN = 0,      // lowest free heap seen (bytes)
+  M_LAST_TEMP,
+  M_BATTERY_PCT,
+  M_SLEEP_S,           // interval chosen for the current/last deep sleep
+  M_RFRAME_HEAP_PEAK,  // heap used on top of the start level during the last remote frame
+  M_SPEC_HIT_PCT,      // spec_hits / (spec_hits + spec_misses), %
+  M_REFRESH_SKIP_PCT,  // refresh_same / (refresh_same + refreshes), %
+  M_GAUGE_COUNT
+};
+
+enum MetricHist : uint8_t {
+  M_H_BUSY_WAIT_MS = 0,
+  M_H_REFRESH_MS,
+  M_H_AWAKE_MS,
+  M_H_CONNECT_CACHED_MS,   // boot -> MQTT session, cached WiFi parameters
+  M_H_CONNECT_FULL_MS,     // boot -> MQTT session, full scan + DHCP
+  M_H_RETAINED_LATENCY_MS, // SUBSCRIBE -> retained value handled
+  M_H_WAKE_PIXEL_MS,       // boot -> refresh of the first frame triggered
+  M_HIST_COUNT
+};
+
+// bucket 0 holds 0, bucket i holds [2^(i-1), 2^i), the last one is open-ended
+static const int METRIC_HIST_BUCKETS = 16;
+
+struct MetricHistogram {
+  uint32_t count;
+  uint32_t sum;
+  uint32_t buckets[METRIC_HIST_BUCKETS];
+};
+
+struct MetricsStore {
+  uint32_t magic;
+  uint32_t counters[M_COUNTER_COUNT];
+  int32_t gauges[M_GAUGE_COUNT];
+  MetricHistogram hists[M_HIST_COUNT];
+};
+
+extern MetricsStore metrics_store;
+
+// Call once per boot/wake; clears the store if it is not valid.
+void metrics_init();
+void metrics_reset();
+
+static inline int metric_bucket(uint32_t v) {
+  int b = (v == 0) ? 0 : 32 - __builtin_clz(v);
+  return (b < METRIC_HIST_BUCKETS) ? b : METRIC_HIST_BUCKETS - 1;
+}
+
+// Inclusive lower bound of a bucket (for labels / host-side decoding).
+static inline uint32_t metric_bucket_floor(int b) {
+  return (b == 0) ? 0 : (1UL << (b - 1));
+}
+
+static inline void metric_inc(MetricCounter c, uint32_t n = 1) {
+  metrics_store.counters[c] += n;
+}
+
+static inline void metric_set(MetricGauge g, int32_t v) {
+  metrics_store.gauges[g] = v;
+}
+
+// Gauge keeps the lowest non-zero value ever set.
+static inline void metric_set_min(MetricGauge g, int32_t v) {
+  int32_t& cur = metrics_store.gauges[g];
+  if (cur == 0 || v < cur) cur = v;
+}
+
+static inline void metric_observe(MetricHist h, uint32_t v) {
+  MetricHistogram& m = metrics_store.hists[h];
+  m.count++;
+  m.sum += v;
+  m.buckets[metric_bucket(v)]++;
+}
+
+// Serializes the registry as compact JSON:
+// {"c":{name:n,...},"g":{name:v,...},"h":{name:{"n":..,"sum":..,"b":[..]}}}
+// Trailing empty buckets are omitted. Returns the length, or 0 if cap is
+// too small.
+size_t metrics_to_json(char* buf, size_t cap);
+
+// Longest metric name (checked at compile time in metrics.cpp) and the
+// longest JSON any store can produce, terminator included: a buffer of
+// METRICS_JSON_MAX never makes metrics_to_json() fail.
+static const size_t METRIC_NAME_MAX = 24;
+static const size_t METRICS_JSON_MAX =
+  sizeof("{\"c\":{},\"g\":{},\"h\":{}}") +
+  M_COUNTER_COUNT * sizeof(",\"\":4294967295") +
+  M_GAUGE_COUNT * sizeof(",\"\":-2147483648") +
+  M_HIST_COUNT * (sizeof(",\"\":{\"n\":4294967295,\"sum\":4294967295,\"b\":[]}") +
+                  METRIC_HIST_BUCKETS * sizeof("4294967295")) +
+  (M_COUNTER_COUNT + M_GAUGE_COUNT + M_HIST_COUNT) * METRIC_NAME_MAX;
@@ -0,0 +1,82 @@
+#pragma once
+
+// Non-blocking WiFi + MQTT connection manager, driven by net_poll() from
+// the network task.
+//
+// "Link up" (WiFi associated, IP assigned) and "session up" (MQTT CONNACK
+// received) are tracked separately. Failed attempts back off exponentially
+// with jitter. When a per-wake time budget is set and the session is not up
+// within it, the manager gives up so the caller can deep-sleep instead of
+// keeping the radio on against a dead AP or broker.
+//
+// After a successful connect the AP BSSID/channel, the IP configuration and
+// the resolved broker address are cached in RTC memory. The next wake from
+// deep sleep joins that AP directly (no scan, no DNS) and falls back to a
+// full scan + DHCP if that fails. The DHCP address is reused without asking
+// the server again only for lease_reuse_s after it was handed out; past
+// that the join runs DHCP, so the device renews its lease like any other
+// client instead of holding an address the server may have given away.
+
+#include <stdint.h>
+
+class PubSubClient;
+
+enum NetState : uint8_t {
+  NET_IDLE = 0,
+  NET_WIFI_CONNECTING,   // WiFi.begin() issued, waiting for an IP
+  NET_WIFI_BACKOFF,      // association failed, waiting before retry
+  NET_LINK_UP,           // WiFi up, MQTT connect due
+  NET_MQTT_BACKOFF,      // broker refused/unreachable, waiting before retry
+  NET_SESSION_UP,        // MQTT connected
+  NET_GAVE_UP            // wake budget exhausted
+};
+
+struct NetConfig {
+  const char* ssid;
+  const char* pass;
+  const char* mqtt_host;
+  uint16_t mqtt_port;
+  const char* mqtt_user;      // empty = anonymous
+  const char* mqtt_pass;
+
+  uint32_t wifi_attempt_ms;   // give up on one association attempt after this
+  uint32_t backoff_min_ms;    // first retry delay
+  uint32_t backoff_max_ms;    // retry delay cap
+  uint32_t wake_budget_ms;    // 0 = retry forever
+
+  bool fast_reconnect;        // use the RTC-cached BSSID/channel/IP
+  uint32_t fast_attempt_ms;   // fall back to a full scan after this
+  uint32_t lease_reuse_s;     // reuse a DHCP address this long (0 = never);
+                              // keep it well below the router's lease time
+  uint32_t (*now_s)();        // caller's clock in seconds, kept across deep
+                              // sleep (lease age); null = no lease reuse
+
+  // Optional static IP (0 = DHCP, or reuse of a recent cached lease)
+  uint32_t static_ip;
+  uint32_t static_gateway;
+  uint32_t static_subnet;
+  uint32_t static_dns;
+
+  // Called every time the MQTT session comes up (subscribe here).
+  void (*on_session_up)();
+};
+
+void net_begin(const NetConfig& cfg, PubSubClient& mqtt);
+
+// Advances the state machine; never blocks longer than one connect attempt.
+void net_poll();
+
+NetState net_state();
+const char* net_state_name(NetState s);
+bool net_link_up();
+bool net_session_up();
+bool net_gave_up();
+
+// Milliseconds since net_begin().
+uint32_t net_elapsed_ms();
+
+// True if the current/last association used the RTC-cached parameters.
+bool net_used_cache();
+
+// Drops the RTC cache (e.g. after changing networks).
+void net_forget_cache();
@@ -0,0 +1,108 @@
+#pragma once
+
+// Remote framebuffer: frames rendered on a server (tools/rframe.py) arrive
+// as a sequence of MQTT chunk messages, already in panel RAM order (2bpp,
+// rotated), and are decoded incrementally, either into a frame buffer or
+// through a sink straight into the panel's RAM (no full image in memory).
+//
+// Chunk message (little endian):
+//   0  'R' 'F'
+//   2  u8  version (RFRAME_VERSION)
+//   3  u8  flags (RFRAME_DELTA)
+//   4  u16 frame id
+//   6  u16 chunk index
+//   8  u16 chunk count
+//  10  u32 base crc    delta frames: CRC-32 of the frame they apply to
+//  14  u32 frame crc   CRC-32 of the complete decoded frame
+//  18  ..  slice of the compressed stream
+//
+// The compressed stream is PackBits-style: a control byte n < 128 is
+// followed by n + 1 literal bytes, n >= 128 by one byte repeated n - 126
+// times. Key frames carry the frame itself; delta frames carry it XORed
+// with the base frame, so unchanged areas are long runs of zeros (frame
+// buffer only). Chunks may split the stream anywhere, so each fits
+// PubSubClient's default 256-byte packet.
+//
+// The chunk index is the sequence number. The decoder only ever advances
+// by the next expected chunk, so a gap leaves its state intact: the caller
+// asks the sender to resend from rx.next_chunk (RFRAME_NEED_RESEND) and the
+// transfer resumes. Duplicates and chunks still in flight behind the gap
+// are ignored; the last chunk reports the gap again, so a lost resend is
+// recovered when the sender repeats its last chunk. A frame whose first
+// chunk is lost is asked for from chunk 0 when any later chunk of it
+// arrives. The CRC-32 is accumulated while decoding and checked after the
+// last chunk.
+//
+// Pure C++ (no Arduino), state passed in.
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const uint8_t RFRAME_VERSION = 1;
+static const int RFRAME_HEADER_BYTES = 18;
+
+enum RFrameFlags : uint8_t { RFRAME_DELTA = 0x01 };
+
+enum RFrameResult : uint8_t {
+  RFRAME_CHUNK_OK = 0,   // accepted, more to come
+  RFRAME_COMPLETE,       // last chunk accepted and the CRC matches
+  RFRAME_IGNORED,        // duplicate, or behind an already reported gap
+  RFRAME_NEED_RESEND,    // gap: ask for chunks from rx.next_chunk on
+  RFRAME_BAD_HEADER,     // not a chunk, wrong version or size
+  RFRAME_OUT_OF_ORDER,   // chunk count differs from the frame's (dropped)
+  RFRAME_BAD_BASE,       // delta against a frame we do not hold
+  RFRAME_CORRUPT,        // stream decodes past the end of the frame
+  RFRAME_BAD_CRC,        // complete, but the result does not match
+};
+
+// Receives decoded bytes in frame order when there is no frame buffer.
+struct RFrameSink {
+  void (*start)();                             // a new frame begins
+  void (*write)(const uint8_t* p, size_t n);
+};
+
+static const int RFRAME_STAGE_BYTES = 64;
+
+struct RFrameRx {
+  uint8_t* fb;           // nullptr: decoded bytes go to sink
+  RFrameSink sink;
+  size_t fb_len;         // frame size in both modes
+  uint32_t fb_crc;       // CRC of what fb holds, 0 = unknown / partial
+
+  bool active;
+  uint8_t flags;
+  uint16_t frame_id;
+  uint16_t next_chunk;
+  uint16_t chunk_count;
+  uint16_t nack_index;   // chunk that triggered the last resend request
+  uint32_t frame_crc;
+
+  // decoder position, kept across chunks
+  size_t out_pos;
+  uint32_t crc;          // running CRC of the decoded bytes
+  uint8_t dec_state;
+  uint8_t dec_count;
+
+  // sink mode: decoded bytes not yet handed to sink.write
+  uint8_t stage[RFRAME_STAGE_BYTES];
+  uint8_t stage_len;
+};
+
+// fb must stay alive; its content is unknown until the first key frame.
+void rframe_begin(RFrameRx& rx, uint8_t* fb, size_t fb_len);
+
+// Without a frame buffer: bytes are passed to sink as they are decoded.
+// Delta frames are rejected (RFRAME_BAD_BASE) since there is no base.
+void rframe_begin_sink(RFrameRx& rx, const RFrameSink& sink, size_t frame_len);
+
+// Feeds one chunk message. CHUNK_OK, IGNORED and NEED_RESEND keep the
+// transfer going; anything else ends it. After an error the frame buffer
+// (or panel RAM) may be partly written, and fb_crc is 0. BAD_BASE leaves
+// fb_crc as it was: the caller reports it so the sender can fall back to a
+// key frame.
+RFrameResult rframe_chunk(RFrameRx& rx, const uint8_t* msg, unsigned int len);
+
+const char* rframe_result_name(RFrameResult r);
+
+// CRC-32 (IEEE, as zlib.crc32); pass the previous value to continue.
+uint32_t rframe_crc32(const uint8_t* p, size_t n, uint32_t crc = 0);
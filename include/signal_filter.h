@@ -0,0 +1,59 @@
+#pragma once
+
+// Signal conditioning between a received reading and a panel refresh.
+//
+//   raw -> median of the last N (outlier rejection) -> optional EWMA
+//       -> deadband decision against the shown value
+//
+// Hysteresis only holds the screen theme (header color), never the
+// number: the theme is picked from a value of its own, which follows the
+// shown one except while it sits within the band around a threshold.
+//
+// Pure C++ with the state passed in, so the firmware can keep it in RTC
+// memory and tools/filter_replay can run several policies side by side.
+
+#include <stdint.h>
+
+static const int FILTER_MAX_MEDIAN = 7;
+
+struct FilterConfig {
+  uint8_t median_n;         // 1 = off, odd, up to FILTER_MAX_MEDIAN
+  uint8_t ewma_alpha_x16;   // weight of a new sample in 1/16, 0 or 16 = off
+  int deadband;             // minimum |change| worth a refresh (1 = any change)
+  int hysteresis;           // the theme only changes this far past its threshold
+  int thresholds[4];        // value > threshold changes the screen theme
+  uint8_t threshold_count;
+};
+
+struct FilterState {
+  uint32_t magic;
+  int16_t window[FILTER_MAX_MEDIAN];
+  uint8_t count;
+  uint8_t head;
+  bool ewma_valid;
+  int32_t ewma_x16;
+};
+
+// Clears the state unless it carries the current magic.
+void filter_init(FilterState& st);
+void filter_reset(FilterState& st);
+
+// Feeds one raw reading, returns the conditioned value.
+int filter_input(const FilterConfig& cfg, FilterState& st, int raw);
+
+enum FilterVerdict : uint8_t {
+  FILTER_SHOW = 0,
+  FILTER_SAME,              // equal to the shown value
+  FILTER_HELD_DEADBAND      // change smaller than the deadband
+};
+
+// "Nothing shown yet" (same sentinel as the firmware's rtc_lastDisplayed).
+static const int FILTER_NO_VALUE = -9999;
+
+// The value the theme is picked from once v is shown, given the current
+// one (theme): v, unless v crosses a threshold without clearing the band.
+int filter_theme(const FilterConfig& cfg, int v, int theme);
+
+// Whether the conditioned value v should replace shown on the panel.
+// A change of theme is always shown, whatever the deadband.
+FilterVerdict filter_decide(const FilterConfig& cfg, int v, int shown, int theme);
@@ -0,0 +1,57 @@
+#pragma once
+
+// Adaptive deep-sleep interval.
+//
+// Keeps a short history of readings and wake outcomes in RTC memory and
+// picks the next sleep from the observed rate of change: roughly the time
+// until the shown integer would change, shortened when a theme threshold is
+// about to be crossed, lengthened after unchanged or failed wakes, and
+// clamped to [min_s, max_s]. A flat trend says nothing about when heating
+// starts, so every sleep is also capped by the time the fastest expected
+// change needs to reach the nearest threshold.
+//
+// There is no RTC wall clock, so the scheduler keeps its own: every
+// sched_end_wake() adds the awake time and the sleep it returns to it.
+// With adaptive off the returned sleep is always default_s, so the clock
+// still moves by the sleep that is actually programmed.
+
+#include <stdint.h>
+
+enum WakeOutcome : uint8_t {
+  WAKE_NO_MESSAGE = 0,   // connected, but no value arrived
+  WAKE_NET_FAILED,       // never got an MQTT session
+  WAKE_INVALID,          // payload could not be parsed
+  WAKE_UNCHANGED,        // value arrived, display already showed it
+  WAKE_REFRESHED         // value changed and the panel was refreshed
+};
+
+struct SleepSchedConfig {
+  bool adaptive;         // false: always sleep default_s
+  uint32_t default_s;    // used until two readings are known
+  uint32_t min_s;
+  uint32_t max_s;
+  int thresholds[4];     // values where the screen changes theme
+  uint8_t threshold_count;
+  uint16_t max_rate_x10_per_h;   // fastest change expected (°C/h x10): no sleep
+                                 // is longer than reaching the nearest threshold
+                                 // at this rate takes, whatever the trend; 0 = off
+};
+
+static const int SCHED_HISTORY = 8;
+
+void sched_begin(const SleepSchedConfig& cfg);
+
+// Forgets the history and restarts the clock at zero.
+void sched_reset();
+
+// Closes this wake: records the outcome (value is ignored unless the
+// outcome carries one) and returns the seconds to sleep.
+uint32_t sched_end_wake(WakeOutcome outcome, int value);
+
+// Scheduler clock (seconds, continues across deep sleep). Counts time
+// since boot with the 64-bit esp_timer, so it does not wrap with millis()
+// when the device stays awake for weeks.
+uint32_t sched_now_s();
+
+// Observed rate in °C per hour x10 (0 with too little history).
+int32_t sched_rate_x10_per_h();
@@ -0,0 +1,57 @@
+#pragma once
+
+// Sparkline of the last 24 h for the canvas.
+//
+// Samples are binned into one column per pixel; each column keeps only its
+// min/max (1 byte each), so adding a sample touches a single column and
+// time advancing shifts the columns left by whole columns. Drawing walks
+// the column cache, never the sample history. The state is small enough to
+// keep in RTC memory, so the graph survives deep sleep.
+//
+// What the graph draws is one vertical span per column (SparkSpans). A
+// display list keeps the spans, so a repaint redraws only the columns whose
+// span changed: one column while samples land in the newest column, every
+// column whose neighbour differs when the graph scrolls or rescales.
+//
+// Pure C++ (no Arduino), builds on the host with the rest of the canvas.
+
+#include <stdint.h>
+
+static const int SPARK_W = 344;            // columns = pixels
+static const int SPARK_H = 16;
+static const uint32_t SPARK_SPAN_S = 24UL * 3600UL;
+static const uint32_t SPARK_COL_S = SPARK_SPAN_S / SPARK_W;
+
+static const uint8_t SPARK_EMPTY = 0xFF;   // column has no sample
+
+struct SparkState {
+  uint32_t magic;
+  uint32_t right_col;                      // absolute column (t / SPARK_COL_S) at the right edge
+  uint8_t cmin[SPARK_W];                   // values clamped to 0..254
+  uint8_t cmax[SPARK_W];
+};
+
+void spark_init(SparkState& sp);
+void spark_reset(SparkState& sp);
+
+// O(1) for a sample in the current column, O(shift) when time advanced.
+void spark_add(SparkState& sp, uint32_t t_s, int value);
+
+bool spark_empty(const SparkState& sp);
+
+// Rows from the top of the graph drawn in each column; top < 0: none.
+struct SparkSpans {
+  int8_t top[SPARK_W];
+  int8_t bot[SPARK_W];
+};
+
+// The value range is fitted to the data (at least 4 °C); empty columns
+// between two samples get the rows of a straight line between them.
+void spark_spans(const SparkState& sp, SparkSpans& out);
+
+// Rasterizes columns from..to-1 of the spans into img at logical (x, y).
+void draw_spark_spans_l(int x, int y, const SparkSpans& s, uint8_t c, int from = 0,
+                        int to = SPARK_W);
+
+// spark_spans() and draw_spark_spans_l() of every column.
+void draw_sparkline_l(int x, int y, const SparkState& sp, uint8_t c);
@@ -0,0 +1,46 @@
+#pragma once
+
+// Compressed cache of frames rendered ahead of time.
+//
+// While a wake waits for the network, the render task draws the frames the
+// next value will most likely need and stores them here, PackBits
+// compressed, in a fixed pool. Each frame is filed under a key that covers
+// every input of the drawing (value, arrow, battery, header color, side
+// values, sparkline), so a lookup can only hit when the frame would come
+// out identical. A frame close to another one (the white-header transition
+// frame vs. the final one) is stored as the PackBits-compressed XOR
+// against it, which is usually a few hundred bytes.
+//
+// Which values to pre-render is spec_guesses(); tools/spec_replay replays
+// a temperature trace to see how often one of them is the frame needed.
+//
+// Pure C++ (no Arduino).
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const size_t SPEC_POOL_BYTES = 16384;
+static const int SPEC_MAX_SLOTS = 12;
+static const int SPEC_MAX_GUESSES = 5;
+
+void spec_reset();
+
+// Compresses frame (frame_len bytes) into the pool under key; with base,
+// as the XOR against that frame, which must already be stored under
+// base_key. False if the pool or the slot table is full.
+bool spec_put(uint32_t key, const uint8_t* frame, size_t frame_len,
+              const uint8_t* base = nullptr, uint32_t base_key = 0);
+
+// Decodes the frame stored under key into frame (its base first, for a
+// delta). False on a miss.
+bool spec_get(uint32_t key, uint8_t* frame, size_t frame_len);
+
+// The next reading most likely received, most likely first: last +1, -1,
+// 0 (only the arrow changes), +2, -2, mirrored when falling. last is the
+// raw reading; each guess goes through the filter like a real one, since
+// the trend and sparkline record it unfiltered. Fills out and returns the
+// count.
+int spec_guesses(int last, bool falling, int* out);
+
+int spec_count();
+size_t spec_bytes_used();
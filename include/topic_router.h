@@ -0,0 +1,41 @@
+#pragma once
+
+// MQTT topic routing table.
+//
+// Each route maps a topic filter (MQTT syntax, '+' and '#' wildcards) to a
+// payload decoder and a handler with a display slot. router_begin() builds
+// a trie over the filter levels in a fixed node pool (no heap); dispatch
+// walks the topic once, comparing each level against the children of the
+// current node, so the cost is O(topic length) plus one extra branch per
+// '+' wildcard on the path.
+//
+// The route table itself must stay alive (filters are not copied).
+
+#include <stdint.h>
+
+// arg is the route's decode_arg (e.g. a JSON path)
+typedef bool (*TopicDecoder)(const uint8_t* payload, unsigned int len, const char* arg, int& out);
+typedef void (*TopicHandler)(uint8_t slot, bool valid, int value);
+
+struct TopicRoute {
+  const char* filter;
+  uint8_t slot;
+  TopicDecoder decode;
+  const char* decode_arg;
+  TopicHandler handle;
+};
+
+static const int ROUTER_MAX_NODES = 48;
+static const int ROUTER_MAX_ROUTES = 16;
+
+// Returns false if the table does not fit the node pool or a filter is
+// malformed ('#' not last, wildcard mixed with text in one level).
+bool router_begin(const TopicRoute* routes, int count);
+
+// Decodes the payload once per matching route and calls its handler.
+// Returns the number of routes that matched.
+int router_dispatch(const char* topic, const uint8_t* payload, unsigned int len);
+
+// Route i of the table passed to router_begin() (for subscribing).
+const TopicRoute* router_route(int i);
+int router_route_count();
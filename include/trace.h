@@ -0,0 +1,80 @@
+#pragma once
+
+// Begin/end span recorder for the wake cycle.
+//
+// Events are 12-byte binary records (µs timestamp, span id, phase, core)
+// in a lock-free ring in ordinary DRAM: any core/task may record, the ring
+// keeps its content across light sleep (esp_timer keeps counting), and the
+// oldest events are overwritten when it wraps. Dump it as text over Serial
+// or as one binary MQTT message; tools/trace2chrome.py turns either into
+// Chrome/Perfetto trace JSON.
+//
+// TRACE_ENABLED=0 compiles every TRACE_* macro away.
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Print;
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+enum TraceId : uint8_t {
+  TR_WIFI_CONNECT = 0,
+  TR_MQTT_CONNECT,
+  TR_SUBSCRIBE,
+  TR_MSG,
+  TR_RENDER,
+  TR_SPI,
+  TR_BUSY,
+  TR_SLEEP,
+  TR_COUNT
+};
+
+enum TracePhase : uint8_t { TRACE_PH_BEGIN = 'B', TRACE_PH_END = 'E', TRACE_PH_INSTANT = 'I' };
+
+static const int TRACE_RING_SIZE = 256;   // events, power of two
+
+struct TraceEvent {
+  uint32_t ts_us;   // esp_timer_get_time(), low 32 bits (host unwraps)
+  uint32_t seq;     // index + 1 once the slot is fully written
+  uint8_t id;
+  uint8_t phase;
+  uint8_t core;
+  uint8_t reserved;
+};
+
+void trace_record(uint8_t id, uint8_t phase);
+const char* trace_name(uint8_t id);
+
+// Text dump: "#TRACE ..." header, one "<ts_us> <core> <B|E|I> <name>" line
+// per event, "#TRACE end".
+void trace_dump(Print& out);
+
+// Binary dump ("TRC1" header, name table, packed events). size() is exact,
+// so it can be streamed with PubSubClient::beginPublish().
+size_t trace_binary_size();
+void trace_write_binary(Print& out);
+
+// Forget everything recorded so far.
+void trace_reset();
+
+#if TRACE_ENABLED
+struct TraceSpan {
+  uint8_t id;
+  explicit TraceSpan(uint8_t i) : id(i) { trace_record(id, TRACE_PH_BEGIN); }
+  ~TraceSpan() { trace_record(id, TRACE_PH_END); }
+};
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+#define TRACE_SPAN(id)    TraceSpan TRACE_CAT(trace_span_, __LINE__)(id)
+#define TRACE_BEGIN(id)   trace_record((id), TRACE_PH_BEGIN)
+#define TRACE_END(id)     trace_record((id), TRACE_PH_END)
+#define TRACE_INSTANT(id) trace_record((id), TRACE_PH_INSTANT)
+#else
+#define TRACE_SPAN(id)    do {} while (0)
+#define TRACE_BEGIN(id)   do {} while (0)
+#define TRACE_END(id)     do {} while (0)
+#define TRACE_INSTANT(id) do {} while (0)
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+// Trend of the reading from a least-squares fit over the last
+// TREND_CAPACITY timestamped samples.
+//
+// The ring keeps running integer sums (n, Σt, Σv, Σt², Σtv, Σv²), so adding
+// a sample (and evicting the oldest) is O(1). The arrow only changes when
+// the fitted slope is statistically meaningful: it has to differ from zero
+// by more than min_t_stat standard errors. A trend whose confidence band
+// lies within ±steady_x10_per_h counts as steady (no arrow).
+//
+// Pure C++ with the state passed in; the firmware keeps it in RTC memory.
+
+#include <stdint.h>
+
+#include "canvas.h"
+
+static const int TREND_CAPACITY = 16;
+
+struct TrendConfig {
+  uint16_t steady_x10_per_h;   // |slope| below this (°C/h x10) is "steady"
+  uint16_t fast_x10_per_h;     // |slope| above this shows the fast arrow, 0 = off
+  uint8_t min_t_stat_x10;      // required |slope| / stderr, x10 (20 = 2.0)
+  uint8_t min_samples;         // no verdict with fewer samples (>= 3)
+};
+
+struct TrendSample {
+  uint32_t t_s;
+  int16_t value;
+};
+
+struct TrendState {
+  uint32_t magic;
+  uint32_t base_s;             // sample times are stored relative to this
+  TrendSample ring[TREND_CAPACITY];
+  uint8_t count;
+  uint8_t head;                // next slot
+  // running sums over the samples in the ring (times relative to base_s)
+  int64_t st, sv, stt, stv, svv;
+};
+
+void trend_init(TrendState& st);
+void trend_reset(TrendState& st);
+
+// Adds a sample; restarts the fit if time went backwards (e.g. power loss
+// reset the clock).
+void trend_add(TrendState& st, uint32_t t_s, int value);
+
+// Value of the newest sample; false when there is none.
+bool trend_last(const TrendState& st, int& value);
+
+// Fitted slope in °C/h x10 and its standard error (both 0 with < 3 samples).
+void trend_slope(const TrendState& st, int32_t& slope_x10_per_h, int32_t& stderr_x10_per_h);
+
+// Arrow for the current fit; returns prev when the data do not support a
+// change either way.
+ArrowDir trend_arrow(const TrendConfig& cfg, const TrendState& st, ArrowDir prev);
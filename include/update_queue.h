@@ -0,0 +1,40 @@
+#pragma once
+
+// Latest-value slot between the MQTT callback and the display.
+//
+// The callback only posts the parsed value; it never renders. The render
+// task takes the newest value once it is free, so a burst
+// of messages collapses into one refresh showing the last value instead of
+// a queue of stale multi-second refreshes. Refreshes are spaced at least
+// min_interval_ms apart unless the new value crosses one of the thresholds
+// (theme change), which is shown right away.
+
+#include <stdint.h>
+
+struct UpdateQueueConfig {
+  uint32_t min_interval_ms;   // 0 = no rate limit
+  int thresholds[4];          // value > threshold changes the screen theme
+  uint8_t threshold_count;
+};
+
+void update_queue_begin(const UpdateQueueConfig& cfg);
+
+// Callback side: replaces any value not yet rendered.
+void update_post(int value);
+
+// A posted value is waiting (rendered or dropped by update_take()).
+bool update_pending();
+
+// Update stage: returns true and the newest value when it should be applied
+// now. shown is the value currently on the panel (or a value no threshold
+// can match before the first refresh).
+bool update_take(uint32_t now_ms, int shown, int& out);
+
+// True if a refresh now would respect the minimum interval.
+bool update_due(uint32_t now_ms);
+
+// Milliseconds until update_due() becomes true (0 = now).
+uint32_t update_wait_ms(uint32_t now_ms);
+
+// Call after the panel has been refreshed.
+void update_refreshed(uint32_t now_ms);
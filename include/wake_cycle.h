@@ -0,0 +1,42 @@
+#pragma once
+
+// Deep-sleep wake cycle bookkeeping.
+//
+// With a retained topic the broker delivers the current value right after
+// SUBSCRIBE, so a wake only has to wait for that one message. The wait is
+// bounded by an adaptive timeout learned from the observed
+// subscribe -> message latency (EWMA kept in RTC memory) instead of a
+// fixed 15 s.
+
+#include <stdint.h>
+
+struct WakeCycleConfig {
+  uint32_t min_timeout_ms;       // never wait less than this
+  uint32_t max_timeout_ms;       // ... nor more (also used before any sample)
+  uint32_t margin_ms;            // added on top of the scaled latency
+  uint8_t latency_multiplier;    // timeout = latency * k + margin
+};
+
+void wake_cycle_begin(const WakeCycleConfig& cfg);
+
+// Forgets the learned latency (the next wait is max_timeout_ms).
+void wake_cycle_reset();
+
+// SUBSCRIBE sent for the retained topic (first session of this wake).
+void wake_cycle_subscribed(uint32_t now_ms);
+
+// First message on the retained topic has been handled.
+void wake_cycle_message(uint32_t now_ms);
+
+bool wake_cycle_subscribed_yet();
+bool wake_cycle_got_message();
+
+// Current wait budget after SUBSCRIBE.
+uint32_t wake_cycle_timeout_ms();
+
+// True once the timeout has passed without a message. Records the miss so
+// the next wake waits longer.
+bool wake_cycle_timed_out(uint32_t now_ms);
+
+// Smoothed subscribe -> message latency, 0 before the first sample.
+uint32_t wake_cycle_latency_ms();
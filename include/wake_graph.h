@@ -0,0 +1,37 @@
+#pragma once
+
+// Stage timestamps for the path from reset to the first refreshed pixel.
+//
+// Panel power-up, battery sampling and the WiFi/MQTT connect do not depend
+// on each other, so they all start at boot; a stage that needs their
+// results (drawing needs the value and the battery level, the refresh
+// needs the frame and a powered panel) waits for them. Every stage records
+// when it started and ended, in ms since boot. When the first frame's
+// refresh is triggered, the critical path is recovered by walking back
+// from it through whichever dependency finished last, and logged next to
+// the sum of all stage durations (what a strictly serial wake would take).
+
+#include <stdint.h>
+
+enum WakeStage : uint8_t {
+  WS_PANEL = 0,   // panel power cycle, reset, POWER_ON
+  WS_BATTERY,     // ADC sampling
+  WS_WIFI,        // associated, IP assigned
+  WS_MQTT,        // session up
+  WS_MESSAGE,     // first value (or complete remote frame) handled
+  WS_RENDER,      // first frame drawn and queued
+  WS_PIXEL,       // first frame sent, refresh triggered
+  WS_COUNT
+};
+
+// Only the first start/end of a stage counts. Each stage is marked from
+// one task only.
+void wake_stage_start(WakeStage s);
+// Returns true for the call that ended the stage.
+bool wake_stage_end(WakeStage s);
+bool wake_stage_done(WakeStage s);
+
+// Logs the critical path to WS_PIXEL and records the wake_pixel_ms metric.
+void wake_graph_report();
+
+const char* wake_stage_name(WakeStage s);
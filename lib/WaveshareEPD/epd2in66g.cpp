@@ -1,6 +1,9 @@
 #include <stdlib.h>
 #include "epd2in66g.h"
 #include "epdif.h"
+#include "log.h"
+#include "trace.h"
+#include "metrics.h"
 
 Epd::~Epd() {}
 
@@ -9,6 +12,7 @@ Epd::Epd() {
     dc_pin = DC_PIN;
     cs_pin = CS_PIN;
     busy_pin = BUSY_PIN;
+    streaming = false;
     WIDTH = EPD_WIDTH;
     HEIGHT = EPD_HEIGHT;
 }
@@ -102,19 +106,29 @@ void Epd::SendData(unsigned char data) {
 }
 
 void Epd::ReadBusyH(void) {
-    Serial.print("e-Paper busy H\r\n ");
+    TRACE_SPAN(TR_BUSY);
+    LOGD("e-Paper busy H");
+    unsigned long start = millis();
     while (DigitalRead(busy_pin) == LOW) { // LOW busy, HIGH idle
         DelayMs(5);
     }
-    Serial.print("e-Paper busy release H\r\n ");
+    unsigned long waited = millis() - start;
+    metric_inc(M_BUSY_WAIT_MS_TOTAL, waited);
+    metric_observe(M_H_BUSY_WAIT_MS, waited);
+    LOGD("e-Paper busy release H (%lu ms)", waited);
 }
 
 void Epd::ReadBusyL(void) {
-    Serial.print("e-Paper busy L\r\n ");
+    TRACE_SPAN(TR_BUSY);
+    LOGD("e-Paper busy L");
+    unsigned long start = millis();
     while (DigitalRead(busy_pin) == HIGH) { // HIGH busy, LOW idle
         DelayMs(5);
     }
-    Serial.print("e-Paper busy release L\r\n ");
+    unsigned long waited = millis() - start;
+    metric_inc(M_BUSY_WAIT_MS_TOTAL, waited);
+    metric_observe(M_H_BUSY_WAIT_MS, waited);
+    LOGD("e-Paper busy release L (%lu ms)", waited);
 }
 
 void Epd::Reset(void) {
@@ -137,11 +151,13 @@ void Epd::Clear(UBYTE color) {
     UWORD Height = HEIGHT;
 
     SendCommand(0x10);
+    TRACE_BEGIN(TR_SPI);
     for (UWORD j = 0; j < Height; j++) {
         for (UWORD i = 0; i < Width; i++) {
             SendData((color << 6) | (color << 4) | (color << 2) | color);
         }
     }
+    TRACE_END(TR_SPI);
     TurnOnDisplay();
 }
 
@@ -150,11 +166,13 @@ void Epd::Display(UBYTE *Image) {
     UWORD Height = HEIGHT;
 
     SendCommand(0x10);
+    TRACE_BEGIN(TR_SPI);
     for (UWORD j = 0; j < Height; j++) {
         for (UWORD i = 0; i < Width; i++) {
             SendData(Image[i + j * Width]); // RAM buffer on ESP32
         }
     }
+    TRACE_END(TR_SPI);
     TurnOnDisplay();
 }
 
@@ -175,7 +193,27 @@ void Epd::Display_part(UBYTE *Image, UWORD xstart, UWORD ystart, UWORD image_wid
     TurnOnDisplay();
 }
 
+void Epd::StreamBegin(void) {
+    SendCommand(0x10);
+    TRACE_BEGIN(TR_SPI);
+    streaming = true;
+}
+
+void Epd::StreamWrite(const UBYTE *data, UDOUBLE len) {
+    for (UDOUBLE i = 0; i < len; i++) {
+        SendData(data[i]);
+    }
+}
+
+void Epd::StreamEnd(void) {
+    if (streaming) TRACE_END(TR_SPI);
+    streaming = false;
+    TurnOnDisplay();
+}
+
 void Epd::Sleep(void) {
+    if (streaming) TRACE_END(TR_SPI);
+    streaming = false;
     // POWER_OFF only (safe). Panel will be re-woken by PWR toggle in Init().
     SendCommand(0x02); // POWER_OFF
     SendData(0x00);
@@ -60,6 +60,12 @@ public:
     void Clear(UBYTE color);
     void Display(UBYTE *Image);
     void Display_part(UBYTE *Image, UWORD xstart, UWORD ystart, UWORD image_width, UWORD image_height);
+    // Frame RAM written in pieces (same byte order as Display), for data
+    // that is never held in RAM as a whole. Traced as one TR_SPI span from
+    // StreamBegin to StreamEnd (or Sleep, if the stream is abandoned).
+    void StreamBegin(void);
+    void StreamWrite(const UBYTE *data, UDOUBLE len);
+    void StreamEnd(void);
     void Sleep(void);
 
 private:
@@ -67,6 +73,7 @@ private:
     unsigned int dc_pin;
     unsigned int cs_pin;
     unsigned int busy_pin;
+    bool streaming;
 };
 
 #endif /* EPD4IN37_H */
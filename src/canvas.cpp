@@ -0,0 +1,908 @@
+#include <string.h>
+
+#include "canvas.h"
+#include "sparkline.h"
+#include "trace.h"
+
+uint8_t img[FRAME_BYTES];
+
+// buffer the primitives draw into
+static uint8_t* fb = img;
+
+void canvas_set_target(uint8_t* target) {
+  fb = target ? target : img;
+}
+
+#ifdef CANVAS_PROFILE
+static void canvas_profile_px(int lx, int ly, uint8_t old_c, uint8_t new_c);
+#endif
+
+// ===================== RECORDING =====================
+// While rec is set the primitives append ops to it instead of drawing;
+// while drawing, rect writes stay inside clip_box.
+static DisplayList* rec = nullptr;
+static const CanvasRect FULL_CANVAS = { 0, 0, CANVAS_W, CANVAS_H };
+static CanvasRect clip_box = FULL_CANVAS;
+
+static bool record(uint8_t kind, uint8_t color, uint8_t arg, uint8_t scale, int x, int y, int w,
+                   int h, uint32_t data = 0) {
+  if (!rec) return false;
+  if (rec->count == DL_MAX_OPS) {
+    rec->overflow = true;
+    return true;
+  }
+  DrawOp& op = rec->ops[rec->count++];
+  op.kind = kind;
+  op.color = color;
+  op.arg = arg;
+  op.scale = scale;
+  op.box.x = (int16_t)x;
+  op.box.y = (int16_t)y;
+  op.box.w = (int16_t)w;
+  op.box.h = (int16_t)h;
+  op.data = data;
+#ifdef CANVAS_PROFILE
+  op.site = canvas_profile_site();
+#endif
+  return true;
+}
+
+static uint32_t fnv1a(const void* p, size_t n, uint32_t h = 2166136261u) {
+  const uint8_t* b = (const uint8_t*)p;
+  for (size_t i = 0; i < n; i++) h = (h ^ b[i]) * 16777619u;
+  return h;
+}
+
+static uint32_t spans_hash(const SparkSpans& s) {
+  return fnv1a(s.bot, sizeof(s.bot), fnv1a(s.top, sizeof(s.top)));
+}
+
+// ===================== LANDSCAPE COORD SYSTEM =====================
+// Logical landscape coordinates: 360x184
+// Mapping: 90° clockwise => physical x=LY, physical y=H-1-LX
+// put_px_l: (lx, ly) known to be on the canvas
+static inline void put_px_l(int lx, int ly, uint8_t c) {
+  int x = ly;
+  int y = PANEL_H - 1 - lx;
+  int byteIndex = y * ROW_BYTES + (x / 4);
+  int shift = (3 - (x % 4)) * 2;
+#ifdef CANVAS_PROFILE
+  canvas_profile_px(lx, ly, (fb[byteIndex] >> shift) & 0x3, c & 0x3);
+#endif
+  fb[byteIndex] =
+    (fb[byteIndex] & ~(0x3 << shift)) | ((c & 0x3) << shift);
+}
+
+static inline void set_px_l(int lx, int ly, uint8_t c) {
+  if (lx < 0 || lx >= CANVAS_W || ly < 0 || ly >= CANVAS_H) return;
+  put_px_l(lx, ly, c);
+}
+
+void fill(uint8_t c) {
+  if (record(OP_FILL, c, 0, 0, 0, 0, CANVAS_W, CANVAS_H)) return;
+  if (clip_box.w != CANVAS_W || clip_box.h != CANVAS_H) {
+    rect_l(clip_box.x, clip_box.y, clip_box.w, clip_box.h, c);
+    return;
+  }
+#ifdef CANVAS_PROFILE
+  for (int ly = 0; ly < CANVAS_H; ly++)
+    for (int lx = 0; lx < CANVAS_W; lx++)
+      set_px_l(lx, ly, c);
+#endif
+  uint8_t v =
+    ((c & 0x3) << 6) |
+    ((c & 0x3) << 4) |
+    ((c & 0x3) << 2) |
+    (c & 0x3);
+  memset(fb, v, FRAME_BYTES);
+}
+
+void rect_l(int x, int y, int w, int h, uint8_t c) {
+  if (record(OP_RECT, c, 0, 0, x, y, w, h)) return;
+  int x0 = x > clip_box.x ? x : clip_box.x;
+  int y0 = y > clip_box.y ? y : clip_box.y;
+  int x1 = (x + w < clip_box.x + clip_box.w) ? x + w : clip_box.x + clip_box.w;
+  int y1 = (y + h < clip_box.y + clip_box.h) ? y + h : clip_box.y + clip_box.h;
+  for (int yy = y0; yy < y1; yy++)
+    for (int xx = x0; xx < x1; xx++)
+      put_px_l(xx, yy, c);
+}
+
+void hline_l(int x, int y, int w, uint8_t c) { rect_l(x, y, w, 1, c); }
+void vline_l(int x, int y, int h, uint8_t c) { rect_l(x, y, 1, h, c); }
+
+void border_l(uint8_t c) {
+  hline_l(0, 0, CANVAS_W, c);
+  hline_l(0, CANVAS_H - 1, CANVAS_W, c);
+  vline_l(0, 0, CANVAS_H, c);
+  vline_l(CANVAS_W - 1, 0, CANVAS_H, c);
+}
+
+// ===================== SIMPLE 5x7 BLOCK FONT =====================
+void draw_char_5x7_l(int x, int y, char ch, int scale, uint8_t c) {
+  if (record(OP_GLYPH, c, (uint8_t)ch, (uint8_t)scale, x, y, 5*scale, 7*scale)) return;
+  const uint8_t* rows = nullptr;
+
+  static const uint8_t B_[7] = {0b11110,0b10001,0b10001,0b11110,0b10001,0b10001,0b11110};
+  static const uint8_t O_[7] = {0b01110,0b10001,0b10001,0b10001,0b10001,0b10001,0b01110};
+  static const uint8_t I_[7] = {0b11111,0b00100,0b00100,0b00100,0b00100,0b00100,0b11111};
+  static const uint8_t L_[7] = {0b10000,0b10000,0b10000,0b10000,0b10000,0b10000,0b11111};
+  static const uint8_t E_[7] = {0b11111,0b10000,0b10000,0b11110,0b10000,0b10000,0b11111};
+  static const uint8_t R_[7] = {0b11110,0b10001,0b10001,0b11110,0b10100,0b10010,0b10001};
+  static const uint8_t T_[7] = {0b11111,0b00100,0b00100,0b00100,0b00100,0b00100,0b00100};
+  static const uint8_t M_[7] = {0b10001,0b11011,0b10101,0b10101,0b10001,0b10001,0b10001};
+  static const uint8_t P_[7] = {0b11110,0b10001,0b10001,0b11110,0b10000,0b10000,0b10000};
+  static const uint8_t A_[7] = {0b01110,0b10001,0b10001,0b11111,0b10001,0b10001,0b10001};
+  static const uint8_t C_[7] = {0b01111,0b10000,0b10000,0b10000,0b10000,0b10000,0b01111};
+  static const uint8_t N_[7] = {0b10001,0b11001,0b10101,0b10011,0b10001,0b10001,0b10001};
+  static const uint8_t K_[7] = {0b10001,0b10010,0b10100,0b11000,0b10100,0b10010,0b10001};
+  static const uint8_t U_[7] = {0b10001,0b10001,0b10001,0b10001,0b10001,0b10001,0b01110};
+  static const uint8_t S_[7] = {0b01111,0b10000,0b10000,0b01110,0b00001,0b00001,0b11110};
+  static const uint8_t DASH[7] = {0,0,0,0b11111,0,0,0};
+  static const uint8_t D0[7] = {0b01110,0b10001,0b10011,0b10101,0b11001,0b10001,0b01110};
+  static const uint8_t D1[7] = {0b00100,0b01100,0b00100,0b00100,0b00100,0b00100,0b01110};
+  static const uint8_t D2[7] = {0b01110,0b10001,0b00001,0b00010,0b00100,0b01000,0b11111};
+  static const uint8_t D3[7] = {0b11111,0b00010,0b00100,0b00010,0b00001,0b10001,0b01110};
+  static const uint8_t D4[7] = {0b00010,0b00110,0b01010,0b10010,0b11111,0b00010,0b00010};
+  static const uint8_t D5[7] = {0b11111,0b10000,0b11110,0b00001,0b00001,0b10001,0b01110};
+  static const uint8_t D6[7] = {0b00110,0b01000,0b10000,0b11110,0b10001,0b10001,0b01110};
+  static const uint8_t D7[7] = {0b11111,0b00001,0b00010,0b00100,0b01000,0b01000,0b01000};
+  static const uint8_t D8[7] = {0b01110,0b10001,0b10001,0b01110,0b10001,0b10001,0b01110};
+  static const uint8_t D9[7] = {0b01110,0b10001,0b10001,0b01111,0b00001,0b00010,0b01100};
+  static const uint8_t* const DIGITS[10] = {D0, D1, D2, D3, D4, D5, D6, D7, D8, D9};
+  static const uint8_t SPC[7] = {0,0,0,0,0,0,0};
+
+  switch (ch) {
+    case 'B': rows = B_; break;
+    case 'O': rows = O_; break;
+    case 'I': rows = I_; break;
+    case 'L': rows = L_; break;
+    case 'E': rows = E_; break;
+    case 'R': rows = R_; break;
+    case 'T': rows = T_; break;
+    case 'M': rows = M_; break;
+    case 'P': rows = P_; break;
+    case 'A': rows = A_; break;
+    case 'C': rows = C_; break;
+    case 'N': rows = N_; break;
+    case 'K': rows = K_; break;
+    case 'U': rows = U_; break;
+    case 'S': rows = S_; break;
+    case '-': rows = DASH; break;
+    default: rows = (ch >= '0' && ch <= '9') ? DIGITS[ch - '0'] : SPC; break;
+  }
+
+  for (int ry = 0; ry < 7; ry++) {
+    uint8_t bits = rows[ry];
+    for (int rx = 0; rx < 5; rx++) {
+      if (bits & (1 << (4 - rx))) {
+        rect_l(x + rx*scale, y + ry*scale, scale, scale, c);
+      }
+    }
+  }
+}
+
+int text_width_5x7(const char* s, int scale, int spacing) {
+  int n = (int)strlen(s);
+  if (n == 0) return 0;
+  return n * (5*scale + spacing) - spacing;
+}
+
+void draw_text_5x7_l(int x, int y, const char* s, int scale, int spacing, uint8_t c) {
+  int cx = x;
+  for (const char* p = s; *p; p++) {
+    draw_char_5x7_l(cx, y, *p, scale, c);
+    cx += (5*scale + spacing);
+  }
+}
+
+// ===================== 7-SEG DIGITS =====================
+void draw_digit7seg_l(int x, int y, int s, int d, uint8_t c) {
+  if (record(OP_DIGIT, c, (uint8_t)d, (uint8_t)s, x, y, 6*s, 10*s)) return;
+  bool seg[7] = {0};
+  switch (d) {
+    case 0: seg[0]=seg[1]=seg[2]=seg[3]=seg[4]=seg[5]=1; break;
+    case 1: seg[1]=seg[2]=1; break;
+    case 2: seg[0]=seg[1]=seg[6]=seg[4]=seg[3]=1; break;
+    case 3: seg[0]=seg[1]=seg[6]=seg[2]=seg[3]=1; break;
+    case 4: seg[5]=seg[6]=seg[1]=seg[2]=1; break;
+    case 5: seg[0]=seg[5]=seg[6]=seg[2]=seg[3]=1; break;
+    case 6: seg[0]=seg[5]=seg[6]=seg[2]=seg[3]=seg[4]=1; break;
+    case 7: seg[0]=seg[1]=seg[2]=1; break;
+    case 8: for (int i=0;i<7;i++) seg[i]=1; break;
+    case 9: seg[0]=seg[1]=seg[2]=seg[3]=seg[5]=seg[6]=1; break;
+    default: break;
+  }
+
+  int t = s;
+  int w = 6*s;
+  int h = 10*s;
+
+  if (seg[0]) rect_l(x + t, y, w - 2*t, t, c);
+  if (seg[1]) rect_l(x + w - t, y + t, t, (h/2) - t, c);
+  if (seg[2]) rect_l(x + w - t, y + h/2, t, (h/2) - t, c);
+  if (seg[3]) rect_l(x + t, y + h - t, w - 2*t, t, c);
+  if (seg[4]) rect_l(x, y + h/2, t, (h/2) - t, c);
+  if (seg[5]) rect_l(x, y + t, t, (h/2) - t, c);
+  if (seg[6]) rect_l(x + t, y + (h/2) - (t/2), w - 2*t, t, c);
+}
+
+void draw_degC_icon_l(int x, int y, uint8_t fg, uint8_t bg) {
+  // degree box
+  rect_l(x,     y,     6, 6, fg);
+  rect_l(x + 2, y + 2, 2, 2, bg);
+
+  // "C" block
+  int cx = x + 10;
+  int cy = y + 2;
+  rect_l(cx, cy,     14, 3, fg);
+  rect_l(cx, cy,      3, 16, fg);
+  rect_l(cx, cy + 13, 14, 3, fg);
+}
+
+// ===================== ARROWS =====================
+// Filled triangle, size rows tall, centered on x from row y down; the apex
+// is the top row, or the bottom one if down.
+static void triangle_l(int x, int y, int size, bool down, uint8_t c) {
+  if (record(OP_TRIANGLE, c, down, (uint8_t)size, x - (size - 1), y, 2*size - 1, size)) return;
+  for (int r = 0; r < size; r++) {
+    int w = 1 + 2*r;
+    int start = x - r;
+    rect_l(start, down ? y + (size - 1 - r) : y + r, w, 1, c);
+  }
+}
+
+// Small triangle arrow (filled) in logical landscape coords
+void draw_arrow_up_l(int x, int y, int size, uint8_t c) {
+  // apex at top center
+  triangle_l(x, y, size, false, c);
+  // small stem
+  rect_l(x - 1, y + size, 3, size + 2, c);
+}
+
+void draw_arrow_down_l(int x, int y, int size, uint8_t c) {
+  // apex at bottom center
+  triangle_l(x, y, size, true, c);
+  // small stem above
+  rect_l(x - 1, y - (size + 2), 3, size + 2, c);
+}
+
+// ===================== THEME BY TEMP =====================
+Theme theme_for_temp(int t) {
+  // your existing rule
+  if (t > THEME_HOT_ABOVE) return Theme{C_RED, C_WHITE};
+  if (t > THEME_WARM_ABOVE && t <= THEME_HOT_ABOVE) return Theme{C_YELLOW, C_BLACK};
+  // requested: low temp header black w/ white text
+  return Theme{C_BLACK, C_WHITE};
+}
+
+// ===================== SCREEN =====================
+// Decimal without printf (canvas has no libc formatting dependency).
+static void format_int(char* out, int v) {
+  char tmp[8];
+  int n = 0;
+  bool neg = v < 0;
+  unsigned u = neg ? (unsigned)(-v) : (unsigned)v;
+  do { tmp[n++] = (char)('0' + u % 10); u /= 10; } while (u && n < 6);
+  if (neg) *out++ = '-';
+  while (n) *out++ = tmp[--n];
+  *out = '\0';
+}
+
+// Positions shared by the static and the dynamic part of the screen.
+struct ScreenLayout {
+  int header_h;
+  int s, digit_w, digit_h, gap;   // 7-segment digits
+  int icon_w;
+  int digits_width, start_x;
+  int top, y_digits;
+  int icon_x, icon_y;             // °C icon
+};
+
+static ScreenLayout screen_layout() {
+  ScreenLayout L;
+  L.header_h = 28;
+
+  // digits sizes (2 digits)
+  L.s = 9;
+  L.digit_w = 6*L.s;
+  L.digit_h = 10*L.s;
+  L.gap = 22;
+
+  L.icon_w = 28;
+  int icon_gap = 12;
+
+  L.digits_width = 2*L.digit_w + L.gap;
+  int group_width = L.digits_width + icon_gap + L.icon_w;
+  L.start_x = (CANVAS_W - group_width) / 2;
+
+  // body layout
+  L.top = 1 + L.header_h + 1 + 10;
+  int avail_h = (CANVAS_H - 1) - L.top;
+  L.y_digits = L.top + (avail_h - L.digit_h) / 2 + 6;
+
+  int digits_end_x = L.start_x + L.digits_width;
+  L.icon_x = digits_end_x + icon_gap;
+  L.icon_y = L.y_digits + 10;
+  if (L.icon_x + L.icon_w > CANVAS_W - 1) L.icon_x = (CANVAS_W - 1) - L.icon_w;
+  if (L.icon_y + 20 > CANVAS_H - 1) L.icon_y = (CANVAS_H - 1) - 20;
+  return L;
+}
+
+// Everything that only depends on the header colors: body, border, header
+// band, title, "TEMP" label and the °C icon. None of it overlaps the
+// dynamic layer except the battery, which is drawn over the header.
+static void draw_static_layer(const ScreenLayout& L, uint8_t header_bg, uint8_t header_fg) {
+  // Body background always white (easier for readability)
+  {
+    CANVAS_SITE("fill");
+    fill(C_WHITE);
+  }
+
+  // Border matches header fg (clean + consistent)
+  {
+    CANVAS_SITE("border");
+    border_l(header_fg);
+  }
+
+  // Header
+  {
+    CANVAS_SITE("header");
+    rect_l(1, 1, CANVAS_W - 2, L.header_h, header_bg);
+  }
+
+  // Separator line under header (1px like border)
+  {
+    CANVAS_SITE("separator");
+    rect_l(1, 1 + L.header_h, CANVAS_W - 2, 1, header_fg);
+  }
+
+  // "BOILER" centered with balanced padding
+  {
+    CANVAS_SITE("title");
+    const char* title = "BOILER";
+    int scale = 3;
+    int spacing = 3;
+    int title_w = text_width_5x7(title, scale, spacing);
+    int tx = (CANVAS_W - title_w) / 2;
+
+    int text_h = 7 * scale;
+    int header_top = 1;
+    int header_bottom = 1 + L.header_h;
+    int available_h = header_bottom - header_top;
+    int ty = header_top + (available_h - text_h) / 2;
+
+    if (ty < header_top + 2) ty = header_top + 2;
+    draw_text_5x7_l(tx, ty, title, scale, spacing, header_fg);
+  }
+
+  // "TEMP" label above digits (uses header_fg to keep nice contrast)
+  {
+    CANVAS_SITE("label");
+    const char* label = "TEMP";
+    int scale = 2;
+    int spacing = 2;
+    int label_w = text_width_5x7(label, scale, spacing);
+    int lx = (CANVAS_W - label_w) / 2;
+
+    int ly = L.y_digits - (7*scale) - 10;
+    int min_ly = 1 + L.header_h + 1 + 4;
+    if (ly < min_ly) ly = min_ly;
+
+    draw_text_5x7_l(lx, ly, label, scale, spacing, header_fg);
+  }
+
+  // °C icon
+  {
+    CANVAS_SITE("icon");
+    draw_degC_icon_l(L.icon_x, L.icon_y, C_BLACK, C_WHITE);
+  }
+}
+
+static void draw_dynamic_layer(const ScreenLayout& L, int t, int batteryPct, ArrowDir dir,
+                               uint8_t header_bg, uint8_t header_fg, const SparkState* spark,
+                               const SideValue* side, int side_count) {
+  // digits
+  {
+    CANVAS_SITE("digits");
+    int x = L.start_x;
+    draw_digit7seg_l(x, L.y_digits, L.s, t / 10, C_BLACK);
+    x += L.digit_w + L.gap;
+    draw_digit7seg_l(x, L.y_digits, L.s, t % 10, C_BLACK);
+  }
+
+  // 24 h sparkline in the strip between digits and bottom border
+  if (spark && !spark_empty(*spark)) {
+    CANVAS_SITE("sparkline");
+    int sx = (CANVAS_W - SPARK_W) / 2;
+    int sy = L.y_digits + L.digit_h + 3;
+    if (sy + SPARK_H > CANVAS_H - 3) sy = CANVAS_H - 3 - SPARK_H;
+    if (rec) {
+      spark_spans(*spark, rec->spark);
+      record(OP_SPARK, C_BLACK, 0, 0, sx, sy, SPARK_W, SPARK_H, spans_hash(rec->spark));
+    } else {
+      draw_sparkline_l(sx, sy, *spark, C_BLACK);
+    }
+  }
+
+  // secondary values, left of the digits: small label, value below
+  if (side && side_count > 0) {
+    CANVAS_SITE("side");
+    int row_h = (CANVAS_H - 1 - L.top) / (side_count < 3 ? 3 : side_count);
+    for (int i = 0; i < side_count; i++) {
+      int ry = L.top + i * row_h;
+      draw_text_5x7_l(8, ry, side[i].label, 1, 1, C_BLACK);
+      char val[8];
+      if (side[i].valid) {
+        int v = side[i].value;
+        if (v < -99) v = -99;
+        if (v > 999) v = 999;
+        format_int(val, v);
+      } else {
+        val[0] = '-'; val[1] = '-'; val[2] = '\0';
+      }
+      draw_text_5x7_l(8, ry + 10, val, 2, 2, C_BLACK);
+    }
+  }
+
+  // Arrow indicator: to the right of digits, below the °C icon
+  // (your request: right of temps + below the °C icon)
+  if (dir != ARROW_NONE) {
+    CANVAS_SITE("arrow");
+    int ax = L.icon_x + L.icon_w/2;   // centered under the icon
+    int ay = L.icon_y + 28;           // below the °C icon
+    int size = 6;                     // small arrow
+    // keep inside screen
+    if (ay + size + 12 > CANVAS_H - 2) ay = CANVAS_H - 2 - (size + 12);
+
+    if (dir == ARROW_UP)   draw_arrow_up_l(ax, ay, size, C_BLACK);
+    if (dir == ARROW_DOWN) draw_arrow_down_l(ax, ay, size, C_RED);
+
+    // fast: two arrows side by side
+    if (dir == ARROW_UP_FAST) {
+      draw_arrow_up_l(ax - 7, ay, size, C_BLACK);
+      draw_arrow_up_l(ax + 7, ay, size, C_BLACK);
+    }
+    if (dir == ARROW_DOWN_FAST) {
+      draw_arrow_down_l(ax - 7, ay, size, C_RED);
+      draw_arrow_down_l(ax + 7, ay, size, C_RED);
+    }
+  }
+
+  // Battery icon (top-right in header)
+  if (batteryPct >= 0) {
+    CANVAS_SITE("battery");
+    int bw = 32;
+    int bh = 12;
+    int bx = CANVAS_W - 1 - 6 - bw - 4;
+    int by = 1 + 7;
+    // battery fg/bg match header readability
+    rect_l(bx, by, bw, bh, header_fg);
+    rect_l(bx + 1, by + 1, bw - 2, bh - 2, header_bg);
+    int nub_w = (bw / 10 > 2) ? bw / 10 : 2;
+    int nub_h = (bh / 2 > 4) ? bh / 2 : 4;
+    rect_l(bx + bw, by + (bh - nub_h) / 2, nub_w, nub_h, header_fg);
+
+    int inner_w = bw - 2;
+    int inner_h = bh - 2;
+    int fill_w = (inner_w * batteryPct) / 100;
+    rect_l(bx + 1, by + 1, fill_w, inner_h, header_fg);
+    if (batteryPct > 0 && fill_w == 0) rect_l(bx + 1, by + 1, 1, inner_h, header_fg);
+  }
+}
+
+// ===================== BACKGROUND CACHE =====================
+// The static layer per header color pair (the theme colors plus the white
+// transition header), least recently used goes. It has only a few dozen
+// distinct panel rows, so it is kept as a row dictionary: restoring it is
+// one memcpy per row.
+struct BackgroundSlot {
+  bool used;
+  uint8_t key;          // header_bg << 2 | header_fg
+  uint8_t row_count;
+  uint32_t last_use;
+  uint8_t row_of[PANEL_H];   // dictionary entry for each panel row
+  uint8_t rows[CANVAS_BG_MAX_ROWS][ROW_BYTES];
+};
+
+static bool bg_cache_on = false;
+static BackgroundSlot bg_slots[CANVAS_BG_SLOTS];
+static uint32_t bg_clock = 0;
+static CanvasCacheStats bg_stats;
+
+void canvas_set_layer_cache(bool on) {
+  bg_cache_on = on;
+  for (int i = 0; i < CANVAS_BG_SLOTS; i++) bg_slots[i].used = false;
+}
+
+const CanvasCacheStats& canvas_cache_stats() {
+  return bg_stats;
+}
+
+static bool background_from_cache(uint8_t key) {
+  for (int i = 0; i < CANVAS_BG_SLOTS; i++) {
+    BackgroundSlot& b = bg_slots[i];
+    if (!b.used || b.key != key) continue;
+    for (int y = 0; y < PANEL_H; y++) memcpy(fb + y * ROW_BYTES, b.rows[b.row_of[y]], ROW_BYTES);
+    b.last_use = ++bg_clock;
+    bg_stats.hits++;
+    return true;
+  }
+  bg_stats.misses++;
+  return false;
+}
+
+static void background_store(uint8_t key) {
+  BackgroundSlot* b = &bg_slots[0];
+  for (int i = 0; i < CANVAS_BG_SLOTS; i++) {
+    if (!bg_slots[i].used) {
+      b = &bg_slots[i];
+      break;
+    }
+    if (bg_slots[i].last_use < b->last_use) b = &bg_slots[i];
+  }
+
+  b->used = true;
+  b->key = key;
+  b->row_count = 0;
+  b->last_use = ++bg_clock;
+  for (int y = 0; y < PANEL_H && b->used; y++) {
+    const uint8_t* row = fb + y * ROW_BYTES;
+    int r = 0;
+    while (r < b->row_count && memcmp(b->rows[r], row, ROW_BYTES) != 0) r++;
+    if (r == b->row_count) {
+      if (r == CANVAS_BG_MAX_ROWS) {
+        b->used = false;   // too busy to pay off: keep drawing it
+        break;
+      }
+      memcpy(b->rows[r], row, ROW_BYTES);
+      b->row_count++;
+    }
+    b->row_of[y] = (uint8_t)r;
+  }
+
+  bg_stats.bytes = 0;
+  for (int i = 0; i < CANVAS_BG_SLOTS; i++) {
+    if (bg_slots[i].used) bg_stats.bytes += PANEL_H + bg_slots[i].row_count * ROW_BYTES;
+  }
+}
+
+// ===================== SCREEN LIST =====================
+// Clamps t to what two digits show and picks the header colors for it.
+static int screen_colors(int tempC, uint8_t header_bg_override, uint8_t& header_bg,
+                         uint8_t& header_fg) {
+  int t = tempC;
+  if (t < 0) t = 0;
+  if (t > 99) t = 99;
+
+  Theme th = theme_for_temp(t);
+  header_bg = (header_bg_override == 255) ? th.header_bg : header_bg_override;
+
+  // readable header fg for the color actually used: the override may be
+  // the white transition, or a theme held by hysteresis
+  header_fg = (header_bg == C_WHITE || header_bg == C_YELLOW) ? C_BLACK : C_WHITE;
+  return t;
+}
+
+void build_screen_list(DisplayList& dl, int tempC, int batteryPct, ArrowDir dir,
+                       uint8_t header_bg_override, const SparkState* spark,
+                       const SideValue* side, int side_count) {
+  uint8_t header_bg, header_fg;
+  int t = screen_colors(tempC, header_bg_override, header_bg, header_fg);
+
+  dl.count = 0;
+  dl.overflow = false;
+  dl.bg_key = (uint8_t)((header_bg & 0x3) << 2 | (header_fg & 0x3));
+  rec = &dl;
+  ScreenLayout L = screen_layout();
+  draw_static_layer(L, header_bg, header_fg);
+  dl.static_count = dl.count;
+  draw_dynamic_layer(L, t, batteryPct, dir, header_bg, header_fg, spark, side, side_count);
+  rec = nullptr;
+}
+
+static CanvasListStats list_stats;
+
+const CanvasListStats& canvas_list_stats() {
+  return list_stats;
+}
+
+static bool overlaps(const CanvasRect& a, const CanvasRect& b) {
+  return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static bool covers(const CanvasRect& outer, const CanvasRect& inner) {
+  return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.w <= outer.x + outer.w &&
+         inner.y + inner.h <= outer.y + outer.h;
+}
+
+static void draw_op(const DisplayList& dl, const DrawOp& op) {
+  const CanvasRect& b = op.box;
+  switch (op.kind) {
+    case OP_FILL: fill(op.color); break;
+    case OP_RECT: rect_l(b.x, b.y, b.w, b.h, op.color); break;
+    case OP_GLYPH: draw_char_5x7_l(b.x, b.y, (char)op.arg, op.scale, op.color); break;
+    case OP_DIGIT: draw_digit7seg_l(b.x, b.y, op.scale, op.arg, op.color); break;
+    case OP_TRIANGLE: triangle_l(b.x + (op.scale - 1), b.y, op.scale, op.arg, op.color); break;
+    case OP_SPARK:
+      draw_spark_spans_l(b.x, b.y, dl.spark, op.color, clip_box.x - b.x,
+                         clip_box.x + clip_box.w - b.x);
+      break;
+  }
+}
+
+// Ops from..to-1; an op is hidden if a later fill or rect in the same range
+// covers its whole box (every op paints only inside its box).
+static void draw_ops(const DisplayList& dl, int from, int to) {
+  for (int i = from; i < to; i++) {
+    const DrawOp& op = dl.ops[i];
+    if (!overlaps(op.box, clip_box)) {
+      list_stats.clipped++;
+      continue;
+    }
+    bool hidden = false;
+    for (int j = i + 1; j < to && !hidden; j++) {
+      const DrawOp& o = dl.ops[j];
+      hidden = (o.kind == OP_FILL || o.kind == OP_RECT) && covers(o.box, op.box);
+    }
+    if (hidden) {
+      list_stats.occluded++;
+      continue;
+    }
+    list_stats.drawn++;
+#ifdef CANVAS_PROFILE
+    canvas_profile_raster_site(op.site);
+#endif
+    draw_op(dl, op);
+  }
+#ifdef CANVAS_PROFILE
+  canvas_profile_raster_site(nullptr);
+#endif
+}
+
+void draw_list(const DisplayList& dl, const CanvasRect* clip) {
+  TRACE_SPAN(TR_RENDER);
+  int first = 0;
+  if (clip) {
+    // rect_l relies on the clip being on the canvas
+    int x0 = clip->x > 0 ? clip->x : 0;
+    int y0 = clip->y > 0 ? clip->y : 0;
+    int x1 = (clip->x + clip->w < CANVAS_W) ? clip->x + clip->w : CANVAS_W;
+    int y1 = (clip->y + clip->h < CANVAS_H) ? clip->y + clip->h : CANVAS_H;
+    if (x1 <= x0 || y1 <= y0) return;
+    clip_box.x = (int16_t)x0;
+    clip_box.y = (int16_t)y0;
+    clip_box.w = (int16_t)(x1 - x0);
+    clip_box.h = (int16_t)(y1 - y0);
+  } else if (bg_cache_on && dl.static_count > 0) {
+    // the static layer drawn on its own, so it can be stored complete
+    if (!background_from_cache(dl.bg_key)) {
+      draw_ops(dl, 0, dl.static_count);
+      background_store(dl.bg_key);
+    }
+    first = dl.static_count;
+  }
+  draw_ops(dl, first, dl.count);
+  clip_box = FULL_CANVAS;
+}
+
+static bool same_op(const DrawOp& a, const DrawOp& b) {
+  return a.kind == b.kind && a.color == b.color && a.arg == b.arg && a.scale == b.scale &&
+         a.box.x == b.box.x && a.box.y == b.box.y && a.box.w == b.box.w &&
+         a.box.h == b.box.h && a.data == b.data;
+}
+
+// Everything but the profiling site, in order.
+uint32_t list_hash(const DisplayList& dl) {
+  uint32_t h = fnv1a(&dl.count, sizeof(dl.count));
+  h = fnv1a(&dl.overflow, sizeof(dl.overflow), h);
+  for (int i = 0; i < dl.count; i++) {
+    const DrawOp& op = dl.ops[i];
+    uint8_t head[4] = { op.kind, op.color, op.arg, op.scale };
+    h = fnv1a(head, sizeof(head), h);
+    h = fnv1a(&op.box, sizeof(op.box), h);
+    h = fnv1a(&op.data, sizeof(op.data), h);
+  }
+  return h;
+}
+
+// new_op: b is the box of another changed op, not one more box of the last.
+static void add_box(ListDiff& out, const CanvasRect& b, bool new_op = true) {
+  bool too_many = out.changed > 0 && out.box_count == 0;
+  if (out.changed == 0) {
+    out.bounds = b;
+  } else {
+    int x1 = out.bounds.x + out.bounds.w, y1 = out.bounds.y + out.bounds.h;
+    if (b.x + b.w > x1) x1 = b.x + b.w;
+    if (b.y + b.h > y1) y1 = b.y + b.h;
+    if (b.x < out.bounds.x) out.bounds.x = b.x;
+    if (b.y < out.bounds.y) out.bounds.y = b.y;
+    out.bounds.w = (int16_t)(x1 - out.bounds.x);
+    out.bounds.h = (int16_t)(y1 - out.bounds.y);
+  }
+  if (new_op) out.changed++;
+  if (too_many) return;
+
+  // an op inside an earlier box needs no box of its own
+  for (int i = 0; i < out.box_count; i++) {
+    if (covers(out.boxes[i], b)) return;
+  }
+  if (out.box_count == DL_MAX_BOXES) {
+    out.box_count = 0;
+    return;
+  }
+  out.boxes[out.box_count++] = b;
+}
+
+// Runs closer than this many columns share a box, so a scrolled graph does
+// not use up the boxes.
+static const int SPARK_RUN_GAP = 8;
+
+// Past this many changed columns (a scrolled graph) one box over the whole
+// strip does the same drawing without the per-run overhead; below it the
+// runs are cheaper (tools/render_bench, 60 / 250 / 900 s per sample).
+static const int SPARK_PARTIAL_MAX = SPARK_W * 3 / 4;
+
+// One changed op: boxes around the runs of columns whose span differs, or
+// the whole strip once too many columns changed.
+static void add_spark_boxes(ListDiff& out, const SparkSpans& a, const SparkSpans& b,
+                            const CanvasRect& box) {
+  int cols = 0;
+  for (int i = 0; i < SPARK_W; i++) cols += a.top[i] != b.top[i] || a.bot[i] != b.bot[i];
+  if (cols > SPARK_PARTIAL_MAX) {
+    add_box(out, box);
+    return;
+  }
+  bool first = true;
+  int start = -1, last = -1;
+  for (int i = 0; i <= SPARK_W; i++) {
+    if (i < SPARK_W && (a.top[i] != b.top[i] || a.bot[i] != b.bot[i])) {
+      if (start < 0) start = i;
+      last = i;
+      continue;
+    }
+    if (start < 0 || (i < SPARK_W && i - last <= SPARK_RUN_GAP)) continue;
+    CanvasRect r = { (int16_t)(box.x + start), box.y, (int16_t)(last - start + 1), box.h };
+    add_box(out, r, first);
+    first = false;
+    start = -1;
+  }
+}
+
+static bool same_place(const DrawOp& a, const DrawOp& b) {
+  return a.kind == b.kind && a.color == b.color && a.box.x == b.box.x && a.box.y == b.box.y &&
+         a.box.w == b.box.w && a.box.h == b.box.h;
+}
+
+// Greedy matching of equal ops; the lists come from the same code, so ops
+// that match also keep their relative order. A sparkline that only changed
+// its spans is diffed by column.
+bool list_diff(const DisplayList& prev, const DisplayList& cur, ListDiff& out) {
+  out.changed = 0;
+  out.box_count = 0;
+  if (prev.overflow || cur.overflow) return false;
+
+  bool matched[DL_MAX_OPS] = { false };
+  int spark_cur = -1;
+  for (int i = 0; i < cur.count; i++) {
+    int j = 0;
+    while (j < prev.count && (matched[j] || !same_op(prev.ops[j], cur.ops[i]))) j++;
+    if (j < prev.count) {
+      matched[j] = true;
+    } else if (cur.ops[i].kind == OP_SPARK) {
+      spark_cur = i;
+    } else {
+      add_box(out, cur.ops[i].box);
+    }
+  }
+  if (spark_cur >= 0) {
+    const DrawOp& op = cur.ops[spark_cur];
+    int j = 0;
+    while (j < prev.count && (matched[j] || !same_place(prev.ops[j], op))) j++;
+    if (j < prev.count) {
+      matched[j] = true;
+      add_spark_boxes(out, prev.spark, cur.spark, op.box);
+    } else {
+      add_box(out, op.box);
+    }
+  }
+  for (int j = 0; j < prev.count; j++) {
+    if (!matched[j]) add_box(out, prev.ops[j].box);
+  }
+  return true;
+}
+
+int canvas_repaint(const DisplayList& prev, const DisplayList& cur) {
+  ListDiff d;
+  if (!list_diff(prev, cur, d)) {
+    draw_list(cur);
+    return -1;
+  }
+  if (d.changed > 0 && d.box_count == 0) {
+    draw_list(cur, &d.bounds);
+  } else {
+    for (int i = 0; i < d.box_count; i++) draw_list(cur, &d.boxes[i]);
+  }
+  return d.changed;
+}
+
+void draw_screen_frame(int tempC, int batteryPct, ArrowDir dir, uint8_t header_bg_override,
+                       const SparkState* spark, const SideValue* side, int side_count) {
+  static DisplayList dl;
+  build_screen_list(dl, tempC, batteryPct, dir, header_bg_override, spark, side, side_count);
+  if (!dl.overflow) {
+    draw_list(dl);
+    return;
+  }
+
+  // more ops than a list holds: draw them as they come
+  TRACE_SPAN(TR_RENDER);
+  uint8_t header_bg, header_fg;
+  int t = screen_colors(tempC, header_bg_override, header_bg, header_fg);
+  ScreenLayout L = screen_layout();
+  draw_static_layer(L, header_bg, header_fg);
+  draw_dynamic_layer(L, t, batteryPct, dir, header_bg, header_fg, spark, side, side_count);
+}
+
+// ===================== PROFILING =====================
+#ifdef CANVAS_PROFILE
+CanvasProfile canvas_profile;
+
+static const int SITE_STACK_DEPTH = 8;
+static int site_stack[SITE_STACK_DEPTH];
+static int site_depth = 0;
+// set while a recorded op is drawn, outside the scope that recorded it
+static const char* raster_site = nullptr;
+
+void canvas_profile_reset() {
+  memset(&canvas_profile, 0, sizeof(canvas_profile));
+  memset(canvas_profile.last_site, 0xFF, sizeof(canvas_profile.last_site));
+  site_depth = 0;
+  raster_site = nullptr;
+}
+
+static int site_index(const char* site) {
+  int i = 0;
+  while (i < canvas_profile.site_count && strcmp(canvas_profile.sites[i].name, site) != 0) i++;
+  if (i == canvas_profile.site_count) {
+    if (i == CANVAS_PROFILE_MAX_SITES) return CANVAS_PROFILE_MAX_SITES - 1;
+    canvas_profile.sites[i].name = site;
+    canvas_profile.site_count++;
+  }
+  return i;
+}
+
+void canvas_profile_enter(const char* site) {
+  int i = site_index(site);
+  canvas_profile.sites[i].calls++;
+  if (site_depth < SITE_STACK_DEPTH) site_stack[site_depth] = i;
+  site_depth++;
+}
+
+void canvas_profile_leave() {
+  if (site_depth > 0) site_depth--;
+}
+
+const char* canvas_profile_site() {
+  int top = (site_depth < SITE_STACK_DEPTH) ? site_depth : SITE_STACK_DEPTH;
+  return top ? canvas_profile.sites[site_stack[top - 1]].name : "(unscoped)";
+}
+
+void canvas_profile_raster_site(const char* site) {
+  raster_site = site;
+}
+
+static void canvas_profile_px(int lx, int ly, uint8_t old_c, uint8_t new_c) {
+  int cur = site_index(raster_site ? raster_site : canvas_profile_site());
+  int p = ly * CANVAS_W + lx;
+
+  CanvasSiteStats& s = canvas_profile.sites[cur];
+  s.writes++;
+  if (old_c == new_c) s.unchanged++;
+
+  uint8_t prev = canvas_profile.last_site[p];
+  if (prev != 0xFF) canvas_profile.sites[prev].overdrawn++;
+  canvas_profile.last_site[p] = (uint8_t)cur;
+  if (canvas_profile.writes[p] < 0xFFFF) canvas_profile.writes[p]++;
+}
+#endif
@@ -0,0 +1,380 @@
+#include <math.h>
+#include <string.h>
+
+#include "decode.h"
+
+// ===================== SENTINELS =====================
+bool decode_is_sentinel(const uint8_t* p, unsigned int len) {
+  switch (len) {
+    case 3:  return !memcmp(p, "nan", 3) || !memcmp(p, "NaN", 3);
+    case 4:  return !memcmp(p, "None", 4) || !memcmp(p, "null", 4);
+    case 7:  return !memcmp(p, "unknown", 7);
+    case 11: return !memcmp(p, "unavailable", 11);
+    default: return false;
+  }
+}
+
+// ===================== NUMBERS =====================
+static bool is_space(uint8_t c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool is_digit(uint8_t c) {
+  return c >= '0' && c <= '9';
+}
+
+// Largest |tenths| accepted (fits int32 with room for rounding).
+static const int64_t TENTHS_MAX = 2000000000LL;
+
+// mantissa * 10^exp10 -> tenths, rounded half away from zero
+static bool scale_to_tenths(int64_t mantissa, int exp10, bool neg, int32_t& out) {
+  int e = exp10 + 1;
+  int64_t v = mantissa;
+  if (e >= 0) {
+    for (; e > 0; e--) {
+      if (v > TENTHS_MAX) return false;
+      v *= 10;
+    }
+  } else {
+    if (e < -18) {
+      v = 0;
+    } else {
+      int64_t div = 1;
+      for (; e < 0; e++) div *= 10;
+      v = (v + div / 2) / div;
+    }
+  }
+  if (v > TENTHS_MAX) return false;
+  out = neg ? -(int32_t)v : (int32_t)v;
+  return true;
+}
+
+bool decode_tenths(const uint8_t* p, unsigned int len, int32_t& tenths) {
+  const uint8_t* end = p + len;
+  while (p < end && is_space(*p)) p++;
+
+  bool neg = false;
+  if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+
+  int64_t mantissa = 0;
+  int exp10 = 0;
+  int digits = 0;        // significant digits kept in mantissa
+  bool any = false;
+
+  for (; p < end && is_digit(*p); p++) {
+    any = true;
+    if (digits < 17) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa) digits++;
+    } else {
+      exp10++;           // beyond int64 precision: only track magnitude
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && is_digit(*p); p++) {
+      any = true;
+      if (digits < 17) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa) digits++;
+        exp10--;
+      }
+    }
+  }
+  if (!any) return false;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const uint8_t* q = p + 1;
+    bool eneg = false;
+    if (q < end && (*q == '-' || *q == '+')) eneg = (*q++ == '-');
+    if (q < end && is_digit(*q)) {
+      int e = 0;
+      for (; q < end && is_digit(*q); q++) {
+        if (e < 1000) e = e * 10 + (*q - '0');
+      }
+      exp10 += eneg ? -e : e;
+    }
+  }
+  if (mantissa == 0) {
+    tenths = 0;
+    return true;
+  }
+  if (exp10 > 30) return false;
+  return scale_to_tenths(mantissa, exp10, neg, tenths);
+}
+
+bool decode_int(const uint8_t* p, unsigned int len, int& out) {
+  if (len == 0 || decode_is_sentinel(p, len)) return false;
+  int32_t t;
+  if (!decode_tenths(p, len, t)) return false;
+  out = tenths_round(t);
+  return true;
+}
+
+// ===================== JSON =====================
+struct Span {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  void ws() { while (p < end && is_space(*p)) p++; }
+  bool eat(uint8_t c) {
+    ws();
+    if (p < end && *p == c) { p++; return true; }
+    return false;
+  }
+};
+
+// Past the closing quote of a string starting at s.p (on the opening quote).
+static bool skip_string(Span& s, const uint8_t*& body, unsigned int& body_len) {
+  if (s.p >= s.end || *s.p != '"') return false;
+  body = ++s.p;
+  while (s.p < s.end) {
+    uint8_t c = *s.p++;
+    if (c == '\\') {
+      if (s.p >= s.end) return false;
+      s.p++;
+    } else if (c == '"') {
+      body_len = (unsigned int)(s.p - 1 - body);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Skips one value of any type; nesting is tracked by a depth counter.
+static bool skip_value(Span& s) {
+  s.ws();
+  int depth = 0;
+  do {
+    if (s.p >= s.end) return false;
+    uint8_t c = *s.p;
+    if (c == '"') {
+      const uint8_t* b;
+      unsigned int n;
+      if (!skip_string(s, b, n)) return false;
+    } else if (c == '{' || c == '[') {
+      depth++;
+      s.p++;
+    } else if (c == '}' || c == ']') {
+      if (--depth < 0) return false;
+      s.p++;
+    } else if (depth == 0) {
+      // scalar: runs up to a delimiter
+      while (s.p < s.end && *s.p != ',' && *s.p != '}' && *s.p != ']' && !is_space(*s.p)) s.p++;
+      return true;
+    } else {
+      s.p++;
+    }
+  } while (depth > 0);
+  return true;
+}
+
+bool decode_json_path(const uint8_t* p, unsigned int len, const char* path,
+                      const uint8_t*& value, unsigned int& value_len) {
+  if (!path) return false;
+  if (path[0] == '$') path += (path[1] == '.') ? 2 : 1;
+
+  Span s = { p, p + len };
+  const char* seg = path;
+  while (*seg) {
+    const char* seg_end = strchr(seg, '.');
+    size_t seg_len = seg_end ? (size_t)(seg_end - seg) : strlen(seg);
+
+    // find the member named seg in the object at s.p
+    if (!s.eat('{')) return false;
+    bool found = false;
+    if (s.eat('}')) return false;
+    while (!found) {
+      s.ws();
+      const uint8_t* key;
+      unsigned int key_len;
+      if (!skip_string(s, key, key_len) || !s.eat(':')) return false;
+      if (key_len == seg_len && !memcmp(key, seg, seg_len)) {
+        found = true;
+        break;
+      }
+      if (!skip_value(s)) return false;
+      if (s.eat(',')) continue;
+      return false;   // '}' or garbage: not in this object
+    }
+    seg = seg_end ? seg_end + 1 : seg + seg_len;
+  }
+
+  // s.p is at the value
+  s.ws();
+  if (s.p >= s.end) return false;
+  if (*s.p == '"') return skip_string(s, value, value_len);
+  const uint8_t* start = s.p;
+  if (!skip_value(s)) return false;
+  value = start;
+  value_len = (unsigned int)(s.p - start);
+  return value_len > 0;
+}
+
+bool decode_json_tenths(const uint8_t* p, unsigned int len, const char* path, int32_t& tenths) {
+  const uint8_t* v;
+  unsigned int n;
+  if (!decode_json_path(p, len, path, v, n)) return false;
+  if (n == 0 || decode_is_sentinel(v, n)) return false;
+  if (*v != '-' && *v != '+' && *v != '.' && !is_digit(*v)) return false;   // object, true, ...
+  return decode_tenths(v, n, tenths);
+}
+
+// ===================== CBOR =====================
+struct Cbor {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  // Reads an item head; false on truncation or indefinite length.
+  bool head(uint8_t& major, uint64_t& arg, uint8_t& ai) {
+    if (p >= end) return false;
+    uint8_t b = *p++;
+    major = b >> 5;
+    ai = b & 0x1F;
+    if (ai < 24) { arg = ai; return true; }
+    int n = (ai == 24) ? 1 : (ai == 25) ? 2 : (ai == 26) ? 4 : (ai == 27) ? 8 : 0;
+    if (n == 0 || end - p < n) return false;
+    arg = 0;
+    for (int i = 0; i < n; i++) arg = (arg << 8) | *p++;
+    return true;
+  }
+};
+
+static const int CBOR_MAX_DEPTH = 16;
+
+static bool cbor_skip(Cbor& c, int depth) {
+  if (depth > CBOR_MAX_DEPTH) return false;
+  uint8_t major, ai;
+  uint64_t arg;
+  if (!c.head(major, arg, ai)) return false;
+  switch (major) {
+    case 0: case 1: case 7:
+      return true;
+    case 2: case 3:
+      if (arg > (uint64_t)(c.end - c.p)) return false;
+      c.p += arg;
+      return true;
+    case 4:
+      if (arg > (uint64_t)(c.end - c.p)) return false;   // every item is >= 1 byte
+      for (uint64_t i = 0; i < arg; i++) if (!cbor_skip(c, depth + 1)) return false;
+      return true;
+    case 5:
+      if (arg > (uint64_t)(c.end - c.p) / 2) return false;
+      for (uint64_t i = 0; i < arg * 2; i++) if (!cbor_skip(c, depth + 1)) return false;
+      return true;
+    case 6:
+      return cbor_skip(c, depth + 1);
+    default:
+      return false;
+  }
+}
+
+static double half_to_double(uint16_t h) {
+  int e = (h >> 10) & 0x1F;
+  int m = h & 0x3FF;
+  double v;
+  if (e == 0) v = ldexp((double)m, -24);
+  else if (e == 31) v = m ? NAN : INFINITY;
+  else v = ldexp((double)(m + 1024), e - 25);
+  return (h & 0x8000) ? -v : v;
+}
+
+static bool double_to_tenths(double v, int32_t& out) {
+  if (!(v == v)) return false;   // NaN
+  double t = v * 10.0;
+  if (t > (double)TENTHS_MAX || t < -(double)TENTHS_MAX) return false;
+  out = (int32_t)lround(t);
+  return true;
+}
+
+static bool cbor_number(Cbor& c, int32_t& out) {
+  uint8_t major, ai;
+  uint64_t arg;
+  for (int tags = 0;; tags++) {
+    if (!c.head(major, arg, ai)) return false;
+    if (major != 6) break;
+    if (tags >= CBOR_MAX_DEPTH) return false;   // tag: the value follows
+  }
+
+  switch (major) {
+    case 0:
+      if (arg > (uint64_t)(TENTHS_MAX / 10)) return false;
+      out = (int32_t)arg * 10;
+      return true;
+    case 1:
+      if (arg >= (uint64_t)(TENTHS_MAX / 10)) return false;
+      out = -(int32_t)(arg + 1) * 10;
+      return true;
+    case 7:
+      if (ai == 25) return double_to_tenths(half_to_double((uint16_t)arg), out);
+      if (ai == 26) {
+        uint32_t bits = (uint32_t)arg;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return double_to_tenths(f, out);
+      }
+      if (ai == 27) {
+        double d;
+        memcpy(&d, &arg, sizeof(d));
+        return double_to_tenths(d, out);
+      }
+      return false;   // false/true/null/undefined
+    case 3:
+      // numeric text, e.g. a state string
+      if (arg > (uint64_t)(c.end - c.p) || decode_is_sentinel(c.p, (unsigned int)arg)) return false;
+      return decode_tenths(c.p, (unsigned int)arg, out);
+    default:
+      return false;
+  }
+}
+
+bool decode_cbor_tenths(const uint8_t* p, unsigned int len, const char* path, int32_t& tenths) {
+  Cbor c = { p, p + len };
+  if (path && path[0] == '$') path += (path[1] == '.') ? 2 : 1;
+
+  const char* seg = path;
+  while (seg && *seg) {
+    const char* seg_end = strchr(seg, '.');
+    size_t seg_len = seg_end ? (size_t)(seg_end - seg) : strlen(seg);
+
+    uint8_t major, ai;
+    uint64_t pairs;
+    if (!c.head(major, pairs, ai) || major != 5) return false;
+    bool found = false;
+    for (uint64_t i = 0; i < pairs && !found; i++) {
+      const uint8_t* key_start = c.p;
+      uint64_t key_len;
+      if (!c.head(major, key_len, ai)) return false;
+      if (major == 3 && key_len <= (uint64_t)(c.end - c.p)) {
+        found = key_len == seg_len && !memcmp(c.p, seg, seg_len);
+        c.p += key_len;
+      } else {
+        c.p = key_start;   // non-text key
+        if (!cbor_skip(c, 0)) return false;
+      }
+      if (!found && !cbor_skip(c, 0)) return false;
+    }
+    if (!found) return false;
+    seg = seg_end ? seg_end + 1 : nullptr;
+  }
+  return cbor_number(c, tenths);
+}
+
+// ===================== ROUTES =====================
+bool decode_number_route(const uint8_t* p, unsigned int len, const char* arg, int& out) {
+  (void)arg;
+  return decode_int(p, len, out);
+}
+
+bool decode_json_route(const uint8_t* p, unsigned int len, const char* arg, int& out) {
+  int32_t t;
+  if (!decode_json_tenths(p, len, arg, t)) return false;
+  out = tenths_round(t);
+  return true;
+}
+
+bool decode_cbor_route(const uint8_t* p, unsigned int len, const char* arg, int& out) {
+  int32_t t;
+  if (!decode_cbor_tenths(p, len, arg, t)) return false;
+  out = tenths_round(t);
+  return true;
+}
@@ -0,0 +1,58 @@
+#include "display_pipe.h"
+#include "block_queue.h"
+#include "crit_section.h"
+#include "log.h"
+
+static BlockQueue free_q;   // uint8_t* of buffers not in use
+static BlockQueue job_q;    // DisplayJob
+
+// jobs submitted but not finished (queued or being handled)
+static CritSection busy_mux;
+static int busy = 0;
+
+bool display_pipe_begin(uint8_t* const* buffers, int count, int depth) {
+  if (count < 0 || count > DISPLAY_MAX_BUFFERS) return false;
+  if (!free_q.create(DISPLAY_MAX_BUFFERS, sizeof(uint8_t*)) ||
+      !job_q.create(depth, sizeof(DisplayJob))) {
+    LOGE("[DISP] queue allocation failed");
+    return false;
+  }
+  for (int i = 0; i < count; i++) free_q.send(&buffers[i], 0);
+  return true;
+}
+
+uint8_t* display_acquire(uint32_t timeout_ms) {
+  uint8_t* fb = nullptr;
+  if (!free_q.receive(&fb, timeout_ms)) return nullptr;
+  return fb;
+}
+
+void display_release(uint8_t* fb) {
+  if (fb) free_q.send(&fb, 0);
+}
+
+bool display_submit(const DisplayJob& job, uint32_t timeout_ms) {
+  {
+    CritLock lock(busy_mux);
+    busy++;
+  }
+  if (job_q.send(&job, timeout_ms)) return true;
+
+  CritLock lock(busy_mux);
+  busy--;
+  return false;
+}
+
+bool display_next(DisplayJob& job, uint32_t timeout_ms) {
+  return job_q.receive(&job, timeout_ms);
+}
+
+void display_done() {
+  CritLock lock(busy_mux);
+  if (busy > 0) busy--;
+}
+
+bool display_idle() {
+  CritLock lock(busy_mux);
+  return busy == 0;
+}
@@ -0,0 +1,252 @@
+#include <esp_attr.h>
+#include <string.h>
+
+#include "flash_log.h"
+#include "flash_part.h"
+#include "log.h"
+
+static const char* const PARTITION_LABEL = "history";
+static const uint8_t PARTITION_SUBTYPE = 0x40;
+
+static const uint32_t SECTOR_BYTES = 4096;
+static const uint32_t SECTOR_MAGIC = 0x464C4F47;   // "FLOG"
+
+struct SectorHeader {
+  uint32_t magic;
+  uint32_t seq;         // +1 for every sector opened
+  uint16_t reserved;
+  uint16_t crc;         // over the fields above
+  uint32_t pad;
+};
+
+struct Record {
+  uint32_t t_s;
+  int16_t value;
+  uint16_t crc;         // over t_s and value
+};
+
+static_assert(sizeof(SectorHeader) == 16 && sizeof(Record) == 8, "flash layout");
+
+static const uint32_t SLOTS = (SECTOR_BYTES - sizeof(SectorHeader)) / sizeof(Record);
+
+enum SlotState : uint8_t { SLOT_EMPTY, SLOT_VALID, SLOT_BAD };
+
+static uint32_t nsect = 0;        // 0 = no partition
+static uint32_t head = 0;         // physical sector being appended to
+static uint32_t used = 0;         // sectors in the chain ending at head
+static uint32_t head_seq = 0;
+static uint32_t head_slots = 0;   // slots written in the head sector
+static uint32_t last_time = 0;
+
+// keeps record times monotonic when the caller's clock restarts
+RTC_DATA_ATTR static uint32_t rtc_time_offset = 0;
+
+// CRC-16/CCITT-FALSE
+static uint16_t crc16(const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint16_t crc = 0xFFFF;
+  while (len--) {
+    crc ^= (uint16_t)(*p++) << 8;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// ===================== LOW LEVEL =====================
+static bool read_header(uint32_t phys, SectorHeader& h) {
+  if (!flash_part_read(phys * SECTOR_BYTES, &h, sizeof(h))) return false;
+  return h.magic == SECTOR_MAGIC && h.crc == crc16(&h, 10);
+}
+
+static SlotState read_slot(uint32_t phys, uint32_t slot, Record& r) {
+  uint32_t off = phys * SECTOR_BYTES + sizeof(SectorHeader) + slot * sizeof(Record);
+  if (!flash_part_read(off, &r, sizeof(r))) return SLOT_BAD;
+  const uint32_t* w = (const uint32_t*)&r;
+  if (w[0] == 0xFFFFFFFF && w[1] == 0xFFFFFFFF) return SLOT_EMPTY;
+  return (r.crc == crc16(&r, 6)) ? SLOT_VALID : SLOT_BAD;
+}
+
+static uint32_t phys_of(uint32_t logical) {
+  return (head + nsect + 1 - used + logical) % nsect;
+}
+
+static uint32_t slots_in(uint32_t logical) {
+  return (logical + 1 == used) ? head_slots : SLOTS;
+}
+
+// First valid record at or after slot (below end); false if none.
+static bool valid_from(uint32_t phys, uint32_t slot, uint32_t end, uint32_t& at, Record& r) {
+  for (; slot < end; slot++) {
+    if (read_slot(phys, slot, r) == SLOT_VALID) {
+      at = slot;
+      return true;
+    }
+  }
+  return false;
+}
+
+// ===================== MOUNT =====================
+static void mount() {
+  used = 0;
+  head_seq = 0;
+  head_slots = 0;
+  last_time = 0;
+  bool found = false;
+  for (uint32_t p = 0; p < nsect; p++) {
+    SectorHeader h;
+    if (!read_header(p, h)) continue;
+    if (!found || (int32_t)(h.seq - head_seq) > 0) {
+      head = p;
+      head_seq = h.seq;
+      found = true;
+    }
+  }
+  if (!found) return;
+
+  // chain of consecutive sequence numbers ending at head
+  used = 1;
+  while (used < nsect) {
+    SectorHeader h;
+    uint32_t p = (head + nsect - used) % nsect;
+    if (!read_header(p, h) || h.seq != head_seq - used) break;
+    used++;
+  }
+
+  // erased slots form a suffix of the head sector: binary search
+  uint32_t lo = 0, hi = SLOTS;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    Record r;
+    if (read_slot(head, mid, r) == SLOT_EMPTY) hi = mid;
+    else lo = mid + 1;
+  }
+  head_slots = lo;
+
+  // newest valid record
+  for (uint32_t s = used; s-- > 0 && !last_time;) {
+    for (uint32_t i = slots_in(s); i-- > 0;) {
+      Record r;
+      if (read_slot(phys_of(s), i, r) == SLOT_VALID) {
+        last_time = r.t_s;
+        break;
+      }
+    }
+  }
+}
+
+bool flog_begin() {
+  nsect = flash_part_open(PARTITION_LABEL, PARTITION_SUBTYPE) / SECTOR_BYTES;
+  if (!nsect) {
+    LOGW("[FLOG] no '%s' partition, flash history disabled", PARTITION_LABEL);
+    return false;
+  }
+  mount();
+  LOGI("[FLOG] %lu sectors, %lu in use, head seq %lu", (unsigned long)nsect,
+       (unsigned long)used, (unsigned long)head_seq);
+  return true;
+}
+
+// ===================== APPEND =====================
+static bool open_sector() {
+  uint32_t next = used ? (head + 1) % nsect : 0;
+  if (!flash_part_erase(next * SECTOR_BYTES, SECTOR_BYTES)) return false;
+
+  SectorHeader h;
+  memset(&h, 0xFF, sizeof(h));
+  h.magic = SECTOR_MAGIC;
+  h.seq = used ? head_seq + 1 : head_seq;
+  h.reserved = 0xFFFF;
+  h.crc = crc16(&h, 10);
+  if (!flash_part_write(next * SECTOR_BYTES, &h, sizeof(h))) return false;
+
+  head = next;
+  head_seq = h.seq;
+  head_slots = 0;
+  if (used < nsect) used++;   // otherwise the oldest sector was just erased
+  return true;
+}
+
+bool flog_append(uint32_t t_s, int value) {
+  if (!nsect) return false;
+  if (used == 0 || head_slots >= SLOTS) {
+    if (!open_sector()) {
+      LOGE("[FLOG] sector erase/header write failed");
+      return false;
+    }
+  }
+
+  uint32_t t = t_s + rtc_time_offset;
+  if (t < last_time) {
+    rtc_time_offset += last_time - t;
+    t = last_time;
+  }
+
+  Record r;
+  r.t_s = t;
+  r.value = (int16_t)(value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : value);
+  r.crc = crc16(&r, 6);
+  uint32_t off = head * SECTOR_BYTES + sizeof(SectorHeader) + head_slots * sizeof(Record);
+  head_slots++;   // a failed write still consumes the slot
+  if (!flash_part_write(off, &r, sizeof(r))) return false;
+  last_time = t;
+  return true;
+}
+
+// ===================== READ =====================
+void flog_seek(FlogCursor& c, uint32_t t_s) {
+  c.sector = 0;
+  c.slot = 0;
+  if (!nsect || used == 0) return;
+
+  // last sector whose first record is <= t_s; a sector without a valid
+  // record (a head opened just before a reset) counts as later
+  uint32_t lo = 0, hi = used;
+  while (hi - lo > 1) {
+    uint32_t mid = (lo + hi) / 2;
+    uint32_t at;
+    Record r;
+    if (valid_from(phys_of(mid), 0, slots_in(mid), at, r) && r.t_s <= t_s) lo = mid;
+    else hi = mid;
+  }
+
+  // first record >= t_s in that sector (damaged slots are stepped over)
+  uint32_t phys = phys_of(lo);
+  uint32_t a = 0, b = slots_in(lo);
+  while (a < b) {
+    uint32_t mid = (a + b) / 2;
+    uint32_t at;
+    Record r;
+    if (!valid_from(phys, mid, b, at, r)) b = mid;
+    else if (r.t_s < t_s) a = at + 1;
+    else b = mid;
+  }
+  c.sector = (uint16_t)lo;
+  c.slot = (uint16_t)a;
+}
+
+bool flog_next(FlogCursor& c, FlogSample& out) {
+  if (!nsect) return false;
+  while (c.sector < used) {
+    if (c.slot >= slots_in(c.sector)) {
+      c.sector++;
+      c.slot = 0;
+      continue;
+    }
+    Record r;
+    SlotState st = read_slot(phys_of(c.sector), c.slot++, r);
+    if (st != SLOT_VALID) continue;
+    out.t_s = r.t_s;
+    out.value = r.value;
+    return true;
+  }
+  return false;
+}
+
+uint32_t flog_last_time() { return last_time; }
+
+uint32_t flog_record_count() {
+  return used ? (used - 1) * SLOTS + head_slots : 0;
+}
+
+uint32_t flog_sector_count() { return nsect; }
+uint32_t flog_erase_cycles() { return used ? head_seq + 1 : 0; }
@@ -0,0 +1,22 @@
+#include <esp_partition.h>
+
+#include "flash_part.h"
+
+static const esp_partition_t* part = nullptr;
+
+uint32_t flash_part_open(const char* label, uint8_t subtype) {
+  part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype, label);
+  return part ? part->size : 0;
+}
+
+bool flash_part_read(uint32_t off, void* buf, size_t len) {
+  return part && esp_partition_read(part, off, buf, len) == ESP_OK;
+}
+
+bool flash_part_write(uint32_t off, const void* buf, size_t len) {
+  return part && esp_partition_write(part, off, buf, len) == ESP_OK;
+}
+
+bool flash_part_erase(uint32_t off, size_t len) {
+  return part && esp_partition_erase_range(part, off, len) == ESP_OK;
+}
@@ -0,0 +1,85 @@
+#include <string.h>
+
+#include "frame_hash.h"
+
+static const uint32_t P1 = 2654435761u;
+static const uint32_t P2 = 2246822519u;
+static const uint32_t P3 = 3266489917u;
+static const uint32_t P4 = 668265263u;
+static const uint32_t P5 = 374761393u;
+
+static inline uint32_t rotl(uint32_t x, int r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+// little-endian targets only (ESP32, x86 hosts)
+static inline uint32_t read32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint32_t round32(uint32_t acc, uint32_t in) {
+  return rotl(acc + in * P2, 13) * P1;
+}
+
+static void stripe(FrameHash& h, const uint8_t* p) {
+  h.v[0] = round32(h.v[0], read32(p));
+  h.v[1] = round32(h.v[1], read32(p + 4));
+  h.v[2] = round32(h.v[2], read32(p + 8));
+  h.v[3] = round32(h.v[3], read32(p + 12));
+}
+
+void frame_hash_init(FrameHash& h, uint32_t seed) {
+  h.v[0] = seed + P1 + P2;
+  h.v[1] = seed + P2;
+  h.v[2] = seed;
+  h.v[3] = seed - P1;
+  h.total = 0;
+  h.buf_len = 0;
+}
+
+void frame_hash_update(FrameHash& h, const uint8_t* p, size_t n) {
+  h.total += (uint32_t)n;
+  if (h.buf_len) {
+    size_t take = 16 - h.buf_len;
+    if (take > n) take = n;
+    memcpy(h.buf + h.buf_len, p, take);
+    h.buf_len += (uint8_t)take;
+    p += take;
+    n -= take;
+    if (h.buf_len < 16) return;
+    stripe(h, h.buf);
+    h.buf_len = 0;
+  }
+  for (; n >= 16; p += 16, n -= 16) stripe(h, p);
+  memcpy(h.buf, p, n);
+  h.buf_len = (uint8_t)n;
+}
+
+uint32_t frame_hash_final(const FrameHash& h) {
+  // v[2] still holds the seed if no full stripe was seen
+  uint32_t x = (h.total >= 16)
+    ? rotl(h.v[0], 1) + rotl(h.v[1], 7) + rotl(h.v[2], 12) + rotl(h.v[3], 18)
+    : h.v[2] + P5;
+  x += h.total;
+
+  const uint8_t* p = h.buf;
+  int n = h.buf_len;
+  for (; n >= 4; p += 4, n -= 4) x = rotl(x + read32(p) * P3, 17) * P4;
+  for (; n > 0; p++, n--) x = rotl(x + *p * P5, 11) * P1;
+
+  x ^= x >> 15;
+  x *= P2;
+  x ^= x >> 13;
+  x *= P3;
+  x ^= x >> 16;
+  return x;
+}
+
+uint32_t frame_hash(const uint8_t* p, size_t n, uint32_t seed) {
+  FrameHash h;
+  frame_hash_init(h, seed);
+  frame_hash_update(h, p, n);
+  return frame_hash_final(h);
+}
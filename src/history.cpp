@@ -0,0 +1,212 @@
+#include <string.h>
+
+#include "history.h"
+
+static const uint32_t HISTORY_MAGIC = 0x48535401 ^ (uint32_t)sizeof(HistoryStore);
+
+// ===================== ENCODING =====================
+static uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t u) {
+  return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static int put_varint(uint8_t* p, uint32_t u) {
+  int n = 0;
+  while (u >= 0x80) {
+    p[n++] = (uint8_t)(u | 0x80);
+    u >>= 7;
+  }
+  p[n++] = (uint8_t)u;
+  return n;
+}
+
+// Returns false if the varint runs past end.
+static bool get_varint(const uint8_t* data, uint16_t end, uint16_t& pos, uint32_t& out) {
+  uint32_t u = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (pos >= end) return false;
+    uint8_t b = data[pos++];
+    u |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      out = u;
+      return true;
+    }
+  }
+  return false;
+}
+
+static int16_t clamp16(int v) {
+  if (v < INT16_MIN) return INT16_MIN;
+  if (v > INT16_MAX) return INT16_MAX;
+  return (int16_t)v;
+}
+
+// ===================== STORE =====================
+void history_reset(HistoryStore& h) {
+  memset(&h, 0, sizeof(h));
+  h.magic = HISTORY_MAGIC;
+}
+
+void history_init(HistoryStore& h) {
+  if (h.magic != HISTORY_MAGIC) history_reset(h);
+}
+
+// i = 0 is the oldest block in use
+static const HistoryBlock& block_at(const HistoryStore& h, int i) {
+  int oldest = (h.head + HISTORY_BLOCKS + 1 - h.blocks_used) % HISTORY_BLOCKS;
+  return h.blocks[(oldest + i) % HISTORY_BLOCKS];
+}
+
+static void start_block(HistoryBlock& b, uint32_t t_s, int16_t v) {
+  memset(&b, 0, sizeof(b));
+  b.t0 = b.t_last = t_s;
+  b.v0 = b.v_last = b.vmin = b.vmax = v;
+  b.sum = v;
+  b.count = 1;
+}
+
+void history_append(HistoryStore& h, uint32_t t_s, int value) {
+  int16_t v = clamp16(value);
+
+  if (h.blocks_used == 0) {
+    h.head = 0;
+    h.blocks_used = 1;
+    start_block(h.blocks[0], t_s, v);
+    return;
+  }
+
+  HistoryBlock* b = &h.blocks[h.head];
+  if (t_s < b->t_last) {
+    history_reset(h);
+    history_append(h, t_s, value);
+    return;
+  }
+
+  int32_t dt = (int32_t)(t_s - b->t_last);
+  uint8_t enc[10];
+  int n = put_varint(enc, zigzag(dt - b->last_dt));
+  n += put_varint(enc + n, zigzag((int32_t)v - b->v_last));
+
+  if (b->used + n > HISTORY_BLOCK_BYTES || b->count == UINT16_MAX) {
+    h.head = (uint8_t)((h.head + 1) % HISTORY_BLOCKS);
+    if (h.blocks_used < HISTORY_BLOCKS) h.blocks_used++;
+    start_block(h.blocks[h.head], t_s, v);
+    return;
+  }
+
+  memcpy(b->data + b->used, enc, n);
+  b->used = (uint16_t)(b->used + n);
+  b->last_dt = dt;
+  b->t_last = t_s;
+  b->v_last = v;
+  if (v < b->vmin) b->vmin = v;
+  if (v > b->vmax) b->vmax = v;
+  b->sum += v;
+  b->count++;
+}
+
+uint32_t history_count(const HistoryStore& h) {
+  uint32_t n = 0;
+  for (int i = 0; i < h.blocks_used; i++) n += block_at(h, i).count;
+  return n;
+}
+
+size_t history_bytes_used(const HistoryStore& h) {
+  size_t n = 0;
+  for (int i = 0; i < h.blocks_used; i++) {
+    n += sizeof(HistoryBlock) - HISTORY_BLOCK_BYTES + block_at(h, i).used;
+  }
+  return n;
+}
+
+bool history_newest(const HistoryStore& h, HistorySample& out) {
+  if (h.blocks_used == 0) return false;
+  const HistoryBlock& b = h.blocks[h.head];
+  out.t_s = b.t_last;
+  out.value = b.v_last;
+  return true;
+}
+
+// ===================== QUERIES =====================
+static void stats_add(HistoryStats& s, int16_t v) {
+  if (s.count == 0 || v < s.min) s.min = v;
+  if (s.count == 0 || v > s.max) s.max = v;
+  s.sum += v;
+  s.count++;
+}
+
+HistoryStats history_query(const HistoryStore& h, uint32_t from_s, uint32_t to_s) {
+  HistoryStats s = {};
+  for (int i = 0; i < h.blocks_used; i++) {
+    const HistoryBlock& b = block_at(h, i);
+    if (b.t_last < from_s || b.t0 > to_s) continue;
+
+    if (b.t0 >= from_s && b.t_last <= to_s) {
+      // whole block inside the window: header only
+      if (s.count == 0 || b.vmin < s.min) s.min = b.vmin;
+      if (s.count == 0 || b.vmax > s.max) s.max = b.vmax;
+      s.sum += b.sum;
+      s.count += b.count;
+      continue;
+    }
+
+    // cut by a window edge: decode this block
+    HistoryReader r;
+    r.h = &h;
+    r.block = (uint8_t)i;
+    r.pos = 0;
+    r.index = 0;
+    r.from_s = from_s;
+    HistorySample smp;
+    while (history_reader_next(r, smp) && r.block == i) {
+      if (smp.t_s > to_s) break;
+      stats_add(s, smp.value);
+    }
+  }
+  return s;
+}
+
+void history_reader_begin(HistoryReader& r, const HistoryStore& h, uint32_t from_s) {
+  r.h = &h;
+  r.block = 0;
+  r.pos = 0;
+  r.index = 0;
+  r.from_s = from_s;
+  // skip whole blocks before the window
+  while (r.block < h.blocks_used && block_at(h, r.block).t_last < from_s) r.block++;
+}
+
+bool history_reader_next(HistoryReader& r, HistorySample& out) {
+  const HistoryStore& h = *r.h;
+  while (r.block < h.blocks_used) {
+    const HistoryBlock& b = block_at(h, r.block);
+
+    if (r.index == 0) {
+      r.t = b.t0;
+      r.v = b.v0;
+      r.dt = 0;
+      r.pos = 0;
+    } else {
+      uint32_t dod, dv;
+      if (r.index >= b.count || !get_varint(b.data, b.used, r.pos, dod) ||
+          !get_varint(b.data, b.used, r.pos, dv)) {
+        r.block++;
+        r.index = 0;
+        continue;
+      }
+      r.dt += unzigzag(dod);
+      r.t += (uint32_t)r.dt;
+      r.v = clamp16(r.v + unzigzag(dv));
+    }
+    r.index++;
+
+    if (r.t < r.from_s) continue;
+    out.t_s = r.t;
+    out.value = r.v;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,245 @@
+#include <Arduino.h>
+
+#include "log.h"
+
+// ===================== RING BUFFER =====================
+static LogRecord ring[LOG_RING_SIZE];
+static uint32_t ring_head = 0;      // next write
+static uint32_t ring_tail = 0;      // next read
+static uint32_t ring_dropped = 0;   // pushes rejected while full
+static bool ring_draining = false;  // a task is in log_drain()
+static portMUX_TYPE ring_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void log_push(uint8_t level, const char* fmt, const log_arg_t* args, uint8_t nargs) {
+  uint32_t now = millis();
+
+  portENTER_CRITICAL(&ring_mux);
+  if (ring_head - ring_tail >= (uint32_t)LOG_RING_SIZE) {
+    ring_dropped++;
+    portEXIT_CRITICAL(&ring_mux);
+    return;
+  }
+  LogRecord& r = ring[ring_head & (LOG_RING_SIZE - 1)];
+  r.ms = now;
+  r.fmt = fmt;
+  r.level = level;
+  r.nargs = nargs;
+  for (uint8_t i = 0; i < nargs; i++) r.args[i] = args[i];
+  ring_head++;
+  portEXIT_CRITICAL(&ring_mux);
+}
+
+int log_pending() {
+  portENTER_CRITICAL(&ring_mux);
+  int n = (int)(ring_head - ring_tail);
+  portEXIT_CRITICAL(&ring_mux);
+  return n;
+}
+
+// ===================== FORMATTER =====================
+static const char LEVEL_CH[] = { '-', 'E', 'W', 'I', 'D' };
+
+// Expands one record into buf. Each conversion is re-issued to snprintf with
+// a normalized spec, so the stored args never go through a fake va_list.
+static size_t format_record(const LogRecord& r, char* buf, size_t cap) {
+  size_t n = (size_t)snprintf(buf, cap, "[%lu][%c] ",
+                              (unsigned long)r.ms, LEVEL_CH[r.level < 5 ? r.level : 0]);
+  if (n >= cap) n = cap - 1;
+
+  uint8_t argi = 0;
+  const char* p = r.fmt;
+  while (*p && n < cap - 1) {
+    if (*p != '%') { buf[n++] = *p++; continue; }
+    if (p[1] == '%') { buf[n++] = '%'; p += 2; continue; }
+
+    // copy "%[flags][width][.prec]" and skip length modifiers
+    char spec[16];
+    size_t sl = 0;
+    spec[sl++] = *p++;
+    while (*p && strchr("-+ #0123456789.", *p) && sl < sizeof(spec) - 3) spec[sl++] = *p++;
+    while (*p && strchr("hlzjt", *p)) p++;
+    char conv = *p ? *p++ : 's';
+
+    log_arg_t a = (argi < r.nargs) ? r.args[argi++] : 0;
+    size_t room = cap - n;
+    int w = 0;
+    switch (conv) {
+      case 'd': case 'i':
+        spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+        w = snprintf(buf + n, room, spec, (long)(intptr_t)a);
+        break;
+      case 'u': case 'x': case 'X': case 'o':
+        spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+        w = snprintf(buf + n, room, spec, (unsigned long)a);
+        break;
+      case 'c':
+        spec[sl++] = 'c'; spec[sl] = '\0';
+        w = snprintf(buf + n, room, spec, (int)a);
+        break;
+      case 's':
+        spec[sl++] = 's'; spec[sl] = '\0';
+        w = snprintf(buf + n, room, spec, a ? (const char*)a : "(null)");
+        break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+        uint32_t bits = (uint32_t)a;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        spec[sl++] = conv; spec[sl] = '\0';
+        w = snprintf(buf + n, room, spec, (double)f);
+        break;
+      }
+      case 'p':
+        spec[sl++] = 'p'; spec[sl] = '\0';
+        w = snprintf(buf + n, room, spec, (void*)a);
+        break;
+      default:
+        w = snprintf(buf + n, room, "%%%c", conv);
+        break;
+    }
+    if (w > 0) n += ((size_t)w < room) ? (size_t)w : room - 1;
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+// ===================== DRAIN =====================
+// The loop task drains at idle and the network task flushes before deep
+// sleep; only one of them may pop and print at a time, or lines interleave.
+static bool drain_begin() {
+  portENTER_CRITICAL(&ring_mux);
+  bool ok = !ring_draining;
+  ring_draining = true;
+  portEXIT_CRITICAL(&ring_mux);
+  return ok;
+}
+
+static void drain_end() {
+  portENTER_CRITICAL(&ring_mux);
+  ring_draining = false;
+  portEXIT_CRITICAL(&ring_mux);
+}
+
+static bool drain_busy() {
+  portENTER_CRITICAL(&ring_mux);
+  bool busy = ring_draining;
+  portEXIT_CRITICAL(&ring_mux);
+  return busy;
+}
+
+// Pops and prints up to max_records. Unless blocking, a record is only
+// popped once its formatted line fits the UART TX buffer.
+static int drain_records(Print& out, int max_records, bool blocking) {
+  if (!drain_begin()) return 0;
+  char line[160];
+  int written = 0;
+
+  uint32_t dropped;
+  portENTER_CRITICAL(&ring_mux);
+  dropped = ring_dropped;
+  ring_dropped = 0;
+  portEXIT_CRITICAL(&ring_mux);
+  if (dropped) {
+    snprintf(line, sizeof(line), "[log] %lu records dropped\n", (unsigned long)dropped);
+    out.print(line);
+  }
+
+  while (written < max_records) {
+    // only the drainer moves the tail, so the record can be read first and
+    // popped once it is printed
+    LogRecord r;
+    portENTER_CRITICAL(&ring_mux);
+    if (ring_tail == ring_head) {
+      portEXIT_CRITICAL(&ring_mux);
+      break;
+    }
+    r = ring[ring_tail & (LOG_RING_SIZE - 1)];
+    portEXIT_CRITICAL(&ring_mux);
+
+    size_t n = format_record(r, line, sizeof(line) - 1);
+    line[n++] = '\n';
+    // leave the draining to the next idle slot rather than block on the UART
+    if (!blocking && &out == &Serial && Serial.availableForWrite() < (int)n) break;
+    out.write((const uint8_t*)line, n);
+
+    portENTER_CRITICAL(&ring_mux);
+    ring_tail++;
+    portEXIT_CRITICAL(&ring_mux);
+    written++;
+  }
+  drain_end();
+  return written;
+}
+
+int log_drain(Print& out, int max_records) {
+  return drain_records(out, max_records, false);
+}
+
+void log_flush() {
+  // wait out another task's drain, whose last line may still be printing;
+  // then write what is left, blocking on the UART
+  for (;;) {
+    while (drain_busy()) delay(1);
+    drain_records(Serial, LOG_RING_SIZE, true);
+    if (log_pending() == 0 && !drain_busy()) break;
+  }
+  Serial.flush();
+}
+
+// ===================== BENCHMARK =====================
+#ifdef LOG_BENCHMARK
+class NullPrint : public Print {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t n) override { return n; }
+};
+
+static void bench_report(Print& out, const char* name, uint32_t cycles, int n) {
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  uint32_t per = cycles / (uint32_t)n;
+  out.printf("[log-bench] %-22s %6lu cycles/call  %6lu ns/call\n",
+             name, (unsigned long)per, (unsigned long)(per * 1000UL / mhz));
+}
+
+void log_benchmark(Print& out) {
+  const int N = 256;
+  static volatile int sink = 0;
+  NullPrint null_out;
+  log_flush();
+
+  // loop overhead only; a compiled-out LOGx compiles to nothing
+  uint32_t c0 = ESP.getCycleCount();
+  for (int i = 0; i < N; i++) {
+    sink = i;
+#if LOG_LEVEL < LOG_LEVEL_DEBUG
+    LOGD("bench %d %d", i, sink);
+#endif
+  }
+  bench_report(out, "compiled out (LOGD)", ESP.getCycleCount() - c0, N);
+
+  // deferred: push only (ring sized so nothing is dropped)
+  uint32_t push_cycles = 0;
+  uint32_t drain_cycles = 0;
+  for (int done = 0; done < N; done += LOG_RING_SIZE / 2) {
+    c0 = ESP.getCycleCount();
+    for (int i = 0; i < LOG_RING_SIZE / 2; i++) {
+      log_write(LOG_LEVEL_INFO, "bench %d %d", i, sink);
+    }
+    push_cycles += ESP.getCycleCount() - c0;
+
+    c0 = ESP.getCycleCount();
+    log_drain(null_out);
+    drain_cycles += ESP.getCycleCount() - c0;
+  }
+  bench_report(out, "deferred push", push_cycles, N);
+  bench_report(out, "deferred format (idle)", drain_cycles, N);
+
+  // synchronous printf to the UART, the previous behaviour
+  Serial.flush();
+  c0 = ESP.getCycleCount();
+  for (int i = 0; i < N / 8; i++) {
+    Serial.printf("[%lu][I] bench %d %d\n", (unsigned long)millis(), i, sink);
+  }
+  Serial.flush();
+  bench_report(out, "synchronous printf", ESP.getCycleCount() - c0, N / 8);
+}
+#endif
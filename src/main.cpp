@@ -1,11 +1,32 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <Preferences.h>
 #include <SPI.h>
 #include <math.h>
 
 #include "epd2in66g.h"
 #include "epdif.h"
+#include "log.h"
+#include "trace.h"
+#include "metrics.h"
+#include "canvas.h"
+#include "netconn.h"
+#include "wake_cycle.h"
+#include "sleep_sched.h"
+#include "update_queue.h"
+#include "signal_filter.h"
+#include "trend.h"
+#include "history.h"
+#include "flash_log.h"
+#include "sparkline.h"
+#include "topic_router.h"
+#include "decode.h"
+#include "remote_frame.h"
+#include "display_pipe.h"
+#include "wake_graph.h"
+#include "spec_cache.h"
+#include "frame_hash.h"
 
 #ifndef WIFI_SSID
 #error "WIFI_SSID is not defined. Create secrets.ini and set [secrets] WIFI_SSID"
@@ -31,21 +52,132 @@ static const uint16_t MQTT_PORT_U16 = (uint16_t)MQTT_PORT;
 static const char* MQTT_USER_S = MQTT_USER;           // optional
 static const char* MQTT_PASS_S = MQTT_PASS;              // optional
 
-// Topic that HA publishes (integer, retained)
-static const char* TOPIC_TEMP_INT = "boiler/temp_int";
+// Topics and payload formats, in display order: boiler (the big digits,
+// retained), then tank / outdoor / setpoint for the left column ("" = not
+// shown). MQTT wildcards work, e.g. "weather/+/temperature".
+// Formats: decode_number_route (plain "42" / "41.6"), decode_json_route
+// with a path such as "$.temperature", decode_cbor_route with a map key path.
+struct TopicConfig {
+  const char* topic;
+  TopicDecoder decode;
+  const char* path;
+};
+
+static const TopicConfig TOPICS[] = {
+  { "boiler/temp_int",  decode_number_route, nullptr },
+  { "boiler/tank_temp", decode_number_route, nullptr },
+  { "outdoor/temp_int", decode_number_route, nullptr },
+  { "boiler/setpoint",  decode_number_route, nullptr },
+};
+
+// Binary span trace (see tools/trace2chrome.py); also dumped as text on
+// Serial when a 't' is received
+static const char* TOPIC_TRACE = "boiler/epd/trace";
+static const bool PUBLISH_TRACE_BEFORE_SLEEP = false;
+
+// All metrics as one JSON message: before each deep sleep, or periodically
+// when staying awake
+static const char* TOPIC_METRICS = "boiler/epd/metrics";
+static const uint32_t METRICS_PUBLISH_INTERVAL_MS = 15UL * 60UL * 1000UL;
+
+// --- Remote framebuffer (see tools/rframe.py) ---
+// Show frames rendered on a server instead of drawing locally; the value
+// topics above are then not subscribed. The CRC of the frame on the panel
+// is published (retained) on the state topic so the server can send deltas.
+static const bool REMOTE_FRAMEBUFFER = false;
+static const char* TOPIC_FRAME = "boiler/epd/frame";
+static const char* TOPIC_FRAME_STATE = "boiler/epd/frame/state";
+// the device asks for a resend from the first missing chunk here
+static const char* TOPIC_FRAME_NACK = "boiler/epd/frame/nack";
+// Decode straight into the panel RAM instead of img: no frame-sized buffer
+// is used, but only key frames can be shown (no base for deltas)
+static const bool REMOTE_FRAME_DIRECT = false;
+// a new transfer waits this long for img while the last frame is being sent
+static const uint32_t RFRAME_FB_WAIT_MS = 2000;
+
+// --- Rendering ---
+// Copy the static part of the screen (border, header, labels) from a cache
+// instead of drawing it (tools/render_bench checks the result is identical)
+static const bool BACKGROUND_CACHE = true;
 
 // --- Transition behavior ---
 static const bool ENABLE_COLOR_TRANSITION_EVERY_UPDATE = true;
 static const uint16_t TRANSITION_DELAY_MS = 250;
+// 24 h graph under the digits
+static const bool SHOW_SPARKLINE = true;
+// Bursts of messages collapse into one refresh with the newest value; at most
+// one refresh per interval, except when the header color has to change
+static const uint32_t MIN_REFRESH_INTERVAL_MS = 60000;
+
+// --- Signal conditioning (see tools/filter_replay) ---
+// Median of the last N readings (1 = off) rejects single-sample outliers,
+// but shows each value only once the next reading confirms it: with a
+// publisher that only sends on change (Home Assistant) the panel stays a
+// reading behind. Optional EWMA (weight of a new reading in 1/16, 0 = off)
+static const uint8_t FILTER_MEDIAN_N = 1;
+static const uint8_t FILTER_EWMA_ALPHA_X16 = 0;
+// Refresh only for changes of at least this many °C...
+static const int FILTER_DEADBAND = 1;
+// ...and change the header color only this far past its threshold, so
+// 41 <-> 42 flapping at the red/yellow boundary does not flip it (the
+// number still follows)
+static const int FILTER_HYSTERESIS = 1;
+
+// --- Trend arrow ---
+// Least-squares slope over the last 16 readings. The arrow only changes when
+// the slope is TREND_MIN_T_STAT_X10/10 standard errors away from zero;
+// slower than TREND_STEADY (°C/h x10) hides it, faster than TREND_FAST
+// shows the double arrow (0 = off)
+static const uint16_t TREND_STEADY_X10_PER_H = 5;
+static const uint16_t TREND_FAST_X10_PER_H = 60;
+static const uint8_t TREND_MIN_T_STAT_X10 = 20;
+static const uint8_t TREND_MIN_SAMPLES = 4;
 
 // --- Deep sleep (optional) ---
 static const bool USE_DEEP_SLEEP = false;
 static const uint32_t SLEEP_SECONDS = 900;
+// Pick each sleep from the temperature trend instead (SLEEP_SECONDS is then
+// only used until enough readings are known)
+static const bool ADAPTIVE_SLEEP = true;
+static const uint32_t SLEEP_MIN_SECONDS = 120;
+static const uint32_t SLEEP_MAX_SECONDS = 3600;
+// Fastest heating expected (°C/h x10): a sleep never lasts longer than this
+// rate needs to reach the next header color threshold (tools/sched_sim)
+static const uint16_t SLEEP_MAX_RATE_X10_PER_H = 300;
+// With deep sleep: give up and sleep if MQTT is not up this long after boot
+static const uint32_t WAKE_NET_BUDGET_MS = 30000;
+// ...and sleep as soon as the retained value is handled. Without it, wait
+// learned broker latency x3 + 300 ms (1..15 s; 15 s until first measured)
+static const uint32_t RETAINED_WAIT_MIN_MS = 1000;
+static const uint32_t RETAINED_WAIT_MAX_MS = 15000;
+static const uint32_t RETAINED_WAIT_MARGIN_MS = 300;
+static const uint8_t RETAINED_WAIT_LATENCY_MULT = 3;
+
+// --- Wake path ---
+// Power up the panel and sample the battery at boot, while WiFi connects,
+// instead of once a refresh is due. false = the old serial order, to
+// compare the wake_pixel_ms metric.
+static const bool OVERLAP_WAKE = true;
+// Meanwhile, draw the frames the next value most likely needs (last reading
+// +-1/+-2 along the trend, see tools/spec_replay) so the refresh can skip
+// drawing
+static const bool SPECULATIVE_RENDER = true;
+
+// --- Connection retries ---
+// Reconnect after deep sleep with the RTC-cached AP/channel/IP/broker address
+static const bool WIFI_FAST_RECONNECT = true;
+static const uint32_t WIFI_FAST_ATTEMPT_MS = 3000;
+// Reuse a DHCP address without asking again for this long; must stay well
+// below the router's lease time (typically 12-24 h)
+static const uint32_t WIFI_LEASE_REUSE_S = 3600;
+static const uint32_t WIFI_ATTEMPT_MS = 10000;
+static const uint32_t NET_BACKOFF_MIN_MS = 1000;
+static const uint32_t NET_BACKOFF_MAX_MS = 60000;
 
 // ===================== BATTERY CONFIG =====================
 static const bool ENABLE_BATTERY_ICON = false;
 
-static const int  BAT_ADC_PIN = 34;     // ADC1 pin recommended
+static const int  BAT_ADC_PIN = 34;     // ADC1 only: sampled while WiFi is on
 static const float ADC_VREF = 3.3f;
 static const float ADC_MAX = 4095.0f;
 
@@ -57,484 +189,1022 @@ static const float VBAT_EMPTY = 3.20f;
 static const float VBAT_FULL  = 4.15f;
 
 // ===================== DISPLAY =====================
-static const int W = EPD_WIDTH;    // 184
-static const int H = EPD_HEIGHT;   // 360
-static const int ROW_BYTES = (W % 4 == 0) ? (W / 4) : (W / 4 + 1);
-static uint8_t img[ROW_BYTES * H];
-
-// Waveshare 2.66G colors (from your driver)
-static const uint8_t C_BLACK  = black;
-static const uint8_t C_WHITE  = white;
-static const uint8_t C_YELLOW = yellow;
-static const uint8_t C_RED    = red;
-
-// ===================== LANDSCAPE COORD SYSTEM =====================
-// Logical landscape coordinates: 360x184
-// Mapping: 90° clockwise => physical x=LY, physical y=H-1-LX
-static inline void set_px_l(int lx, int ly, uint8_t c) {
-  int x = ly;
-  int y = H - 1 - lx;
-  if (x < 0 || x >= W || y < 0 || y >= H) return;
-
-  int byteIndex = y * ROW_BYTES + (x / 4);
-  int shift = (3 - (x % 4)) * 2;
-  img[byteIndex] =
-    (img[byteIndex] & ~(0x3 << shift)) | ((c & 0x3) << shift);
-}
-
-static void fill(uint8_t c) {
-  uint8_t v =
-    ((c & 0x3) << 6) |
-    ((c & 0x3) << 4) |
-    ((c & 0x3) << 2) |
-    (c & 0x3);
-  memset(img, v, sizeof(img));
-}
-
-static void rect_l(int x, int y, int w, int h, uint8_t c) {
-  for (int yy = y; yy < y + h; yy++)
-    for (int xx = x; xx < x + w; xx++)
-      set_px_l(xx, yy, c);
-}
-
-static void hline_l(int x, int y, int w, uint8_t c) { rect_l(x, y, w, 1, c); }
-static void vline_l(int x, int y, int h, uint8_t c) { rect_l(x, y, 1, h, c); }
-
-static void border_l(uint8_t c) {
-  const int CANVAS_W = 360;
-  const int CANVAS_H = 184;
-  hline_l(0, 0, CANVAS_W, c);
-  hline_l(0, CANVAS_H - 1, CANVAS_W, c);
-  vline_l(0, 0, CANVAS_H, c);
-  vline_l(CANVAS_W - 1, 0, CANVAS_H, c);
-}
-
-// ===================== SIMPLE 5x7 BLOCK FONT =====================
-static void draw_char_5x7_l(int x, int y, char ch, int scale, uint8_t c) {
-  const uint8_t* rows = nullptr;
-
-  static const uint8_t B_[7] = {0b11110,0b10001,0b10001,0b11110,0b10001,0b10001,0b11110};
-  static const uint8_t O_[7] = {0b01110,0b10001,0b10001,0b10001,0b10001,0b10001,0b01110};
-  static const uint8_t I_[7] = {0b11111,0b00100,0b00100,0b00100,0b00100,0b00100,0b11111};
-  static const uint8_t L_[7] = {0b10000,0b10000,0b10000,0b10000,0b10000,0b10000,0b11111};
-  static const uint8_t E_[7] = {0b11111,0b10000,0b10000,0b11110,0b10000,0b10000,0b11111};
-  static const uint8_t R_[7] = {0b11110,0b10001,0b10001,0b11110,0b10100,0b10010,0b10001};
-  static const uint8_t T_[7] = {0b11111,0b00100,0b00100,0b00100,0b00100,0b00100,0b00100};
-  static const uint8_t M_[7] = {0b10001,0b11011,0b10101,0b10101,0b10001,0b10001,0b10001};
-  static const uint8_t P_[7] = {0b11110,0b10001,0b10001,0b11110,0b10000,0b10000,0b10000};
-  static const uint8_t A_[7] = {0b01110,0b10001,0b10001,0b11111,0b10001,0b10001,0b10001};
-  static const uint8_t C_[7] = {0b01111,0b10000,0b10000,0b10000,0b10000,0b10000,0b01111};
-  static const uint8_t SPC[7] = {0,0,0,0,0,0,0};
-
-  switch (ch) {
-    case 'B': rows = B_; break;
-    case 'O': rows = O_; break;
-    case 'I': rows = I_; break;
-    case 'L': rows = L_; break;
-    case 'E': rows = E_; break;
-    case 'R': rows = R_; break;
-    case 'T': rows = T_; break;
-    case 'M': rows = M_; break;
-    case 'P': rows = P_; break;
-    case 'A': rows = A_; break;
-    case 'C': rows = C_; break;
-    default: rows = SPC; break;
-  }
-
-  for (int ry = 0; ry < 7; ry++) {
-    uint8_t bits = rows[ry];
-    for (int rx = 0; rx < 5; rx++) {
-      if (bits & (1 << (4 - rx))) {
-        rect_l(x + rx*scale, y + ry*scale, scale, scale, c);
-      }
+// canvas.h must agree with the driver on geometry and color codes
+static_assert(PANEL_W == EPD_WIDTH && PANEL_H == EPD_HEIGHT, "canvas size != panel size");
+static_assert(C_BLACK == black && C_WHITE == white && C_YELLOW == yellow && C_RED == red,
+              "canvas colors != panel colors");
+
+// ===================== BATTERY % (ADC) =====================
+static int read_battery_percent() {
+  if (!ENABLE_BATTERY_ICON) return -1;
+
+  uint32_t sum = 0;
+  const int N = 20;
+  for (int i = 0; i < N; i++) {
+    sum += analogRead(BAT_ADC_PIN);
+    delay(2);
+  }
+  float raw = (float)sum / (float)N;
+  float v_adc = (raw / ADC_MAX) * ADC_VREF;
+  float v_bat = v_adc * DIVIDER_RATIO;
+
+  float pctf = (v_bat - VBAT_EMPTY) / (VBAT_FULL - VBAT_EMPTY) * 100.0f;
+  if (pctf < 0) pctf = 0;
+  if (pctf > 100) pctf = 100;
+  int pct = (int)lroundf(pctf);
+  metric_set(M_BATTERY_PCT, pct);
+  return pct;
+}
+
+// ===================== E-PAPER =====================
+// keep last displayed temp across deep sleep
+RTC_DATA_ATTR int rtc_lastDisplayed = -9999;
+// the value the header color is picked from (filter_theme())
+RTC_DATA_ATTR int rtc_themeTemp = -9999;
+
+// display list hash of the frame the panel shows (0 = unknown); set by
+// the display task next to rtc_shown_frame
+RTC_DATA_ATTR uint32_t rtc_shown_list = 0;
+
+// frame_hash() of what the panel shows (0 = unknown). E-paper keeps its
+// image without power, so it is kept in NVS as well: after a power loss
+// the RTC copy is gone, the NVS one still tells what is on the panel.
+RTC_DATA_ATTR uint32_t rtc_shown_frame = 0;
+static const char* const SHOWN_NVS_NAMESPACE = "panel";
+static const char* const SHOWN_NVS_KEY = "shown";
+static Preferences shown_prefs;
+static bool shown_prefs_ok = false;
+static uint32_t nvs_shown = 0;   // value stored under SHOWN_NVS_KEY
+
+// At boot, before the display task runs. NVS is written after a refresh
+// only, so a refresh cut short leaves the old hash there. The stored
+// value is trusted after a plain power-on (battery swapped, most likely
+// while asleep) or a deep sleep wake; after a brown-out, crash or watchdog
+// reset the panel may be half drawn and it is dropped.
+static void shown_frame_begin() {
+  shown_prefs_ok = shown_prefs.begin(SHOWN_NVS_NAMESPACE, false);
+  if (!shown_prefs_ok) {
+    LOGW("[EPD] NVS unavailable, shown frame kept in RTC only");
+    return;
+  }
+  nvs_shown = shown_prefs.getUInt(SHOWN_NVS_KEY, 0);
+  esp_reset_reason_t why = esp_reset_reason();
+  if (why != ESP_RST_POWERON && why != ESP_RST_DEEPSLEEP) {
+    rtc_shown_frame = 0;
+    rtc_shown_list = 0;
+    if (nvs_shown) {
+      LOGW("[EPD] reset during a refresh possible, shown frame unknown");
+      shown_prefs.putUInt(SHOWN_NVS_KEY, 0);
+      nvs_shown = 0;
     }
+    return;
   }
+  if (!rtc_shown_frame) rtc_shown_frame = nvs_shown;
 }
 
-static int text_width_5x7(const char* s, int scale, int spacing) {
-  int n = (int)strlen(s);
-  if (n == 0) return 0;
-  return n * (5*scale + spacing) - spacing;
+// Display task only. 0 ("unknown", just before a refresh) goes to RTC
+// only, a hash to NVS as well when it differs from the stored one: one
+// NVS write per refresh, after it. list: the display list hash, RTC only.
+static void shown_frame_set(uint32_t hash, uint32_t list) {
+  rtc_shown_frame = hash;
+  rtc_shown_list = list;
+  if (!hash || hash == nvs_shown || !shown_prefs_ok) return;
+  shown_prefs.putUInt(SHOWN_NVS_KEY, hash);
+  nvs_shown = hash;
 }
 
-static void draw_text_5x7_l(int x, int y, const char* s, int scale, int spacing, uint8_t c) {
-  int cx = x;
-  for (const char* p = s; *p; p++) {
-    draw_char_5x7_l(cx, y, *p, scale, c);
-    cx += (5*scale + spacing);
-  }
+// Counts a refresh as skipped (the panel already shows the frame) or
+// shown. Render task, or the network task for remote frames; never both.
+static void count_refresh(bool skipped) {
+  if (skipped) metric_inc(M_REFRESH_SAME);
+  uint32_t same = metrics_store.counters[M_REFRESH_SAME];
+  // a refresh just submitted is not counted by the display task yet
+  uint32_t shown = metrics_store.counters[M_REFRESHES] + (skipped ? 0 : 1);
+  metric_set(M_REFRESH_SKIP_PCT, (int32_t)(same * 100 / (same + shown)));
 }
 
-// ===================== 7-SEG DIGITS =====================
-static void draw_digit7seg_l(int x, int y, int s, int d, uint8_t c) {
-  bool seg[7] = {0};
-  switch (d) {
-    case 0: seg[0]=seg[1]=seg[2]=seg[3]=seg[4]=seg[5]=1; break;
-    case 1: seg[1]=seg[2]=1; break;
-    case 2: seg[0]=seg[1]=seg[6]=seg[4]=seg[3]=1; break;
-    case 3: seg[0]=seg[1]=seg[6]=seg[2]=seg[3]=1; break;
-    case 4: seg[5]=seg[6]=seg[1]=seg[2]=1; break;
-    case 5: seg[0]=seg[5]=seg[6]=seg[2]=seg[3]=1; break;
-    case 6: seg[0]=seg[5]=seg[6]=seg[2]=seg[3]=seg[4]=1; break;
-    case 7: seg[0]=seg[1]=seg[2]=1; break;
-    case 8: for (int i=0;i<7;i++) seg[i]=1; break;
-    case 9: seg[0]=seg[1]=seg[2]=seg[3]=seg[5]=seg[6]=1; break;
-    default: break;
+// median window / EWMA, kept across deep sleep
+RTC_DATA_ATTR FilterState rtc_filter;
+static FilterConfig filter_cfg;
+
+// sample ring for the trend arrow, and the arrow on the panel
+RTC_DATA_ATTR TrendState rtc_trend;
+RTC_DATA_ATTR uint8_t rtc_lastArrow = ARROW_NONE;
+static TrendConfig trend_cfg;
+
+// compressed reading history (~2 weeks at one reading per 15 min); send 'h'
+// on the serial monitor for a summary
+RTC_DATA_ATTR HistoryStore rtc_history;
+
+// ...and every reading in the "history" flash partition (survives power loss)
+static const bool FLASH_HISTORY = true;
+static bool flash_history_ok = false;
+
+// per-pixel-column min/max of the last 24 h for the sparkline
+RTC_DATA_ATTR SparkState rtc_spark;
+
+// Display slots; each topic route feeds one
+enum DisplaySlot : uint8_t { SLOT_BOILER = 0, SLOT_TANK, SLOT_OUTDOOR, SLOT_SETPOINT, SLOT_COUNT };
+static const int SIDE_COUNT = SLOT_COUNT - 1;
+static_assert(sizeof(TOPICS) / sizeof(TOPICS[0]) == SLOT_COUNT, "one topic per display slot");
+static const char* const SIDE_LABELS[SIDE_COUNT] = { "TANK", "OUT", "SET" };
+
+// last secondary values, shown with the next refresh
+RTC_DATA_ATTR int rtc_side_value[SIDE_COUNT];
+RTC_DATA_ATTR bool rtc_side_valid[SIDE_COUNT];
+static bool side_enabled[SIDE_COUNT];
+static bool side_dirty = false;   // changed since the last refresh
+
+static int collect_side_values(SideValue* out) {
+  int n = 0;
+  for (int i = 0; i < SIDE_COUNT; i++) {
+    if (!side_enabled[i]) continue;
+    out[n].label = SIDE_LABELS[i];
+    out[n].value = rtc_side_value[i];
+    out[n].valid = rtc_side_valid[i];
+    n++;
   }
+  return n;
+}
 
-  int t = s;
-  int w = 6*s;
-  int h = 10*s;
+// guards the value state above (filter, trend, history, sparkline, side
+// values) between the MQTT callbacks on the network task, the render task
+// and the serial commands
+static SemaphoreHandle_t state_lock = nullptr;
+
+struct StateLock {
+  StateLock() { xSemaphoreTake(state_lock, portMAX_DELAY); }
+  ~StateLock() { xSemaphoreGive(state_lock); }
+};
+
+// What this wake achieved, for the sleep scheduler
+static WakeOutcome wake_outcome = WAKE_NO_MESSAGE;
+static int wake_value = 0;
+
+// ===================== DISPLAY TASK =====================
+// Sole owner of the panel. Frames arrive through display_pipe; a frame
+// buffer goes back to the pool right after its SPI transfer, so the render
+// task can draw the next one during the multi-second refresh.
+static const int DISPLAY_QUEUE_DEPTH = 4;
+static const uint32_t DISPLAY_STACK = 4096;
+static const UBaseType_t DISPLAY_PRIO = 2;
+static const BaseType_t DISPLAY_CORE = 1;
 
-  if (seg[0]) rect_l(x + t, y, w - 2*t, t, c);
-  if (seg[1]) rect_l(x + w - t, y + t, t, (h/2) - t, c);
-  if (seg[2]) rect_l(x + w - t, y + h/2, t, (h/2) - t, c);
-  if (seg[3]) rect_l(x + t, y + h - t, w - 2*t, t, c);
-  if (seg[4]) rect_l(x, y + h/2, t, (h/2) - t, c);
-  if (seg[5]) rect_l(x, y + t, t, (h/2) - t, c);
-  if (seg[6]) rect_l(x + t, y + (h/2) - (t/2), w - 2*t, t, c);
-}
+Epd epd;
+
+// second frame buffer for local rendering (img is the first)
+static uint8_t img_back[FRAME_BYTES];
 
-static void draw_degC_icon_l(int x, int y, uint8_t fg, uint8_t bg) {
-  // degree box
-  rect_l(x,     y,     6, 6, fg);
-  rect_l(x + 2, y + 2, 2, 2, bg);
+static bool panel_powered = false;   // Init done, not put to sleep since
+
+// Powers the panel up unless it still is (early init at boot).
+static bool panel_up() {
+  if (panel_powered) return true;
+  wake_stage_start(WS_PANEL);
+  panel_powered = epd.Init() == 0;
+  if (!panel_powered) LOGE("[EPD] Init failed");
+  else wake_stage_end(WS_PANEL);
+  return panel_powered;
+}
 
-  // "C" block
-  int cx = x + 10;
-  int cy = y + 2;
-  rect_l(cx, cy,     14, 3, fg);
-  rect_l(cx, cy,      3, 16, fg);
-  rect_l(cx, cy + 13, 14, 3, fg);
+static void panel_down() {
+  if (!panel_powered) return;
+  epd.Sleep();
+  panel_powered = false;
 }
 
-// ===================== ARROWS =====================
-enum ArrowDir : uint8_t { ARROW_NONE=0, ARROW_UP=1, ARROW_DOWN=2 };
+// The refresh is triggered by the caller right after this.
+static void mark_first_pixel() {
+  if (wake_stage_end(WS_PIXEL)) wake_graph_report();
+}
 
-// Small triangle arrow (filled) in logical landscape coords
-static void draw_arrow_up_l(int x, int y, int size, uint8_t c) {
-  // apex at top center
-  for (int r = 0; r < size; r++) {
-    int w = 1 + 2*r;
-    int start = x - r;
-    rect_l(start, y + r, w, 1, c);
-  }
-  // small stem
-  rect_l(x - 1, y + size, 3, size + 2, c);
+static void finish_update(uint32_t t0) {
+  panel_down();
+  metric_inc(M_REFRESHES);
+  metric_observe(M_H_REFRESH_MS, millis() - t0);
+  LOGI("[EPD] done");
 }
 
-static void draw_arrow_down_l(int x, int y, int size, uint8_t c) {
-  // apex at bottom center
-  for (int r = 0; r < size; r++) {
-    int w = 1 + 2*r;
-    int start = x - r;
-    rect_l(start, y + (size - 1 - r), w, 1, c);
+static void display_task(void*) {
+  uint32_t t0 = 0;
+  DisplayJob job;
+  for (;;) {
+    if (!display_next(job, UINT32_MAX)) continue;
+    switch (job.op) {
+      case DISP_FRAME:
+        if (job.flags & DISP_INIT) {
+          t0 = millis();
+          wake_stage_start(WS_PIXEL);
+          if (panel_up() && (job.flags & DISP_CLEAR)) {
+            shown_frame_set(0, 0);
+            epd.Clear(C_WHITE);
+          }
+        }
+        if (job.delay_ms) vTaskDelay(pdMS_TO_TICKS(job.delay_ms));
+        if (panel_powered) {
+          epd.StreamBegin();
+          epd.StreamWrite(job.fb, FRAME_BYTES);
+        }
+        // in panel RAM now; the refresh does not need the buffer
+        if (job.flags & DISP_RELEASE) display_release(job.fb);
+        if (panel_powered) {
+          mark_first_pixel();
+          shown_frame_set(0, 0);   // in case the refresh is cut short
+          epd.StreamEnd();
+          if (job.flags & DISP_SLEEP) {
+            shown_frame_set(job.hash, job.list);
+            finish_update(t0);
+          }
+        }
+        break;
+      case DISP_STREAM_BEGIN:
+        t0 = millis();
+        wake_stage_start(WS_PIXEL);
+        if (panel_up()) epd.StreamBegin();
+        break;
+      case DISP_STREAM_DATA:
+        if (panel_powered) epd.StreamWrite(job.data, job.len);
+        break;
+      case DISP_STREAM_END:
+        if (panel_powered) {
+          mark_first_pixel();
+          shown_frame_set(0, 0);
+          epd.StreamEnd();
+          shown_frame_set(job.hash, 0);
+          finish_update(t0);
+        }
+        break;
+      case DISP_STREAM_ABORT:
+        // panel RAM holds a partial frame: power down without showing it
+        panel_down();
+        break;
+      case DISP_POWER_UP:
+        panel_up();
+        break;
+      case DISP_POWER_DOWN:
+        panel_down();
+        break;
+    }
+    display_done();
   }
-  // small stem above
-  rect_l(x - 1, y - (size + 2), 3, size + 2, c);
 }
 
-// ===================== THEME BY TEMP =====================
-struct Theme { uint8_t header_bg; uint8_t header_fg; };
+// ===================== RENDER TASK =====================
+// Takes posted values, runs the display decision and draws frames into
+// pool buffers. Woken by the MQTT callbacks; otherwise it only wakes when
+// a held value or secondary change becomes due.
+static const uint32_t RENDER_STACK = 6144;
+static const UBaseType_t RENDER_PRIO = 1;
+static const BaseType_t RENDER_CORE = 1;
+
+static TaskHandle_t render_handle = nullptr;
+static volatile bool render_busy = false;   // between taking a value and submitting its frames
+
+// Everything one refresh draws, copied under the state lock.
+struct RenderJob {
+  int temp;
+  int theme_temp;   // picks the header color; lags temp within the hysteresis
+  ArrowDir dir;
+  bool show_spark;
+  SparkState spark;
+  SideValue side[SIDE_COUNT];
+  int side_count;
+};
+
+// Sampled once at boot, in parallel with the connect (OVERLAP_WAKE), for
+// the first refresh; later refreshes sample again.
+static int battery_pct = -1;
+static bool battery_fresh = false;
+
+static void sample_battery() {
+  wake_stage_start(WS_BATTERY);
+  battery_pct = read_battery_percent();
+  battery_fresh = true;
+  wake_stage_end(WS_BATTERY);
+}
 
-static Theme theme_for_temp(int t) {
-  // your existing rule
-  if (t > 41) return Theme{C_RED, C_WHITE};
-  if (t > 36 && t <= 41) return Theme{C_YELLOW, C_BLACK};
-  // requested: low temp header black w/ white text
-  return Theme{C_BLACK, C_WHITE};
+static int battery_for_refresh() {
+  if (!battery_fresh) sample_battery();
+  battery_fresh = false;
+  return battery_pct;
 }
 
-// ===================== BATTERY % (ADC) =====================
-static int read_battery_percent() {
-  if (!ENABLE_BATTERY_ICON) return -1;
+static void wake_render() {
+  if (render_handle) xTaskNotifyGive(render_handle);
+}
 
-  uint32_t sum = 0;
-  const int N = 20;
-  for (int i = 0; i < N; i++) {
-    sum += analogRead(BAT_ADC_PIN);
-    delay(2);
+// --- Display lists ---
+// Frames are recorded as display lists first; equal list hashes mean
+// identical frames. Each pool buffer remembers the list it was last drawn
+// from, so the next frame there only repaints the boxes that changed.
+struct HeldFrame {
+  const uint8_t* fb;
+  bool valid;
+  DisplayList dl;
+};
+static HeldFrame held[DISPLAY_MAX_BUFFERS];
+
+static HeldFrame& held_frame(const uint8_t* fb) {
+  for (HeldFrame& h : held) {
+    if (h.fb == fb) return h;
   }
-  float raw = (float)sum / (float)N;
-  float v_adc = (raw / ADC_MAX) * ADC_VREF;
-  float v_bat = v_adc * DIVIDER_RATIO;
+  for (HeldFrame& h : held) {
+    if (!h.fb) {
+      h.fb = fb;
+      h.valid = false;
+      return h;
+    }
+  }
+  return held[0];   // not reached: one entry per pool buffer
+}
 
-  float pctf = (v_bat - VBAT_EMPTY) / (VBAT_FULL - VBAT_EMPTY) * 100.0f;
-  if (pctf < 0) pctf = 0;
-  if (pctf > 100) pctf = 100;
-  return (int)lroundf(pctf);
+// fb now holds dl's frame (nullptr: something else)
+static void held_set(const uint8_t* fb, const DisplayList* dl) {
+  HeldFrame& h = held_frame(fb);
+  h.valid = dl && !dl->overflow;
+  if (h.valid) h.dl = *dl;
 }
 
-// ===================== E-PAPER =====================
-Epd epd;
+static void build_job_list(DisplayList& dl, const RenderJob& job, int battery, uint8_t header_bg) {
+  build_screen_list(dl, job.temp, battery, job.dir, header_bg,
+                    job.show_spark ? &job.spark : nullptr, job.side, job.side_count);
+}
 
-// keep last displayed temp across deep sleep
-RTC_DATA_ATTR int rtc_lastDisplayed = -9999;
+// dl must be build_job_list() of the same arguments.
+static void draw_job(const RenderJob& job, int battery, uint8_t header_bg, const DisplayList& dl,
+                     uint8_t* fb) {
+  HeldFrame& h = held_frame(fb);
+  canvas_set_target(fb);
+  if (dl.overflow) {
+    draw_screen_frame(job.temp, battery, job.dir, header_bg,
+                      job.show_spark ? &job.spark : nullptr, job.side, job.side_count);
+  } else if (h.valid) {
+    canvas_repaint(h.dl, dl);
+  } else {
+    draw_list(dl);
+  }
+  held_set(fb, &dl);
+}
 
-static void draw_screen_frame(int tempC, int batteryPct, ArrowDir dir, uint8_t header_bg_override = 255) {
-  const int CANVAS_W = 360;
-  const int CANVAS_H = 184;
+// --- Speculative frames ---
+static bool spec_armed = false;   // spec_cache holds guesses for the next refresh
 
-  int t = tempC;
-  if (t < 0) t = 0;
-  if (t > 99) t = 99;
+// Stores frame under key, as a delta against base_key's frame if given.
+static bool spec_store(uint32_t key, const uint8_t* frame, uint32_t base_key, uint8_t* scratch) {
+  if (!base_key) return spec_put(key, frame, FRAME_BYTES);
+  return spec_get(base_key, scratch, FRAME_BYTES) &&
+         spec_put(key, frame, FRAME_BYTES, scratch, base_key);
+}
 
-  Theme th = theme_for_temp(t);
-  uint8_t header_bg = (header_bg_override == 255) ? th.header_bg : header_bg_override;
+// The first candidate is stored whole; later ones (and every transition
+// frame) as deltas against the first, which differ only in the digits.
+static bool spec_candidate(const RenderJob& job, uint8_t* fb, uint8_t* scratch, uint32_t& first_key,
+                           uint32_t& first_white_key) {
+  static DisplayList dl;
+  uint8_t header_bg = theme_for_temp(job.theme_temp).header_bg;
+  build_job_list(dl, job, battery_pct, header_bg);
+  if (dl.overflow) return false;   // no usable key
+  uint32_t key = list_hash(dl);
+  draw_job(job, battery_pct, header_bg, dl, fb);
+  if (!spec_store(key, fb, first_key, scratch)) return false;
+  if (!first_key) first_key = key;
+  if (!ENABLE_COLOR_TRANSITION_EVERY_UPDATE) return true;
+
+  build_job_list(dl, job, battery_pct, C_WHITE);
+  key = list_hash(dl);
+  draw_job(job, battery_pct, C_WHITE, dl, fb);
+  if (!spec_store(key, fb, first_white_key ? first_white_key : first_key, scratch)) return false;
+  if (!first_white_key) first_white_key = key;
+  return true;
+}
 
-  // Choose readable header fg
-  uint8_t header_fg = th.header_fg;
-  if (header_bg_override != 255) {
-    // if overriding to white for transition, use black text
-    if (header_bg_override == C_WHITE) header_fg = C_BLACK;
+// Runs while the wake waits for the network: each guessed reading goes
+// through copies of the filter, trend and sparkline the way a real one
+// would, so its value, arrow and graph match what the refresh will draw.
+static void speculate() {
+  static RenderJob base, cand;
+  static TrendState trend, cand_trend;
+  static FilterState filter, cand_filter;
+  uint8_t last_arrow;
+  int last_raw;
+  {
+    StateLock lock;
+    if (rtc_lastDisplayed == -9999) return;
+    base.temp = rtc_lastDisplayed;
+    base.theme_temp = rtc_themeTemp;
+    last_arrow = rtc_lastArrow;
+    trend = rtc_trend;
+    filter = rtc_filter;
+    base.show_spark = SHOW_SPARKLINE;
+    if (SHOW_SPARKLINE) base.spark = rtc_spark;
+    base.side_count = collect_side_values(base.side);
+  }
+  if (!trend_last(trend, last_raw)) last_raw = base.temp;
+
+  uint8_t* fb = display_acquire(0);
+  uint8_t* scratch = display_acquire(0);
+  if (fb && scratch) {
+    spec_reset();
+    uint32_t now_s = sched_now_s();
+    ArrowDir heading = trend_arrow(trend_cfg, trend, (ArrowDir)last_arrow);
+    int guesses[SPEC_MAX_GUESSES];
+    int guess_count = spec_guesses(last_raw, heading == ARROW_DOWN || heading == ARROW_DOWN_FAST,
+                                   guesses);
+    uint32_t first_key = 0, first_white_key = 0;
+    int n = 0;
+    for (int i = 0; i < guess_count; i++) {
+      if (update_pending()) break;   // the real value is here
+      int t = guesses[i];
+      cand = base;
+      cand_filter = filter;
+      int v = filter_input(filter_cfg, cand_filter, t);
+      if (filter_decide(filter_cfg, v, base.temp, base.theme_temp) == FILTER_SHOW) {
+        cand.temp = v;
+        cand.theme_temp = filter_theme(filter_cfg, v, base.theme_temp);
+      }
+      cand_trend = trend;
+      trend_add(cand_trend, now_s, t);
+      cand.dir = trend_arrow(trend_cfg, cand_trend, (ArrowDir)last_arrow);
+      if (SHOW_SPARKLINE) spark_add(cand.spark, now_s, t);
+      if (!spec_candidate(cand, fb, scratch, first_key, first_white_key)) break;
+      n++;
+    }
+    spec_armed = n > 0;
+    held_set(scratch, nullptr);   // holds whatever was decoded last
+    LOGI("[SPEC] %d values pre-rendered, %u bytes", n, (unsigned)spec_bytes_used());
   }
+  display_release(fb);
+  display_release(scratch);
+}
 
-  // Body background always white (easier for readability)
-  fill(C_WHITE);
+static DisplayList job_list;
 
-  // Border matches header fg (clean + consistent)
-  border_l(header_fg);
+// Draws the frame into fb, or decodes it from the speculative frames;
+// true if it came from there.
+static bool render_frame(const RenderJob& job, int battery, uint8_t header_bg, uint8_t* fb) {
+  wake_stage_start(WS_RENDER);
+  build_job_list(job_list, job, battery, header_bg);
+  bool cached = spec_armed && !job_list.overflow && spec_get(list_hash(job_list), fb, FRAME_BYTES);
+  if (cached) {
+    held_set(fb, &job_list);
+  } else {
+    if (spec_armed) held_set(fb, nullptr);   // a failed decode may have written to it
+    draw_job(job, battery, header_bg, job_list, fb);
+  }
+  wake_stage_end(WS_RENDER);
+  return cached;
+}
 
-  // Header
-  const int HEADER_H = 28;
-  rect_l(1, 1, CANVAS_W - 2, HEADER_H, header_bg);
+// hash: frame_hash() of fb, for the last frame of an update
+static bool submit_frame(uint8_t* fb, uint8_t flags, uint16_t delay_ms, uint32_t hash,
+                         uint32_t list) {
+  DisplayJob d = {};
+  d.op = DISP_FRAME;
+  d.flags = flags | DISP_RELEASE;
+  d.delay_ms = delay_ms;
+  d.hash = hash;
+  d.list = list;
+  d.fb = fb;
+  return display_submit(d, UINT32_MAX);
+}
 
-  // Separator line under header (1px like border)
-  rect_l(1, 1 + HEADER_H, CANVAS_W - 2, 1, header_fg);
+// Swaps the two free buffers if only other was last drawn with the header
+// colors bg_key, so the frame drawn into fb repaints the least.
+static void prefer_buffer(uint8_t*& fb, uint8_t*& other, uint8_t bg_key) {
+  const HeldFrame& a = held_frame(fb);
+  const HeldFrame& b = held_frame(other);
+  if ((a.valid && a.dl.bg_key == bg_key) || !b.valid || b.dl.bg_key != bg_key) return;
+  uint8_t* t = fb;
+  fb = other;
+  other = t;
+}
 
-  // "BOILER" centered with balanced padding
-  {
-    const char* title = "BOILER";
-    int scale = 3;
-    int spacing = 3;
-    int title_w = text_width_5x7(title, scale, spacing);
-    int tx = (CANVAS_W - title_w) / 2;
+// false if the panel already shows exactly this frame.
+static bool show_temp_on_epaper(const RenderJob& job) {
+  int batteryPct = battery_for_refresh();
+  Theme th = theme_for_temp(job.theme_temp);
+
+  // the theme frame is the one left on the panel: same list, same frame
+  build_job_list(job_list, job, batteryPct, th.header_bg);
+  uint32_t list = job_list.overflow ? 0 : list_hash(job_list);
+  if (list && list == rtc_shown_list) {
+    count_refresh(true);
+    LOGI("[EPD] %d: same frame as on the panel, refresh skipped", job.temp);
+    return false;
+  }
 
-    int text_h = 7 * scale;
-    int header_top = 1;
-    int header_bottom = 1 + HEADER_H;
-    int available_h = header_bottom - header_top;
-    int ty = header_top + (available_h - text_h) / 2;
+  // Without the list hash (after a power loss, or a remote frame) the
+  // theme frame is drawn first and its bytes compared.
+  uint8_t* fb = display_acquire(UINT32_MAX);
+  uint8_t* white_fb = ENABLE_COLOR_TRANSITION_EVERY_UPDATE ? display_acquire(UINT32_MAX) : nullptr;
+  if (!fb || (ENABLE_COLOR_TRANSITION_EVERY_UPDATE && !white_fb)) {
+    display_release(fb);
+    display_release(white_fb);
+    return false;
+  }
+  if (white_fb) prefer_buffer(fb, white_fb, job_list.bg_key);
+  bool hit = render_frame(job, batteryPct, th.header_bg, fb);
+  uint32_t hash = frame_hash(fb, FRAME_BYTES);
+  if (rtc_shown_frame && hash == rtc_shown_frame) {
+    display_release(fb);
+    display_release(white_fb);
+    rtc_shown_list = list;
+    count_refresh(true);
+    LOGI("[EPD] %d: frame %08lx already on the panel, refresh skipped", job.temp,
+         (unsigned long)hash);
+    return false;
+  }
 
-    if (ty < header_top + 2) ty = header_top + 2;
-    draw_text_5x7_l(tx, ty, title, scale, spacing, header_fg);
+  LOGI("[EPD] start update -> %d", job.temp);
+  bool hit2 = true;
+  if (white_fb) {
+    hit2 = render_frame(job, batteryPct, C_WHITE, white_fb);
+    submit_frame(white_fb, DISP_INIT | DISP_CLEAR, 0, 0, 0);
+    submit_frame(fb, DISP_SLEEP, TRANSITION_DELAY_MS, hash, list);
+  } else {
+    submit_frame(fb, DISP_INIT | DISP_CLEAR | DISP_SLEEP, 0, hash, list);
   }
+  count_refresh(false);
+
+  // one set of guesses per wake
+  if (!spec_armed) return true;
+  spec_armed = false;
+  metric_inc((hit && hit2) ? M_SPEC_HITS : M_SPEC_MISSES);
+  uint32_t hits = metrics_store.counters[M_SPEC_HITS];
+  uint32_t total = hits + metrics_store.counters[M_SPEC_MISSES];
+  metric_set(M_SPEC_HIT_PCT, (int32_t)(hits * 100 / total));
+  LOGI("[SPEC] %s", (hit && hit2) ? "hit" : "miss");
+  return true;
+}
+
+// ===================== REMOTE FRAMES =====================
+// Chunks are decoded on the network task as they arrive, into img or
+// (REMOTE_FRAME_DIRECT) as data blocks queued straight to the panel; the
+// display task shows the frame once its CRC checked out.
+static RFrameRx rframe;
+static bool rframe_fb_held = false;     // img taken from the pool for a transfer
+static bool rframe_streaming = false;   // panel RAM write queued (direct mode)
+static FrameHash rframe_hash;           // of the bytes streamed so far (direct mode)
+
+// free heap at the start of the transfer and its low point since
+static uint32_t rframe_heap_start = 0;
+static uint32_t rframe_heap_low = 0;
+
+static_assert(RFRAME_STAGE_BYTES <= DISPLAY_BLOCK_BYTES, "a staged block fits one display job");
+
+// Without show the panel keeps its image (RAM written but not refreshed).
+static void rframe_panel_finish(bool show) {
+  if (!rframe_streaming) return;
+  rframe_streaming = false;
+  DisplayJob d = {};
+  d.op = show ? DISP_STREAM_END : DISP_STREAM_ABORT;
+  d.hash = frame_hash_final(rframe_hash);
+  display_submit(d, UINT32_MAX);
+}
 
-  // digits sizes (2 digits)
-  int tens = t / 10;
-  int ones = t % 10;
+static void rframe_panel_start() {
+  rframe_panel_finish(false);   // a new frame replaced one still streaming
+  DisplayJob d = {};
+  d.op = DISP_STREAM_BEGIN;
+  display_submit(d, UINT32_MAX);
+  rframe_streaming = true;
+  frame_hash_init(rframe_hash);
+}
 
-  int s = 9;
-  int digit_w = 6*s;
-  int digit_h = 10*s;
-  int gap = 22;
+// blocks while the display task is behind (queue full)
+static void rframe_panel_write(const uint8_t* p, size_t n) {
+  frame_hash_update(rframe_hash, p, n);
+  while (n > 0) {
+    DisplayJob d = {};
+    d.op = DISP_STREAM_DATA;
+    d.len = (uint16_t)(n < (size_t)DISPLAY_BLOCK_BYTES ? n : DISPLAY_BLOCK_BYTES);
+    memcpy(d.data, p, d.len);
+    display_submit(d, UINT32_MAX);
+    p += d.len;
+    n -= d.len;
+  }
+}
 
-  int icon_w = 28;
-  int icon_gap = 12;
+// ===================== WIFI + MQTT =====================
+WiFiClient wifiClient;
+PubSubClient mqtt(wifiClient);
 
-  int digits_width = 2*digit_w + gap;
-  int group_width = digits_width + icon_gap + icon_w;
-  int start_x = (CANVAS_W - group_width) / 2;
+static void publish_frame_state() {
+  char buf[9];
+  snprintf(buf, sizeof(buf), "%08lx", (unsigned long)rframe.fb_crc);
+  mqtt.publish(TOPIC_FRAME_STATE, buf, true);
+}
 
-  // body layout
-  int top = 1 + HEADER_H + 1 + 10;
-  int avail_h = (CANVAS_H - 1) - top;
-  int y_digits = top + (avail_h - digit_h) / 2 + 6;
+// "<frame id> <first missing chunk>", both hex
+static void publish_frame_nack() {
+  char buf[12];
+  snprintf(buf, sizeof(buf), "%04x %x", rframe.frame_id, rframe.next_chunk);
+  mqtt.publish(TOPIC_FRAME_NACK, buf);
+}
 
-  // "TEMP" label above digits (uses header_fg to keep nice contrast)
-  {
-    const char* label = "TEMP";
-    int scale = 2;
-    int spacing = 2;
-    int label_w = text_width_5x7(label, scale, spacing);
-    int lx = (CANVAS_W - label_w) / 2;
-
-    int ly = y_digits - (7*scale) - 10;
-    int min_ly = 1 + HEADER_H + 1 + 4;
-    if (ly < min_ly) ly = min_ly;
-
-    draw_text_5x7_l(lx, ly, label, scale, spacing, header_fg);
-  }
-
-  // digits
-  int x = start_x;
-  draw_digit7seg_l(x, y_digits, s, tens, C_BLACK);
-  x += digit_w + gap;
-  draw_digit7seg_l(x, y_digits, s, ones, C_BLACK);
-
-  // °C icon
-  int digits_end_x = start_x + digits_width;
-  int icon_x = digits_end_x + icon_gap;
-  int icon_y = y_digits + 10;
-
-  if (icon_x + icon_w > CANVAS_W - 1) icon_x = (CANVAS_W - 1) - icon_w;
-  if (icon_y + 20 > CANVAS_H - 1) icon_y = (CANVAS_H - 1) - 20;
-
-  draw_degC_icon_l(icon_x, icon_y, C_BLACK, C_WHITE);
-
-  // Arrow indicator: to the right of digits, below the °C icon
-  // (your request: right of temps + below the °C icon)
-  if (dir != ARROW_NONE) {
-    int ax = icon_x + icon_w/2;     // centered under the icon
-    int ay = icon_y + 28;           // below the °C icon
-    int size = 6;                   // small arrow
-    // keep inside screen
-    if (ay + size + 12 > CANVAS_H - 2) ay = CANVAS_H - 2 - (size + 12);
-
-    if (dir == ARROW_UP)   draw_arrow_up_l(ax, ay, size, C_BLACK);
-    if (dir == ARROW_DOWN) draw_arrow_down_l(ax, ay, size, C_RED);
-  }
-
-  // Battery icon (top-right in header)
-  if (ENABLE_BATTERY_ICON && batteryPct >= 0) {
-    int bw = 32;
-    int bh = 12;
-    int bx = CANVAS_W - 1 - 6 - bw - 4;
-    int by = 1 + 7;
-    // battery fg/bg match header readability
-    rect_l(bx, by, bw, bh, header_fg);
-    rect_l(bx + 1, by + 1, bw - 2, bh - 2, header_bg);
-    int nub_w = max(2, bw / 10);
-    int nub_h = max(4, bh / 2);
-    rect_l(bx + bw, by + (bh - nub_h) / 2, nub_w, nub_h, header_fg);
-
-    int inner_w = bw - 2;
-    int inner_h = bh - 2;
-    int fill_w = (inner_w * batteryPct) / 100;
-    rect_l(bx + 1, by + 1, fill_w, inner_h, header_fg);
-    if (batteryPct > 0 && fill_w == 0) rect_l(bx + 1, by + 1, 1, inner_h, header_fg);
-  }
-}
-
-static void show_temp_on_epaper(int tempC, ArrowDir dir) {
-  int batteryPct = read_battery_percent();
-
-  Serial.printf("[EPD] start update -> %d\n", tempC);
-  Serial.println("[EPD] Init()");
-  if (epd.Init() != 0) return;
-
-  Serial.println("[EPD] Clear()");
-  epd.Clear(C_WHITE);
-
-  if (ENABLE_COLOR_TRANSITION_EVERY_UPDATE) {
-    Serial.println("[EPD] Frame1 (white header)");
-    draw_screen_frame(tempC, batteryPct, dir, C_WHITE);
-    epd.Display(img);
-    delay(TRANSITION_DELAY_MS);
-
-    Serial.println("[EPD] Frame2 (final header)");
-    Theme th = theme_for_temp(tempC);
-    draw_screen_frame(tempC, batteryPct, dir, th.header_bg);
-    epd.Display(img);
-  } else {
-    Theme th = theme_for_temp(tempC);
-    draw_screen_frame(tempC, batteryPct, dir, th.header_bg);
-    epd.Display(img);
+static void onSessionUp() {
+  TRACE_SPAN(TR_SUBSCRIBE);
+  if (REMOTE_FRAMEBUFFER) {
+    LOGI("Subscribing: %s", TOPIC_FRAME);
+    mqtt.subscribe(TOPIC_FRAME);
+    publish_frame_state();
+  }
+  for (int i = 0; i < router_route_count(); i++) {
+    const char* filter = router_route(i)->filter;
+    LOGI("Subscribing: %s", filter);
+    mqtt.subscribe(filter);
   }
+  wake_cycle_subscribed(millis());
+  wake_stage_end(WS_MQTT);
+}
 
-  Serial.println("[EPD] Sleep()");
-  epd.Sleep();
-  Serial.println("[EPD] done");
+// Streams the trace ring as a single binary message (no MQTT buffer limit).
+static void publish_trace() {
+  if (!mqtt.connected()) return;
+  size_t n = trace_binary_size();
+  if (!mqtt.beginPublish(TOPIC_TRACE, n, false)) return;
+  trace_write_binary(mqtt);
+  mqtt.endPublish();
 }
 
-// ===================== WIFI + MQTT =====================
-WiFiClient wifiClient;
-PubSubClient mqtt(wifiClient);
+static void publish_metrics() {
+  static char buf[METRICS_JSON_MAX];
+  if (!mqtt.connected()) return;
+  metric_set_min(M_HEAP_MIN, (int32_t)ESP.getMinFreeHeap());
+  size_t n = metrics_to_json(buf, sizeof(buf));
+  if (n == 0) {
+    // cannot happen while METRICS_JSON_MAX is right; count it if it does
+    metric_inc(M_METRICS_DROPPED);
+    LOGE("[METRICS] JSON does not fit %u bytes", (unsigned)sizeof(buf));
+    return;
+  }
+  if (!mqtt.beginPublish(TOPIC_METRICS, n, false)) return;
+  mqtt.write((const uint8_t*)buf, n);
+  mqtt.endPublish();
+}
 
-static void ensureWifi() {
-  if (WiFi.status() == WL_CONNECTED) return;
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID_S, WIFI_PASS_S);
-  while (WiFi.status() != WL_CONNECTED) delay(500);
-  Serial.printf("WiFi OK, IP: %s\n", WiFi.localIP().toString().c_str());
-}
-
-static void ensureMqtt() {
-  if (mqtt.connected()) return;
-  Serial.print("Connecting MQTT...");
-  while (!mqtt.connected()) {
-    String cid = "boiler-epd-" + String((uint32_t)ESP.getEfuseMac(), HEX);
-    bool ok = false;
-    if (strlen(MQTT_USER_S)) ok = mqtt.connect(cid.c_str(), MQTT_USER_S, MQTT_PASS_S);
-    else ok = mqtt.connect(cid.c_str());
-
-    if (ok) {
-      Serial.println("OK");
-      Serial.printf("Subscribing: %s\n", TOPIC_TEMP_INT);
-      mqtt.subscribe(TOPIC_TEMP_INT);
-    } else {
-      Serial.println("FAIL, retrying...");
-      delay(2000);
-    }
+static void go_to_sleep() {
+  uint32_t awake_ms = millis();
+  uint32_t sleep_s = sched_end_wake(wake_outcome, wake_value);
+
+  // the panel may still be powered from the early init
+  DisplayJob off = {};
+  off.op = DISP_POWER_DOWN;
+  display_submit(off, UINT32_MAX);
+  while (!display_idle()) vTaskDelay(pdMS_TO_TICKS(5));
+
+  metric_observe(M_H_AWAKE_MS, awake_ms);
+  metric_set(M_SLEEP_S, (int32_t)sleep_s);
+  publish_metrics();
+  TRACE_INSTANT(TR_SLEEP);
+  if (PUBLISH_TRACE_BEFORE_SLEEP) publish_trace();
+  log_flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)sleep_s * 1000000ULL);
+  esp_deep_sleep_start();
+}
+
+// Callback side (main value): hand it to the render task, nothing more.
+static void on_boiler_value(uint8_t slot, bool valid, int t) {
+  // changed, unchanged or invalid: this wake has nothing left to wait for
+  // once the render task has caught up
+  wake_cycle_message(millis());
+  wake_stage_end(WS_MESSAGE);
+
+  if (!valid) {
+    metric_inc(M_PAYLOAD_INVALID);
+    wake_outcome = WAKE_INVALID;
+    LOGW("MQTT payload invalid (ignored)");
+    return;
+  }
+  metric_set(M_LAST_TEMP, t);
+  {
+    StateLock lock;
+    // everything recorded keeps the reading as received; the filter only
+    // decides what the panel shows
+    uint32_t now_s = sched_now_s();
+    trend_add(rtc_trend, now_s, t);
+    history_append(rtc_history, now_s, t);
+    if (flash_history_ok && !flog_append(now_s, t)) LOGW("[FLOG] append failed");
+    spark_add(rtc_spark, now_s, t);
+    int v = filter_input(filter_cfg, rtc_filter, t);
+    if (v != t) LOGD("[MAIN] reading %d, filtered to %d", t, v);
+    update_post(v);
   }
+  wake_render();
 }
 
-static bool parseIntPayload(const byte* payload, unsigned int len, int& out) {
-  if (len == 0 || len > 32) return false;
-  char buf[40];
-  memcpy(buf, payload, len);
-  buf[len] = '\0';
+// Secondary values are only stored; they show up with the next refresh.
+static void on_side_value(uint8_t slot, bool valid, int v) {
+  int i = slot - 1;
+  if (i < 0 || i >= SIDE_COUNT) return;
+  if (!valid) {
+    metric_inc(M_PAYLOAD_INVALID);
+    return;
+  }
+  {
+    StateLock lock;
+    if (rtc_side_valid[i] && rtc_side_value[i] == v) return;
+    rtc_side_value[i] = v;
+    rtc_side_valid[i] = true;
+    side_dirty = true;
+  }
+  LOGD("[MAIN] %s -> %d", SIDE_LABELS[i], v);
+  wake_render();
+}
 
-  if (!strcmp(buf, "unknown") || !strcmp(buf, "unavailable") || !strcmp(buf, "None") ||
-      !strcmp(buf, "null") || !strcmp(buf, "nan") || !strcmp(buf, "NaN")) {
+// Display decision for the newest posted value; fills job if a refresh is
+// needed. Called with the state lock held.
+static bool take_update(RenderJob& job) {
+  int t = 0;
+  if (!update_take(millis(), rtc_lastDisplayed, t)) {
+    // only secondary values changed: redraw what is shown, rate limited
+    if (!side_dirty || rtc_lastDisplayed == -9999 || !update_due(millis())) return false;
+    t = rtc_lastDisplayed;
+  }
+  wake_value = t;
+
+  // arrow from the fitted trend, not from the last step
+  ArrowDir dir = trend_arrow(trend_cfg, rtc_trend, (ArrowDir)rtc_lastArrow);
+  bool arrow_changed = dir != rtc_lastArrow;
+
+  FilterVerdict verdict = filter_decide(filter_cfg, t, rtc_lastDisplayed, rtc_themeTemp);
+  if (verdict != FILTER_SHOW && !arrow_changed && !side_dirty) {
+    wake_outcome = WAKE_UNCHANGED;
+    if (verdict == FILTER_SAME) {
+      metric_inc(M_VALUE_UNCHANGED);
+      LOGI("Temp unchanged (ignored)");
+    } else {
+      metric_inc(M_FILTER_HELD);
+      LOGI("Temp %d held (deadband), showing %d", t, rtc_lastDisplayed);
+    }
     return false;
   }
 
-  char* endp = nullptr;
-  long v = strtol(buf, &endp, 10);
-  if (endp == buf) return false;
-  out = (int)v;
+  if (verdict == FILTER_SHOW) {
+    LOGI("Temp changed: %d -> %d. Queuing update...", rtc_lastDisplayed, t);
+    rtc_lastDisplayed = t;
+    rtc_themeTemp = filter_theme(filter_cfg, t, rtc_themeTemp);
+  } else if (arrow_changed) {
+    // trend changed but the value is held: redraw the shown value
+    LOGI("Trend arrow %u -> %u", rtc_lastArrow, dir);
+  }
+  rtc_lastArrow = dir;
+  side_dirty = false;
+
+  job.temp = rtc_lastDisplayed;
+  job.theme_temp = rtc_themeTemp;
+  job.dir = dir;
+  job.show_spark = SHOW_SPARKLINE;
+  if (SHOW_SPARKLINE) job.spark = rtc_spark;
+  job.side_count = collect_side_values(job.side);
   return true;
 }
 
-static void onMqtt(char* topic, byte* payload, unsigned int len) {
-  if (strcmp(topic, TOPIC_TEMP_INT) != 0) return;
+static void render_task(void*) {
+  static RenderJob job;
+  if (OVERLAP_WAKE || SPECULATIVE_RENDER) sample_battery();
+  if (SPECULATIVE_RENDER) speculate();
+  for (;;) {
+    // sleep until a callback posts something, or a held value becomes due
+    TickType_t wait = portMAX_DELAY;
+    if (update_pending() || side_dirty) {
+      uint32_t ms = update_wait_ms(millis());
+      wait = pdMS_TO_TICKS(ms < 10 ? 10 : ms);
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
 
-  // log raw payload
-  char tmp[64];
-  unsigned int n = min(len, (unsigned int)63);
-  memcpy(tmp, payload, n);
-  tmp[n] = '\0';
-  Serial.printf("MQTT msg topic: %s\n", topic);
-  Serial.printf("MQTT payload raw: '%s'\n", tmp);
+    render_busy = true;
+    bool refresh;
+    {
+      StateLock lock;
+      refresh = take_update(job);
+    }
+    if (refresh) {
+      LOGD("[MAIN] Applying temp %d", job.temp);
+      if (show_temp_on_epaper(job)) {
+        update_refreshed(millis());
+        wake_outcome = WAKE_REFRESHED;
+      } else if (wake_outcome != WAKE_REFRESHED) {
+        wake_outcome = WAKE_UNCHANGED;
+      }
+    }
+    render_busy = false;
+  }
+}
 
-  int t = 0;
-  if (!parseIntPayload(payload, len, t)) {
-    Serial.println("MQTT payload invalid (ignored)");
-    return;
+// Network task side; the frame is shown by the display task.
+static void on_frame_chunk(const uint8_t* payload, unsigned int len) {
+  wake_stage_end(WS_MESSAGE);
+  if (!rframe.active) {
+    rframe_heap_start = ESP.getFreeHeap();
+    rframe_heap_low = rframe_heap_start;
+    // img is still on its way to the panel while the last frame is sent
+    if (!REMOTE_FRAME_DIRECT && !rframe_fb_held) {
+      if (!display_acquire(RFRAME_FB_WAIT_MS)) {
+        LOGW("[RFRAME] frame buffer busy, chunk dropped");
+        return;
+      }
+      rframe_fb_held = true;
+    }
+  }
+  RFrameResult r = rframe_chunk(rframe, payload, len);
+  uint32_t heap = ESP.getFreeHeap();
+  if (heap < rframe_heap_low) rframe_heap_low = heap;
+
+  switch (r) {
+    case RFRAME_CHUNK_OK:
+      return;
+    case RFRAME_IGNORED:
+      break;
+    case RFRAME_NEED_RESEND:
+      metric_inc(M_REMOTE_FRAME_RESENDS);
+      LOGW("[RFRAME] gap, asking for chunk %u on", rframe.next_chunk);
+      publish_frame_nack();
+      return;
+    case RFRAME_COMPLETE: {
+      wake_stage_end(WS_RENDER);   // assembled
+      uint32_t hash = REMOTE_FRAME_DIRECT ? frame_hash_final(rframe_hash) : frame_hash(img, FRAME_BYTES);
+      bool same = rtc_shown_frame && hash == rtc_shown_frame;
+      if (same) {
+        LOGI("[RFRAME] frame %08lx already on the panel, refresh skipped",
+             (unsigned long)rframe.frame_crc);
+      } else {
+        LOGI("[RFRAME] showing frame %08lx", (unsigned long)rframe.frame_crc);
+      }
+      if (REMOTE_FRAME_DIRECT) {
+        rframe_panel_finish(!same);   // already in panel RAM
+      } else if (!same) {
+        DisplayJob d = {};
+        d.op = DISP_FRAME;
+        d.flags = DISP_INIT | DISP_SLEEP | DISP_RELEASE;
+        d.hash = hash;
+        d.fb = img;
+        display_submit(d, UINT32_MAX);
+        rframe_fb_held = false;
+      }
+      count_refresh(same);
+      if (!same) {
+        metric_inc(M_REMOTE_FRAMES);
+        wake_outcome = WAKE_REFRESHED;
+      } else if (wake_outcome != WAKE_REFRESHED) {
+        wake_outcome = WAKE_UNCHANGED;
+      }
+      publish_frame_state();
+      wake_cycle_message(millis());
+      break;
+    }
+    default:
+      metric_inc(M_REMOTE_FRAME_ERRORS);
+      LOGW("[RFRAME] frame dropped: %s", rframe_result_name(r));
+      if (REMOTE_FRAME_DIRECT) rframe_panel_finish(false);
+      if (r == RFRAME_BAD_BASE) publish_frame_state();   // the sender falls back to a key frame
+      break;
+  }
+  // no transfer running: img goes back to the pool
+  if (rframe_fb_held && !rframe.active) {
+    display_release(img);
+    rframe_fb_held = false;
   }
+  metric_set(M_RFRAME_HEAP_PEAK, (int32_t)(rframe_heap_start - rframe_heap_low));
+}
 
-  if (t == rtc_lastDisplayed) {
-    Serial.println("Temp unchanged (ignored)");
+static void onMqtt(char* topic, byte* payload, unsigned int len) {
+  // topic/payload live in PubSubClient's buffer, so only log copies of them
+  LOGD("MQTT msg, %u bytes", len);
+  metric_inc(M_MSGS_RECEIVED);
+  TRACE_SPAN(TR_MSG);
+  if (REMOTE_FRAMEBUFFER && strcmp(topic, TOPIC_FRAME) == 0) {
+    on_frame_chunk(payload, len);
     return;
   }
+  if (router_dispatch(topic, payload, len) == 0) LOGD("MQTT msg on unrouted topic");
+}
 
-  // Determine direction for arrow
-  ArrowDir dir = ARROW_NONE;
-  if (rtc_lastDisplayed != -9999) {
-    if (t > rtc_lastDisplayed) dir = ARROW_UP;
-    else if (t < rtc_lastDisplayed) dir = ARROW_DOWN;
+// Topic -> decoder -> display slot; empty topics are left out
+static TopicRoute routes[SLOT_COUNT];
+
+static void setup_routes() {
+  int n = 0;
+  for (int slot = 0; slot < SLOT_COUNT; slot++) {
+    const TopicConfig& tc = TOPICS[slot];
+    if (!tc.topic || !tc.topic[0]) continue;
+    routes[n].filter = tc.topic;
+    routes[n].slot = (uint8_t)slot;
+    routes[n].decode = tc.decode;
+    routes[n].decode_arg = tc.path;
+    routes[n].handle = (slot == SLOT_BOILER) ? on_boiler_value : on_side_value;
+    if (slot != SLOT_BOILER) side_enabled[slot - 1] = true;
+    n++;
   }
+  if (!router_begin(routes, n)) LOGE("[MAIN] topic routing table does not fit");
+}
 
-  Serial.printf("Temp changed: %d -> %d. Queuing update...\n", rtc_lastDisplayed, t);
-  rtc_lastDisplayed = t;
+static void print_window(Print& out, const char* name, const HistoryStats& st) {
+  if (st.count == 0) return;
+  out.printf("  last %-4s n=%lu min=%d max=%d avg=%.1f\n", name, (unsigned long)st.count, st.min,
+             st.max, (double)st.sum / st.count);
+}
+
+static const uint32_t WINDOWS_S[] = { 3600UL, 86400UL, 7UL * 86400UL };
+static const char* const WINDOW_NAMES[] = { "1 h", "24 h", "7 d" };
 
-  Serial.printf("[MAIN] Applying temp %d\n", t);
-  show_temp_on_epaper(t, dir);
+static void print_history(Print& out) {
+  StateLock lock;
+  HistorySample last;
+  if (!history_newest(rtc_history, last)) {
+    out.println("history: empty");
+  } else {
+    uint32_t n = history_count(rtc_history);
+    size_t bytes = history_bytes_used(rtc_history);
+    out.printf("history: %lu samples in %u bytes (%lu per KB)\n", (unsigned long)n,
+               (unsigned)bytes, (unsigned long)(bytes ? n * 1024UL / bytes : 0));
+    for (int i = 0; i < 3; i++) {
+      uint32_t from = last.t_s > WINDOWS_S[i] ? last.t_s - WINDOWS_S[i] : 0;
+      print_window(out, WINDOW_NAMES[i], history_query(rtc_history, from, last.t_s));
+    }
+  }
 
-  if (USE_DEEP_SLEEP) {
-    esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_SECONDS * 1000000ULL);
-    esp_deep_sleep_start();
+  if (!flash_history_ok) return;
+  out.printf("flash: %lu records, %lu sectors, %lu erases\n", (unsigned long)flog_record_count(),
+             (unsigned long)flog_sector_count(), (unsigned long)flog_erase_cycles());
+  uint32_t end = flog_last_time();
+  for (int i = 0; i < 3; i++) {
+    HistoryStats st = {};
+    FlogCursor c;
+    FlogSample smp;
+    flog_seek(c, end > WINDOWS_S[i] ? end - WINDOWS_S[i] : 0);
+    while (flog_next(c, smp)) {
+      if (st.count == 0 || smp.value < st.min) st.min = smp.value;
+      if (st.count == 0 || smp.value > st.max) st.max = smp.value;
+      st.sum += smp.value;
+      st.count++;
+    }
+    print_window(out, WINDOW_NAMES[i], st);
+  }
+}
+
+// ===================== NETWORK TASK =====================
+// WiFi/MQTT upkeep and every MQTT callback run here, on the core the WiFi
+// stack uses; the deep-sleep decision too, once render and display are idle.
+static const uint32_t NET_STACK = 8192;
+static const UBaseType_t NET_PRIO = 3;
+static const BaseType_t NET_CORE = 0;
+
+static bool pipeline_idle() {
+  return !update_pending() && !render_busy && display_idle();
+}
+
+static void network_task(void*) {
+  for (;;) {
+    net_poll();
+    if (net_link_up()) wake_stage_end(WS_WIFI);
+    if (net_session_up()) mqtt.loop();
+
+    if (!USE_DEEP_SLEEP) {
+      static uint32_t last_metrics = 0;
+      if (millis() - last_metrics > METRICS_PUBLISH_INTERVAL_MS) {
+        last_metrics = millis();
+        publish_metrics();
+      }
+    }
+
+    if (USE_DEEP_SLEEP) {
+      if (wake_cycle_got_message() && pipeline_idle()) go_to_sleep();
+      if (net_gave_up()) {
+        LOGW("Network not up within budget, going to sleep.");
+        wake_outcome = WAKE_NET_FAILED;
+        go_to_sleep();
+      }
+      if (wake_cycle_timed_out(millis())) {
+        LOGI("No retained value after subscribing, going to sleep.");
+        go_to_sleep();
+      }
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(10));
   }
 }
 
 // ===================== ARDUINO =====================
+// UART TX ring for the deferred log. Without it availableForWrite() only
+// reports the 128-byte hardware FIFO, less than a long log line.
+static const size_t SERIAL_TX_BUFFER = 1024;
+
 void setup() {
+  Serial.setTxBufferSize(SERIAL_TX_BUFFER);   // log_drain() checks room for a whole line
   Serial.begin(115200);
-  delay(500);
+  state_lock = xSemaphoreCreateMutex();
+
+#ifdef LOG_BENCHMARK
+  log_benchmark(Serial);
+#endif
+
+  metrics_init();
+  metric_inc(M_WAKES);
 
   // SPI pins (match your wiring; CS is controlled by epdif/CS_PIN)
   SPI.begin(18, -1, 23, CS_PIN);
+  canvas_set_layer_cache(BACKGROUND_CACHE);
 
   if (ENABLE_BATTERY_ICON) {
     analogReadResolution(12);
@@ -542,27 +1212,115 @@ void setup() {
     pinMode(BAT_ADC_PIN, INPUT);
   }
 
-  ensureWifi();
-  mqtt.setServer(MQTT_HOST_S, MQTT_PORT_U16);
+  shown_frame_begin();
+
+  // frame buffers: two for local rendering, img for remote frames, none
+  // when those go straight to the panel
+  uint8_t* const pool[] = { img, img_back };
+  int pool_n = !REMOTE_FRAMEBUFFER ? 2 : (REMOTE_FRAME_DIRECT ? 0 : 1);
+  display_pipe_begin(pool, pool_n, DISPLAY_QUEUE_DEPTH);
+  xTaskCreatePinnedToCore(display_task, "display", DISPLAY_STACK, nullptr, DISPLAY_PRIO, nullptr,
+                          DISPLAY_CORE);
+  if (OVERLAP_WAKE) {
+    // the panel power-up (~250 ms of fixed delays) needs nothing else: start
+    // it now and let it run while WiFi associates
+    DisplayJob up = {};
+    up.op = DISP_POWER_UP;
+    display_submit(up, 0);
+  }
+
+  NetConfig net = {};
+  net.ssid = WIFI_SSID_S;
+  net.pass = WIFI_PASS_S;
+  net.mqtt_host = MQTT_HOST_S;
+  net.mqtt_port = MQTT_PORT_U16;
+  net.mqtt_user = MQTT_USER_S;
+  net.mqtt_pass = MQTT_PASS_S;
+  net.wifi_attempt_ms = WIFI_ATTEMPT_MS;
+  net.backoff_min_ms = NET_BACKOFF_MIN_MS;
+  net.backoff_max_ms = NET_BACKOFF_MAX_MS;
+  net.wake_budget_ms = USE_DEEP_SLEEP ? WAKE_NET_BUDGET_MS : 0;
+  net.fast_reconnect = WIFI_FAST_RECONNECT;
+  net.fast_attempt_ms = WIFI_FAST_ATTEMPT_MS;
+  net.lease_reuse_s = WIFI_LEASE_REUSE_S;
+  net.now_s = sched_now_s;
+  net.on_session_up = onSessionUp;
+
+  WakeCycleConfig wake = {};
+  wake.min_timeout_ms = RETAINED_WAIT_MIN_MS;
+  wake.max_timeout_ms = RETAINED_WAIT_MAX_MS;
+  wake.margin_ms = RETAINED_WAIT_MARGIN_MS;
+  wake.latency_multiplier = RETAINED_WAIT_LATENCY_MULT;
+  wake_cycle_begin(wake);
+
+  SleepSchedConfig sched = {};
+  sched.adaptive = ADAPTIVE_SLEEP;
+  sched.default_s = SLEEP_SECONDS;
+  sched.min_s = SLEEP_MIN_SECONDS;
+  sched.max_s = SLEEP_MAX_SECONDS;
+  sched.thresholds[0] = THEME_WARM_ABOVE;
+  sched.thresholds[1] = THEME_HOT_ABOVE;
+  sched.threshold_count = 2;
+  sched.max_rate_x10_per_h = SLEEP_MAX_RATE_X10_PER_H;
+  sched_begin(sched);
+
+  UpdateQueueConfig upd = {};
+  upd.min_interval_ms = MIN_REFRESH_INTERVAL_MS;
+  upd.thresholds[0] = THEME_WARM_ABOVE;
+  upd.thresholds[1] = THEME_HOT_ABOVE;
+  upd.threshold_count = 2;
+  update_queue_begin(upd);
+
+  filter_cfg.median_n = FILTER_MEDIAN_N;
+  filter_cfg.ewma_alpha_x16 = FILTER_EWMA_ALPHA_X16;
+  filter_cfg.deadband = FILTER_DEADBAND;
+  filter_cfg.hysteresis = FILTER_HYSTERESIS;
+  filter_cfg.thresholds[0] = THEME_WARM_ABOVE;
+  filter_cfg.thresholds[1] = THEME_HOT_ABOVE;
+  filter_cfg.threshold_count = 2;
+  filter_init(rtc_filter);
+
+  trend_cfg.steady_x10_per_h = TREND_STEADY_X10_PER_H;
+  trend_cfg.fast_x10_per_h = TREND_FAST_X10_PER_H;
+  trend_cfg.min_t_stat_x10 = TREND_MIN_T_STAT_X10;
+  trend_cfg.min_samples = TREND_MIN_SAMPLES;
+  trend_init(rtc_trend);
+  history_init(rtc_history);
+  if (FLASH_HISTORY) flash_history_ok = flog_begin();
+  spark_init(rtc_spark);
+
+  if (REMOTE_FRAMEBUFFER && REMOTE_FRAME_DIRECT) {
+    RFrameSink sink = { rframe_panel_start, rframe_panel_write };
+    rframe_begin_sink(rframe, sink, FRAME_BYTES);
+  } else if (REMOTE_FRAMEBUFFER) {
+    rframe_begin(rframe, img, sizeof(img));
+  } else {
+    setup_routes();
+  }
+
+  if (!REMOTE_FRAMEBUFFER) {
+    xTaskCreatePinnedToCore(render_task, "render", RENDER_STACK, nullptr, RENDER_PRIO,
+                            &render_handle, RENDER_CORE);
+  }
+
   mqtt.setCallback(onMqtt);
-  ensureMqtt();
+  wake_stage_start(WS_WIFI);
+  net_begin(net, mqtt);
+  xTaskCreatePinnedToCore(network_task, "network", NET_STACK, nullptr, NET_PRIO, nullptr, NET_CORE);
 
-  Serial.println("Setup done. Waiting for MQTT updates...");
+  LOGI("Setup done. Waiting for MQTT updates...");
 }
 
+// Only the serial console and log output are left on the Arduino loop task.
 void loop() {
-  ensureWifi();
-  ensureMqtt();
-  mqtt.loop();
-
-  if (USE_DEEP_SLEEP) {
-    static uint32_t start = millis();
-    if (millis() - start > 15000) {
-      Serial.println("No update received, going to sleep.");
-      esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_SECONDS * 1000000ULL);
-      esp_deep_sleep_start();
-    }
+  // idle: format whatever the other tasks queued
+  log_drain(Serial, 8);
+
+  if (Serial.available()) {
+    int c = Serial.read();
+    if (c == 't') trace_dump(Serial);
+    if (c == 'h') print_history(Serial);
   }
 
   delay(10);
-}
\ No newline at end of file
+}
@@ -0,0 +1,124 @@
+#include <esp_attr.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics.h"
+
+// changes whenever metrics are added or removed, which resets the store
+static const uint32_t METRICS_MAGIC = 0x4D455400 ^ (uint32_t)sizeof(MetricsStore);
+
+RTC_DATA_ATTR MetricsStore metrics_store;
+
+static constexpr const char* COUNTER_NAMES[M_COUNTER_COUNT] = {
+  "wakes",
+  "wifi_connects",
+  "mqtt_connects",
+  "mqtt_connect_fails",
+  "msgs_received",
+  "payload_invalid",
+  "value_unchanged",
+  "refreshes",
+  "busy_wait_ms",
+  "wifi_fast_fallbacks",
+  "updates_coalesced",
+  "refresh_bypasses",
+  "filter_held",
+  "remote_frames",
+  "remote_frame_errors",
+  "remote_frame_resends",
+  "spec_hits",
+  "spec_misses",
+  "refresh_same",
+  "metrics_dropped",
+};
+
+static constexpr const char* GAUGE_NAMES[M_GAUGE_COUNT] = {
+  "heap_min",
+  "last_temp",
+  "battery_pct",
+  "sleep_s",
+  "rframe_heap_peak",
+  "spec_hit_pct",
+  "refresh_skip_pct",
+};
+
+static constexpr const char* HIST_NAMES[M_HIST_COUNT] = {
+  "busy_wait_ms",
+  "refresh_ms",
+  "awake_ms",
+  "connect_cached_ms",
+  "connect_full_ms",
+  "retained_latency_ms",
+  "wake_pixel_ms",
+};
+
+// METRICS_JSON_MAX assumes no name is longer than METRIC_NAME_MAX
+static constexpr size_t name_len(const char* s) { return *s ? 1 + name_len(s + 1) : 0; }
+static constexpr size_t longest(const char* const* names, int n) {
+  return n == 0 ? 0 : (name_len(names[n - 1]) > longest(names, n - 1)
+                       ? name_len(names[n - 1]) : longest(names, n - 1));
+}
+static_assert(longest(COUNTER_NAMES, M_COUNTER_COUNT) <= METRIC_NAME_MAX, "counter name too long");
+static_assert(longest(GAUGE_NAMES, M_GAUGE_COUNT) <= METRIC_NAME_MAX, "gauge name too long");
+static_assert(longest(HIST_NAMES, M_HIST_COUNT) <= METRIC_NAME_MAX, "histogram name too long");
+
+void metrics_reset() {
+  memset(&metrics_store, 0, sizeof(metrics_store));
+  metrics_store.magic = METRICS_MAGIC;
+}
+
+void metrics_init() {
+  if (metrics_store.magic != METRICS_MAGIC) metrics_reset();
+}
+
+// ===================== JSON =====================
+struct JsonOut {
+  char* buf;
+  size_t cap;
+  size_t len;
+  bool ok;
+
+  void add(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (!ok) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + len, cap - len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= cap - len) { ok = false; return; }
+    len += (size_t)n;
+  }
+};
+
+size_t metrics_to_json(char* buf, size_t cap) {
+  if (cap == 0) return 0;
+  JsonOut o = { buf, cap, 0, true };
+
+  o.add("{\"c\":{");
+  for (int i = 0; i < M_COUNTER_COUNT; i++) {
+    o.add("%s\"%s\":%lu", i ? "," : "", COUNTER_NAMES[i],
+          (unsigned long)metrics_store.counters[i]);
+  }
+  o.add("},\"g\":{");
+  for (int i = 0; i < M_GAUGE_COUNT; i++) {
+    o.add("%s\"%s\":%ld", i ? "," : "", GAUGE_NAMES[i], (long)metrics_store.gauges[i]);
+  }
+  o.add("},\"h\":{");
+  for (int i = 0; i < M_HIST_COUNT; i++) {
+    const MetricHistogram& h = metrics_store.hists[i];
+    int last = METRIC_HIST_BUCKETS - 1;
+    while (last >= 0 && h.buckets[last] == 0) last--;
+
+    o.add("%s\"%s\":{\"n\":%lu,\"sum\":%lu,\"b\":[", i ? "," : "", HIST_NAMES[i],
+          (unsigned long)h.count, (unsigned long)h.sum);
+    for (int b = 0; b <= last; b++) o.add("%s%lu", b ? "," : "", (unsigned long)h.buckets[b]);
+    o.add("]}");
+  }
+  o.add("}}");
+
+  if (!o.ok) {
+    buf[0] = '\0';
+    return 0;
+  }
+  return o.len;
+}
@@ -0,0 +1,308 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+#include "netconn.h"
+#include "log.h"
+#include "trace.h"
+#include "metrics.h"
+
+static NetConfig cfg;
+static PubSubClient* mqtt = nullptr;
+
+static NetState state = NET_IDLE;
+static uint32_t begin_ms = 0;
+static uint32_t state_ms = 0;      // when the current state was entered
+static uint32_t retry_at_ms = 0;   // end of the current backoff
+static uint8_t wifi_failures = 0;
+static uint8_t mqtt_failures = 0;
+static char client_id[32];
+static bool session_reported = false;
+static bool fast_attempt = false;   // current association uses the cache
+static bool fast_failed = false;    // cache already failed this wake
+static bool lease_reused = false;   // current association skipped DHCP
+static bool broker_is_literal = false;
+
+// Connection parameters kept across deep sleep
+struct NetRtcCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t lease_s;     // NetConfig::now_s() when DHCP handed out ip
+  uint32_t broker_ip;   // resolved mqtt_host, 0 = resolve again
+};
+
+static const uint32_t NET_CACHE_MAGIC = 0x4E455402;
+RTC_DATA_ATTR static NetRtcCache rtc_net;
+
+// PubSubClient waits this long for CONNACK (default 15 s)
+static const uint16_t MQTT_SOCKET_TIMEOUT_S = 5;
+
+static const char* const STATE_NAMES[] = {
+  "idle", "wifi_connecting", "wifi_backoff", "link_up", "mqtt_backoff", "session_up", "gave_up",
+};
+
+const char* net_state_name(NetState s) {
+  return (s <= NET_GAVE_UP) ? STATE_NAMES[s] : "?";
+}
+
+static void set_state(NetState s) {
+  if (s == state) return;
+  LOGD("[NET] %s -> %s", net_state_name(state), net_state_name(s));
+  state = s;
+  state_ms = millis();
+}
+
+static bool due(uint32_t now, uint32_t at) {
+  return (int32_t)(now - at) >= 0;
+}
+
+// Exponential backoff with "equal jitter": half of the window is fixed, the
+// other half random, so retries from several devices spread out but never
+// collapse to zero.
+static uint32_t backoff_ms(uint8_t failures) {
+  uint32_t window = cfg.backoff_min_ms;
+  for (uint8_t i = 1; i < failures && window < cfg.backoff_max_ms; i++) window *= 2;
+  if (window > cfg.backoff_max_ms) window = cfg.backoff_max_ms;
+  uint32_t half = window / 2;
+  return half + esp_random() % (half + 1);
+}
+
+static bool cache_valid() {
+  return rtc_net.magic == NET_CACHE_MAGIC && rtc_net.channel > 0;
+}
+
+// The cached DHCP address may be used without asking the server again.
+// Read at every join, so a link lost days after boot sees the real age.
+static bool lease_fresh() {
+  return cfg.lease_reuse_s && cfg.now_s && rtc_net.ip != 0 &&
+         cfg.now_s() - rtc_net.lease_s < cfg.lease_reuse_s;
+}
+
+void net_forget_cache() {
+  memset(&rtc_net, 0, sizeof(rtc_net));
+}
+
+static void save_cache() {
+  const uint8_t* bssid = WiFi.BSSID();
+  if (!bssid) return;
+  memcpy(rtc_net.bssid, bssid, sizeof(rtc_net.bssid));
+  rtc_net.channel = WiFi.channel();
+  rtc_net.magic = NET_CACHE_MAGIC;
+  if (cfg.static_ip) {
+    // AP and channel only; the address comes from cfg
+    rtc_net.ip = 0;
+    return;
+  }
+  // a reused address keeps the age of the lease it came from
+  if (!lease_reused) rtc_net.lease_s = cfg.now_s ? cfg.now_s() : 0;
+  rtc_net.ip = (uint32_t)WiFi.localIP();
+  rtc_net.gateway = (uint32_t)WiFi.gatewayIP();
+  rtc_net.subnet = (uint32_t)WiFi.subnetMask();
+  rtc_net.dns = (uint32_t)WiFi.dnsIP();
+}
+
+static void start_wifi() {
+  if (mqtt->connected()) mqtt->disconnect();
+  WiFi.mode(WIFI_STA);
+
+  fast_attempt = cfg.fast_reconnect && !fast_failed && cache_valid();
+  lease_reused = fast_attempt && !cfg.static_ip && lease_fresh();
+  if (cfg.static_ip) {
+    WiFi.config(IPAddress(cfg.static_ip), IPAddress(cfg.static_gateway),
+                IPAddress(cfg.static_subnet), IPAddress(cfg.static_dns));
+  } else if (lease_reused) {
+    // skip DHCP: the address was handed out less than lease_reuse_s ago
+    WiFi.config(IPAddress(rtc_net.ip), IPAddress(rtc_net.gateway),
+                IPAddress(rtc_net.subnet), IPAddress(rtc_net.dns));
+  } else {
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));  // DHCP
+  }
+  if (fast_attempt) {
+    // skip the scan: join the known AP on its known channel
+    WiFi.begin(cfg.ssid, cfg.pass, rtc_net.channel, rtc_net.bssid);
+    LOGD("[NET] fast reconnect, channel %d, %s", (int)rtc_net.channel,
+         lease_reused ? "cached address" : "DHCP");
+  } else {
+    WiFi.begin(cfg.ssid, cfg.pass);
+  }
+  TRACE_BEGIN(TR_WIFI_CONNECT);
+  set_state(NET_WIFI_CONNECTING);
+}
+
+static void wifi_failed(const char* why) {
+  TRACE_END(TR_WIFI_CONNECT);
+  WiFi.disconnect();
+
+  if (fast_attempt) {
+    // stale AP/channel/lease: forget it and scan right away, no backoff
+    LOGW("[NET] cached WiFi parameters failed (%s), full scan", why);
+    metric_inc(M_WIFI_FAST_FALLBACKS);
+    fast_failed = true;
+    net_forget_cache();
+    start_wifi();
+    return;
+  }
+
+  if (wifi_failures < 255) wifi_failures++;
+  uint32_t wait = backoff_ms(wifi_failures);
+  LOGW("[NET] WiFi %s (attempt %u), retry in %lu ms", why, wifi_failures, (unsigned long)wait);
+  retry_at_ms = millis() + wait;
+  set_state(NET_WIFI_BACKOFF);
+}
+
+// Points PubSubClient at the cached broker address, resolving (and caching)
+// it first when needed. Literal IPs are used as given.
+static void prepare_broker() {
+  if (broker_is_literal) return;
+  if (!rtc_net.broker_ip) {
+    IPAddress resolved;
+    if (!WiFi.hostByName(cfg.mqtt_host, resolved)) {
+      LOGW("[NET] DNS lookup failed for %s", cfg.mqtt_host);
+      mqtt->setServer(cfg.mqtt_host, cfg.mqtt_port);
+      return;
+    }
+    rtc_net.broker_ip = (uint32_t)resolved;
+  }
+  mqtt->setServer(IPAddress(rtc_net.broker_ip), cfg.mqtt_port);
+}
+
+static void connect_mqtt() {
+  prepare_broker();
+  LOGI("Connecting MQTT...");
+  bool ok = false;
+  TRACE_BEGIN(TR_MQTT_CONNECT);
+  if (strlen(cfg.mqtt_user)) ok = mqtt->connect(client_id, cfg.mqtt_user, cfg.mqtt_pass);
+  else ok = mqtt->connect(client_id);
+  TRACE_END(TR_MQTT_CONNECT);
+
+  if (ok) {
+    metric_inc(M_MQTT_CONNECTS);
+    if (!session_reported) {
+      // wake-to-connected time, split by WiFi path
+      session_reported = true;
+      uint32_t ms = millis();
+      metric_observe(fast_attempt ? M_H_CONNECT_CACHED_MS : M_H_CONNECT_FULL_MS, ms);
+      LOGI("[NET] boot -> MQTT session in %lu ms (%s WiFi)", (unsigned long)ms,
+           fast_attempt ? "cached" : "full scan");
+    }
+    mqtt_failures = 0;
+    LOGI("MQTT OK");
+    set_state(NET_SESSION_UP);
+    if (cfg.on_session_up) cfg.on_session_up();
+    return;
+  }
+
+  metric_inc(M_MQTT_CONNECT_FAILS);
+  rtc_net.broker_ip = 0;   // re-resolve in case the broker moved
+  if (mqtt_failures < 255) mqtt_failures++;
+  uint32_t wait = backoff_ms(mqtt_failures);
+  LOGW("MQTT connect FAIL (state %d), retry in %lu ms", mqtt->state(), (unsigned long)wait);
+  retry_at_ms = millis() + wait;
+  set_state(NET_MQTT_BACKOFF);
+}
+
+void net_begin(const NetConfig& c, PubSubClient& client) {
+  cfg = c;
+  mqtt = &client;
+  begin_ms = millis();
+  wifi_failures = 0;
+  mqtt_failures = 0;
+  fast_failed = false;
+  session_reported = false;
+  state = NET_IDLE;
+
+  snprintf(client_id, sizeof(client_id), "boiler-epd-%lx", (unsigned long)(uint32_t)ESP.getEfuseMac());
+  IPAddress literal;
+  broker_is_literal = literal.fromString(cfg.mqtt_host);
+  mqtt->setServer(cfg.mqtt_host, cfg.mqtt_port);
+  mqtt->setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+
+  // the cache replaces the SDK's own flash-stored config; avoid flash writes
+  WiFi.persistent(false);
+  if (rtc_net.magic != NET_CACHE_MAGIC) net_forget_cache();
+
+  // association runs in the background from here on
+  start_wifi();
+}
+
+void net_poll() {
+  if (!mqtt || state == NET_GAVE_UP) return;
+  uint32_t now = millis();
+
+  if (cfg.wake_budget_ms && state != NET_SESSION_UP && now - begin_ms > cfg.wake_budget_ms) {
+    LOGW("[NET] wake budget of %lu ms exhausted in %s, giving up",
+         (unsigned long)cfg.wake_budget_ms, net_state_name(state));
+    if (state == NET_WIFI_CONNECTING) TRACE_END(TR_WIFI_CONNECT);
+    if (mqtt->connected()) mqtt->disconnect();
+    WiFi.disconnect(true);
+    set_state(NET_GAVE_UP);
+    return;
+  }
+
+  bool wifi_ok = WiFi.status() == WL_CONNECTED;
+
+  switch (state) {
+    case NET_IDLE:
+      start_wifi();
+      break;
+
+    case NET_WIFI_CONNECTING: {
+      wl_status_t st = WiFi.status();
+      if (st == WL_CONNECTED) {
+        TRACE_END(TR_WIFI_CONNECT);
+        metric_inc(M_WIFI_CONNECTS);
+        wifi_failures = 0;
+        if (cfg.fast_reconnect) save_cache();
+        IPAddress ip = WiFi.localIP();
+        LOGI("WiFi OK in %lu ms (%s)", (unsigned long)(now - state_ms),
+             fast_attempt ? "cached" : "full scan");
+        LOGI("IP: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        set_state(NET_LINK_UP);
+      } else if (st == WL_NO_SSID_AVAIL || st == WL_CONNECT_FAILED) {
+        wifi_failed(st == WL_NO_SSID_AVAIL ? "SSID not found" : "auth failed");
+      } else if (now - state_ms > (fast_attempt ? cfg.fast_attempt_ms : cfg.wifi_attempt_ms)) {
+        wifi_failed("timeout");
+      }
+      break;
+    }
+
+    case NET_WIFI_BACKOFF:
+      if (due(now, retry_at_ms)) start_wifi();
+      break;
+
+    case NET_LINK_UP:
+      if (!wifi_ok) start_wifi();
+      else connect_mqtt();
+      break;
+
+    case NET_MQTT_BACKOFF:
+      if (!wifi_ok) start_wifi();
+      else if (due(now, retry_at_ms)) connect_mqtt();
+      break;
+
+    case NET_SESSION_UP:
+      if (!wifi_ok) {
+        LOGW("[NET] WiFi link lost");
+        start_wifi();
+      } else if (!mqtt->connected()) {
+        LOGW("[NET] MQTT session lost (state %d)", mqtt->state());
+        set_state(NET_LINK_UP);
+      }
+      break;
+
+    case NET_GAVE_UP:
+      break;
+  }
+}
+
+NetState net_state() { return state; }
+bool net_link_up() { return state == NET_LINK_UP || state == NET_MQTT_BACKOFF || state == NET_SESSION_UP; }
+bool net_session_up() { return state == NET_SESSION_UP; }
+bool net_gave_up() { return state == NET_GAVE_UP; }
+uint32_t net_elapsed_ms() { return millis() - begin_ms; }
+bool net_used_cache() { return fast_attempt; }
@@ -0,0 +1,234 @@
+#include "remote_frame.h"
+
+#include <string.h>
+
+// ===================== CRC-32 =====================
+// nibble table: 64 bytes instead of 1 KB
+static const uint32_t CRC_NIBBLE[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t rframe_crc32(const uint8_t* p, size_t n, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= p[i];
+    crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+    crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+// ===================== HEADER =====================
+struct ChunkHeader {
+  uint8_t flags;
+  uint16_t frame_id;
+  uint16_t index;
+  uint16_t count;
+  uint32_t base_crc;
+  uint32_t frame_crc;
+};
+
+static uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool parse_header(const uint8_t* msg, unsigned int len, ChunkHeader& h) {
+  if (len < (unsigned)RFRAME_HEADER_BYTES) return false;
+  if (msg[0] != 'R' || msg[1] != 'F' || msg[2] != RFRAME_VERSION) return false;
+  h.flags = msg[3];
+  h.frame_id = rd16(msg + 4);
+  h.index = rd16(msg + 6);
+  h.count = rd16(msg + 8);
+  h.base_crc = rd32(msg + 10);
+  h.frame_crc = rd32(msg + 14);
+  return h.count > 0 && h.index < h.count;
+}
+
+// ===================== OUTPUT =====================
+static void flush_stage(RFrameRx& rx) {
+  if (rx.stage_len == 0) return;
+  rx.crc = rframe_crc32(rx.stage, rx.stage_len, rx.crc);
+  rx.sink.write(rx.stage, rx.stage_len);
+  rx.stage_len = 0;
+}
+
+static void out_literal(RFrameRx& rx, const uint8_t* p, size_t n) {
+  if (rx.fb) {
+    uint8_t* dst = rx.fb + rx.out_pos;
+    if (rx.flags & RFRAME_DELTA) {
+      for (size_t i = 0; i < n; i++) dst[i] ^= p[i];
+    } else {
+      memcpy(dst, p, n);
+    }
+    rx.crc = rframe_crc32(dst, n, rx.crc);
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      rx.stage[rx.stage_len++] = p[i];
+      if (rx.stage_len == RFRAME_STAGE_BYTES) flush_stage(rx);
+    }
+  }
+  rx.out_pos += n;
+}
+
+static void out_run(RFrameRx& rx, uint8_t v, size_t n) {
+  if (rx.fb) {
+    uint8_t* dst = rx.fb + rx.out_pos;
+    if (rx.flags & RFRAME_DELTA) {
+      if (v) for (size_t i = 0; i < n; i++) dst[i] ^= v;
+    } else {
+      memset(dst, v, n);
+    }
+    rx.crc = rframe_crc32(dst, n, rx.crc);
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      rx.stage[rx.stage_len++] = v;
+      if (rx.stage_len == RFRAME_STAGE_BYTES) flush_stage(rx);
+    }
+  }
+  rx.out_pos += n;
+}
+
+// ===================== DECODER =====================
+enum DecState : uint8_t { DEC_CTRL = 0, DEC_LITERAL, DEC_RUN };
+
+// false if the stream writes past the end of the frame
+static bool decode(RFrameRx& rx, const uint8_t* p, const uint8_t* end) {
+  while (p < end) {
+    switch (rx.dec_state) {
+      case DEC_CTRL: {
+        uint8_t n = *p++;
+        if (n < 128) {
+          rx.dec_state = DEC_LITERAL;
+          rx.dec_count = (uint8_t)(n + 1);
+        } else {
+          rx.dec_state = DEC_RUN;
+          rx.dec_count = (uint8_t)(n - 126);
+        }
+        break;
+      }
+      case DEC_LITERAL: {
+        size_t n = rx.dec_count;
+        if ((size_t)(end - p) < n) n = (size_t)(end - p);
+        if (n > rx.fb_len - rx.out_pos) return false;
+        out_literal(rx, p, n);
+        p += n;
+        rx.dec_count = (uint8_t)(rx.dec_count - n);
+        if (rx.dec_count == 0) rx.dec_state = DEC_CTRL;
+        break;
+      }
+      case DEC_RUN: {
+        uint8_t v = *p++;
+        if (rx.dec_count > rx.fb_len - rx.out_pos) return false;
+        out_run(rx, v, rx.dec_count);
+        rx.dec_state = DEC_CTRL;
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+// ===================== RECEIVE =====================
+static const uint16_t NO_NACK = 0xFFFF;
+
+void rframe_begin(RFrameRx& rx, uint8_t* fb, size_t fb_len) {
+  memset(&rx, 0, sizeof(rx));
+  rx.fb = fb;
+  rx.fb_len = fb_len;
+}
+
+void rframe_begin_sink(RFrameRx& rx, const RFrameSink& sink, size_t frame_len) {
+  memset(&rx, 0, sizeof(rx));
+  rx.sink = sink;
+  rx.fb_len = frame_len;
+}
+
+RFrameResult rframe_chunk(RFrameRx& rx, const uint8_t* msg, unsigned int len) {
+  ChunkHeader h;
+  if (!parse_header(msg, len, h)) return RFRAME_BAD_HEADER;
+
+  // a second copy of the first chunk: the delta base may already be overwritten
+  if (h.index == 0 && rx.active && h.frame_id == rx.frame_id && rx.next_chunk > 0)
+    return RFRAME_IGNORED;
+
+  if (h.index == 0) {
+    // a new frame replaces whatever was in flight
+    if ((h.flags & RFRAME_DELTA) && (!rx.fb || rx.fb_crc == 0 || h.base_crc != rx.fb_crc)) {
+      rx.active = false;
+      rx.frame_id = h.frame_id;   // its later chunks are ignored
+      rx.chunk_count = h.count;
+      return RFRAME_BAD_BASE;
+    }
+    rx.active = true;
+    rx.flags = h.flags;
+    rx.frame_id = h.frame_id;
+    rx.chunk_count = h.count;
+    rx.frame_crc = h.frame_crc;
+    rx.next_chunk = 0;
+    rx.nack_index = NO_NACK;
+    rx.out_pos = 0;
+    rx.crc = 0;
+    rx.dec_state = DEC_CTRL;
+    rx.dec_count = 0;
+    rx.stage_len = 0;
+    rx.fb_crc = 0;   // partly written from here on
+    if (!rx.fb) rx.sink.start();
+  } else if (!rx.active || h.frame_id != rx.frame_id) {
+    // late copy of a frame that already ended
+    if (!rx.active && h.frame_id == rx.frame_id && rx.chunk_count) return RFRAME_IGNORED;
+    // a frame whose first chunk went missing: ask for it, the frame buffer
+    // (and so the delta base) is untouched until it arrives
+    rx.active = true;
+    rx.frame_id = h.frame_id;
+    rx.chunk_count = h.count;
+    rx.next_chunk = 0;
+    rx.nack_index = h.index;
+    return RFRAME_NEED_RESEND;
+  }
+
+  if (h.count != rx.chunk_count) {
+    rx.active = false;
+    return RFRAME_OUT_OF_ORDER;
+  }
+  if (h.index < rx.next_chunk) return RFRAME_IGNORED;
+  if (h.index > rx.next_chunk) {
+    // report each gap once; chunks already sent behind it are expected. The
+    // last chunk reports it again, in case the resend got lost as well.
+    if (rx.nack_index != NO_NACK && h.index > rx.nack_index && h.index + 1 < rx.chunk_count)
+      return RFRAME_IGNORED;
+    rx.nack_index = h.index;
+    return RFRAME_NEED_RESEND;
+  }
+
+  if (!decode(rx, msg + RFRAME_HEADER_BYTES, msg + len)) {
+    rx.active = false;
+    return RFRAME_CORRUPT;
+  }
+  if (!rx.fb) flush_stage(rx);
+  rx.next_chunk++;
+  if (rx.nack_index != NO_NACK && rx.next_chunk > rx.nack_index) rx.nack_index = NO_NACK;
+  if (rx.next_chunk < rx.chunk_count) return RFRAME_CHUNK_OK;
+
+  rx.active = false;
+  if (rx.out_pos != rx.fb_len || rx.dec_state != DEC_CTRL) return RFRAME_CORRUPT;
+  if (rx.crc != rx.frame_crc) return RFRAME_BAD_CRC;
+  if (rx.fb) rx.fb_crc = rx.frame_crc;
+  return RFRAME_COMPLETE;
+}
+
+const char* rframe_result_name(RFrameResult r) {
+  switch (r) {
+    case RFRAME_CHUNK_OK:     return "ok";
+    case RFRAME_COMPLETE:     return "complete";
+    case RFRAME_IGNORED:      return "ignored";
+    case RFRAME_NEED_RESEND:  return "gap";
+    case RFRAME_BAD_HEADER:   return "bad header";
+    case RFRAME_OUT_OF_ORDER: return "out of order";
+    case RFRAME_BAD_BASE:     return "unknown base";
+    case RFRAME_CORRUPT:      return "corrupt";
+    case RFRAME_BAD_CRC:      return "crc mismatch";
+  }
+  return "?";
+}
@@ -0,0 +1,93 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "signal_filter.h"
+
+static const uint32_t FILTER_MAGIC = 0x464C5401 ^ (uint32_t)sizeof(FilterState);
+
+void filter_reset(FilterState& st) {
+  memset(&st, 0, sizeof(st));
+  st.magic = FILTER_MAGIC;
+}
+
+void filter_init(FilterState& st) {
+  if (st.magic != FILTER_MAGIC) filter_reset(st);
+}
+
+static int median_of(const FilterState& st) {
+  int16_t v[FILTER_MAX_MEDIAN];
+  int n = st.count;
+  memcpy(v, st.window, sizeof(v));
+  // insertion sort, n <= 7
+  for (int i = 1; i < n; i++) {
+    int16_t x = v[i];
+    int j = i - 1;
+    while (j >= 0 && v[j] > x) { v[j + 1] = v[j]; j--; }
+    v[j + 1] = x;
+  }
+  return v[(n - 1) / 2];
+}
+
+// round-to-nearest of x / 16 for either sign
+static int round_x16(int32_t x) {
+  return (x >= 0) ? (int)((x + 8) / 16) : -(int)((-x + 8) / 16);
+}
+
+int filter_input(const FilterConfig& cfg, FilterState& st, int raw) {
+  if (raw < INT16_MIN) raw = INT16_MIN;
+  if (raw > INT16_MAX) raw = INT16_MAX;
+
+  int v = raw;
+  int n = cfg.median_n;
+  if (n > FILTER_MAX_MEDIAN) n = FILTER_MAX_MEDIAN;
+  if (n > 1) {
+    // window starts empty: the median of what is there (lower middle)
+    st.window[st.head] = (int16_t)raw;
+    st.head = (uint8_t)((st.head + 1) % n);
+    if (st.count < n) st.count++;
+    v = median_of(st);
+  }
+
+  if (cfg.ewma_alpha_x16 > 0 && cfg.ewma_alpha_x16 < 16) {
+    if (!st.ewma_valid) {
+      st.ewma_x16 = (int32_t)v * 16;
+      st.ewma_valid = true;
+    } else {
+      st.ewma_x16 += ((int32_t)v * 16 - st.ewma_x16) * cfg.ewma_alpha_x16 / 16;
+    }
+    v = round_x16(st.ewma_x16);
+  }
+  return v;
+}
+
+int filter_theme(const FilterConfig& cfg, int v, int theme) {
+  if (theme == FILTER_NO_VALUE) return v;
+  int r = v;
+  for (uint8_t i = 0; i < cfg.threshold_count; i++) {
+    int th = cfg.thresholds[i];
+    if ((theme > th) == (v > th)) continue;
+    // up: clear th + hysteresis, down: reach th - hysteresis; a crossing
+    // that does not stops on its own side of th
+    if (v > th && v <= th + cfg.hysteresis && r > th) r = th;
+    if (v <= th && v > th - cfg.hysteresis && r <= th) r = th + 1;
+  }
+  return r;
+}
+
+static bool same_theme(const FilterConfig& cfg, int a, int b) {
+  for (uint8_t i = 0; i < cfg.threshold_count; i++) {
+    int th = cfg.thresholds[i];
+    if ((a > th) != (b > th)) return false;
+  }
+  return true;
+}
+
+FilterVerdict filter_decide(const FilterConfig& cfg, int v, int shown, int theme) {
+  if (shown == FILTER_NO_VALUE) return FILTER_SHOW;
+  if (v == shown) return FILTER_SAME;
+  if (!same_theme(cfg, theme, filter_theme(cfg, v, theme))) return FILTER_SHOW;
+
+  int d = v - shown;
+  if (d < 0) d = -d;
+  return (d >= cfg.deadband) ? FILTER_SHOW : FILTER_HELD_DEADBAND;
+}
@@ -0,0 +1,159 @@
+#include <Arduino.h>
+
+#include "sleep_sched.h"
+#include "log.h"
+
+struct SchedSample {
+  uint32_t t_s;
+  int16_t value;
+};
+
+struct SleepSchedRtc {
+  uint32_t magic;
+  uint32_t clock_s;            // scheduler time at the start of this wake
+  SchedSample hist[SCHED_HISTORY];
+  uint8_t count;
+  uint8_t head;                // next slot
+  uint8_t quiet_wakes;         // consecutive wakes without a change
+  uint8_t failed_wakes;        // consecutive wakes without a session/value
+  uint32_t last_sleep_s;
+};
+
+static const uint32_t SCHED_MAGIC = 0x53434801;
+RTC_DATA_ATTR static SleepSchedRtc rtc_sched;
+
+static SleepSchedConfig cfg;
+
+void sched_reset() {
+  memset(&rtc_sched, 0, sizeof(rtc_sched));
+  rtc_sched.magic = SCHED_MAGIC;
+}
+
+void sched_begin(const SleepSchedConfig& c) {
+  cfg = c;
+  if (rtc_sched.magic != SCHED_MAGIC) sched_reset();
+}
+
+static void push_sample(uint32_t t_s, int value) {
+  rtc_sched.hist[rtc_sched.head] = SchedSample{ t_s, (int16_t)value };
+  rtc_sched.head = (rtc_sched.head + 1) % SCHED_HISTORY;
+  if (rtc_sched.count < SCHED_HISTORY) rtc_sched.count++;
+}
+
+static const SchedSample& sample_back(int i) {   // 0 = newest
+  return rtc_sched.hist[(rtc_sched.head + SCHED_HISTORY - 1 - i) % SCHED_HISTORY];
+}
+
+int32_t sched_rate_x10_per_h() {
+  if (rtc_sched.count < 2) return 0;
+  const SchedSample& a = sample_back(rtc_sched.count - 1);
+  const SchedSample& b = sample_back(0);
+  if (b.t_s <= a.t_s) return 0;
+  return (int32_t)((int64_t)(b.value - a.value) * 36000 / (int64_t)(b.t_s - a.t_s));
+}
+
+// Rate over the last two samples only. The long-window rate is diluted by
+// hours of flat history when heating starts.
+static int32_t recent_rate_x10_per_h() {
+  if (rtc_sched.count < 2) return 0;
+  const SchedSample& a = sample_back(1);
+  const SchedSample& b = sample_back(0);
+  if (b.t_s <= a.t_s) return 0;
+  return (int32_t)((int64_t)(b.value - a.value) * 36000 / (int64_t)(b.t_s - a.t_s));
+}
+
+static uint32_t clamp_s(uint64_t s) {
+  if (s < cfg.min_s) return cfg.min_s;
+  if (s > cfg.max_s) return cfg.max_s;
+  return (uint32_t)s;
+}
+
+// Time the fastest expected rise needs to change the theme. Heating can
+// start at any moment; cooling is slow and the trend sees it coming.
+static uint64_t threshold_cap_s(int v) {
+  uint64_t cap = UINT64_MAX;
+  if (!cfg.max_rate_x10_per_h) return cap;
+  for (uint8_t i = 0; i < cfg.threshold_count; i++) {
+    int th = cfg.thresholds[i];
+    if (v > th) continue;
+    int dist = th + 1 - v;
+    uint64_t s = 36000ULL * (uint32_t)dist / cfg.max_rate_x10_per_h;
+    if (s < cap) cap = s;
+  }
+  return cap;
+}
+
+static uint32_t choose_interval() {
+  if (!cfg.adaptive) return cfg.default_s;
+  uint32_t base;
+  int32_t rate = sched_rate_x10_per_h();   // °C/h x10
+  int32_t recent = recent_rate_x10_per_h();
+  if ((recent < 0 ? -recent : recent) > (rate < 0 ? -rate : rate)) rate = recent;
+
+  if (rtc_sched.count < 2 || rate == 0) {
+    // a flat trend says nothing about the next change; the quiet stretch
+    // and the threshold cap below decide how long to wait
+    base = cfg.default_s;
+  } else {
+    uint32_t abs_rate = (uint32_t)(rate < 0 ? -rate : rate);
+    // seconds until the value moves by 3/4 °C: the reading sits somewhere
+    // inside the shown degree, so waiting for a whole one is usually late
+    uint64_t s = 27000ULL / abs_rate;
+
+    // arrive at (not after) the next theme threshold in the current direction
+    int v = sample_back(0).value;
+    for (uint8_t i = 0; i < cfg.threshold_count; i++) {
+      int th = cfg.thresholds[i];
+      int dist = (rate > 0) ? (th + 1 - v) : (v - th);
+      if (dist <= 0) continue;
+      uint64_t to_th = 36000ULL * (uint32_t)dist / abs_rate;
+      if (to_th < s) s = to_th;
+    }
+    base = clamp_s(s);
+  }
+
+  // nothing happening (or nothing reachable): stretch the interval
+  uint64_t s = base;
+  if (rtc_sched.quiet_wakes > 1) s = s * (2 + rtc_sched.quiet_wakes) / 3;
+  if (rtc_sched.failed_wakes) s <<= (rtc_sched.failed_wakes < 4 ? rtc_sched.failed_wakes : 4);
+  if (rtc_sched.count) {
+    uint64_t cap = threshold_cap_s(sample_back(0).value);
+    if (s > cap) s = cap;
+  }
+  return clamp_s(s);
+}
+
+uint32_t sched_now_s() {
+  return rtc_sched.clock_s + (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+uint32_t sched_end_wake(WakeOutcome outcome, int value) {
+  uint32_t now_s = sched_now_s();
+
+  switch (outcome) {
+    case WAKE_REFRESHED:
+      push_sample(now_s, value);
+      rtc_sched.quiet_wakes = 0;
+      rtc_sched.failed_wakes = 0;
+      break;
+    case WAKE_UNCHANGED:
+      push_sample(now_s, value);
+      if (rtc_sched.quiet_wakes < 255) rtc_sched.quiet_wakes++;
+      rtc_sched.failed_wakes = 0;
+      break;
+    case WAKE_INVALID:
+    case WAKE_NO_MESSAGE:
+    case WAKE_NET_FAILED:
+      if (rtc_sched.failed_wakes < 255) rtc_sched.failed_wakes++;
+      break;
+  }
+
+  uint32_t sleep_s = choose_interval();
+  LOGI("[SCHED] outcome %u, rate %ld.%ld C/h, sleep %lu s", outcome,
+       (long)(sched_rate_x10_per_h() / 10), (long)abs(sched_rate_x10_per_h() % 10),
+       (unsigned long)sleep_s);
+
+  rtc_sched.last_sleep_s = sleep_s;
+  rtc_sched.clock_s = now_s + sleep_s;
+  return sleep_s;
+}
@@ -0,0 +1,117 @@
+#include <string.h>
+
+#include "sparkline.h"
+#include "canvas.h"
+
+static const uint32_t SPARK_MAGIC = 0x53504B01 ^ (uint32_t)sizeof(SparkState);
+
+void spark_reset(SparkState& sp) {
+  memset(&sp, 0, sizeof(sp));
+  memset(sp.cmin, SPARK_EMPTY, sizeof(sp.cmin));
+  memset(sp.cmax, SPARK_EMPTY, sizeof(sp.cmax));
+  sp.magic = SPARK_MAGIC;
+}
+
+void spark_init(SparkState& sp) {
+  if (sp.magic != SPARK_MAGIC) spark_reset(sp);
+}
+
+bool spark_empty(const SparkState& sp) {
+  return sp.right_col == 0;
+}
+
+// drops the oldest n columns
+static void shift_left(SparkState& sp, uint32_t n) {
+  if (n >= (uint32_t)SPARK_W) {
+    memset(sp.cmin, SPARK_EMPTY, sizeof(sp.cmin));
+    memset(sp.cmax, SPARK_EMPTY, sizeof(sp.cmax));
+    return;
+  }
+  memmove(sp.cmin, sp.cmin + n, SPARK_W - n);
+  memmove(sp.cmax, sp.cmax + n, SPARK_W - n);
+  memset(sp.cmin + SPARK_W - n, SPARK_EMPTY, n);
+  memset(sp.cmax + SPARK_W - n, SPARK_EMPTY, n);
+}
+
+void spark_add(SparkState& sp, uint32_t t_s, int value) {
+  uint32_t col = t_s / SPARK_COL_S + 1;   // +1: 0 marks an empty graph
+  uint8_t v = (uint8_t)(value < 0 ? 0 : (value > 254 ? 254 : value));
+
+  if (spark_empty(sp) || col + SPARK_W <= sp.right_col) {
+    // first sample, or older than the whole graph (clock restarted)
+    spark_reset(sp);
+    sp.right_col = col;
+  } else if (col > sp.right_col) {
+    shift_left(sp, col - sp.right_col);
+    sp.right_col = col;
+  }
+
+  int i = SPARK_W - 1 - (int)(sp.right_col - col);
+  if (sp.cmin[i] == SPARK_EMPTY || v < sp.cmin[i]) sp.cmin[i] = v;
+  if (sp.cmax[i] == SPARK_EMPTY || v > sp.cmax[i]) sp.cmax[i] = v;
+}
+
+// value -> row, hi on the top row
+static int spark_row(int v, int lo, int range) {
+  return (SPARK_H - 1) - (v - lo) * (SPARK_H - 1) / range;
+}
+
+void spark_spans(const SparkState& sp, SparkSpans& out) {
+  memset(out.top, -1, sizeof(out.top));
+  memset(out.bot, -1, sizeof(out.bot));
+  int lo = 255, hi = -1;
+  for (int i = 0; i < SPARK_W; i++) {
+    if (sp.cmin[i] == SPARK_EMPTY) continue;
+    if (sp.cmin[i] < lo) lo = sp.cmin[i];
+    if (sp.cmax[i] > hi) hi = sp.cmax[i];
+  }
+  if (hi < 0) return;
+  if (hi - lo < 4) {
+    lo = (hi + lo) / 2 - 2;
+    hi = lo + 4;
+  }
+  int range = hi - lo;
+
+  // one vertical span per column; empty columns between two samples are
+  // bridged with a straight line
+  int prev_i = -1, prev_y = 0;
+  for (int i = 0; i < SPARK_W; i++) {
+    if (sp.cmin[i] == SPARK_EMPTY) continue;
+    int y_top = spark_row(sp.cmax[i], lo, range);
+    int y_bot = spark_row(sp.cmin[i], lo, range);
+    int y_mid = spark_row((sp.cmin[i] + sp.cmax[i]) / 2, lo, range);
+
+    if (prev_i >= 0) {
+      int last = prev_y;
+      for (int k = prev_i + 1; k < i; k++) {
+        int yk = prev_y + (y_mid - prev_y) * (k - prev_i) / (i - prev_i);
+        out.top[k] = (int8_t)(yk < last ? yk : last);
+        out.bot[k] = (int8_t)(yk < last ? last : yk);
+        last = yk;
+      }
+      // join to the previous column
+      if (last < y_top) y_top = last;
+      if (last > y_bot) y_bot = last;
+    }
+    out.top[i] = (int8_t)y_top;
+    out.bot[i] = (int8_t)y_bot;
+
+    prev_i = i;
+    prev_y = y_mid;
+  }
+}
+
+void draw_spark_spans_l(int x, int y, const SparkSpans& s, uint8_t c, int from, int to) {
+  if (from < 0) from = 0;
+  if (to > SPARK_W) to = SPARK_W;
+  for (int i = from; i < to; i++) {
+    if (s.top[i] < 0) continue;
+    vline_l(x + i, y + s.top[i], s.bot[i] - s.top[i] + 1, c);
+  }
+}
+
+void draw_sparkline_l(int x, int y, const SparkState& sp, uint8_t c) {
+  static SparkSpans spans;   // off the render task's stack
+  spark_spans(sp, spans);
+  draw_spark_spans_l(x, y, spans, c);
+}
@@ -0,0 +1,131 @@
+#include <string.h>
+
+#include "spec_cache.h"
+
+struct SpecSlot {
+  uint32_t key;
+  uint32_t base_key;
+  uint16_t off;
+  uint16_t len;
+  bool delta;
+};
+
+static_assert(SPEC_POOL_BYTES <= 65535, "slot offsets are 16 bit");
+
+static uint8_t pool[SPEC_POOL_BYTES];
+static size_t used = 0;
+static SpecSlot slots[SPEC_MAX_SLOTS];
+static int slot_count = 0;
+
+// Same PackBits variant as the remote frames: header n < 128 is followed
+// by n + 1 literal bytes, n >= 128 by one byte repeated n - 126 times.
+// in[i] ^ (base ? base[i] : 0) is encoded. Returns 0 if out is too small.
+static size_t packbits_encode(const uint8_t* in, const uint8_t* base, size_t n, uint8_t* out,
+                              size_t cap) {
+#define SRC(i) (uint8_t)(in[i] ^ (base ? base[i] : 0))
+  size_t o = 0;
+  size_t i = 0;
+  while (i < n) {
+    uint8_t b = SRC(i);
+    size_t run = 1;
+    while (i + run < n && run < 129 && SRC(i + run) == b) run++;
+    if (run >= 2) {
+      if (o + 2 > cap) return 0;
+      out[o++] = (uint8_t)(126 + run);
+      out[o++] = b;
+      i += run;
+      continue;
+    }
+    // literal until the next pair of equal bytes
+    size_t start = i;
+    size_t len = 0;
+    while (i < n && len < 128) {
+      if (i + 1 < n && SRC(i + 1) == SRC(i)) break;
+      i++;
+      len++;
+    }
+    if (len == 0) continue;   // a run starts right here
+    if (o + 1 + len > cap) return 0;
+    out[o++] = (uint8_t)(len - 1);
+    for (size_t k = 0; k < len; k++) out[o++] = SRC(start + k);
+  }
+#undef SRC
+  return o;
+}
+
+static bool packbits_decode(const uint8_t* in, size_t n, uint8_t* out, size_t out_len, bool xor_in) {
+  size_t o = 0;
+  size_t i = 0;
+  while (i < n) {
+    uint8_t h = in[i++];
+    if (h < 128) {
+      size_t len = (size_t)h + 1;
+      if (i + len > n || o + len > out_len) return false;
+      for (size_t k = 0; k < len; k++, o++) out[o] = xor_in ? (uint8_t)(out[o] ^ in[i + k]) : in[i + k];
+      i += len;
+    } else {
+      size_t len = (size_t)h - 126;
+      if (i >= n || o + len > out_len) return false;
+      uint8_t b = in[i++];
+      if (xor_in) {
+        for (size_t k = 0; k < len; k++, o++) out[o] ^= b;
+      } else {
+        memset(out + o, b, len);
+        o += len;
+      }
+    }
+  }
+  return o == out_len;
+}
+
+static const SpecSlot* find(uint32_t key) {
+  for (int i = 0; i < slot_count; i++) {
+    if (slots[i].key == key) return &slots[i];
+  }
+  return nullptr;
+}
+
+void spec_reset() {
+  used = 0;
+  slot_count = 0;
+}
+
+bool spec_put(uint32_t key, const uint8_t* frame, size_t frame_len, const uint8_t* base,
+              uint32_t base_key) {
+  if (find(key)) return true;
+  if (slot_count >= SPEC_MAX_SLOTS) return false;
+  if (base && !find(base_key)) return false;
+  size_t n = packbits_encode(frame, base, frame_len, pool + used, SPEC_POOL_BYTES - used);
+  if (n == 0) return false;
+
+  SpecSlot& s = slots[slot_count++];
+  s.key = key;
+  s.base_key = base_key;
+  s.off = (uint16_t)used;
+  s.len = (uint16_t)n;
+  s.delta = base != nullptr;
+  used += n;
+  return true;
+}
+
+bool spec_get(uint32_t key, uint8_t* frame, size_t frame_len) {
+  const SpecSlot* s = find(key);
+  if (!s) return false;
+  if (s->delta && !spec_get(s->base_key, frame, frame_len)) return false;
+  return packbits_decode(pool + s->off, s->len, frame, frame_len, s->delta);
+}
+
+int spec_guesses(int last, bool falling, int* out) {
+  static const int STEPS[SPEC_MAX_GUESSES] = { 1, -1, 0, 2, -2 };
+  int sign = falling ? -1 : 1;
+  for (int i = 0; i < SPEC_MAX_GUESSES; i++) out[i] = last + sign * STEPS[i];
+  return SPEC_MAX_GUESSES;
+}
+
+int spec_count() {
+  return slot_count;
+}
+
+size_t spec_bytes_used() {
+  return used;
+}
@@ -0,0 +1,138 @@
+#include <string.h>
+
+#include "topic_router.h"
+
+static const uint8_t NONE = 0xFF;
+static const uint8_t ROOT = 0;
+
+// One filter level; the children of a node form a sibling list.
+struct RouteNode {
+  const char* seg;      // points into the filter string
+  uint8_t seg_len;
+  uint8_t first_child;
+  uint8_t next_sibling;
+  uint8_t route;        // first route ending at this level
+};
+
+static RouteNode nodes[ROUTER_MAX_NODES];
+static uint8_t node_count = 0;
+static uint8_t route_next[ROUTER_MAX_ROUTES];   // routes sharing one filter
+static const TopicRoute* table = nullptr;
+static int table_count = 0;
+
+static void init_node(uint8_t n, const char* seg, uint8_t len) {
+  nodes[n].seg = seg;
+  nodes[n].seg_len = len;
+  nodes[n].first_child = NONE;
+  nodes[n].next_sibling = NONE;
+  nodes[n].route = NONE;
+}
+
+// Finds or appends the child of parent for one level.
+static uint8_t child_for(uint8_t parent, const char* seg, uint8_t len) {
+  uint8_t prev = NONE;
+  for (uint8_t c = nodes[parent].first_child; c != NONE; c = nodes[c].next_sibling) {
+    if (nodes[c].seg_len == len && memcmp(nodes[c].seg, seg, len) == 0) return c;
+    prev = c;
+  }
+  if (node_count >= ROUTER_MAX_NODES) return NONE;
+
+  uint8_t n = node_count++;
+  init_node(n, seg, len);
+  if (prev == NONE) nodes[parent].first_child = n;
+  else nodes[prev].next_sibling = n;
+  return n;
+}
+
+bool router_begin(const TopicRoute* routes, int count) {
+  table = routes;
+  table_count = 0;
+  node_count = 1;
+  init_node(ROOT, "", 0);
+  if (count > ROUTER_MAX_ROUTES) return false;
+
+  for (int r = 0; r < count; r++) {
+    const char* p = routes[r].filter;
+    uint8_t node = ROOT;
+    while (true) {
+      const char* end = strchr(p, '/');
+      size_t len = end ? (size_t)(end - p) : strlen(p);
+      bool wild = memchr(p, '+', len) || memchr(p, '#', len);
+      if (len > 255 || (wild && len != 1)) return false;
+      if (p[0] == '#' && end) return false;   // '#' must be the last level
+
+      node = child_for(node, p, (uint8_t)len);
+      if (node == NONE) return false;
+      if (!end) break;
+      p = end + 1;
+    }
+
+    route_next[r] = NONE;
+    if (nodes[node].route == NONE) {
+      nodes[node].route = (uint8_t)r;
+    } else {
+      uint8_t last = nodes[node].route;
+      while (route_next[last] != NONE) last = route_next[last];
+      route_next[last] = (uint8_t)r;
+    }
+    table_count = r + 1;
+  }
+  return true;
+}
+
+// ===================== DISPATCH =====================
+static int fire(uint8_t route, const uint8_t* payload, unsigned int len) {
+  int n = 0;
+  for (; route != NONE; route = route_next[route]) {
+    const TopicRoute& rt = table[route];
+    int value = 0;
+    bool ok = rt.decode ? rt.decode(payload, len, rt.decode_arg, value) : true;
+    if (rt.handle) rt.handle(rt.slot, ok, value);
+    n++;
+  }
+  return n;
+}
+
+// Matches the topic levels starting at seg against the children of node.
+static int match(uint8_t node, const char* seg, bool first_level, const uint8_t* payload,
+                 unsigned int len) {
+  const char* end = strchr(seg, '/');
+  size_t seg_len = end ? (size_t)(end - seg) : strlen(seg);
+  // "$SYS/..." topics are not matched by a leading wildcard
+  bool wild_ok = !(first_level && seg[0] == '$');
+
+  int n = 0;
+  for (uint8_t c = nodes[node].first_child; c != NONE; c = nodes[c].next_sibling) {
+    const RouteNode& ch = nodes[c];
+    bool hit;
+    if (ch.seg_len == 1 && ch.seg[0] == '#') {
+      if (wild_ok) n += fire(ch.route, payload, len);   // rest of the topic
+      continue;
+    }
+    if (ch.seg_len == 1 && ch.seg[0] == '+') hit = wild_ok;
+    else hit = ch.seg_len == seg_len && memcmp(ch.seg, seg, seg_len) == 0;
+    if (!hit) continue;
+
+    if (end) {
+      n += match(c, end + 1, false, payload, len);
+    } else {
+      n += fire(ch.route, payload, len);
+      // "a/#" also matches "a"
+      for (uint8_t g = ch.first_child; g != NONE; g = nodes[g].next_sibling) {
+        if (nodes[g].seg_len == 1 && nodes[g].seg[0] == '#') n += fire(nodes[g].route, payload, len);
+      }
+    }
+  }
+  return n;
+}
+
+int router_dispatch(const char* topic, const uint8_t* payload, unsigned int len) {
+  if (!table || !topic) return 0;
+  return match(ROOT, topic, true, payload, len);
+}
+
+const TopicRoute* router_route(int i) {
+  return (i >= 0 && i < table_count) ? &table[i] : nullptr;
+}
+
+int router_route_count() { return table_count; }
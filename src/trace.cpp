@@ -0,0 +1,120 @@
+#include <Arduino.h>
+
+#include "trace.h"
+
+// ===================== RING =====================
+static TraceEvent ring[TRACE_RING_SIZE];
+static uint32_t ring_head = 0;   // total events ever claimed
+
+static const char* const NAMES[TR_COUNT] = {
+  "wifi_connect",
+  "mqtt_connect",
+  "subscribe",
+  "mqtt_message",
+  "render",
+  "spi_transfer",
+  "busy_wait",
+  "sleep",
+};
+
+const char* trace_name(uint8_t id) {
+  return (id < TR_COUNT) ? NAMES[id] : "?";
+}
+
+void trace_record(uint8_t id, uint8_t phase) {
+  uint32_t ts = (uint32_t)esp_timer_get_time();
+  // claim a slot; concurrent writers on the other core get the next one
+  uint32_t idx = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+  TraceEvent& e = ring[idx & (TRACE_RING_SIZE - 1)];
+  __atomic_store_n(&e.seq, 0, __ATOMIC_RELAXED);
+  // the data stores must not become visible before the slot is marked busy
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  e.ts_us = ts;
+  e.id = id;
+  e.phase = phase;
+  e.core = (uint8_t)xPortGetCoreID();
+  __atomic_store_n(&e.seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+void trace_reset() {
+  __atomic_store_n(&ring_head, 0, __ATOMIC_RELAXED);
+  for (int i = 0; i < TRACE_RING_SIZE; i++) ring[i].seq = 0;
+}
+
+// Copies the event claimed as index idx, false if it was overwritten or is
+// still being written.
+static bool read_event(uint32_t idx, TraceEvent& out) {
+  const TraceEvent& e = ring[idx & (TRACE_RING_SIZE - 1)];
+  if (__atomic_load_n(&e.seq, __ATOMIC_ACQUIRE) != idx + 1) return false;
+  out = e;
+  // keep the copy above ahead of the re-check, or a torn copy could pass
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&e.seq, __ATOMIC_RELAXED) == idx + 1;
+}
+
+static uint32_t window_first(uint32_t head) {
+  return (head > (uint32_t)TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+}
+
+// ===================== TEXT DUMP =====================
+void trace_dump(Print& out) {
+  uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+  uint32_t first = window_first(head);
+
+  out.printf("#TRACE v1 events=%lu lost=%lu\n",
+             (unsigned long)(head - first), (unsigned long)first);
+  for (uint32_t i = first; i < head; i++) {
+    TraceEvent e;
+    if (!read_event(i, e)) continue;
+    out.printf("%lu %u %c %s\n", (unsigned long)e.ts_us, e.core, (char)e.phase, trace_name(e.id));
+  }
+  out.println("#TRACE end");
+}
+
+// ===================== BINARY DUMP =====================
+// "TRC1" | u8 name_count | u8 event_size | u16 event_count (LE)
+// name_count x (u8 len, chars)
+// event_count x (u32 ts_us LE, u8 id, u8 phase, u8 core, u8 0)
+// Events overwritten between size() and write() are emitted with id 0xFF.
+static const uint8_t BIN_EVENT_SIZE = 8;
+static uint32_t bin_head = 0;
+
+size_t trace_binary_size() {
+  bin_head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+  size_t n = 8;
+  for (int i = 0; i < TR_COUNT; i++) n += 1 + strlen(NAMES[i]);
+  n += (size_t)(bin_head - window_first(bin_head)) * BIN_EVENT_SIZE;
+  return n;
+}
+
+void trace_write_binary(Print& out) {
+  uint32_t head = bin_head;
+  uint32_t first = window_first(head);
+  uint16_t count = (uint16_t)(head - first);
+
+  uint8_t hdr[8] = { 'T', 'R', 'C', '1', (uint8_t)TR_COUNT, BIN_EVENT_SIZE,
+                     (uint8_t)(count & 0xFF), (uint8_t)(count >> 8) };
+  out.write(hdr, sizeof(hdr));
+  for (int i = 0; i < TR_COUNT; i++) {
+    uint8_t len = (uint8_t)strlen(NAMES[i]);
+    out.write(&len, 1);
+    out.write((const uint8_t*)NAMES[i], len);
+  }
+
+  for (uint32_t i = first; i < head; i++) {
+    TraceEvent e;
+    uint8_t rec[BIN_EVENT_SIZE] = { 0 };
+    if (read_event(i, e)) {
+      rec[0] = (uint8_t)(e.ts_us);
+      rec[1] = (uint8_t)(e.ts_us >> 8);
+      rec[2] = (uint8_t)(e.ts_us >> 16);
+      rec[3] = (uint8_t)(e.ts_us >> 24);
+      rec[4] = e.id;
+      rec[5] = e.phase;
+      rec[6] = e.core;
+    } else {
+      rec[4] = 0xFF;
+    }
+    out.write(rec, sizeof(rec));
+  }
+}
@@ -0,0 +1,121 @@
+#include <math.h>
+#include <string.h>
+
+#include "trend.h"
+
+static const uint32_t TREND_MAGIC = 0x54524E01 ^ (uint32_t)sizeof(TrendState);
+
+// keep relative times small enough that Σt² and (Σt)² stay well inside int64
+static const uint32_t TREND_REBASE_S = 1UL << 24;
+
+void trend_reset(TrendState& st) {
+  memset(&st, 0, sizeof(st));
+  st.magic = TREND_MAGIC;
+}
+
+void trend_init(TrendState& st) {
+  if (st.magic != TREND_MAGIC) trend_reset(st);
+}
+
+static void sums_add(TrendState& st, const TrendSample& s, int sign) {
+  int64_t t = (int64_t)s.t_s;
+  int64_t v = s.value;
+  st.st += sign * t;
+  st.sv += sign * v;
+  st.stt += sign * t * t;
+  st.stv += sign * t * v;
+  st.svv += sign * v * v;
+}
+
+static const TrendSample& newest(const TrendState& st) {
+  return st.ring[(st.head + TREND_CAPACITY - 1) % TREND_CAPACITY];
+}
+
+static const TrendSample& oldest(const TrendState& st) {
+  return st.ring[(st.head + TREND_CAPACITY - st.count) % TREND_CAPACITY];
+}
+
+// Moves base_s up to the oldest sample; O(n), only every ~194 days.
+static void rebase(TrendState& st) {
+  uint32_t shift = oldest(st).t_s;
+  st.base_s += shift;
+  st.st = st.sv = st.stt = st.stv = st.svv = 0;
+  for (uint8_t i = 0; i < st.count; i++) {
+    TrendSample& s = st.ring[(st.head + TREND_CAPACITY - 1 - i) % TREND_CAPACITY];
+    s.t_s -= shift;
+    sums_add(st, s, +1);
+  }
+}
+
+void trend_add(TrendState& st, uint32_t t_s, int value) {
+  if (value < INT16_MIN) value = INT16_MIN;
+  if (value > INT16_MAX) value = INT16_MAX;
+
+  if (st.count == 0) st.base_s = t_s;
+  if (t_s < st.base_s || (st.count && t_s - st.base_s < newest(st).t_s)) {
+    trend_reset(st);
+    st.base_s = t_s;
+  }
+
+  if (st.count == TREND_CAPACITY) {
+    sums_add(st, st.ring[st.head], -1);   // evict the oldest
+    st.count--;
+  }
+
+  TrendSample s = { t_s - st.base_s, (int16_t)value };
+  st.ring[st.head] = s;
+  st.head = (uint8_t)((st.head + 1) % TREND_CAPACITY);
+  st.count++;
+  sums_add(st, s, +1);
+
+  if (s.t_s >= TREND_REBASE_S) rebase(st);
+}
+
+bool trend_last(const TrendState& st, int& value) {
+  if (st.count == 0) return false;
+  value = newest(st).value;
+  return true;
+}
+
+void trend_slope(const TrendState& st, int32_t& slope_x10_per_h, int32_t& stderr_x10_per_h) {
+  slope_x10_per_h = 0;
+  stderr_x10_per_h = 0;
+  int64_t n = st.count;
+  if (n < 3) return;
+
+  // centered sums, exact in integers (scaled by n)
+  int64_t sxx = n * st.stt - st.st * st.st;
+  int64_t sxy = n * st.stv - st.st * st.sv;
+  int64_t syy = n * st.svv - st.sv * st.sv;
+  if (sxx <= 0) return;   // all samples at the same time
+
+  // only the final step is floating point
+  double slope = (double)sxy / (double)sxx;   // °C per second
+  double ssr = ((double)syy - (double)sxy * slope) / (double)n;
+  if (ssr < 0) ssr = 0;
+  double se = sqrt(ssr / (double)(n - 2) / ((double)sxx / (double)n));
+
+  slope_x10_per_h = (int32_t)lround(slope * 36000.0);
+  stderr_x10_per_h = (int32_t)lround(se * 36000.0);
+}
+
+ArrowDir trend_arrow(const TrendConfig& cfg, const TrendState& st, ArrowDir prev) {
+  uint8_t min_samples = cfg.min_samples < 3 ? 3 : cfg.min_samples;
+  if (st.count < min_samples) return prev;
+
+  int32_t slope, se;
+  trend_slope(st, slope, se);
+  int32_t mag = slope < 0 ? -slope : slope;
+  int32_t band = se * cfg.min_t_stat_x10 / 10;
+
+  // steady: even the edge of the confidence band is a slow drift
+  if (mag + band < (int32_t)cfg.steady_x10_per_h) return ARROW_NONE;
+
+  // rising/falling: the slope is clearly non-zero and not a slow drift
+  if (mag > band && mag >= (int32_t)cfg.steady_x10_per_h) {
+    bool fast = cfg.fast_x10_per_h && mag - band >= (int32_t)cfg.fast_x10_per_h;
+    if (slope > 0) return fast ? ARROW_UP_FAST : ARROW_UP;
+    return fast ? ARROW_DOWN_FAST : ARROW_DOWN;
+  }
+  return prev;
+}
@@ -0,0 +1,88 @@
+#include "update_queue.h"
+#include "crit_section.h"
+#include "log.h"
+#include "metrics.h"
+
+static UpdateQueueConfig cfg;
+
+// written by the MQTT callback, read by the render task
+static CritSection slot_mux;
+static int slot_value = 0;
+static bool slot_full = false;
+
+static bool refreshed_once = false;
+static uint32_t last_refresh_ms = 0;
+
+void update_queue_begin(const UpdateQueueConfig& c) {
+  cfg = c;
+  slot_full = false;
+  refreshed_once = false;
+}
+
+void update_post(int value) {
+  bool replaced;
+  {
+    CritLock lock(slot_mux);
+    replaced = slot_full;
+    slot_value = value;
+    slot_full = true;
+  }
+
+  if (replaced) metric_inc(M_UPDATES_COALESCED);
+}
+
+bool update_pending() {
+  CritLock lock(slot_mux);
+  return slot_full;
+}
+
+static bool crosses_threshold(int from, int to) {
+  for (uint8_t i = 0; i < cfg.threshold_count; i++) {
+    int th = cfg.thresholds[i];
+    if ((from > th) != (to > th)) return true;
+  }
+  return false;
+}
+
+bool update_take(uint32_t now_ms, int shown, int& out) {
+  bool full;
+  int v;
+  {
+    CritLock lock(slot_mux);
+    full = slot_full;
+    v = slot_value;
+  }
+  if (!full) return false;
+
+  if (refreshed_once && v != shown && now_ms - last_refresh_ms < cfg.min_interval_ms) {
+    if (!crosses_threshold(shown, v)) return false;   // keep it for later
+    metric_inc(M_REFRESH_BYPASSES);
+    LOGD("[UPD] %d crosses a threshold, refreshing early", v);
+  }
+
+  // only clear the slot if nothing newer arrived meanwhile
+  bool same;
+  {
+    CritLock lock(slot_mux);
+    same = slot_value == v;
+    if (same) slot_full = false;
+  }
+  if (!same) return false;   // picked up on the next pass
+
+  out = v;
+  return true;
+}
+
+bool update_due(uint32_t now_ms) {
+  return !refreshed_once || now_ms - last_refresh_ms >= cfg.min_interval_ms;
+}
+
+uint32_t update_wait_ms(uint32_t now_ms) {
+  if (update_due(now_ms)) return 0;
+  return cfg.min_interval_ms - (now_ms - last_refresh_ms);
+}
+
+void update_refreshed(uint32_t now_ms) {
+  refreshed_once = true;
+  last_refresh_ms = now_ms;
+}
@@ -0,0 +1,82 @@
+#include <Arduino.h>
+
+#include "wake_cycle.h"
+#include "metrics.h"
+#include "log.h"
+
+// EWMA with alpha = 1/4, stored x16 for sub-ms resolution
+struct WakeCycleRtc {
+  uint32_t magic;
+  uint32_t latency_x16;
+  uint32_t samples;
+};
+
+static const uint32_t WAKE_MAGIC = 0x57414B01;
+RTC_DATA_ATTR static WakeCycleRtc rtc_wake;
+
+static WakeCycleConfig cfg;
+static uint32_t subscribed_ms = 0;
+static bool subscribed = false;
+static bool got_message = false;
+static bool timed_out = false;
+
+void wake_cycle_reset() {
+  memset(&rtc_wake, 0, sizeof(rtc_wake));
+  rtc_wake.magic = WAKE_MAGIC;
+}
+
+void wake_cycle_begin(const WakeCycleConfig& c) {
+  cfg = c;
+  subscribed = false;
+  got_message = false;
+  timed_out = false;
+  if (rtc_wake.magic != WAKE_MAGIC) wake_cycle_reset();
+}
+
+void wake_cycle_subscribed(uint32_t now_ms) {
+  if (subscribed) return;
+  subscribed = true;
+  subscribed_ms = now_ms;
+}
+
+void wake_cycle_message(uint32_t now_ms) {
+  if (!subscribed || got_message) return;
+  got_message = true;
+
+  uint32_t latency = now_ms - subscribed_ms;
+  metric_observe(M_H_RETAINED_LATENCY_MS, latency);
+  if (rtc_wake.samples == 0) rtc_wake.latency_x16 = latency * 16;
+  else rtc_wake.latency_x16 = rtc_wake.latency_x16 - rtc_wake.latency_x16 / 4 + latency * 4;
+  rtc_wake.samples++;
+  LOGD("[WAKE] retained value after %lu ms (avg %lu ms)",
+       (unsigned long)latency, (unsigned long)wake_cycle_latency_ms());
+}
+
+bool wake_cycle_subscribed_yet() { return subscribed; }
+bool wake_cycle_got_message() { return got_message; }
+
+uint32_t wake_cycle_latency_ms() {
+  return rtc_wake.latency_x16 / 16;
+}
+
+uint32_t wake_cycle_timeout_ms() {
+  if (rtc_wake.samples == 0) return cfg.max_timeout_ms;
+  uint32_t t = wake_cycle_latency_ms() * cfg.latency_multiplier + cfg.margin_ms;
+  if (t < cfg.min_timeout_ms) t = cfg.min_timeout_ms;
+  if (t > cfg.max_timeout_ms) t = cfg.max_timeout_ms;
+  return t;
+}
+
+bool wake_cycle_timed_out(uint32_t now_ms) {
+  if (!subscribed || got_message) return false;
+  if (now_ms - subscribed_ms <= wake_cycle_timeout_ms()) return false;
+
+  if (!timed_out) {
+    // the broker was slower than we assumed: double the estimate so the
+    // next wake waits longer (bounded by max_timeout_ms; stop doubling
+    // there, or a long run of misses overflows it back to a short wait)
+    timed_out = true;
+    if (rtc_wake.samples && rtc_wake.latency_x16 < cfg.max_timeout_ms * 16) rtc_wake.latency_x16 *= 2;
+  }
+  return true;
+}
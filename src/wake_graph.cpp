@@ -0,0 +1,88 @@
+#include <Arduino.h>
+
+#include "wake_graph.h"
+#include "log.h"
+#include "metrics.h"
+
+#define WS_BIT(s) (1u << (s))
+
+// stages each one waits for
+static const uint8_t DEPS[WS_COUNT] = {
+  0,                                   // WS_PANEL
+  0,                                   // WS_BATTERY
+  0,                                   // WS_WIFI
+  WS_BIT(WS_WIFI),                     // WS_MQTT
+  WS_BIT(WS_MQTT),                     // WS_MESSAGE
+  WS_BIT(WS_MESSAGE) | WS_BIT(WS_BATTERY),   // WS_RENDER
+  WS_BIT(WS_RENDER) | WS_BIT(WS_PANEL),      // WS_PIXEL
+};
+
+static const char* const NAMES[WS_COUNT] = {
+  "panel", "battery", "wifi", "mqtt", "message", "render", "pixel",
+};
+
+static uint32_t start_ms[WS_COUNT];
+static uint32_t end_ms[WS_COUNT];
+static volatile bool started[WS_COUNT];
+static volatile bool ended[WS_COUNT];
+
+const char* wake_stage_name(WakeStage s) {
+  return (s < WS_COUNT) ? NAMES[s] : "?";
+}
+
+void wake_stage_start(WakeStage s) {
+  if (s >= WS_COUNT || started[s]) return;
+  start_ms[s] = millis();
+  started[s] = true;
+}
+
+bool wake_stage_end(WakeStage s) {
+  if (s >= WS_COUNT || ended[s]) return false;
+  end_ms[s] = millis();
+  if (!started[s]) {
+    // not started explicitly: it began when its last dependency ended
+    uint32_t t = 0;
+    for (int d = 0; d < WS_COUNT; d++) {
+      if ((DEPS[s] & WS_BIT(d)) && ended[d] && end_ms[d] > t) t = end_ms[d];
+    }
+    start_ms[s] = t;
+    started[s] = true;
+  }
+  ended[s] = true;
+  return true;
+}
+
+bool wake_stage_done(WakeStage s) {
+  return s < WS_COUNT && ended[s];
+}
+
+void wake_graph_report() {
+  if (!ended[WS_PIXEL]) return;
+
+  // walk back through the dependency that finished last
+  uint8_t path[WS_COUNT];
+  int n = 0;
+  int s = WS_PIXEL;
+  while (s >= 0 && n < WS_COUNT) {
+    path[n++] = (uint8_t)s;
+    int last = -1;
+    for (int d = 0; d < WS_COUNT; d++) {
+      if (!(DEPS[s] & WS_BIT(d)) || !ended[d]) continue;
+      if (last < 0 || end_ms[d] > end_ms[last]) last = d;
+    }
+    s = last;
+  }
+
+  uint32_t serial_ms = 0;
+  for (int i = 0; i < WS_COUNT; i++) {
+    if (ended[i]) serial_ms += end_ms[i] - start_ms[i];
+  }
+  uint32_t total = end_ms[WS_PIXEL];
+  metric_observe(M_H_WAKE_PIXEL_MS, total);
+  LOGI("[WAKE] first pixel at %lu ms (stages add up to %lu ms)", (unsigned long)total,
+       (unsigned long)serial_ms);
+  for (int i = n - 1; i >= 0; i--) {
+    uint8_t p = path[i];
+    LOGI("[WAKE]   %s %lu..%lu ms", NAMES[p], (unsigned long)start_ms[p], (unsigned long)end_ms[p]);
+  }
+}
@@ -0,0 +1,699 @@
+// Host-side differential fuzz of the payload decoders.
+//
+// decode_tenths() is checked against strtod() on the longest number prefix
+// the documented grammar allows, rounded to tenths half away from zero.
+// decode_json_path() / decode_json_tenths() are checked against a small
+// validating recursive-descent JSON parser on random documents (nested
+// objects, arrays, escaped strings, odd whitespace, duplicate keys: the
+// first one wins), and decode_cbor_tenths() against the item tree an
+// independent encoder wrote (integers, half/single/double floats, tags,
+// numeric and sentinel strings, non-text keys). Mutated and truncated
+// inputs must not crash and must return spans inside the input; build
+// with -fsanitize=address,undefined to have out-of-bounds reads caught.
+// Exits with 1 on any mismatch.
+//
+//   pio run -e decode_fuzz
+//   .pio/build/decode_fuzz/program [--iters N] [--seed S]
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude src/decode.cpp tools/decode_fuzz/decode_fuzz.cpp -o decode_fuzz
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "decode.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+// Prints the input of the first few failing cases.
+static int reported = 0;
+
+static void report(const char* what, const std::string& in, const char* path = nullptr) {
+  failures++;
+  if (reported++ >= 10) return;
+  fprintf(stderr, "%s mismatch%s%s on %u bytes:", what, path ? " at path " : "", path ? path : "",
+          (unsigned)in.size());
+  for (unsigned char c : in) fprintf(stderr, (c >= 0x20 && c < 0x7F) ? "%c" : "\\x%02x", c);
+  fprintf(stderr, "\n");
+}
+
+static uint64_t rng_state = 1;
+
+static uint32_t rnd() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (uint32_t)(rng_state >> 16);
+}
+
+static uint32_t rnd(uint32_t n) { return rnd() % n; }
+
+static const uint8_t* bytes(const std::string& s) { return (const uint8_t*)s.data(); }
+
+// ===================== NUMBERS =====================
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// Reference for decode_tenths(): 0 no number, 1 value in *out, 2 out of
+// range, 3 too close to a rounding tie or the range limit to tell.
+static int ref_tenths(const std::string& s, int32_t* out) {
+  size_t i = 0, n = s.size();
+  while (i < n && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) i++;
+  size_t start = i;
+  if (i < n && (s[i] == '-' || s[i] == '+')) i++;
+  size_t digits = 0;
+  while (i < n && is_digit(s[i])) i++, digits++;
+  if (i < n && s[i] == '.') {
+    i++;
+    while (i < n && is_digit(s[i])) i++, digits++;
+  }
+  if (digits == 0) return 0;
+  std::string num = s.substr(start, i - start);
+  int exp = 0;
+  if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+    size_t j = i + 1;
+    bool neg = false;
+    if (j < n && (s[j] == '-' || s[j] == '+')) neg = s[j++] == '-';
+    if (j < n && is_digit(s[j])) {
+      for (; j < n && is_digit(s[j]); j++) {
+        if (exp < 100000) exp = exp * 10 + (s[j] - '0');
+      }
+      if (neg) exp = -exp;
+    }
+  }
+  // strtod rounds the decimal string correctly; scale by 10 in the string
+  char buf[64];
+  snprintf(buf, sizeof(buf), "e%d", exp + 1);
+  double t = strtod((num + buf).c_str(), nullptr);
+  double a = fabs(t);
+  if (a > 2000000000.0 + 1) return 2;
+  if (a > 2000000000.0 - 1) return 3;
+  // beyond ~15 significant digits strtod and the decoder may round a near
+  // tie differently (the decoder keeps 17 digits and drops the rest)
+  size_t sig = 0;
+  bool lead = true;
+  for (char c : num) {
+    if (!is_digit(c) || (lead && c == '0')) continue;
+    lead = false;
+    sig++;
+  }
+  double frac = a - floor(a);
+  if (fabs(frac - 0.5) < 1e-6 && (frac != 0.5 || sig > 15)) return 3;
+  double r = floor(a + 0.5);
+  *out = (int32_t)(t < 0 ? -r : r);
+  return 1;
+}
+
+static std::string gen_digits(int max) {
+  std::string s;
+  int n = (int)rnd(max + 1);
+  for (int i = 0; i < n; i++) s += (char)('0' + rnd(10));
+  return s;
+}
+
+// Mostly well-formed numbers with the odd stray character.
+static std::string gen_number() {
+  static const char* const JUNK[] = { "", "", "", " ", "x", "\xC2\xB0" "C", ",", "e", "e+", ".", "-" };
+  std::string s;
+  for (int n = (int)rnd(3); n > 0; n--) s += " \t\r\n"[rnd(4)];
+  if (rnd(3) == 0) s += "+-"[rnd(2)];
+  int shape = (int)rnd(4);
+  if (shape == 0) {
+    s += gen_digits(25);   // past int64 precision too
+  } else {
+    s += gen_digits(shape == 1 ? 12 : 4);
+    s += '.';
+    s += gen_digits(shape == 3 ? 22 : 5);
+  }
+  if (rnd(3) == 0) {
+    s += "eE"[rnd(2)];
+    if (rnd(2)) s += "+-"[rnd(2)];
+    s += rnd(8) ? gen_digits(2) : gen_digits(6);
+  }
+  s += JUNK[rnd(sizeof(JUNK) / sizeof(JUNK[0]))];
+  return s;
+}
+
+static void mutate(std::string& s) {
+  int n = 1 + (int)rnd(3);
+  for (int i = 0; i < n && !s.empty(); i++) {
+    size_t at = rnd((uint32_t)s.size());
+    switch (rnd(4)) {
+      case 0: s[at] = (char)rnd(256); break;
+      case 1: s.erase(at, 1); break;
+      case 2: s.insert(at, 1, (char)rnd(256)); break;
+      default: s.resize(at); break;
+    }
+  }
+}
+
+static void check_number(const std::string& s) {
+  int32_t want = 0, got = 0;
+  int ref = ref_tenths(s, &want);
+  bool ok = decode_tenths(bytes(s), (unsigned int)s.size(), got);
+  if (ref == 3) return;
+  if (ok != (ref == 1) || (ok && got != want)) report("decode_tenths", s);
+}
+
+static void fuzz_numbers(int iters) {
+  for (int i = 0; i < iters; i++) {
+    std::string s = gen_number();
+    check_number(s);
+    mutate(s);
+    check_number(s);
+  }
+  static const char* const EDGE[] = {
+    "0", "-0", "0.05", "-0.05", "0.04999", "42.75", "-42.75", "4.25e1", "1e", "1e+", ".5", "5.",
+    ".", "-", "+.e1", "200000000", "200000000.04", "200000000.06", "-200000000.05",
+    "99999999999999999999999", "0.000000000000000000000000001", "1e-99999", "0e99999",
+    "1e30", "1e31", "00000000000000000000012.5", " \t\r\n7", "\v7"
+  };
+  for (const char* e : EDGE) check_number(e);
+  printf("decode_tenths: %d random + %d mutated + %d edge cases\n", iters, iters,
+         (int)(sizeof(EDGE) / sizeof(EDGE[0])));
+}
+
+// ===================== JSON =====================
+static const char* const KEYS[] = { "temperature", "attributes", "temp", "t", "a", "b", "" };
+static const int KEY_COUNT = sizeof(KEYS) / sizeof(KEYS[0]);
+
+static void ws(std::string& s) {
+  if (rnd(3) == 0) s += " \t\r\n"[rnd(4)];
+}
+
+static void gen_json_value(std::string& s, int depth);
+
+static void gen_json_string(std::string& s) {
+  static const char* const PARTS[] = { "ab", "42.5", "unknown", "\\\"", "\\\\", "\\n", "\\u00b0",
+                                       "{", "}", "[", "]", ",", ":", " " };
+  s += '"';
+  for (int n = (int)rnd(4); n > 0; n--) s += PARTS[rnd(sizeof(PARTS) / sizeof(PARTS[0]))];
+  s += '"';
+}
+
+static void gen_json_object(std::string& s, int depth) {
+  s += '{';
+  int n = (int)rnd(5);
+  for (int i = 0; i < n; i++) {
+    if (i) s += ',';
+    ws(s);
+    s += '"';
+    s += KEYS[rnd(KEY_COUNT)];
+    s += '"';
+    ws(s);
+    s += ':';
+    ws(s);
+    gen_json_value(s, depth + 1);
+    ws(s);
+  }
+  s += '}';
+}
+
+static void gen_json_value(std::string& s, int depth) {
+  uint32_t k = rnd(depth > 4 ? 6 : 9);
+  switch (k) {
+    case 0: case 1:   // JSON number grammar
+      if (rnd(2)) s += '-';
+      s += rnd(4) ? std::string(1, (char)('1' + rnd(9))) + gen_digits(3) : "0";
+      if (rnd(2)) s += "." + gen_digits(3) + (char)('0' + rnd(10));
+      if (rnd(4) == 0) s += std::string("e") + "+-"[rnd(2)] + (char)('0' + rnd(3));
+      break;
+    case 2: gen_json_string(s); break;
+    case 3: s += '"'; s += rnd(2) ? "-" : ""; s += gen_digits(3) + "7.5\""; break;
+    case 4: s += "true"; break;
+    case 5: s += rnd(2) ? "null" : "false"; break;
+    case 6: case 7: gen_json_object(s, depth); break;
+    default:
+      s += '[';
+      for (int n = (int)rnd(4), i = 0; i < n; i++) {
+        if (i) s += ',';
+        ws(s);
+        gen_json_value(s, depth + 1);
+      }
+      s += ']';
+      break;
+  }
+}
+
+// Validating reference parser. Records where the value at path is.
+struct RefJson {
+  const std::string& s;
+  size_t i;
+  std::vector<std::string> path;
+  std::vector<std::string> at;    // keys of the member being parsed
+  std::vector<bool> first;        // ...and whether it is the first with that key
+  bool found;
+  size_t v0, v1;                  // value span; a string without its quotes
+
+  void skip_ws() {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) i++;
+  }
+
+  bool on_path() const {
+    if (at.size() != path.size()) return false;
+    for (size_t k = 0; k < at.size(); k++) {
+      if (at[k] != path[k] || !first[k]) return false;
+    }
+    return true;
+  }
+
+  bool string(size_t& b0, size_t& b1) {
+    if (i >= s.size() || s[i] != '"') return false;
+    b0 = ++i;
+    while (i < s.size()) {
+      char c = s[i++];
+      if (c == '\\') {
+        if (i >= s.size()) return false;
+        char e = s[i++];
+        if (e == 'u') {
+          for (int k = 0; k < 4; k++, i++) {
+            if (i >= s.size() || !isxdigit((unsigned char)s[i])) return false;
+          }
+        } else if (!strchr("\"\\/bfnrt", e)) {
+          return false;
+        }
+      } else if (c == '"') {
+        b1 = i - 1;
+        return true;
+      } else if ((unsigned char)c < 0x20) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  bool number() {
+    size_t st = i;
+    if (i < s.size() && s[i] == '-') i++;
+    if (i >= s.size() || !is_digit(s[i])) return false;
+    if (s[i] == '0') i++;
+    else while (i < s.size() && is_digit(s[i])) i++;
+    if (i < s.size() && s[i] == '.') {
+      i++;
+      if (i >= s.size() || !is_digit(s[i])) return false;
+      while (i < s.size() && is_digit(s[i])) i++;
+    }
+    if (i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+      i++;
+      if (i < s.size() && (s[i] == '+' || s[i] == '-')) i++;
+      if (i >= s.size() || !is_digit(s[i])) return false;
+      while (i < s.size() && is_digit(s[i])) i++;
+    }
+    return i > st;
+  }
+
+  bool value() {
+    skip_ws();
+    if (i >= s.size()) return false;
+    size_t start = i, b0 = 0, b1 = 0;
+    bool is_string = s[i] == '"';
+    bool ok;
+    if (is_string) {
+      ok = string(b0, b1);
+    } else if (s[i] == '{') {
+      ok = object();
+    } else if (s[i] == '[') {
+      i++;
+      skip_ws();
+      ok = true;
+      if (i < s.size() && s[i] == ']') {
+        i++;
+      } else {
+        at.push_back("\x01[");   // array members are never on a path
+        first.push_back(false);
+        while (ok) {
+          ok = value();
+          skip_ws();
+          if (!ok || i >= s.size()) { ok = false; break; }
+          if (s[i] == ',') { i++; continue; }
+          ok = s[i++] == ']';
+          break;
+        }
+        at.pop_back();
+        first.pop_back();
+      }
+    } else if (!s.compare(i, 4, "true") || !s.compare(i, 4, "null")) {
+      i += 4;
+      ok = true;
+    } else if (!s.compare(i, 5, "false")) {
+      i += 5;
+      ok = true;
+    } else {
+      ok = number();
+    }
+    if (ok && !found && on_path()) {
+      found = true;
+      v0 = is_string ? b0 : start;
+      v1 = is_string ? b1 : i;
+    }
+    return ok;
+  }
+
+  bool object() {
+    i++;   // '{'
+    skip_ws();
+    if (i < s.size() && s[i] == '}') {
+      i++;
+      return true;
+    }
+    std::vector<std::string> seen;
+    for (;;) {
+      skip_ws();
+      size_t k0, k1;
+      if (!string(k0, k1)) return false;
+      std::string key = s.substr(k0, k1 - k0);
+      bool is_first = true;
+      for (const std::string& o : seen) is_first &= o != key;
+      seen.push_back(key);
+      skip_ws();
+      if (i >= s.size() || s[i++] != ':') return false;
+      at.push_back(key);
+      first.push_back(is_first);
+      bool ok = value();
+      at.pop_back();
+      first.pop_back();
+      if (!ok) return false;
+      skip_ws();
+      if (i >= s.size()) return false;
+      char c = s[i++];
+      if (c == '}') return true;
+      if (c != ',') return false;
+    }
+  }
+
+  // -1 invalid document, 0 not found, 1 found
+  int run(const char* p) {
+    std::string seg;
+    for (;; p++) {
+      if (*p == '.' || !*p) {
+        path.push_back(seg);
+        seg.clear();
+        if (!*p) break;
+      } else {
+        seg += *p;
+      }
+    }
+    if (!value()) return -1;
+    skip_ws();
+    if (i != s.size()) return -1;
+    return found ? 1 : 0;
+  }
+};
+
+static const char* const JSON_PATHS[] = { "temperature", "$.temperature", "attributes.temp",
+                                          "$.attributes.temperature", "a.b.t", "a.a", "t", "a..t",
+                                          "attributes.a.temperature" };
+
+static void check_json(const std::string& doc, bool valid_expected, int& hits) {
+  for (const char* path : JSON_PATHS) {
+    const char* p = path[0] == '$' ? path + 2 : path;
+    RefJson ref = { doc, 0, {}, {}, {}, false, 0, 0 };
+    int want = ref.run(p);
+    if (valid_expected && want < 0) {
+      report("generator (invalid JSON)", doc);
+      return;
+    }
+
+    const uint8_t* v = nullptr;
+    unsigned int n = 0;
+    bool got = decode_json_path(bytes(doc), (unsigned int)doc.size(), path, v, n);
+    if (got && (v < bytes(doc) || v + n > bytes(doc) + doc.size())) {
+      report("decode_json_path (span outside input)", doc, path);
+      continue;
+    }
+    if (want < 0) continue;   // invalid JSON: no crash and in bounds is all we ask
+    bool match = got == (want == 1) &&
+                 (!got || (v == bytes(doc) + ref.v0 && n == ref.v1 - ref.v0));
+    if (!match) {
+      report("decode_json_path", doc, path);
+      continue;
+    }
+    if (!got) continue;
+    hits++;
+
+    // the number at the path, if it is one
+    int32_t t = 0, rt = 0;
+    bool tok = decode_json_tenths(bytes(doc), (unsigned int)doc.size(), path, t);
+    std::string val = doc.substr(ref.v0, ref.v1 - ref.v0);
+    bool numeric = !val.empty() && (val[0] == '-' || val[0] == '+' || val[0] == '.' ||
+                                    is_digit(val[0]));
+    int r = numeric && !decode_is_sentinel(bytes(val), (unsigned int)val.size())
+            ? ref_tenths(val, &rt) : 0;
+    if (r != 3 && (tok != (r == 1) || (tok && t != rt))) report("decode_json_tenths", doc, path);
+  }
+}
+
+static void fuzz_json(int iters) {
+  int hits = 0;
+  for (int i = 0; i < iters; i++) {
+    std::string doc;
+    ws(doc);
+    gen_json_object(doc, 0);
+    ws(doc);
+    check_json(doc, true, hits);
+    mutate(doc);
+    check_json(doc, false, hits);
+  }
+  printf("decode_json_path: %d documents x %d paths, %d values found\n", 2 * iters,
+         (int)(sizeof(JSON_PATHS) / sizeof(JSON_PATHS[0])), hits);
+}
+
+// ===================== CBOR =====================
+// An item as the encoder wrote it, with what decode_cbor_tenths() must
+// make of it if it is the target.
+struct CborItem {
+  enum Kind { NUMBER, TEXT, OTHER, MAP } kind;
+  bool tagged;
+  int result;        // NUMBER: 1 value in tenths, 2 out of range
+  int32_t tenths;
+  std::string text;  // TEXT: the string
+  std::vector<std::pair<std::string, CborItem> > members;   // MAP; "\x01" = non-text key
+};
+
+static void cbor_head(std::string& s, uint8_t major, uint64_t arg) {
+  int n = arg < 24 && rnd(4) ? 0 : arg <= 0xFF && rnd(2) ? 1 : arg <= 0xFFFF && rnd(2) ? 2
+        : arg <= 0xFFFFFFFFu && rnd(2) ? 4 : 8;   // also non-minimal heads
+  static const uint8_t AI[] = { 0, 24, 25, 0, 26, 0, 0, 0, 27 };
+  s += (char)((major << 5) | (n ? AI[n] : (uint8_t)arg));
+  for (int i = n - 1; i >= 0; i--) s += (char)(arg >> (8 * i));
+}
+
+static void cbor_text(std::string& s, const std::string& t) {
+  cbor_head(s, 3, t.size());
+  s += t;
+}
+
+// |v| * 10 within the decoder's range -> 1, else 2
+static int in_range(double tenths) {
+  return fabs(tenths) <= 2000000000.0 ? 1 : 2;
+}
+
+static CborItem gen_cbor(std::string& s, int depth) {
+  CborItem it;
+  it.kind = CborItem::NUMBER;
+  it.tagged = false;
+  it.result = 1;
+  it.tenths = 0;
+  if (rnd(6) == 0) {
+    it.tagged = true;
+    cbor_head(s, 6, rnd(2) ? 1 : 0x10000 + rnd(1000));   // epoch time, or some other tag
+  }
+
+  uint32_t k = rnd(depth > 3 ? 8 : 10);
+  switch (k) {
+    case 0: {   // unsigned
+      uint64_t v = rnd(4) ? rnd(1000) : rnd(2) ? rnd() : ((uint64_t)rnd() << 32) | rnd();
+      cbor_head(s, 0, v);
+      it.result = v <= 200000000u ? 1 : 2;
+      it.tenths = it.result == 1 ? (int32_t)v * 10 : 0;
+      break;
+    }
+    case 1: {   // negative: -1 - v
+      uint64_t v = rnd(4) ? rnd(1000) : rnd(2) ? 199999999u + rnd(3) : rnd();
+      cbor_head(s, 1, v);
+      it.result = v < 200000000u ? 1 : 2;
+      it.tenths = it.result == 1 ? -(int32_t)(v + 1) * 10 : 0;
+      break;
+    }
+    case 2: {   // half: any bit pattern, decoded independently
+      uint16_t h = (uint16_t)rnd(0x10000);
+      s += (char)0xF9;
+      s += (char)(h >> 8);
+      s += (char)h;
+      int e = (h >> 10) & 0x1F, m = h & 0x3FF;
+      double v = e == 0 ? m / 1024.0 / 16384.0 : (1 + m / 1024.0) * pow(2.0, e - 15);
+      if (h & 0x8000) v = -v;
+      if (e == 31) {
+        it.result = 2;   // inf / nan
+      } else {
+        it.result = in_range(v * 10);
+        it.tenths = (int32_t)(v < 0 ? -floor(-v * 10 + 0.5) : floor(v * 10 + 0.5));
+      }
+      break;
+    }
+    case 3: {   // single, from a decimal value
+      float f = (float)((int)rnd(200001) - 100000) / 64.0f;
+      uint32_t bits;
+      memcpy(&bits, &f, 4);
+      s += (char)0xFA;
+      for (int i = 3; i >= 0; i--) s += (char)(bits >> (8 * i));
+      double t = (double)f * 10;
+      it.tenths = (int32_t)(t < 0 ? -floor(-t + 0.5) : floor(t + 0.5));
+      break;
+    }
+    case 4: {   // double, including huge ones
+      double d = rnd(4) ? ((int)rnd(2000001) - 1000000) / 128.0 : ldexp(1.0, (int)rnd(80));
+      uint64_t bits;
+      memcpy(&bits, &d, 8);
+      s += (char)0xFB;
+      for (int i = 7; i >= 0; i--) s += (char)(bits >> (8 * i));
+      it.result = in_range(d * 10);
+      double t = d * 10;
+      it.tenths = (int32_t)(it.result == 1 ? (t < 0 ? -floor(-t + 0.5) : floor(t + 0.5)) : 0);
+      break;
+    }
+    case 5: {   // text: a number, a sentinel or a word
+      static const char* const WORDS[] = { "unknown", "unavailable", "nan", "None", "on", "" };
+      it.kind = CborItem::TEXT;
+      it.text = rnd(2) ? gen_number() : WORDS[rnd(sizeof(WORDS) / sizeof(WORDS[0]))];
+      cbor_text(s, it.text);
+      break;
+    }
+    case 6: {   // simple values and byte strings
+      it.kind = CborItem::OTHER;
+      if (rnd(2)) {
+        s += (char)(0xF4 + rnd(4));   // false, true, null, undefined
+      } else {
+        std::string b = gen_digits(6);
+        cbor_head(s, 2, b.size());
+        s += b;
+      }
+      break;
+    }
+    case 7: {   // array
+      it.kind = CborItem::OTHER;
+      int n = (int)rnd(4);
+      cbor_head(s, 4, n);
+      for (int i = 0; i < n; i++) gen_cbor(s, depth + 1);
+      break;
+    }
+    default: {   // map
+      it.kind = CborItem::MAP;
+      int n = (int)rnd(5);
+      cbor_head(s, 5, n);
+      for (int i = 0; i < n; i++) {
+        std::string key;
+        if (rnd(6) == 0) {
+          key = "\x01";
+          cbor_head(s, 0, rnd(100));   // integer key
+        } else {
+          key = KEYS[rnd(KEY_COUNT)];
+          cbor_text(s, key);
+        }
+        it.members.push_back(std::make_pair(key, gen_cbor(s, depth + 1)));
+      }
+      break;
+    }
+  }
+  return it;
+}
+
+// Reference lookup: 0 not a number there, 1 value, 2 out of range, 3
+// undecidable (text near a rounding tie).
+static int ref_cbor(const CborItem& root, const char* path, int32_t& out) {
+  const CborItem* it = &root;
+  std::string seg;
+  if (path && path[0] == '$') path += path[1] == '.' ? 2 : 1;
+  for (const char* p = path; p && *p;) {
+    const char* e = strchr(p, '.');
+    seg.assign(p, e ? (size_t)(e - p) : strlen(p));
+    if (it->kind != CborItem::MAP || it->tagged) return 0;
+    const CborItem* next = nullptr;
+    for (const auto& m : it->members) {
+      if (m.first == seg) {
+        next = &m.second;
+        break;
+      }
+    }
+    if (!next) return 0;
+    it = next;
+    p = e ? e + 1 : nullptr;
+  }
+  switch (it->kind) {
+    case CborItem::NUMBER:
+      out = it->tenths;
+      return it->result;
+    case CborItem::TEXT: {
+      if (decode_is_sentinel(bytes(it->text), (unsigned int)it->text.size())) return 0;
+      int r = ref_tenths(it->text, &out);
+      return r == 2 ? 0 : r;
+    }
+    default:
+      return 0;
+  }
+}
+
+static const char* const CBOR_PATHS[] = { nullptr, "", "temperature", "$.attributes.temp", "a.b",
+                                          "t", "a.a.temperature" };
+
+static void fuzz_cbor(int iters) {
+  int hits = 0;
+  for (int i = 0; i < iters; i++) {
+    std::string s;
+    CborItem root = gen_cbor(s, rnd(2) ? 0 : 4);
+    for (const char* path : CBOR_PATHS) {
+      int32_t want = 0, got = 0;
+      int r = ref_cbor(root, path, want);
+      bool ok = decode_cbor_tenths(bytes(s), (unsigned int)s.size(), path, got);
+      if (r == 3) continue;
+      if (ok != (r == 1) || (ok && got != want)) report("decode_cbor_tenths", s, path ? path : "(null)");
+      hits += ok;
+    }
+    for (int m = 0; m < 4; m++) {
+      std::string t = s;
+      mutate(t);
+      int32_t got;
+      for (const char* path : CBOR_PATHS) decode_cbor_tenths(bytes(t), (unsigned int)t.size(), path, got);
+    }
+  }
+  printf("decode_cbor_tenths: %d items x %d paths, %d numbers found, %d mutated\n", iters,
+         (int)(sizeof(CBOR_PATHS) / sizeof(CBOR_PATHS[0])), hits, 4 * iters);
+}
+
+int main(int argc, char** argv) {
+  int iters = 200000;
+  uint64_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--iters") && i + 1 < argc) {
+      iters = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoull(argv[++i], nullptr, 0);
+    } else {
+      fprintf(stderr, "usage: decode_fuzz [--iters N] [--seed S]\n");
+      return 2;
+    }
+  }
+  rng_state = seed ? seed : 1;
+
+  fuzz_numbers(iters);
+  fuzz_json(iters / 4);
+  fuzz_cbor(iters / 4);
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,161 @@
+// Host-side throughput of MQTT dispatch through the topic router.
+//
+// Builds a routing table like the firmware's (plain topics, '+' and '#'
+// wildcards, number / JSON path / CBOR decoders) and dispatches a shuffled
+// stream of mixed topics through it, including topics no route matches and
+// topics that match two routes. Checks the matched-route count and the
+// decoded value of every topic once, then reports dispatches per second
+// for the mixed stream and for each payload format on its own. Exits with
+// 1 on a wrong match or value.
+//
+//   pio run -e dispatch_bench
+//   .pio/build/dispatch_bench/program [--iters N]
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude src/decode.cpp src/topic_router.cpp
+//       tools/dispatch_bench/dispatch_bench.cpp -o dispatch_bench
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "decode.h"
+#include "topic_router.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static volatile int sink;
+static int last_slot = -1;
+static int last_value = 0;
+
+static void on_value(uint8_t slot, bool valid, int value) {
+  sink += slot + (valid ? value : 0);
+  last_slot = slot;
+  last_value = valid ? value : INT32_MIN;
+}
+
+static const TopicRoute ROUTES[] = {
+  { "boiler/temp_int", 0, decode_number_route, nullptr, on_value },
+  { "boiler/tank_temp", 1, decode_number_route, nullptr, on_value },
+  { "outdoor/temp_int", 2, decode_number_route, nullptr, on_value },
+  { "boiler/setpoint", 3, decode_number_route, nullptr, on_value },
+  { "ha/sensor/+/state", 4, decode_json_route, "$.attributes.temperature", on_value },
+  { "ha/cbor/boiler", 5, decode_cbor_route, "temp", on_value },
+  { "weather/+/temperature", 6, decode_number_route, nullptr, on_value },
+  { "weather/#", 7, decode_number_route, nullptr, on_value },
+};
+
+static const uint8_t CBOR_MAP[] = { 0xA2, 0x62, 'i', 'd', 0x07, 0x64, 't', 'e', 'm', 'p',
+                                    0xF9, 0x51, 0x50 };   // {"id": 7, "temp": 42.5}
+
+struct Msg {
+  const char* name;
+  const char* topic;
+  std::string payload;
+  int matches;     // routes the topic matches
+  int slot;        // slot of the last matching route, -1 = none
+  int value;       // what that route decodes
+};
+
+static const Msg MSGS[] = {
+  { "plain number", "boiler/setpoint", "42.5", 1, 3, 43 },
+  { "plain number", "boiler/temp_int", "57", 1, 0, 57 },
+  { "plain number", "outdoor/temp_int", "-3.4", 1, 2, -3 },
+  { "JSON path", "ha/sensor/boiler/state",
+    "{\"state\": \"on\", \"attributes\": {\"unit\": \"\\u00b0C\", \"temperature\": 42.5}}", 1, 4,
+    43 },
+  { "CBOR map", "ha/cbor/boiler", std::string((const char*)CBOR_MAP, sizeof(CBOR_MAP)), 1, 5,
+    43 },
+  { "two routes", "weather/roof/temperature", "12", 2, 7, 12 },
+  { "'#' only", "weather/roof/humidity/avg", "61", 1, 7, 61 },
+  { "no route", "boiler/unknown", "1", 0, -1, 0 },
+  { "no route", "ha/sensor/boiler/attributes", "{}", 0, -1, 0 },
+};
+static const int MSG_COUNT = (int)(sizeof(MSGS) / sizeof(MSGS[0]));
+
+static int dispatch(const Msg& m) {
+  return router_dispatch(m.topic, (const uint8_t*)m.payload.data(), (unsigned int)m.payload.size());
+}
+
+static void check_routes() {
+  for (const Msg& m : MSGS) {
+    last_slot = -1;
+    int n = dispatch(m);
+    if (n != m.matches || last_slot != m.slot || (m.slot >= 0 && last_value != m.value)) {
+      fprintf(stderr, "%s: %d routes, slot %d, value %d; want %d, %d, %d\n", m.topic, n, last_slot,
+              last_value, m.matches, m.slot, m.value);
+    }
+    CHECK(n == m.matches);
+    CHECK(last_slot == m.slot);
+    if (m.slot >= 0) CHECK(last_value == m.value);
+  }
+}
+
+static double time_stream(const std::vector<int>& order, int rounds) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i : order) dispatch(MSGS[i]);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)rounds * order.size());
+}
+
+int main(int argc, char** argv) {
+  int iters = 1000000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--iters") && i + 1 < argc) {
+      iters = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: dispatch_bench [--iters N]\n");
+      return 2;
+    }
+  }
+  if (iters < 1) iters = 1;
+
+  CHECK(router_begin(ROUTES, (int)(sizeof(ROUTES) / sizeof(ROUTES[0]))));
+  check_routes();
+
+  // every message equally often, shuffled, so the branch history of one
+  // topic does not help the next
+  std::vector<int> order;
+  for (int k = 0; k < 64; k++) {
+    for (int i = 0; i < MSG_COUNT; i++) order.push_back(i);
+  }
+  srand(1);
+  for (size_t i = order.size() - 1; i > 0; i--) {
+    size_t j = (size_t)rand() % (i + 1);
+    int t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  int rounds = iters / (int)order.size() + 1;
+  double ns = time_stream(order, rounds);
+  printf("mixed stream, %d topics: %6.1f ns per dispatch, %5.2f M/s\n", MSG_COUNT, ns, 1000.0 / ns);
+
+  static const int SINGLE[] = { 0, 3, 4, 7 };
+  for (int i : SINGLE) {
+    std::vector<int> one(1, i);
+    ns = time_stream(one, iters);
+    printf("  %-13s %3u bytes: %6.1f ns, %5.2f M/s\n", MSGS[i].name,
+           (unsigned)MSGS[i].payload.size(), ns, 1000.0 / ns);
+  }
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,313 @@
+// Host-side test of the frame hand-off to the display task, with real
+// threads (block_queue.h and crit_section.h fall back to std::mutex and
+// condition variables off the ESP32).
+//
+// A display thread handles jobs the way display_task in main.cpp does:
+// copy the frame to a fake panel, return the buffer, then "refresh". It
+// checks that every frame arrives intact (no producer wrote into a buffer
+// still queued or on the wire), in the order each producer submitted it,
+// and that streamed frames are assembled from their blocks in order.
+// Backpressure: with the display stalled, acquire and submit block and
+// time out once the pool and the queue are full, and go on as soon as the
+// display frees a buffer or takes a job. The next frame can be acquired
+// while the panel is still refreshing the last one.
+// Exits with 1 on any failure, also when the pipe gets stuck (watchdog).
+//
+//   pio run -e display_pipe_test
+//   .pio/build/display_pipe_test/program
+//
+// or without PlatformIO:
+//   g++ -O2 -pthread -Iinclude -Itools/host -DLOG_LEVEL=0 src/display_pipe.cpp
+//       tools/display_pipe_test/display_pipe_test.cpp -o display_pipe_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "display_pipe.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static const size_t FRAME = 4096;   // smaller than the panel's, same handling
+static const int DEPTH = 4;         // DISPLAY_QUEUE_DEPTH in main.cpp
+
+typedef std::chrono::steady_clock Clock;
+
+static uint8_t pool_mem[DISPLAY_MAX_BUFFERS][FRAME];
+static uint8_t* pool[DISPLAY_MAX_BUFFERS] = { pool_mem[0], pool_mem[1] };
+
+// job.hash carries producer << 24 | sequence number
+static uint8_t pattern(uint32_t tag, size_t i) { return (uint8_t)(tag * 31 + i * 7 + (i >> 8)); }
+
+static void fill(uint8_t* p, uint32_t tag) {
+  for (size_t i = 0; i < FRAME; i++) p[i] = pattern(tag, i);
+}
+
+static bool intact(const uint8_t* p, uint32_t tag) {
+  for (size_t i = 0; i < FRAME; i++)
+    if (p[i] != pattern(tag, i)) return false;
+  return true;
+}
+
+static bool from_pool(const uint8_t* fb) {
+  for (int i = 0; i < DISPLAY_MAX_BUFFERS; i++)
+    if (fb == pool[i]) return true;
+  return false;
+}
+
+// ===================== DISPLAY =====================
+struct Panel {
+  uint8_t ram[FRAME];
+  size_t pos = 0;
+  uint32_t last_seq[4] = { 0, 0, 0, 0 };
+  int frames = 0, streams = 0;
+  bool ordered = true, whole = true, stream_ok = true;
+  std::atomic<Clock::rep> refresh_end{ 0 };
+};
+
+// Runs until a DISP_POWER_DOWN job; refresh_ms stands in for the panel.
+static void display_thread(Panel& panel, uint32_t refresh_ms) {
+  DisplayJob job;
+  for (;;) {
+    if (!display_next(job, UINT32_MAX)) continue;
+    bool stop = job.op == DISP_POWER_DOWN;
+    uint32_t producer = job.hash >> 24, seq = job.hash & 0xFFFFFF;
+    switch (job.op) {
+      case DISP_FRAME:
+        if (!from_pool(job.fb) || !intact(job.fb, job.hash)) panel.whole = false;
+        memcpy(panel.ram, job.fb, FRAME);
+        if (job.flags & DISP_RELEASE) display_release(job.fb);
+        if (seq <= panel.last_seq[producer]) panel.ordered = false;
+        panel.last_seq[producer] = seq;
+        panel.frames++;
+        break;
+      case DISP_STREAM_BEGIN:
+        panel.pos = 0;
+        break;
+      case DISP_STREAM_DATA:
+        if (panel.pos + job.len > FRAME) {
+          panel.stream_ok = false;
+          break;
+        }
+        memcpy(panel.ram + panel.pos, job.data, job.len);
+        panel.pos += job.len;
+        break;
+      case DISP_STREAM_END:
+        if (panel.pos != FRAME || !intact(panel.ram, job.hash)) panel.stream_ok = false;
+        panel.streams++;
+        break;
+    }
+    if (job.op == DISP_FRAME || job.op == DISP_STREAM_END) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(refresh_ms));
+      panel.refresh_end = Clock::now().time_since_epoch().count();
+    }
+    display_done();
+    if (stop) return;
+  }
+}
+
+static void submit_op(uint8_t op) {
+  DisplayJob d = {};
+  d.op = op;
+  display_submit(d, UINT32_MAX);
+}
+
+// ===================== ORDERING =====================
+// Two producers race for the two buffers; each frame must come out intact
+// and in its producer's order.
+static void test_frames() {
+  CHECK(display_pipe_begin(pool, DISPLAY_MAX_BUFFERS, DEPTH));
+  Panel panel;
+  std::thread display(display_thread, std::ref(panel), 0);
+
+  const uint32_t N = 3000;
+  std::vector<std::thread> producers;
+  for (uint32_t p = 1; p <= 2; p++) {
+    producers.push_back(std::thread([p, N] {
+      for (uint32_t seq = 1; seq <= N; seq++) {
+        uint8_t* fb = display_acquire(UINT32_MAX);
+        uint32_t tag = p << 24 | seq;
+        fill(fb, tag);
+        DisplayJob d = {};
+        d.op = DISP_FRAME;
+        d.flags = DISP_RELEASE;
+        d.hash = tag;
+        d.fb = fb;
+        display_submit(d, UINT32_MAX);
+      }
+    }));
+  }
+  for (size_t i = 0; i < producers.size(); i++) producers[i].join();
+  submit_op(DISP_POWER_DOWN);
+  display.join();
+
+  CHECK(panel.whole);
+  CHECK(panel.ordered);
+  CHECK(panel.frames == (int)(2 * N));
+  CHECK(panel.last_seq[1] == N && panel.last_seq[2] == N);
+  CHECK(display_idle());
+  printf("frames: %d from 2 producers over %d buffers, queue depth %d\n", panel.frames,
+         DISPLAY_MAX_BUFFERS, DEPTH);
+}
+
+// Streamed frames: many small blocks through the same queue.
+static void test_stream() {
+  CHECK(display_pipe_begin(pool, DISPLAY_MAX_BUFFERS, DEPTH));
+  Panel panel;
+  std::thread display(display_thread, std::ref(panel), 0);
+
+  const uint32_t N = 200;
+  std::vector<uint8_t> src(FRAME);
+  for (uint32_t seq = 1; seq <= N; seq++) {
+    uint32_t tag = 3u << 24 | seq;
+    fill(src.data(), tag);
+    submit_op(DISP_STREAM_BEGIN);
+    for (size_t off = 0; off < FRAME;) {
+      DisplayJob d = {};
+      d.op = DISP_STREAM_DATA;
+      d.len = (uint16_t)(1 + (off / 64 + seq) % DISPLAY_BLOCK_BYTES);   // uneven blocks
+      if (off + d.len > FRAME) d.len = (uint16_t)(FRAME - off);
+      memcpy(d.data, &src[off], d.len);
+      display_submit(d, UINT32_MAX);
+      off += d.len;
+    }
+    DisplayJob end = {};
+    end.op = DISP_STREAM_END;
+    end.hash = tag;
+    display_submit(end, UINT32_MAX);
+  }
+  submit_op(DISP_POWER_DOWN);
+  display.join();
+
+  CHECK(panel.stream_ok);
+  CHECK(panel.streams == (int)N);
+  CHECK(display_idle());
+  printf("streams: %d frames in blocks of 1..%d bytes\n", panel.streams, DISPLAY_BLOCK_BYTES);
+}
+
+// ===================== BACKPRESSURE =====================
+static double ms_since(Clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static void test_backpressure() {
+  CHECK(display_pipe_begin(pool, DISPLAY_MAX_BUFFERS, DEPTH));
+
+  // display stalled: the pool runs dry, then the queue fills
+  uint8_t* a = display_acquire(0);
+  uint8_t* b = display_acquire(0);
+  CHECK(a && b && a != b);
+  Clock::time_point t0 = Clock::now();
+  CHECK(display_acquire(30) == nullptr);
+  CHECK(ms_since(t0) >= 25);
+
+  DisplayJob d = {};
+  d.op = DISP_POWER_UP;
+  for (int i = 0; i < DEPTH; i++) CHECK(display_submit(d, 0));
+  t0 = Clock::now();
+  CHECK(!display_submit(d, 30));
+  CHECK(ms_since(t0) >= 25);
+  CHECK(!display_idle());
+
+  // a blocked submit goes on once the display takes a job
+  std::atomic<bool> submitted(false);
+  std::thread producer([&] {
+    DisplayJob f = {};
+    f.op = DISP_FRAME;
+    f.flags = DISP_RELEASE;
+    f.hash = 1u << 24 | 1;
+    f.fb = a;
+    fill(a, f.hash);
+    display_submit(f, UINT32_MAX);
+    submitted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  CHECK(!submitted);
+  DisplayJob got;
+  CHECK(display_next(got, 0) && got.op == DISP_POWER_UP);
+  display_done();
+  producer.join();
+  CHECK(submitted);
+
+  // a blocked acquire goes on once the display has sent a frame
+  std::atomic<uint8_t*> acquired(nullptr);
+  std::thread renderer([&] { acquired = display_acquire(UINT32_MAX); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  CHECK(acquired.load() == nullptr);
+  for (int i = 1; i < DEPTH; i++) {
+    CHECK(display_next(got, 0) && got.op == DISP_POWER_UP);
+    display_done();
+  }
+  CHECK(display_next(got, 0) && got.op == DISP_FRAME && intact(got.fb, got.hash));
+  display_release(got.fb);
+  renderer.join();
+  CHECK(acquired.load() == a);
+  display_done();
+  CHECK(display_idle());
+  CHECK(!display_next(got, 0));
+  display_release(a);
+  display_release(b);
+  printf("backpressure: acquire and submit block while full, resume on release / take\n");
+}
+
+// The buffer comes back before the refresh, so the next frame is drawn
+// while the panel is busy.
+static void test_overlap() {
+  uint8_t* one[1] = { pool[0] };
+  CHECK(display_pipe_begin(one, 1, DEPTH));
+  Panel panel;
+  const uint32_t REFRESH_MS = 50;
+  std::thread display(display_thread, std::ref(panel), REFRESH_MS);
+
+  uint8_t* fb = display_acquire(UINT32_MAX);
+  fill(fb, 1u << 24 | 1);
+  DisplayJob d = {};
+  d.op = DISP_FRAME;
+  d.flags = DISP_RELEASE;
+  d.hash = 1u << 24 | 1;
+  d.fb = fb;
+  Clock::time_point t0 = Clock::now();
+  display_submit(d, UINT32_MAX);
+  fb = display_acquire(UINT32_MAX);
+  double got_ms = ms_since(t0);
+  bool during_refresh = panel.refresh_end.load() == 0;
+  display_release(fb);
+  submit_op(DISP_POWER_DOWN);
+  display.join();
+
+  CHECK(fb == pool[0]);
+  CHECK(during_refresh);
+  CHECK(got_ms < REFRESH_MS);
+  printf("overlap: next buffer after %.2f ms, refresh takes %u ms\n", got_ms, (unsigned)REFRESH_MS);
+}
+
+int main() {
+  std::thread([] {
+    std::this_thread::sleep_for(std::chrono::seconds(30));
+    fprintf(stderr, "stuck: a producer or the display never returned\n");
+    _Exit(1);
+  }).detach();
+  test_frames();
+  test_stream();
+  test_backpressure();
+  test_overlap();
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,240 @@
+// Host-side replay of recorded readings through the signal filter.
+//
+// Reads one reading per line from a file or stdin (a trailing CSV column is
+// used, so "timestamp,value" exports from Home Assistant work as is) and
+// reports, for each filtering policy, how many panel refreshes it would have
+// triggered, how often the header color flipped and how far the shown value
+// strayed from the raw reading.
+//
+// --check runs built-in streams through the firmware's policy instead and
+// exits with 1 on a mismatch: a monotonic on-change stream (as Home
+// Assistant publishes) must show every value as it arrives, hysteresis may
+// hold the header color but not the number, and a median rejects a single
+// outlier.
+//
+//   pio run -e filter_replay
+//   .pio/build/filter_replay/program history.csv
+//   .pio/build/filter_replay/program --median 5 --hyst 2 < history.csv
+//   .pio/build/filter_replay/program --check
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude src/signal_filter.cpp tools/filter_replay/filter_replay.cpp
+//       -o filter_replay
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "canvas.h"
+#include "signal_filter.h"
+
+// same values as main.cpp
+static const int FILTER_MEDIAN_N = 1;
+static const int FILTER_EWMA_ALPHA_X16 = 0;
+static const int FILTER_DEADBAND = 1;
+static const int FILTER_HYSTERESIS = 1;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+struct Policy {
+  const char* name;
+  FilterConfig cfg;
+};
+
+static FilterConfig make_cfg(int median, int ewma, int deadband, int hyst) {
+  FilterConfig c = {};
+  c.median_n = (uint8_t)median;
+  c.ewma_alpha_x16 = (uint8_t)ewma;
+  c.deadband = deadband;
+  c.hysteresis = hyst;
+  c.thresholds[0] = THEME_WARM_ABOVE;
+  c.thresholds[1] = THEME_HOT_ABOVE;
+  c.threshold_count = 2;
+  return c;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: filter_replay [--median N] [--ewma A16] [--deadband D] [--hyst H] [FILE]\n"
+          "       filter_replay --check\n"
+          "       without options, compares a set of built-in policies\n");
+  exit(2);
+}
+
+static bool read_values(FILE* f, std::vector<int>& out) {
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    const char* p = strrchr(line, ',');
+    p = p ? p + 1 : line;
+    char* end = nullptr;
+    double v = strtod(p, &end);
+    if (end == p) continue;   // header, "unavailable", blank
+    out.push_back((int)(v < 0 ? v - 0.5 : v + 0.5));
+  }
+  return !out.empty();
+}
+
+struct Result {
+  int refreshes;
+  int held;
+  int theme_flips;
+  int max_err;
+  double sum_err;
+  std::vector<int> shown;    // after each reading
+  std::vector<int> theme;    // theme band after each reading
+};
+
+// 0 below the first threshold, 1 above it, ... (header black, yellow, red)
+static int band_of(const FilterConfig& cfg, int t) {
+  int b = 0;
+  for (uint8_t i = 0; i < cfg.threshold_count; i++)
+    if (t > cfg.thresholds[i]) b++;
+  return b;
+}
+
+static Result replay(const FilterConfig& cfg, const std::vector<int>& values) {
+  Result r = {};
+  FilterState st;
+  filter_reset(st);
+  int shown = FILTER_NO_VALUE, theme = FILTER_NO_VALUE;
+
+  for (size_t i = 0; i < values.size(); i++) {
+    int v = filter_input(cfg, st, values[i]);
+    FilterVerdict verdict = filter_decide(cfg, v, shown, theme);
+    if (verdict == FILTER_SHOW) {
+      int next = filter_theme(cfg, v, theme);
+      if (theme != FILTER_NO_VALUE && band_of(cfg, next) != band_of(cfg, theme)) r.theme_flips++;
+      shown = v;
+      theme = next;
+      r.refreshes++;
+    } else if (verdict != FILTER_SAME) {
+      r.held++;
+    }
+    r.shown.push_back(shown);
+    r.theme.push_back(band_of(cfg, theme));
+    int err = shown - values[i];
+    if (err < 0) err = -err;
+    if (err > r.max_err) r.max_err = err;
+    r.sum_err += err;
+  }
+  return r;
+}
+
+// ===================== CHECKS =====================
+static std::vector<int> seq(int from, int to) {
+  std::vector<int> v;
+  for (int t = from; from <= to ? t <= to : t >= to; t += from <= to ? 1 : -1) v.push_back(t);
+  return v;
+}
+
+static int run_checks() {
+  FilterConfig fw = make_cfg(FILTER_MEDIAN_N, FILTER_EWMA_ALPHA_X16, FILTER_DEADBAND,
+                             FILTER_HYSTERESIS);
+
+  // on-change publisher, heating up: every value shows as it arrives, the
+  // last one included (no later message would push it through)
+  std::vector<int> up = seq(30, 35);
+  Result r = replay(fw, up);
+  CHECK(r.shown == up);
+  CHECK(r.refreshes == (int)up.size());
+  std::vector<int> down = seq(45, 38);
+  r = replay(fw, down);
+  CHECK(r.shown == down);
+  // a median shows each value one reading late: why it is off by default
+  r = replay(make_cfg(3, 0, 1, 0), up);
+  CHECK(r.shown.back() == 34);
+
+  // hysteresis holds the header color at the red/yellow boundary, never
+  // the number
+  std::vector<int> flap = { 40, 41, 42, 41, 42, 41, 43, 42, 41, 40 };
+  r = replay(fw, flap);
+  CHECK(r.shown == flap);
+  const int YELLOW = 1, RED = 2;
+  for (size_t i = 0; i < 6; i++) CHECK(r.theme[i] == YELLOW);
+  CHECK(r.theme[6] == RED && r.theme[7] == RED && r.theme[8] == RED);
+  CHECK(r.theme[9] == YELLOW);
+  CHECK(r.theme_flips == 2);
+  // a jump across both thresholds stops short of the one it does not clear
+  r = replay(fw, std::vector<int>{ 30, 42 });
+  CHECK(r.shown.back() == 42 && r.theme.back() == YELLOW);
+
+  // the median still rejects a single outlier when turned on
+  r = replay(make_cfg(3, 0, 1, 1), std::vector<int>{ 40, 40, 80, 40, 40 });
+  CHECK(r.shown == std::vector<int>(5, 40));
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  std::vector<Policy> policies;
+  int median = 1, ewma = 0, deadband = 1, hyst = 0;
+  bool custom = false;
+  const char* path = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    bool has_value = i + 1 < argc;
+    if (!strcmp(a, "--check")) return run_checks();
+    else if (!strcmp(a, "--median") && has_value) { median = atoi(argv[++i]); custom = true; }
+    else if (!strcmp(a, "--ewma") && has_value) { ewma = atoi(argv[++i]); custom = true; }
+    else if (!strcmp(a, "--deadband") && has_value) { deadband = atoi(argv[++i]); custom = true; }
+    else if (!strcmp(a, "--hyst") && has_value) { hyst = atoi(argv[++i]); custom = true; }
+    else if (a[0] == '-' && a[1]) usage();
+    else path = a;
+  }
+
+  if (median < 1 || median > FILTER_MAX_MEDIAN || !(median & 1) || ewma < 0 || ewma > 16 ||
+      deadband < 1 || hyst < 0) {
+    usage();
+  }
+
+  policies.push_back({ "any change", make_cfg(1, 0, 1, 0) });
+  if (custom) {
+    policies.push_back({ "custom", make_cfg(median, ewma, deadband, hyst) });
+  } else {
+    policies.push_back({ "deadband 2", make_cfg(1, 0, 2, 0) });
+    policies.push_back({ "hysteresis 1 (default)", make_cfg(1, 0, 1, 1) });
+    policies.push_back({ "median 3", make_cfg(3, 0, 1, 0) });
+    policies.push_back({ "median 3 + hyst 1", make_cfg(3, 0, 1, 1) });
+    policies.push_back({ "median 5 + hyst 1", make_cfg(5, 0, 1, 1) });
+    policies.push_back({ "ewma 4/16 + hyst 1", make_cfg(1, 4, 1, 1) });
+  }
+
+  FILE* f = path ? fopen(path, "r") : stdin;
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  std::vector<int> values;
+  bool ok = read_values(f, values);
+  if (path) fclose(f);
+  if (!ok) {
+    fprintf(stderr, "no readings found\n");
+    return 1;
+  }
+
+  printf("%zu readings, themes change above %d / %d\n\n", values.size(), THEME_WARM_ABOVE,
+         THEME_HOT_ABOVE);
+  printf("%-22s %10s %8s %8s %8s %8s\n", "policy", "refreshes", "held", "flips", "max err",
+         "avg err");
+  for (size_t i = 0; i < policies.size(); i++) {
+    Result r = replay(policies[i].cfg, values);
+    printf("%-22s %10d %8d %8d %8d %8.2f\n", policies[i].name, r.refreshes, r.held,
+           r.theme_flips, r.max_err, r.sum_err / (double)values.size());
+  }
+  return 0;
+}
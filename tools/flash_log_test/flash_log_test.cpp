@@ -0,0 +1,223 @@
+// Host-side power-cut test and benchmark of the flash reading log.
+//
+// Runs flash_log.cpp against the RAM partition in tools/host (NOR
+// semantics: erase to 0xFF, writes only clear bits). An append workload
+// that opens sectors and wraps the ring is cut at every write and erase it
+// issues, after every byte of each record and header write and every 512
+// bytes of each erase. After each cut the log is mounted again and must
+// hold every acknowledged record that still fits in the ring, in order,
+// nothing that was never appended, accept new appends after them, seek
+// correctly, and never program a slot that is not erased.
+//
+// Then reports host appends/s, flash operations per append, the reads a
+// mount and a seek cost on the full 256 KB partition, and an estimated
+// device time from typical SPI NOR timings (estimates, not measurements).
+// Exits with 1 on any failure.
+//
+//   pio run -e flash_log_test
+//   .pio/build/flash_log_test/program
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -Itools/host -DLOG_LEVEL=0 src/flash_log.cpp
+//       tools/host/flash_part_ram.cpp tools/flash_log_test/flash_log_test.cpp
+//       -o flash_log_test
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "flash_log.h"
+#include "flash_part_ram.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static const uint32_t SECTOR = 4096;
+static const uint32_t SLOTS = (SECTOR - 16) / 8;   // records per sector
+static const uint32_t CUT_SECTORS = 3;             // small ring: wraps twice
+static const uint32_t CUT_APPENDS = 3 * SLOTS + 60;
+static const uint32_t AFTER_APPENDS = SLOTS + 10;  // opens at least one sector
+
+static uint32_t time_of(uint32_t i) { return 1000 + i * 60; }
+static int value_of(uint32_t i) { return (int)(i * 7 % 900) - 200; }
+
+static std::vector<FlogSample> read_all() {
+  std::vector<FlogSample> out;
+  FlogCursor c;
+  flog_seek(c, 0);
+  FlogSample s;
+  while (flog_next(c, s)) out.push_back(s);
+  return out;
+}
+
+// Index of the append that wrote s (times are unique), -1 if none.
+static int32_t index_of(const FlogSample& s, uint32_t appends) {
+  if (s.t_s < 1000 || (s.t_s - 1000) % 60) return -1;
+  uint32_t i = (s.t_s - 1000) / 60;
+  return (i < appends && s.value == value_of(i)) ? (int32_t)i : -1;
+}
+
+// One trial: cut_keep bytes into the cut_at-th flash mutation of the
+// workload, then power on, mount and check. Returns false once the
+// workload finishes without reaching the cut.
+static bool trial(uint32_t cut_at, uint32_t cut_keep, bool& was_erase) {
+  flash_ram_setup(CUT_SECTORS * SECTOR);
+  flog_begin();
+  flash_ram_cut_at(cut_at, cut_keep);
+
+  std::vector<bool> acked;
+  uint32_t erases_before = 0, mutations_before = 0;
+  for (uint32_t i = 0; i < CUT_APPENDS && !flash_ram_cut_happened(); i++) {
+    erases_before = flash_ram_stats().erases;
+    mutations_before = flash_ram_mutations();
+    acked.push_back(flog_append(time_of(i), value_of(i)));
+  }
+  if (!flash_ram_cut_happened()) return false;
+  // an append that opens a sector erases first
+  was_erase = flash_ram_stats().erases != erases_before && cut_at == mutations_before;
+
+  flash_ram_power_on();
+  CHECK(flog_begin());
+  std::vector<FlogSample> got = read_all();
+  uint32_t attempts = (uint32_t)acked.size();
+
+  // ordered subsequence of what was appended
+  int32_t prev = -1;
+  bool ordered = true;
+  for (size_t k = 0; k < got.size(); k++) {
+    int32_t i = index_of(got[k], attempts);
+    if (i <= prev) ordered = false;
+    prev = i;
+  }
+  CHECK(ordered);
+
+  // acknowledged records in the newest (sectors - 1) sectors' worth of slots
+  uint32_t keep_from = attempts > (CUT_SECTORS - 1) * SLOTS ? attempts - (CUT_SECTORS - 1) * SLOTS : 0;
+  size_t k = 0;
+  bool all_kept = true;
+  for (uint32_t i = keep_from; i < attempts; i++) {
+    if (!acked[i]) continue;
+    while (k < got.size() && index_of(got[k], attempts) < (int32_t)i) k++;
+    if (k == got.size() || index_of(got[k], attempts) != (int32_t)i) all_kept = false;
+  }
+  CHECK(all_kept);
+  CHECK(flog_record_count() >= got.size());
+
+  // appending continues after the surviving records
+  bool appended = true;
+  for (uint32_t i = attempts; i < attempts + AFTER_APPENDS; i++)
+    appended &= flog_append(time_of(i), value_of(i));
+  CHECK(appended);
+  std::vector<FlogSample> after = read_all();
+  bool tail_ok = after.size() >= AFTER_APPENDS;
+  for (uint32_t j = 0; tail_ok && j < AFTER_APPENDS; j++) {
+    const FlogSample& s = after[after.size() - AFTER_APPENDS + j];
+    tail_ok = s.t_s == time_of(attempts + j) && s.value == value_of(attempts + j);
+  }
+  CHECK(tail_ok);
+
+  // seek lands on the first record at or after the time
+  bool seek_ok = true;
+  for (size_t j = 0; j < after.size(); j += 97) {
+    FlogCursor c;
+    flog_seek(c, after[j].t_s - 30);
+    FlogSample s;
+    seek_ok &= flog_next(c, s) && s.t_s == after[j].t_s;
+  }
+  CHECK(seek_ok);
+
+  CHECK(flash_ram_stats().dirty_writes == 0);
+  if (failures) fprintf(stderr, "  at mutation %u, %u bytes kept\n", (unsigned)cut_at, (unsigned)cut_keep);
+  return true;
+}
+
+static void test_power_cuts() {
+  uint32_t trials = 0, erase_cuts = 0;
+  for (uint32_t m = 0; failures == 0; m++) {
+    // byte offsets 0..16 cover every record (8 B) and header (16 B) prefix;
+    // an erase is cut every 512 bytes
+    bool was_erase = false;
+    if (!trial(m, 0, was_erase)) break;
+    trials++;
+    uint32_t step = was_erase ? 512 : 1;
+    uint32_t limit = was_erase ? SECTOR : 16;
+    for (uint32_t keep = step; keep <= limit && failures == 0; keep += step) {
+      trial(m, keep, was_erase);
+      trials++;
+    }
+    if (was_erase) erase_cuts++;
+  }
+  printf("power cuts: %u trials, %u erases cut\n", (unsigned)trials, (unsigned)erase_cuts);
+}
+
+// ===================== BENCHMARK =====================
+// Typical SPI NOR figures (W25Q32-class datasheet, plus driver overhead):
+// estimates only, for the order of magnitude on the device.
+static const double EST_WRITE_US = 30;      // program up to one page
+static const double EST_ERASE_US = 45000;   // 4 KB sector erase
+static const double EST_READ_US = 5;        // short read through the cache-bypass path
+
+static double est_us(const FlashRamStats& s) {
+  return s.writes * EST_WRITE_US + s.erases * EST_ERASE_US + s.reads * EST_READ_US;
+}
+
+static void benchmark() {
+  const uint32_t part = 0x40000;   // partitions.csv "history"
+  const uint32_t n = 200000;       // a bit over six trips around the ring
+
+  flash_ram_setup(part);
+  flog_begin();
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < n; i++) flog_append(time_of(i), value_of(i));
+  auto t1 = std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(t1 - t0).count();
+  FlashRamStats app = flash_ram_stats();
+  CHECK(app.dirty_writes == 0);
+  printf("append: %.1f M/s on the host, %.3f writes + %.4f erases per record,"
+         " ~%.0f us per record on the device (est.)\n",
+         n / secs / 1e6, (double)app.writes / n, (double)app.erases / n, est_us(app) / n);
+
+  flash_ram_stats() = FlashRamStats();
+  flog_begin();
+  FlashRamStats mnt = flash_ram_stats();
+  printf("mount:  %u reads (%u bytes), ~%.1f ms on the device (est.)\n", (unsigned)mnt.reads,
+         (unsigned)mnt.read_bytes, est_us(mnt) / 1000);
+  CHECK(flog_record_count() == (part / SECTOR) * SLOTS - (SLOTS - n % SLOTS) % SLOTS);
+
+  const int seeks = 1000;
+  uint32_t first = flog_last_time() - (flog_record_count() - 1) * 60;
+  flash_ram_stats() = FlashRamStats();
+  bool seek_ok = true;
+  for (int i = 0; i < seeks; i++) {
+    uint32_t t = first + (uint32_t)(rand() % flog_record_count()) * 60;
+    FlogCursor c;
+    flog_seek(c, t);
+    FlogSample s;
+    seek_ok &= flog_next(c, s) && s.t_s == t;
+  }
+  CHECK(seek_ok);
+  FlashRamStats sk = flash_ram_stats();
+  printf("seek:   %.1f reads, ~%.0f us on the device (est.)\n", (double)sk.reads / seeks,
+         est_us(sk) / seeks);
+}
+
+int main() {
+  srand(1);
+  test_power_cuts();
+  if (failures == 0) benchmark();
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,127 @@
+// Host-side check of src/frame_hash.cpp against xxHash32.
+//
+// Hashes the sanity buffer of the reference implementation (xxhsum) and
+// compares with its published results, with seed 0 and seed PRIME32, then
+// hashes a frame-sized buffer in pieces of uneven, random length (chunk
+// boundaries on both sides of every stripe offset) and checks that the
+// streaming result matches the one-shot one. Exits with 1 on a mismatch.
+//
+//   pio run -e frame_hash_test
+//   .pio/build/frame_hash_test/program
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude src/frame_hash.cpp tools/frame_hash_test/frame_hash_test.cpp
+//       -o frame_hash_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_hash.h"
+
+static const uint32_t PRIME32 = 2654435761u;
+static const uint64_t PRIME64 = 11400714785074694797ull;
+static const size_t SANITY_LEN = 2367;    // as in xxhsum
+static const size_t FRAME_LEN = 16560;    // 360x184 at 2 bpp
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static uint8_t sanity[SANITY_LEN];
+
+// xxhsum's BMK_fillTestBuffer()
+static void fill_sanity() {
+  uint64_t gen = PRIME32;
+  for (size_t i = 0; i < SANITY_LEN; i++) {
+    sanity[i] = (uint8_t)(gen >> 56);
+    gen *= PRIME64;
+  }
+}
+
+static uint32_t streamed(const uint8_t* p, size_t n, uint32_t seed, const size_t* cuts, int cut_n) {
+  FrameHash h;
+  frame_hash_init(h, seed);
+  size_t at = 0;
+  for (int i = 0; i < cut_n && at < n; i++) {
+    size_t len = cuts[i] < n - at ? cuts[i] : n - at;
+    frame_hash_update(h, p + at, len);
+    at += len;
+  }
+  frame_hash_update(h, p + at, n - at);
+  return frame_hash_final(h);
+}
+
+static void test_reference() {
+  struct { size_t len; uint32_t seed; uint32_t hash; } v[] = {
+    { 0, 0, 0x02CC5D05 },   { 0, PRIME32, 0x36B78AE7 },
+    { 1, 0, 0xCF65B03E },   { 1, PRIME32, 0xB4545AA4 },
+    { 14, 0, 0x1208E7E2 },  { 14, PRIME32, 0x6AF1D1FE },
+    { 222, 0, 0x5BD11DBD }, { 222, PRIME32, 0x58803C5F },
+  };
+  for (auto& t : v) {
+    uint32_t got = frame_hash(sanity, t.len, t.seed);
+    if (got != t.hash)
+      fprintf(stderr, "len %u seed %08x: %08x, want %08x\n", (unsigned)t.len, (unsigned)t.seed,
+              (unsigned)got, (unsigned)t.hash);
+    CHECK(got == t.hash);
+  }
+
+  CHECK(frame_hash((const uint8_t*)"", 0, 1) == 0x0B2CB792);
+  CHECK(frame_hash((const uint8_t*)"a", 1) == 0x550D7456);
+  CHECK(frame_hash((const uint8_t*)"abc", 3) == 0x32D153FF);
+}
+
+static void test_chunked() {
+  static uint8_t frame[FRAME_LEN];
+  srand(1);
+  for (size_t i = 0; i < FRAME_LEN; i++) frame[i] = (uint8_t)rand();
+
+  // every length up to a few stripes, split once at every offset
+  for (size_t n = 0; n <= 70; n++) {
+    uint32_t want = frame_hash(sanity, n);
+    for (size_t cut = 0; cut <= n; cut++) CHECK(streamed(sanity, n, 0, &cut, 1) == want);
+  }
+
+  // whole frames in random pieces of 1..40 bytes, and a few large ones
+  uint32_t want = frame_hash(frame, FRAME_LEN, 7);
+  size_t cuts[FRAME_LEN];
+  for (int round = 0; round < 200; round++) {
+    int n = 0;
+    size_t left = FRAME_LEN;
+    while (left && n < (int)FRAME_LEN) {
+      size_t len = round % 10 ? 1 + (size_t)rand() % 40 : 1 + (size_t)rand() % 4000;
+      if (len > left) len = left;
+      cuts[n++] = len;
+      left -= len;
+    }
+    CHECK(streamed(frame, FRAME_LEN, 7, cuts, n) == want);
+  }
+
+  // a zero-length update changes nothing
+  FrameHash h;
+  frame_hash_init(h, 7);
+  frame_hash_update(h, frame, 0);
+  frame_hash_update(h, frame, FRAME_LEN);
+  frame_hash_update(h, frame, 0);
+  CHECK(frame_hash_final(h) == want);
+}
+
+int main() {
+  fill_sanity();
+  test_reference();
+  test_chunked();
+  if (failures) {
+    printf("frame_hash_test: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("frame_hash_test: ok\n");
+  return 0;
+}
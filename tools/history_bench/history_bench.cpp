@@ -0,0 +1,187 @@
+// Host-side check and benchmark of the compressed reading history.
+//
+// Fills a store with synthetic traces (fixed 15 min cadence, the adaptive
+// sleep's irregular cadence, a noisy 1 min feed, large swings), checks that
+// the reader returns exactly the newest samples that were kept and that
+// window queries match a brute-force scan over them, and reports samples
+// per KB, the time span held, and the cost of 1 h / 24 h / 7 d queries
+// against decoding every sample. Exits with 1 on any mismatch.
+//
+//   pio run -e history_bench
+//   .pio/build/history_bench/program
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude src/history.cpp tools/history_bench/history_bench.cpp
+//       -o history_bench
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "history.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static HistoryStore store;
+
+struct Trace {
+  const char* name;
+  std::vector<HistorySample> s;
+};
+
+static int rnd(int n) { return rand() % n; }
+
+static Trace fixed_cadence() {
+  Trace t = { "15 min, +-1 C", {} };
+  int v = 40;
+  for (uint32_t i = 0; i < 5000; i++) {
+    v += rnd(3) - 1;
+    if (v < 20) v = 20;
+    if (v > 65) v = 65;
+    t.s.push_back(HistorySample{ i * 900, (int16_t)v });
+  }
+  return t;
+}
+
+static Trace adaptive_cadence() {
+  Trace t = { "adaptive 2-60 min", {} };
+  int v = 40;
+  uint32_t ts = 0;
+  for (uint32_t i = 0; i < 5000; i++) {
+    ts += 120 + (uint32_t)rnd(3480) + (uint32_t)rnd(3);
+    v += rnd(3) - 1;
+    t.s.push_back(HistorySample{ ts, (int16_t)v });
+  }
+  return t;
+}
+
+static Trace noisy_minute() {
+  Trace t = { "1 min, noisy +-3 C", {} };
+  int v = 50;
+  for (uint32_t i = 0; i < 20000; i++) {
+    v += rnd(7) - 3;
+    if (v < 0) v = 0;
+    if (v > 90) v = 90;
+    t.s.push_back(HistorySample{ i * 60 + (uint32_t)rnd(2), (int16_t)v });
+  }
+  return t;
+}
+
+static Trace large_swings() {
+  Trace t = { "15 min, swings 20-70 C", {} };
+  for (uint32_t i = 0; i < 5000; i++) {
+    int v = (i % 8 < 4) ? 20 + rnd(5) : 65 + rnd(5);
+    t.s.push_back(HistorySample{ i * 900, (int16_t)v });
+  }
+  return t;
+}
+
+static HistoryStats brute(const std::vector<HistorySample>& kept, uint32_t from, uint32_t to) {
+  HistoryStats s = {};
+  for (const HistorySample& x : kept) {
+    if (x.t_s < from || x.t_s > to) continue;
+    if (s.count == 0 || x.value < s.min) s.min = x.value;
+    if (s.count == 0 || x.value > s.max) s.max = x.value;
+    s.sum += x.value;
+    s.count++;
+  }
+  return s;
+}
+
+static bool same(const HistoryStats& a, const HistoryStats& b) {
+  if (a.count != b.count) return false;
+  if (a.count == 0) return true;
+  return a.min == b.min && a.max == b.max && a.sum == b.sum;
+}
+
+template <typename F>
+static double ns_per_call(F f, int iters) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; i++) f(i);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+static volatile int32_t sink;
+
+static void run(const Trace& tr) {
+  history_reset(store);
+  for (const HistorySample& x : tr.s) history_append(store, x.t_s, x.value);
+
+  // what the store says it holds must be exactly the newest samples
+  uint32_t n = history_count(store);
+  CHECK(n > 0 && n <= tr.s.size());
+  std::vector<HistorySample> kept(tr.s.end() - n, tr.s.end());
+
+  HistoryReader r;
+  history_reader_begin(r, store, 0);
+  HistorySample x;
+  size_t i = 0;
+  bool match = true;
+  while (history_reader_next(r, x)) {
+    if (i >= kept.size() || x.t_s != kept[i].t_s || x.value != kept[i].value) match = false;
+    i++;
+  }
+  CHECK(match && i == kept.size());
+
+  HistorySample newest;
+  CHECK(history_newest(store, newest) && newest.t_s == kept.back().t_s);
+
+  // random windows, including ones cut by block edges and past both ends
+  uint32_t first = kept.front().t_s, last = kept.back().t_s;
+  for (int q = 0; q < 2000; q++) {
+    uint32_t a = first - 3600 + (uint32_t)((uint64_t)rand() * (last - first + 7200) / RAND_MAX);
+    uint32_t b = a + (uint32_t)rnd(14 * 86400);
+    CHECK(same(history_query(store, a, b), brute(kept, a, b)));
+  }
+
+  size_t bytes = history_bytes_used(store);
+  double span_d = (last - first) / 86400.0;
+  printf("%-24s %6u %6u %7.1f %6.2f %7.1f |", tr.name, (unsigned)n, (unsigned)bytes,
+         n * 1024.0 / bytes, (double)bytes / n, span_d);
+
+  const uint32_t windows[] = { 3600, 86400, 7 * 86400 };
+  for (uint32_t w : windows) {
+    uint32_t to = last;
+    uint32_t from = to > w ? to - w : 0;
+    double q = ns_per_call([&](int) { sink = history_query(store, from, to).sum; }, 20000);
+    printf(" %7.0f", q);
+  }
+  double full = ns_per_call([&](int) {
+    HistoryReader rr;
+    history_reader_begin(rr, store, 0);
+    HistorySample s;
+    int32_t sum = 0;
+    while (history_reader_next(rr, s)) sum += s.value;
+    sink = sum;
+  }, 2000);
+  printf(" %8.0f\n", full);
+}
+
+int main() {
+  srand(1);
+  printf("store: %d x %d-byte blocks, %u bytes of RAM\n", HISTORY_BLOCKS, HISTORY_BLOCK_BYTES,
+         (unsigned)sizeof(HistoryStore));
+  printf("%-24s %6s %6s %7s %6s %7s | %7s %7s %7s %8s\n", "trace", "kept", "bytes", "smp/KB",
+         "B/smp", "days", "1h ns", "24h ns", "7d ns", "decode ns");
+  run(fixed_cadence());
+  run(adaptive_cadence());
+  run(noisy_minute());
+  run(large_swings());
+  if (failures) {
+    printf("history_bench: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("history_bench: ok\n");
+  return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Host stand-in for the Arduino core: the C library, a simulated clock and
+// the few ESP32 calls the portable modules make. Time only moves when a
+// test calls host_advance_ms(); delay() advances it too.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "esp_attr.h"
+
+// ===================== CLOCK =====================
+extern uint64_t host_now_us;
+
+static inline void host_advance_ms(uint32_t ms) { host_now_us += (uint64_t)ms * 1000; }
+static inline void host_set_ms(uint64_t ms) { host_now_us = ms * 1000; }
+
+static inline unsigned long millis() { return (unsigned long)(uint32_t)(host_now_us / 1000); }
+static inline unsigned long micros() { return (unsigned long)(uint32_t)host_now_us; }
+static inline int64_t esp_timer_get_time() { return (int64_t)host_now_us; }
+static inline void delay(uint32_t ms) { host_advance_ms(ms); }
+
+// ===================== ESP =====================
+// Deterministic: tests seed it to get reproducible jitter.
+uint32_t esp_random();
+void host_seed_random(uint32_t seed);
+
+class EspClass {
+ public:
+  uint64_t getEfuseMac() { return 0x24A1602B3C4DULL; }
+};
+extern EspClass ESP;
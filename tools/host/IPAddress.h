@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for the Arduino IPAddress: IPv4 in network byte order, as
+// the ESP32 core stores it.
+
+#include <stdint.h>
+#include <stdio.h>
+
+class IPAddress {
+ public:
+  IPAddress() : addr_(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : addr_((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  explicit IPAddress(uint32_t a) : addr_(a) {}
+
+  operator uint32_t() const { return addr_; }
+  uint8_t operator[](int i) const { return (uint8_t)(addr_ >> (8 * i)); }
+
+  bool fromString(const char* s) {
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) return false;
+    if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+    *this = IPAddress((uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d);
+    return true;
+  }
+
+ private:
+  uint32_t addr_;
+};
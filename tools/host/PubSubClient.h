@@ -0,0 +1,88 @@
+#pragma once
+
+// Host stand-in for PubSubClient: connect() succeeds when the scripted
+// broker is up and costs connect_ms of simulated time either way (a dead
+// broker costs the socket timeout). A subscribe() is answered, from loop(),
+// with the retained value retained_after_ms later, if there is one.
+
+#include <stdint.h>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_CONNECTED 0
+
+typedef void (*MqttCallback)(char* topic, uint8_t* payload, unsigned int length);
+
+class PubSubClient {
+ public:
+  // scripted by the test
+  bool broker_up = true;
+  uint32_t connect_ms = 40;
+  uint32_t fail_ms = 5000;
+  int32_t retained_after_ms = 20;    // < 0: no retained value on the topic
+  const char* retained_payload = "42.0";
+
+  // what was asked for
+  int connects = 0;
+  int by_address = 0;   // connects issued with a resolved IP address
+
+  PubSubClient& setServer(const char* host, uint16_t port) {
+    (void)host; (void)port;
+    resolved_ = false;
+    return *this;
+  }
+  PubSubClient& setServer(IPAddress ip, uint16_t port) {
+    (void)ip; (void)port;
+    resolved_ = true;
+    return *this;
+  }
+  PubSubClient& setSocketTimeout(uint16_t s) { (void)s; return *this; }
+
+  bool connect(const char* id) { return connect(id, nullptr, nullptr); }
+  bool connect(const char* id, const char* user, const char* pass) {
+    (void)id; (void)user; (void)pass;
+    connects++;
+    if (resolved_) by_address++;
+    host_advance_ms(broker_up ? connect_ms : fail_ms);
+    connected_ = broker_up;
+    return connected_;
+  }
+
+  PubSubClient& setCallback(MqttCallback cb) { callback_ = cb; return *this; }
+
+  bool subscribe(const char* topic, uint8_t qos = 0) {
+    (void)qos;
+    if (!connected_) return false;
+    snprintf(topic_, sizeof(topic_), "%s", topic);
+    pending_ = retained_after_ms >= 0;
+    deliver_at_us_ = host_now_us + (uint64_t)(retained_after_ms < 0 ? 0 : retained_after_ms) * 1000;
+    return true;
+  }
+
+  bool connected() { return connected_; }
+  void disconnect() { connected_ = false; pending_ = false; }
+  int state() { return connected_ ? MQTT_CONNECTED : MQTT_CONNECT_FAILED; }
+
+  bool loop() {
+    if (connected_ && pending_ && host_now_us >= deliver_at_us_) {
+      pending_ = false;
+      char payload[32];
+      unsigned int n = (unsigned int)snprintf(payload, sizeof(payload), "%s", retained_payload);
+      if (callback_) callback_(topic_, (uint8_t*)payload, n);
+    }
+    return connected_;
+  }
+
+  // Drops the session as a broker restart would.
+  void host_drop() { connected_ = false; pending_ = false; }
+
+ private:
+  bool connected_ = false;
+  bool resolved_ = false;
+  MqttCallback callback_ = nullptr;
+  bool pending_ = false;
+  uint64_t deliver_at_us_ = 0;
+  char topic_[64] = "";
+};
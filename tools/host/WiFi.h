@@ -0,0 +1,132 @@
+#pragma once
+
+// Host stand-in for the ESP32 WiFi station. An attempt started by begin()
+// connects join_ms (or fast_join_ms with a BSSID/channel) of simulated time
+// later if the scripted network allows it; the test scripts the network in
+// WiFi.sim and reads back what the code under test asked for.
+
+#include <stdint.h>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+
+struct HostWifiSim {
+  // the network
+  bool ap_up;             // false: attempts never complete (timeout)
+  bool ssid_missing;      // the attempt reports WL_NO_SSID_AVAIL right away
+  bool cache_stale;       // BSSID/channel joins fail (AP moved channel)
+  uint32_t join_ms;       // scan + association + DHCP
+  uint32_t fast_join_ms;  // association to a given BSSID/channel
+  uint32_t dhcp_ip;       // address DHCP hands out
+  uint8_t channel;
+
+  // what was asked for
+  int begins;
+  int fast_begins;        // begin() with BSSID and channel
+  int dhcp_configs;       // config(0, 0, 0)
+  int static_configs;
+  uint32_t static_ip;     // last static address configured
+  int disconnects;
+
+  // the current attempt
+  bool connecting;
+  bool connected;
+  bool fast;
+  uint32_t ip;
+  uint64_t connect_at_us;
+};
+
+class WiFiClass {
+ public:
+  HostWifiSim sim;
+
+  WiFiClass() { host_reset(); }
+
+  void host_reset() {
+    memset(&sim, 0, sizeof(sim));
+    sim.ap_up = true;
+    sim.join_ms = 1500;
+    sim.fast_join_ms = 250;
+    sim.dhcp_ip = (uint32_t)IPAddress(192, 168, 1, 50);
+    sim.channel = 6;
+    pending_static_ = 0;
+  }
+
+  // Drops the link as an AP restart would.
+  void host_drop_link() { sim.connected = false; sim.connecting = false; }
+
+  void mode(wifi_mode_t) {}
+  void persistent(bool) {}
+
+  bool config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns = IPAddress()) {
+    (void)gateway; (void)subnet; (void)dns;
+    if ((uint32_t)ip == 0) {
+      sim.dhcp_configs++;
+    } else {
+      sim.static_configs++;
+      sim.static_ip = (uint32_t)ip;
+    }
+    pending_static_ = (uint32_t)ip;
+    return true;
+  }
+
+  void begin(const char* ssid, const char* pass, int32_t channel = 0, const uint8_t* bssid = nullptr) {
+    (void)ssid; (void)pass;
+    sim.begins++;
+    sim.fast = bssid && channel > 0;
+    if (sim.fast) sim.fast_begins++;
+    sim.connecting = true;
+    sim.connected = false;
+    sim.ip = pending_static_ ? pending_static_ : sim.dhcp_ip;
+    sim.connect_at_us = host_now_us + (uint64_t)(sim.fast ? sim.fast_join_ms : sim.join_ms) * 1000;
+  }
+
+  bool disconnect(bool wifioff = false) {
+    (void)wifioff;
+    sim.disconnects++;
+    sim.connecting = false;
+    sim.connected = false;
+    return true;
+  }
+
+  wl_status_t status() {
+    if (sim.connected) return WL_CONNECTED;
+    if (!sim.connecting) return WL_DISCONNECTED;
+    if (sim.ssid_missing) return WL_NO_SSID_AVAIL;
+    if (!sim.ap_up || (sim.fast && sim.cache_stale)) return WL_DISCONNECTED;
+    if (host_now_us < sim.connect_at_us) return WL_DISCONNECTED;
+    sim.connecting = false;
+    sim.connected = true;
+    return WL_CONNECTED;
+  }
+
+  const uint8_t* BSSID() { return sim.connected ? bssid_ : nullptr; }
+  int32_t channel() { return sim.channel; }
+  IPAddress localIP() { return IPAddress(sim.connected ? sim.ip : 0); }
+  IPAddress gatewayIP() { return IPAddress(192, 168, 1, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP() { return IPAddress(192, 168, 1, 1); }
+
+  int hostByName(const char* host, IPAddress& out) {
+    (void)host;
+    if (!sim.connected) return 0;
+    out = IPAddress(192, 168, 1, 10);
+    return 1;
+  }
+
+ private:
+  uint32_t pending_static_;
+  const uint8_t bssid_[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+};
+
+extern WiFiClass WiFi;
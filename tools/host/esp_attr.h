@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF header of the same name: memory placement
+// attributes mean nothing off target.
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
@@ -0,0 +1,89 @@
+// RAM partition for flash_part.h on the host; see flash_part_ram.h.
+
+#include <string.h>
+#include <vector>
+
+#include "flash_part.h"
+#include "flash_part_ram.h"
+
+static const uint32_t SECTOR = 4096;
+
+static std::vector<uint8_t> mem;
+static FlashRamStats stats;
+static uint32_t mutations = 0;
+static bool armed = false;
+static uint32_t cut_at = 0;
+static uint32_t cut_keep = 0;
+static bool dead = false;
+
+void flash_ram_setup(uint32_t size) {
+  mem.assign(size, 0xFF);
+  memset(&stats, 0, sizeof(stats));
+  mutations = 0;
+  armed = false;
+  dead = false;
+}
+
+void flash_ram_cut_at(uint32_t mutation, uint32_t keep) {
+  armed = true;
+  cut_at = mutations + mutation;
+  cut_keep = keep;
+}
+
+bool flash_ram_cut_happened() { return dead; }
+
+void flash_ram_power_on() {
+  armed = false;
+  dead = false;
+}
+
+uint32_t flash_ram_mutations() { return mutations; }
+FlashRamStats& flash_ram_stats() { return stats; }
+uint8_t* flash_ram_data() { return mem.data(); }
+
+// How much of this mutation takes effect; false once power is gone.
+static bool begin_mutation(size_t len, size_t& apply) {
+  if (dead) return false;
+  apply = len;
+  if (armed && mutations == cut_at) {
+    apply = cut_keep < len ? cut_keep : len;
+    dead = true;
+  }
+  mutations++;
+  return true;
+}
+
+uint32_t flash_part_open(const char*, uint8_t) { return (uint32_t)mem.size(); }
+
+bool flash_part_read(uint32_t off, void* buf, size_t len) {
+  if (dead || off + len > mem.size()) return false;
+  stats.reads++;
+  stats.read_bytes += len;
+  memcpy(buf, mem.data() + off, len);
+  return true;
+}
+
+bool flash_part_write(uint32_t off, const void* buf, size_t len) {
+  if (off + len > mem.size()) return false;
+  size_t apply;
+  if (!begin_mutation(len, apply)) return false;
+  stats.writes++;
+  stats.write_bytes += apply;
+  const uint8_t* src = (const uint8_t*)buf;
+  bool dirty = false;
+  for (size_t i = 0; i < apply; i++) {
+    if ((mem[off + i] & src[i]) != src[i]) dirty = true;
+    mem[off + i] &= src[i];
+  }
+  if (dirty) stats.dirty_writes++;
+  return !dead;
+}
+
+bool flash_part_erase(uint32_t off, size_t len) {
+  if (off % SECTOR || len % SECTOR || off + len > mem.size()) return false;
+  size_t apply;
+  if (!begin_mutation(len, apply)) return false;
+  stats.erases++;
+  memset(mem.data() + off, 0xFF, apply);
+  return !dead;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Controls for the RAM partition behind flash_part.h on the host.
+//
+// Behaves like NOR flash: erase sets whole 4 KB sectors to 0xFF, a write
+// ANDs its bytes in (it can clear bits, never set them). A power cut can be
+// armed to hit the n-th write or erase: that operation applies only its
+// first keep bytes (the rest of a write is not programmed, the rest of an
+// erase keeps its old content), fails, and every later call fails until
+// flash_ram_power_on().
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct FlashRamStats {
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t erases;
+  uint64_t read_bytes;
+  uint64_t write_bytes;
+  uint32_t dirty_writes;   // writes onto bits that were not erased
+};
+
+// Fresh erased partition of size bytes (a multiple of 4096).
+void flash_ram_setup(uint32_t size);
+
+// Arms a cut at write/erase number mutation (counted from now, 0 = the next
+// one) after keep bytes of it.
+void flash_ram_cut_at(uint32_t mutation, uint32_t keep);
+bool flash_ram_cut_happened();
+void flash_ram_power_on();   // disarms and clears the cut
+
+// Writes and erases issued so far.
+uint32_t flash_ram_mutations();
+
+FlashRamStats& flash_ram_stats();
+uint8_t* flash_ram_data();
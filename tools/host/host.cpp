@@ -0,0 +1,21 @@
+// Definitions behind the host stand-ins (tools/host/*.h).
+
+#include "Arduino.h"
+#include "WiFi.h"
+
+uint64_t host_now_us = 0;
+EspClass ESP;
+WiFiClass WiFi;
+
+static uint32_t rng_state = 0x9E3779B9u;
+
+void host_seed_random(uint32_t seed) { rng_state = seed ? seed : 0x9E3779B9u; }
+
+// xorshift32
+uint32_t esp_random() {
+  uint32_t x = rng_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return rng_state = x;
+}
@@ -0,0 +1,133 @@
+// Host-side check of metric histogram bucketing and JSON serialization.
+//
+// Walks every bucket boundary, feeds observations and compares counts and
+// sums, renders known stores and compares the JSON text, and fills every
+// field with its widest value to show that METRICS_JSON_MAX always fits.
+// Exits with 1 on the first mismatch.
+//
+//   pio run -e metrics_test
+//   .pio/build/metrics_test/program
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -Itools/host src/metrics.cpp
+//       tools/metrics_test/metrics_test.cpp -o metrics_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static void test_buckets() {
+  CHECK(metric_bucket(0) == 0);
+  CHECK(metric_bucket(1) == 1);
+  CHECK(metric_bucket(2) == 2);
+  CHECK(metric_bucket(3) == 2);
+  CHECK(metric_bucket(4) == 3);
+  CHECK(metric_bucket(0xFFFFFFFFu) == METRIC_HIST_BUCKETS - 1);
+
+  // every bucket below the open-ended one holds exactly [floor(b), floor(b+1))
+  for (int b = 1; b < METRIC_HIST_BUCKETS - 1; b++) {
+    uint32_t lo = metric_bucket_floor(b);
+    uint32_t hi = metric_bucket_floor(b + 1);
+    CHECK(metric_bucket(lo) == b);
+    CHECK(metric_bucket(hi - 1) == b);
+    CHECK(metric_bucket(lo - 1) == b - 1);
+  }
+  uint32_t open = metric_bucket_floor(METRIC_HIST_BUCKETS - 1);
+  CHECK(metric_bucket(open) == METRIC_HIST_BUCKETS - 1);
+  CHECK(metric_bucket(open * 8) == METRIC_HIST_BUCKETS - 1);
+}
+
+static void test_observe() {
+  metrics_reset();
+  const uint32_t values[] = { 0, 1, 5, 7, 100, 40000, 40000 };
+  uint32_t sum = 0;
+  for (uint32_t v : values) {
+    metric_observe(M_H_REFRESH_MS, v);
+    sum += v;
+  }
+  const MetricHistogram& h = metrics_store.hists[M_H_REFRESH_MS];
+  CHECK(h.count == 7);
+  CHECK(h.sum == sum);
+  CHECK(h.buckets[0] == 1);
+  CHECK(h.buckets[1] == 1);
+  CHECK(h.buckets[3] == 2);    // 5, 7
+  CHECK(h.buckets[7] == 1);    // 100
+  CHECK(h.buckets[METRIC_HIST_BUCKETS - 1] == 2);
+
+  uint32_t total = 0;
+  for (int b = 0; b < METRIC_HIST_BUCKETS; b++) total += h.buckets[b];
+  CHECK(total == h.count);
+
+  // other histograms untouched
+  CHECK(metrics_store.hists[M_H_BUSY_WAIT_MS].count == 0);
+}
+
+static void test_json() {
+  static char buf[METRICS_JSON_MAX];
+
+  metrics_reset();
+  size_t n = metrics_to_json(buf, sizeof(buf));
+  CHECK(n > 0 && n == strlen(buf));
+  CHECK(strncmp(buf, "{\"c\":{\"wakes\":0,", 16) == 0);
+  CHECK(strstr(buf, "\"busy_wait_ms\":{\"n\":0,\"sum\":0,\"b\":[]}") != nullptr);
+  CHECK(strcmp(buf + n - 2, "}}") == 0);
+
+  metric_inc(M_WAKES, 3);
+  metric_set(M_LAST_TEMP, -12);
+  metric_observe(M_H_AWAKE_MS, 0);
+  metric_observe(M_H_AWAKE_MS, 5);
+  n = metrics_to_json(buf, sizeof(buf));
+  CHECK(strncmp(buf, "{\"c\":{\"wakes\":3,", 16) == 0);
+  CHECK(strstr(buf, "\"last_temp\":-12") != nullptr);
+  // trailing empty buckets are left out, inner ones kept
+  CHECK(strstr(buf, "\"awake_ms\":{\"n\":2,\"sum\":5,\"b\":[1,0,0,1]}") != nullptr);
+
+  // exact fit and one byte short
+  size_t len = n;
+  CHECK(metrics_to_json(buf, len + 1) == len);
+  CHECK(metrics_to_json(buf, len) == 0 && buf[0] == '\0');
+  CHECK(metrics_to_json(buf, 0) == 0);
+}
+
+static void test_worst_case() {
+  static char buf[METRICS_JSON_MAX];
+
+  metrics_reset();
+  for (int i = 0; i < M_COUNTER_COUNT; i++) metrics_store.counters[i] = 0xFFFFFFFFu;
+  for (int i = 0; i < M_GAUGE_COUNT; i++) metrics_store.gauges[i] = INT32_MIN;
+  for (int i = 0; i < M_HIST_COUNT; i++) {
+    MetricHistogram& h = metrics_store.hists[i];
+    h.count = h.sum = 0xFFFFFFFFu;
+    for (int b = 0; b < METRIC_HIST_BUCKETS; b++) h.buckets[b] = 0xFFFFFFFFu;
+  }
+  size_t n = metrics_to_json(buf, sizeof(buf));
+  CHECK(n > 0);
+  printf("metrics JSON: worst case %u bytes, buffer %u bytes\n",
+         (unsigned)n + 1, (unsigned)sizeof(buf));
+}
+
+int main() {
+  test_buckets();
+  test_observe();
+  test_json();
+  test_worst_case();
+  if (failures) {
+    printf("metrics_test: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("metrics_test: ok\n");
+  return 0;
+}
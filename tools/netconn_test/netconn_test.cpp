@@ -0,0 +1,398 @@
+// Host-side test of the WiFi/MQTT connection manager against simulated
+// WiFi and broker stand-ins (tools/host) on a simulated clock.
+//
+// Polls net_poll() every POLL_MS of simulated time, as the network task
+// does, and checks: first connect and the cached reconnect on the next
+// wake, DHCP lease reuse and renewal (also on an always-awake device), the
+// cached join with a static IP, the fallback from stale cached
+// parameters, WiFi and MQTT retry
+// spacing (exponential window, equal jitter, cap) over many seeds, the
+// per-wake budget and what it costs on top, and recovery from a dropped
+// link. Exits with 1 on the first mismatch.
+//
+//   pio run -e netconn_test
+//   .pio/build/netconn_test/program
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -Itools/host -DLOG_LEVEL=0 -DTRACE_ENABLED=0
+//       src/netconn.cpp src/metrics.cpp tools/host/host.cpp
+//       tools/netconn_test/netconn_test.cpp -o netconn_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+#include "metrics.h"
+#include "netconn.h"
+
+static const uint32_t POLL_MS = 10;
+
+static const uint32_t ATTEMPT_MS = 10000;
+static const uint32_t FAST_ATTEMPT_MS = 3000;
+static const uint32_t BACKOFF_MIN_MS = 1000;
+static const uint32_t BACKOFF_MAX_MS = 60000;
+static const uint32_t LEASE_REUSE_S = 3600;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static int sessions = 0;
+static void on_session_up() { sessions++; }
+
+// scheduler clock: its value at this wake plus the time awake
+static uint32_t wake_clock_s = 0;
+static uint32_t clock_s() { return wake_clock_s + millis() / 1000; }
+
+static NetConfig make_cfg(uint32_t budget_ms) {
+  NetConfig c = {};
+  c.ssid = "ssid";
+  c.pass = "pass";
+  c.mqtt_host = "broker.lan";
+  c.mqtt_port = 1883;
+  c.mqtt_user = "";
+  c.mqtt_pass = "";
+  c.wifi_attempt_ms = ATTEMPT_MS;
+  c.backoff_min_ms = BACKOFF_MIN_MS;
+  c.backoff_max_ms = BACKOFF_MAX_MS;
+  c.wake_budget_ms = budget_ms;
+  c.fast_reconnect = true;
+  c.fast_attempt_ms = FAST_ATTEMPT_MS;
+  c.lease_reuse_s = LEASE_REUSE_S;
+  c.now_s = clock_s;
+  c.on_session_up = on_session_up;
+  return c;
+}
+
+// A fresh wake: clock at zero, link down, RTC memory (cache, metrics) kept.
+static void wake(PubSubClient& mqtt, const NetConfig& cfg) {
+  host_set_ms(0);
+  WiFi.host_drop_link();
+  mqtt.host_drop();
+  sessions = 0;
+  net_begin(cfg, mqtt);
+}
+
+// Polls until done() or limit_ms of simulated time; returns the time.
+template <typename F>
+static uint32_t poll_until(F done, uint32_t limit_ms) {
+  while (!done() && millis() < limit_ms) {
+    host_advance_ms(POLL_MS);
+    net_poll();
+  }
+  return millis();
+}
+
+static uint32_t window_for(int failures_so_far) {
+  uint32_t w = BACKOFF_MIN_MS;
+  for (int i = 1; i < failures_so_far && w < BACKOFF_MAX_MS; i++) w *= 2;
+  return w < BACKOFF_MAX_MS ? w : BACKOFF_MAX_MS;
+}
+
+// ===================== CONNECT / CACHE =====================
+static void test_connect_and_cache() {
+  WiFi.host_reset();
+  PubSubClient mqtt;
+  metrics_reset();
+  net_forget_cache();
+
+  NetConfig cfg = make_cfg(30000);
+  wake(mqtt, cfg);
+  uint32_t t = poll_until(net_session_up, 60000);
+  CHECK(net_session_up());
+  CHECK(!net_used_cache());
+  CHECK(WiFi.sim.fast_begins == 0);
+  CHECK(sessions == 1);
+  CHECK(t <= WiFi.sim.join_ms + mqtt.connect_ms + 3 * POLL_MS);
+  printf("full connect:    %5lu ms to session\n", (unsigned long)t);
+
+  // next wake joins the cached AP and reaches the broker by address
+  int connects = mqtt.connects;
+  wake(mqtt, cfg);
+  t = poll_until(net_session_up, 60000);
+  CHECK(net_session_up());
+  CHECK(net_used_cache());
+  CHECK(WiFi.sim.fast_begins == 1);
+  CHECK(mqtt.by_address == 2 && mqtt.connects == connects + 1);
+  CHECK(t <= WiFi.sim.fast_join_ms + mqtt.connect_ms + 3 * POLL_MS);
+  CHECK(metrics_store.hists[M_H_CONNECT_CACHED_MS].count == 1);
+  CHECK(metrics_store.hists[M_H_CONNECT_FULL_MS].count == 1);
+  printf("cached connect:  %5lu ms to session\n", (unsigned long)t);
+
+  // AP moved channel: the cached join fails once, a full scan follows at once
+  WiFi.sim.cache_stale = true;
+  int begins = WiFi.sim.begins;
+  wake(mqtt, cfg);
+  t = poll_until(net_session_up, 60000);
+  CHECK(net_session_up());
+  CHECK(WiFi.sim.begins == begins + 2);
+  CHECK(metrics_store.counters[M_WIFI_FAST_FALLBACKS] == 1);
+  CHECK(t <= FAST_ATTEMPT_MS + WiFi.sim.join_ms + mqtt.connect_ms + 4 * POLL_MS);
+  printf("stale cache:     %5lu ms to session\n", (unsigned long)t);
+}
+
+// ===================== DHCP LEASE =====================
+// Wakes at the given scheduler times; true if that wake asked DHCP.
+static bool wake_asks_dhcp(PubSubClient& mqtt, NetConfig& cfg, uint32_t now_s) {
+  wake_clock_s = now_s;
+  int dhcp = WiFi.sim.dhcp_configs;
+  int fast = WiFi.sim.fast_begins;
+  wake(mqtt, cfg);
+  poll_until(net_session_up, 60000);
+  CHECK(net_session_up());
+  CHECK(WiFi.sim.fast_begins == fast + 1);   // the scan is skipped either way
+  return WiFi.sim.dhcp_configs != dhcp;
+}
+
+// Drops the link after awake_s more seconds awake and waits for the session.
+static void relink_after(uint32_t awake_s) {
+  host_advance_ms(awake_s * 1000UL);
+  WiFi.host_drop_link();
+  host_advance_ms(POLL_MS);
+  net_poll();
+  CHECK(net_state() == NET_WIFI_CONNECTING);
+  poll_until(net_session_up, millis() + 60000);
+  CHECK(net_session_up());
+}
+
+static void test_lease() {
+  WiFi.host_reset();
+  PubSubClient mqtt;
+  net_forget_cache();
+  NetConfig cfg = make_cfg(30000);
+
+  wake_clock_s = 1000;
+  wake(mqtt, cfg);
+  poll_until(net_session_up, 60000);
+  CHECK(WiFi.sim.dhcp_configs == 1);
+
+  CHECK(!wake_asks_dhcp(mqtt, cfg, 1600));
+  CHECK(WiFi.sim.static_ip == (uint32_t)IPAddress(192, 168, 1, 50));
+  CHECK(!wake_asks_dhcp(mqtt, cfg, 1000 + LEASE_REUSE_S - 1));
+
+  // reuse window over: DHCP again, and the server may hand out another address
+  WiFi.sim.dhcp_ip = (uint32_t)IPAddress(192, 168, 1, 77);
+  CHECK(wake_asks_dhcp(mqtt, cfg, 1000 + LEASE_REUSE_S + 5));
+  CHECK(WiFi.localIP() == (uint32_t)IPAddress(192, 168, 1, 77));
+  // the window restarts from that renewal
+  CHECK(!wake_asks_dhcp(mqtt, cfg, 1000 + LEASE_REUSE_S + 65));
+  CHECK(WiFi.sim.static_ip == (uint32_t)IPAddress(192, 168, 1, 77));
+
+  // scheduler clock reset (its RTC state lost): never treat the lease as fresh
+  CHECK(wake_asks_dhcp(mqtt, cfg, 5));
+
+  // reuse off: DHCP on every wake
+  cfg.lease_reuse_s = 0;
+  CHECK(wake_asks_dhcp(mqtt, cfg, 10000));
+  CHECK(wake_asks_dhcp(mqtt, cfg, 10060));
+
+  // always awake: a link lost days after boot sees the lease's real age
+  cfg.lease_reuse_s = LEASE_REUSE_S;
+  cfg.wake_budget_ms = 0;   // as with USE_DEEP_SLEEP off
+  wake_clock_s = 20000;
+  wake(mqtt, cfg);
+  poll_until(net_session_up, 60000);
+  int dhcp = WiFi.sim.dhcp_configs;
+  int begins = WiFi.sim.fast_begins;
+  relink_after(LEASE_REUSE_S / 2);
+  CHECK(WiFi.sim.fast_begins == begins + 1);
+  CHECK(WiFi.sim.dhcp_configs == dhcp);   // still fresh
+  relink_after(3 * 86400);
+  CHECK(WiFi.sim.fast_begins == begins + 2);
+  CHECK(WiFi.sim.dhcp_configs == dhcp + 1);
+}
+
+// A user-set static address is the only one ever configured; the AP and
+// channel are still cached, from an empty cache on.
+static void test_static_ip() {
+  WiFi.host_reset();
+  PubSubClient mqtt;
+  net_forget_cache();
+  NetConfig cfg = make_cfg(30000);
+  cfg.static_ip = (uint32_t)IPAddress(192, 168, 1, 200);
+  cfg.static_gateway = (uint32_t)IPAddress(192, 168, 1, 1);
+  cfg.static_subnet = (uint32_t)IPAddress(255, 255, 255, 0);
+  for (int i = 0; i < 6; i++) {
+    wake_clock_s = 20000 + i * 1800;
+    wake(mqtt, cfg);
+    poll_until(net_session_up, 60000);
+    CHECK(net_session_up());
+    CHECK(net_used_cache() == (i > 0));
+    CHECK(WiFi.sim.static_ip == cfg.static_ip);
+  }
+  CHECK(WiFi.sim.fast_begins == 5);
+  CHECK(WiFi.sim.dhcp_configs == 0);
+}
+
+// ===================== BACKOFF =====================
+// Times from each failed attempt's end to the next attempt, for several
+// seeds; checks each against its window and that the jitter spreads.
+static void test_wifi_backoff() {
+  const int SEEDS = 50;
+  const int RETRIES = 9;   // windows 1 s .. 60 s (capped)
+  std::vector<uint32_t> lo(RETRIES, UINT32_MAX), hi(RETRIES, 0);
+
+  for (int seed = 1; seed <= SEEDS; seed++) {
+    host_seed_random((uint32_t)seed * 2654435761u);
+    WiFi.host_reset();
+    WiFi.sim.ap_up = false;
+    PubSubClient mqtt;
+    net_forget_cache();
+    wake(mqtt, make_cfg(0));
+
+    uint32_t fail_at = 0;
+    int seen = WiFi.sim.begins;
+    int retry = 0;
+    while (retry < RETRIES && millis() < 3600000) {
+      NetState before = net_state();
+      host_advance_ms(POLL_MS);
+      net_poll();
+      if (before == NET_WIFI_CONNECTING && net_state() == NET_WIFI_BACKOFF) fail_at = millis();
+      if (WiFi.sim.begins != seen) {
+        seen = WiFi.sim.begins;
+        uint32_t wait = millis() - fail_at;
+        uint32_t w = window_for(retry + 1);
+        CHECK(wait + POLL_MS >= w / 2 && wait <= w + POLL_MS);
+        if (wait < lo[retry]) lo[retry] = wait;
+        if (wait > hi[retry]) hi[retry] = wait;
+        retry++;
+      }
+    }
+    CHECK(retry == RETRIES);
+    CHECK(!net_gave_up());   // no budget: retries forever
+  }
+
+  printf("wifi retry waits over %d seeds (window: min..max ms):\n", SEEDS);
+  for (int i = 0; i < RETRIES; i++) {
+    uint32_t w = window_for(i + 1);
+    printf("  retry %d  %5lu: %5lu..%5lu\n", i + 1, (unsigned long)w, (unsigned long)lo[i],
+           (unsigned long)hi[i]);
+    // equal jitter: spread over most of the upper half of the window
+    CHECK(hi[i] - lo[i] >= w / 4);
+  }
+}
+
+static void test_mqtt_backoff() {
+  host_seed_random(7);
+  WiFi.host_reset();
+  PubSubClient mqtt;
+  mqtt.broker_up = false;
+  metrics_reset();
+  net_forget_cache();
+  wake(mqtt, make_cfg(0));
+
+  int seen = 0;
+  uint32_t fail_at = 0;
+  for (int retry = 0; retry < 6 && millis() < 3600000;) {
+    host_advance_ms(POLL_MS);
+    net_poll();
+    if (mqtt.connects != seen) {
+      if (seen > 0) {
+        uint32_t w = window_for(retry + 1);
+        uint32_t wait = millis() - fail_at - mqtt.fail_ms;   // this attempt's cost excluded
+        CHECK(wait + POLL_MS >= w / 2 && wait <= w + POLL_MS);
+        retry++;
+      }
+      seen = mqtt.connects;
+      fail_at = millis();
+    }
+  }
+  CHECK(net_link_up() && !net_session_up());
+  CHECK(metrics_store.counters[M_MQTT_CONNECT_FAILS] >= 6);
+
+  mqtt.broker_up = true;
+  poll_until(net_session_up, millis() + BACKOFF_MAX_MS + 1000);
+  CHECK(net_session_up());
+  CHECK(sessions == 1);
+}
+
+// ===================== BUDGET =====================
+static void test_budget() {
+  const uint32_t BUDGET = 30000;
+
+  // AP gone
+  WiFi.host_reset();
+  WiFi.sim.ap_up = false;
+  PubSubClient mqtt;
+  net_forget_cache();
+  wake(mqtt, make_cfg(BUDGET));
+  uint32_t t = poll_until(net_gave_up, 600000);
+  CHECK(net_gave_up());
+  CHECK(t > BUDGET && t <= BUDGET + POLL_MS);
+  int begins = WiFi.sim.begins;
+  poll_until([] { return false; }, t + 120000);
+  CHECK(WiFi.sim.begins == begins);   // stays down
+  printf("budget, no AP:     gave up at %5lu ms (budget %lu)\n", (unsigned long)t,
+         (unsigned long)BUDGET);
+
+  // WiFi up, broker dead: a blocking connect can run past the budget by at
+  // most one socket timeout
+  WiFi.host_reset();
+  PubSubClient dead;
+  dead.broker_up = false;
+  wake(dead, make_cfg(BUDGET));
+  t = poll_until(net_gave_up, 600000);
+  CHECK(net_gave_up());
+  CHECK(t > BUDGET && t <= BUDGET + dead.fail_ms + POLL_MS);
+  CHECK(!dead.connected());
+  printf("budget, no broker: gave up at %5lu ms (budget %lu, socket timeout %lu)\n",
+         (unsigned long)t, (unsigned long)BUDGET, (unsigned long)dead.fail_ms);
+
+  // a session reached inside the budget is kept past it
+  WiFi.host_reset();
+  PubSubClient ok;
+  wake(ok, make_cfg(BUDGET));
+  poll_until([] { return false; }, BUDGET * 3);
+  CHECK(net_session_up());
+}
+
+// ===================== LINK LOSS =====================
+static void test_link_loss() {
+  WiFi.host_reset();
+  PubSubClient mqtt;
+  net_forget_cache();
+  wake(mqtt, make_cfg(0));
+  poll_until(net_session_up, 60000);
+  CHECK(sessions == 1);
+
+  WiFi.host_drop_link();
+  host_advance_ms(POLL_MS);
+  net_poll();
+  CHECK(net_state() == NET_WIFI_CONNECTING);
+  poll_until(net_session_up, millis() + 60000);
+  CHECK(net_session_up());
+  CHECK(sessions == 2);
+
+  mqtt.host_drop();
+  host_advance_ms(POLL_MS);
+  net_poll();
+  CHECK(net_state() == NET_LINK_UP);
+  poll_until(net_session_up, millis() + 60000);
+  CHECK(sessions == 3);
+}
+
+int main() {
+  test_connect_and_cache();
+  test_lease();
+  test_static_ip();
+  test_wifi_backoff();
+  test_mqtt_backoff();
+  test_budget();
+  test_link_loss();
+  if (failures) {
+    printf("netconn_test: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("netconn_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,347 @@
+// Host-side check and benchmark of the background layer cache and of
+// display list repaints.
+//
+// Renders every combination of value, arrow, battery level, header (theme
+// and white transition), sparkline and side values twice, with the cache
+// off (everything drawn) and on (static layer copied in), and compares the
+// frames byte for byte. Then walks a warm-up / cool-down run of readings
+// the way the firmware shows them, repainting each frame over the previous
+// one from the display list diff, and compares that with a full redraw,
+// and checks that a full battery icon skips the op its level bar covers.
+// Times typical updates all three ways, and the cost of one new sparkline
+// sample repainted by column against redrawing the graph strip. Exits with
+// 1 if any frame differs.
+//
+//   pio run -e render_bench
+//   .pio/build/render_bench/program [--updates N] [--verbose]
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -DTRACE_ENABLED=0 src/canvas.cpp src/sparkline.cpp
+//       tools/render_bench/render_bench.cpp -o render_bench
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "canvas.h"
+#include "sparkline.h"
+
+static uint8_t reference[FRAME_BYTES];
+static uint8_t kept[2][FRAME_BYTES];
+
+static const ArrowDir ARROWS[] = { ARROW_NONE, ARROW_UP, ARROW_DOWN, ARROW_UP_FAST, ARROW_DOWN_FAST };
+static const int BATTERIES[] = { -1, 0, 3, 55, 100 };
+static const SideValue SIDE[3] = { { "TANK", 52, true }, { "OUT", -7, true }, { "SET", 0, false } };
+
+// 24 h of synthetic readings every 15 min around temp
+static SparkState spark_state;
+
+static void make_spark(int temp) {
+  spark_reset(spark_state);
+  for (uint32_t t = 0; t <= SPARK_SPAN_S; t += 900) {
+    int step = (int)(t / 900);
+    spark_add(spark_state, t, temp - 4 + (step % 32 < 16 ? step % 16 : 16 - step % 16) / 2);
+  }
+}
+
+static void render(int temp, int battery, ArrowDir dir, uint8_t header, bool spark, bool side) {
+  draw_screen_frame(temp, battery, dir, header, spark ? &spark_state : nullptr,
+                    side ? SIDE : nullptr, side ? 3 : 0);
+}
+
+// Both renderers over all combinations; returns the number of mismatches.
+static int compare_all() {
+  int frames = 0, bad = 0;
+  for (int temp = -5; temp <= 105; temp++) {
+    make_spark(temp);
+    for (ArrowDir dir : ARROWS) {
+      for (int battery : BATTERIES) {
+        for (int h = 0; h < 2; h++) {
+          uint8_t header = h ? C_WHITE : (uint8_t)255;
+          for (int extras = 0; extras < 4; extras++) {
+            bool spark = extras & 1, side = extras & 2;
+            canvas_set_layer_cache(false);
+            render(temp, battery, dir, header, spark, side);
+            memcpy(reference, img, FRAME_BYTES);
+            canvas_set_layer_cache(true);
+            render(temp, battery, dir, header, spark, side);   // fills the cache
+            render(temp, battery, dir, header, spark, side);   // from the cache
+            frames++;
+            if (memcmp(reference, img, FRAME_BYTES) != 0) {
+              if (bad < 10) {
+                printf("MISMATCH temp %d arrow %d battery %d header %s spark %d side %d\n", temp,
+                       dir, battery, h ? "white" : "theme", spark, side);
+              }
+              bad++;
+            }
+          }
+        }
+      }
+    }
+  }
+  printf("%d frames compared, %d differ\n", frames, bad);
+  return bad;
+}
+
+// The i-th reading of a boiler warming from 30 to 48 °C and cooling back,
+// with the arrow a trend filter would show and a slowly draining battery.
+struct Reading {
+  int temp;
+  ArrowDir dir;
+  int battery;
+};
+
+static Reading reading(int i) {
+  static const int RUN[] = { 30, 31, 33, 36, 40, 44, 47, 48, 48, 47, 46, 44, 42, 41, 40, 40,
+                             39, 37, 36, 35, 35, 34, 33, 33, 32, 31, 31, 30, 30, 30 };
+  const int n = (int)(sizeof(RUN) / sizeof(RUN[0]));
+  Reading r;
+  r.temp = RUN[i % n];
+  int prev = RUN[(i + n - 1) % n];
+  int d = r.temp - prev;
+  r.dir = d >= 3 ? ARROW_UP_FAST : d > 0 ? ARROW_UP : d <= -3 ? ARROW_DOWN_FAST
+        : d < 0 ? ARROW_DOWN : ARROW_NONE;
+  r.battery = 90 - i / 10;
+  return r;
+}
+
+static void build(DisplayList& dl, const Reading& r, uint8_t header) {
+  build_screen_list(dl, r.temp, r.battery, r.dir, header, &spark_state, SIDE, 3);
+}
+
+static int area(const CanvasRect& b) {
+  return b.w * b.h;
+}
+
+// Every frame of a run of updates repainted over the one before it in the
+// same buffer and compared with a full draw. As on the device, the white
+// transition frame and the theme frame alternate between two buffers, and
+// each reading also goes into the sparkline. Returns the number of
+// mismatches.
+static int compare_repaints(int updates, bool verbose) {
+  static DisplayList prev[2], cur;
+  canvas_set_layer_cache(false);
+  make_spark(40);
+  for (int h = 0; h < 2; h++) {
+    build(prev[h], reading(0), h ? (uint8_t)255 : C_WHITE);
+    canvas_set_target(kept[h]);
+    draw_list(prev[h]);
+  }
+
+  int frames = 0, bad = 0, same = 0;
+  long changed = 0, repainted = 0;
+  CanvasListStats before = canvas_list_stats();
+  for (int i = 1; i <= updates; i++) {
+    Reading r = reading(i);
+    spark_add(spark_state, SPARK_SPAN_S + i * 900, r.temp);
+    for (int h = 0; h < 2; h++) {
+      uint8_t header = h ? (uint8_t)255 : C_WHITE;
+      build(cur, r, header);
+      ListDiff d;
+      list_diff(prev[h], cur, d);
+      if (list_hash(prev[h]) == list_hash(cur)) same++;
+
+      canvas_set_target(kept[h]);
+      int n = canvas_repaint(prev[h], cur);
+      canvas_set_target(nullptr);
+      draw_list(cur);
+      frames++;
+      changed += n;
+
+      int px = 0;
+      if (d.box_count) {
+        for (int b = 0; b < d.box_count; b++) px += area(d.boxes[b]);
+      } else if (d.changed) {
+        px = area(d.bounds);
+      }
+      repainted += px;
+      if (verbose || i <= 3) {
+        printf("%2d -> %2d %-5s %2d ops, %2d changed in %2d boxes, %5.1f%% of the canvas\n",
+               reading(i - 1).temp, r.temp, h ? "theme" : "white", cur.count, d.changed,
+               d.box_count, 100.0 * px / (CANVAS_W * CANVAS_H));
+      }
+      if (memcmp(img, kept[h], FRAME_BYTES) != 0) {
+        if (bad < 10) printf("MISMATCH repainting update %d (%s frame)\n", i, h ? "theme" : "white");
+        bad++;
+      }
+      prev[h] = cur;
+    }
+  }
+  const CanvasListStats& st = canvas_list_stats();
+  printf("%d frames repainted, %d differ, %d identical to the previous one\n", frames, bad, same);
+  printf("average: %.1f ops changed, %.1f%% of the canvas repainted\n", (double)changed / frames,
+         100.0 * repainted / frames / (CANVAS_W * CANVAS_H));
+  printf("ops: %u drawn, %u outside the clip, %u under a later rect\n",
+         (unsigned)(st.drawn - before.drawn), (unsigned)(st.clipped - before.clipped),
+         (unsigned)(st.occluded - before.occluded));
+  return bad;
+}
+
+// Occlusion culling on a known transition: the battery going from 90 to
+// 100 % repaints its icon, and at 100 % the level bar covers the cleared
+// inside exactly, so that one op must be skipped (and the frame still
+// match a full draw). At 90 % nothing is covered. Returns the number of
+// failed checks.
+static int check_occlusion() {
+  static DisplayList from, to;
+  canvas_set_layer_cache(false);
+  make_spark(40);
+  build_screen_list(from, 40, 90, ARROW_NONE, 255, &spark_state, SIDE, 3);
+  build_screen_list(to, 40, 100, ARROW_NONE, 255, &spark_state, SIDE, 3);
+  canvas_set_target(kept[0]);
+  CanvasListStats s0 = canvas_list_stats();
+  draw_list(from);
+  CanvasListStats s1 = canvas_list_stats();
+  canvas_repaint(from, to);
+  CanvasListStats s2 = canvas_list_stats();
+  canvas_set_target(nullptr);
+  draw_list(to);
+
+  int bad = 0;
+  uint32_t before = s1.occluded - s0.occluded, after = s2.occluded - s1.occluded;
+  if (before != 0 || after != 1) {
+    printf("OCCLUSION: battery 90 %% drawn with %u ops occluded (want 0), 90 -> 100 %% repainted"
+           " with %u (want 1)\n", (unsigned)before, (unsigned)after);
+    bad++;
+  }
+  if (memcmp(img, kept[0], FRAME_BYTES) != 0) {
+    printf("MISMATCH repainting battery 90 -> 100 %%\n");
+    bad++;
+  }
+  return bad;
+}
+
+// Redraw cost of one new sample: the same screen with the sparkline one
+// sample further, repainted from the list diff (only the columns whose span
+// changed), against redrawing the whole graph strip once the same diff has
+// shown that nothing else changed, and against the whole frame.
+// Samples arrive every cadence_s seconds as a random walk. Returns the
+// number of repaints that differ from a full draw.
+static int bench_spark(uint32_t cadence_s, int samples) {
+  static DisplayList prev, cur;
+  static uint8_t strip[FRAME_BYTES];
+  const Reading r = reading(5);
+  canvas_set_layer_cache(false);
+  make_spark(40);
+  build(prev, r, 255);
+  canvas_set_target(kept[0]);
+  draw_list(prev);
+  memcpy(strip, kept[0], FRAME_BYTES);
+
+  int bad = 0, value = 40 * 4, single = 0;
+  long columns = 0;
+  double t_repaint = 0, t_strip = 0, t_full = 0;
+  for (int i = 1; i <= samples; i++) {
+    value += rand() % 3 - 1;
+    spark_add(spark_state, SPARK_SPAN_S + i * cadence_s, value / 4);
+    build(cur, r, 255);
+    ListDiff d;
+    list_diff(prev, cur, d);
+    int cols = 0;
+    if (d.box_count) {
+      for (int b = 0; b < d.box_count; b++) cols += d.boxes[b].w;
+    } else if (d.changed) {
+      cols = d.bounds.w;
+    }
+    columns += cols;
+    if (cols <= 1) single++;
+    CanvasRect box = d.bounds;
+    for (int k = 0; k < cur.count; k++) {
+      if (cur.ops[k].kind == OP_SPARK) box = cur.ops[k].box;
+    }
+
+    // the strip needs the diff too, to know that only the graph changed
+    auto t0 = std::chrono::steady_clock::now();
+    canvas_set_target(kept[0]);
+    canvas_repaint(prev, cur);
+    auto t1 = std::chrono::steady_clock::now();
+    canvas_set_target(strip);
+    ListDiff strip_diff;
+    if (list_diff(prev, cur, strip_diff) && strip_diff.changed) draw_list(cur, &box);
+    auto t2 = std::chrono::steady_clock::now();
+    canvas_set_target(nullptr);
+    draw_list(cur);
+    auto t3 = std::chrono::steady_clock::now();
+    t_repaint += std::chrono::duration<double, std::micro>(t1 - t0).count();
+    t_strip += std::chrono::duration<double, std::micro>(t2 - t1).count();
+    t_full += std::chrono::duration<double, std::micro>(t3 - t2).count();
+
+    if (memcmp(img, kept[0], FRAME_BYTES) != 0 || memcmp(img, strip, FRAME_BYTES) != 0) bad++;
+    prev = cur;
+  }
+  canvas_set_target(nullptr);
+  printf("sparkline, a sample every %3u s: %5.1f of %d columns repainted (%2d%% of samples at most"
+         " one), %.2f us repainted, %.2f us whole strip, %.2f us whole frame%s\n",
+         (unsigned)cadence_s, (double)columns / samples, SPARK_W, 100 * single / samples,
+         t_repaint / samples, t_strip / samples, t_full / samples, bad ? " (MISMATCH)" : "");
+  return bad;
+}
+
+enum Mode { MODE_DRAW, MODE_CACHE, MODE_REPAINT };
+
+// A refresh as the firmware does it: white header frame, then the theme
+// one, each in its own buffer.
+static double time_updates(Mode mode, int updates) {
+  static DisplayList held[2], cur;
+  canvas_set_layer_cache(mode == MODE_CACHE);
+  make_spark(40);
+  for (int h = 0; h < 2; h++) {
+    build(held[h], reading(0), h ? (uint8_t)255 : C_WHITE);
+    canvas_set_target(kept[h]);
+    draw_list(held[h]);
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < updates; i++) {
+    Reading r = reading(i);
+    spark_add(spark_state, SPARK_SPAN_S + i * 900, r.temp);
+    for (int h = 0; h < 2; h++) {
+      uint8_t header = h ? (uint8_t)255 : C_WHITE;
+      canvas_set_target(kept[h]);
+      if (mode != MODE_REPAINT) {
+        render(r.temp, r.battery, r.dir, header, true, true);
+        continue;
+      }
+      build(cur, r, header);
+      canvas_repaint(held[h], cur);
+      held[h] = cur;
+    }
+  }
+  canvas_set_target(nullptr);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(t1 - t0).count() / updates;
+}
+
+int main(int argc, char** argv) {
+  int updates = 2000;
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--updates") && i + 1 < argc) {
+      updates = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--verbose")) {
+      verbose = true;
+    } else {
+      fprintf(stderr, "usage: render_bench [--updates N] [--verbose]\n");
+      return 2;
+    }
+  }
+  if (updates < 1) updates = 1;
+
+  int bad = compare_all();
+  bad += compare_repaints(verbose ? 30 : updates, verbose);
+  bad += check_occlusion();
+  srand(1);
+  static const uint32_t CADENCES[] = { 60, 250, 900 };   // within, about one, several columns
+  for (uint32_t cadence : CADENCES) bad += bench_spark(cadence, updates);
+
+  double full = time_updates(MODE_DRAW, updates);
+  double layered = time_updates(MODE_CACHE, updates);
+  double repaint = time_updates(MODE_REPAINT, updates);
+  const CanvasCacheStats& st = canvas_cache_stats();
+  printf("per update (2 frames): %.1f us drawn, %.1f us with cached background (%.1fx), "
+         "%.1f us repainted (%.1fx)\n", full, layered, layered > 0 ? full / layered : 0.0,
+         repaint, repaint > 0 ? full / repaint : 0.0);
+  printf("cache: %u hits, %u misses, %u bytes held\n", (unsigned)st.hits, (unsigned)st.misses,
+         (unsigned)st.bytes);
+  return bad ? 1 : 0;
+}
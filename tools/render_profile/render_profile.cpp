@@ -0,0 +1,150 @@
+// Host-side render profiler for the canvas layer.
+//
+// Renders screens with the real draw_screen_frame() built with
+// -D CANVAS_PROFILE and reports, per drawing step, how many pixel writes it
+// issued, how many stored the color already there and how many were later
+// overwritten in the same frame. A PPM heatmap shows writes per pixel.
+//
+//   pio run -e render_profile
+//   .pio/build/render_profile/program --temp 45 --arrow up --heatmap heat.ppm
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -DCANVAS_PROFILE -DTRACE_ENABLED=0 src/canvas.cpp src/sparkline.cpp
+//       tools/render_profile/render_profile.cpp -o render_profile
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "canvas.h"
+#include "sparkline.h"
+
+struct Options {
+  int temp = 45;
+  int battery = -1;
+  ArrowDir arrow = ARROW_UP;
+  bool transition = true;
+  bool spark = false;
+  const char* heatmap = nullptr;
+};
+
+static void usage() {
+  fprintf(stderr,
+          "usage: render_profile [--temp N] [--arrow up|down|up-fast|down-fast|none] [--battery PCT]\n"
+          "                      [--spark] [--no-transition] [--heatmap OUT.ppm]\n");
+  exit(2);
+}
+
+static Options parse_args(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    bool has_value = i + 1 < argc;
+    if (!strcmp(a, "--temp") && has_value) {
+      o.temp = atoi(argv[++i]);
+    } else if (!strcmp(a, "--battery") && has_value) {
+      o.battery = atoi(argv[++i]);
+    } else if (!strcmp(a, "--arrow") && has_value) {
+      const char* v = argv[++i];
+      if (!strcmp(v, "up")) o.arrow = ARROW_UP;
+      else if (!strcmp(v, "down")) o.arrow = ARROW_DOWN;
+      else if (!strcmp(v, "up-fast")) o.arrow = ARROW_UP_FAST;
+      else if (!strcmp(v, "down-fast")) o.arrow = ARROW_DOWN_FAST;
+      else if (!strcmp(v, "none")) o.arrow = ARROW_NONE;
+      else usage();
+    } else if (!strcmp(a, "--spark")) {
+      o.spark = true;
+    } else if (!strcmp(a, "--no-transition")) {
+      o.transition = false;
+    } else if (!strcmp(a, "--heatmap") && has_value) {
+      o.heatmap = argv[++i];
+    } else {
+      usage();
+    }
+  }
+  return o;
+}
+
+static void report(const char* title) {
+  const CanvasProfile& p = canvas_profile;
+  uint32_t total = 0, unchanged = 0, overdrawn = 0, touched = 0, max_w = 0;
+  for (int i = 0; i < CANVAS_W * CANVAS_H; i++) {
+    if (p.writes[i]) touched++;
+    if (p.writes[i] > max_w) max_w = p.writes[i];
+  }
+
+  printf("== %s ==\n", title);
+  printf("%-12s %6s %9s %9s %9s %7s\n", "site", "calls", "writes", "unchanged", "overdrawn", "waste%");
+  for (int i = 0; i < p.site_count; i++) {
+    const CanvasSiteStats& s = p.sites[i];
+    total += s.writes;
+    unchanged += s.unchanged;
+    overdrawn += s.overdrawn;
+    double waste = s.writes ? 100.0 * s.overdrawn / s.writes : 0.0;
+    printf("%-12s %6u %9u %9u %9u %6.1f%%\n", s.name, (unsigned)s.calls, (unsigned)s.writes,
+           (unsigned)s.unchanged, (unsigned)s.overdrawn, waste);
+  }
+  printf("%-12s %6s %9u %9u %9u %6.1f%%\n", "total", "", (unsigned)total, (unsigned)unchanged,
+         (unsigned)overdrawn, total ? 100.0 * overdrawn / total : 0.0);
+  printf("pixels touched %u of %u, overdraw ratio %.3f (writes/pixel), max %u writes on one pixel\n\n",
+         (unsigned)touched, (unsigned)(CANVAS_W * CANVAS_H),
+         touched ? (double)total / touched : 0.0, (unsigned)max_w);
+}
+
+// 0 = black, then blue, green, yellow, red for 1, 2, 3, 4+ writes
+static bool write_heatmap(const char* path) {
+  static const uint8_t PALETTE[5][3] = {
+    { 0, 0, 0 }, { 30, 60, 200 }, { 40, 190, 60 }, { 240, 220, 40 }, { 230, 40, 30 },
+  };
+  FILE* f = fopen(path, "wb");
+  if (!f) return false;
+  fprintf(f, "P6\n%d %d\n255\n", CANVAS_W, CANVAS_H);
+  for (int i = 0; i < CANVAS_W * CANVAS_H; i++) {
+    int w = canvas_profile.writes[i];
+    fwrite(PALETTE[w < 4 ? w : 4], 1, 3, f);
+  }
+  fclose(f);
+  return true;
+}
+
+// 24 h of synthetic readings every 15 min around o.temp
+static SparkState spark_state;
+
+static const SparkState* make_spark(const Options& o) {
+  if (!o.spark) return nullptr;
+  spark_reset(spark_state);
+  for (uint32_t t = 0; t <= SPARK_SPAN_S; t += 900) {
+    int step = (int)(t / 900);
+    int v = o.temp - 4 + (step % 32 < 16 ? step % 16 : 16 - step % 16) / 2;
+    spark_add(spark_state, t, v);
+  }
+  return &spark_state;
+}
+
+int main(int argc, char** argv) {
+  Options o = parse_args(argc, argv);
+  const SparkState* spark = make_spark(o);
+  char title[96];
+
+  if (o.transition) {
+    canvas_profile_reset();
+    draw_screen_frame(o.temp, o.battery, o.arrow, C_WHITE, spark);
+    snprintf(title, sizeof(title), "temp %d, transition frame (white header)", o.temp);
+    report(title);
+  }
+
+  canvas_profile_reset();
+  draw_screen_frame(o.temp, o.battery, o.arrow, theme_for_temp(o.temp).header_bg, spark);
+  snprintf(title, sizeof(title), "temp %d, final frame", o.temp);
+  report(title);
+
+  if (o.heatmap) {
+    if (!write_heatmap(o.heatmap)) {
+      fprintf(stderr, "cannot write %s\n", o.heatmap);
+      return 1;
+    }
+    printf("heatmap (final frame): %s  [black 0, blue 1, green 2, yellow 3, red 4+ writes]\n",
+           o.heatmap);
+  }
+  return 0;
+}
@@ -0,0 +1,323 @@
+#!/usr/bin/env python3
+"""Render-on-server publisher for the boiler-epd remote framebuffer mode.
+
+Converts an image to the panel's RAM layout (2bpp, rotated), compresses it
+as a key frame or as a delta against the frame the device reports on its
+state topic, and publishes it as chunk messages small enough for
+PubSubClient's default buffer. See include/remote_frame.h for the format.
+
+Input is a 360x184 landscape image (PNG etc. needs Pillow, binary PPM
+works without it) or a raw 16560-byte panel frame. Colors are mapped to
+the nearest of black / white / yellow / red.
+
+    rframe.py screen.png --host 192.168.1.10          # publish
+    rframe.py screen.png --frame-out frame.bin        # panel frame only
+    rframe.py screen.png --chunks-out chunks.bin      # length-prefixed chunks
+
+Publishing needs paho-mqtt. Sent frames are kept in --cache, keyed by CRC,
+so the next publish can send a delta. When the device reports a gap on the
+nack topic, sending resumes from the first missing chunk; when it rejects
+the delta base, the frame is sent again as a key frame.
+
+usage: rframe.py INPUT [--host H] [--port P] [--user U] [--password PW]
+                 [--topic T] [--state-topic T] [--nack-topic T]
+                 [--chunk N] [--key] [--settle S] [--retries N]
+                 [--cache DIR] [--frame-out F] [--chunks-out F]
+"""
+
+import argparse
+import os
+import random
+import struct
+import sys
+import time
+import zlib
+
+PANEL_W, PANEL_H = 184, 360
+CANVAS_W, CANVAS_H = PANEL_H, PANEL_W
+ROW_BYTES = (PANEL_W + 3) // 4
+FRAME_BYTES = ROW_BYTES * PANEL_H
+
+VERSION = 1
+FLAG_DELTA = 0x01
+HEADER = struct.Struct("<2sBBHHHII")
+
+# panel color codes (canvas.h)
+PALETTE = [((0, 0, 0), 0), ((255, 255, 255), 1), ((255, 255, 0), 2), ((255, 0, 0), 3)]
+
+
+# ===================== IMAGE =====================
+def read_ppm(data):
+    parts = []
+    off = 0
+    while len(parts) < 4:
+        while data[off:off + 1].isspace():
+            off += 1
+        if data[off:off + 1] == b"#":
+            off = data.index(b"\n", off) + 1
+            continue
+        end = off
+        while not data[end:end + 1].isspace():
+            end += 1
+        parts.append(data[off:end])
+        off = end
+    if parts[0] != b"P6" or int(parts[3]) != 255:
+        raise ValueError("only 8-bit binary PPM (P6) is supported without Pillow")
+    w, h = int(parts[1]), int(parts[2])
+    px = data[off + 1:off + 1 + w * h * 3]
+    return w, h, [tuple(px[i:i + 3]) for i in range(0, len(px), 3)]
+
+
+def read_image(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:2] == b"P6":
+        return read_ppm(data)
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit("Pillow is needed for %s (or convert it to PPM)" % path)
+    im = Image.open(path).convert("RGB")
+    return im.width, im.height, list(im.getdata())
+
+
+def nearest(rgb):
+    return min(PALETTE, key=lambda p: sum((a - b) ** 2 for a, b in zip(p[0], rgb)))[1]
+
+
+def to_panel(w, h, pixels):
+    if (w, h) == (PANEL_W, PANEL_H):
+        # already portrait: rotate back to the canvas orientation
+        pixels = [pixels[(PANEL_H - 1 - lx) * PANEL_W + ly]
+                  for ly in range(CANVAS_H) for lx in range(CANVAS_W)]
+    elif (w, h) != (CANVAS_W, CANVAS_H):
+        sys.exit("image must be %dx%d (or %dx%d), got %dx%d"
+                 % (CANVAS_W, CANVAS_H, PANEL_W, PANEL_H, w, h))
+    frame = bytearray([0x55]) * FRAME_BYTES   # white
+    cache = {}
+    for ly in range(CANVAS_H):
+        for lx in range(CANVAS_W):
+            rgb = pixels[ly * CANVAS_W + lx]
+            c = cache.get(rgb)
+            if c is None:
+                c = cache[rgb] = nearest(rgb)
+            # same mapping as set_px_l in src/canvas.cpp
+            x, y = ly, PANEL_H - 1 - lx
+            i = y * ROW_BYTES + x // 4
+            shift = (3 - x % 4) * 2
+            frame[i] = (frame[i] & ~(3 << shift)) | (c << shift)
+    return bytes(frame)
+
+
+def load_frame(path):
+    if os.path.getsize(path) == FRAME_BYTES and not path.lower().endswith((".ppm", ".png")):
+        with open(path, "rb") as f:
+            return f.read()
+    return to_panel(*read_image(path))
+
+
+# ===================== ENCODING =====================
+def packbits(data):
+    out = bytearray()
+    i, n = 0, len(data)
+    lit_start = 0
+    while i < n:
+        run = 1
+        while i + run < n and run < 129 and data[i + run] == data[i]:
+            run += 1
+        if run >= 3 or (run == 2 and lit_start == i):
+            flush_literals(out, data, lit_start, i)
+            out.append(run + 126)
+            out.append(data[i])
+            i += run
+            lit_start = i
+        else:
+            i += run
+    flush_literals(out, data, lit_start, n)
+    return bytes(out)
+
+
+def flush_literals(out, data, start, end):
+    while start < end:
+        k = min(128, end - start)
+        out.append(k - 1)
+        out += data[start:start + k]
+        start += k
+
+
+def chunk_messages(stream, flags, frame_id, base_crc, frame_crc, chunk):
+    room = chunk - HEADER.size
+    if room <= 0:
+        sys.exit("--chunk must be larger than the %d-byte header" % HEADER.size)
+    slices = [stream[i:i + room] for i in range(0, len(stream), room)] or [b""]
+    return [HEADER.pack(b"RF", VERSION, flags, frame_id, i, len(slices), base_crc, frame_crc) + s
+            for i, s in enumerate(slices)]
+
+
+def encode(frame, base, frame_id, chunk, force_key):
+    crc = zlib.crc32(frame) & 0xFFFFFFFF
+    key = packbits(frame)
+    flags, stream, base_crc = 0, key, 0
+    if base is not None and not force_key:
+        delta = packbits(bytes(a ^ b for a, b in zip(frame, base)))
+        if len(delta) < len(key):
+            flags, stream, base_crc = FLAG_DELTA, delta, zlib.crc32(base) & 0xFFFFFFFF
+    return crc, flags, stream, chunk_messages(stream, flags, frame_id, base_crc, crc, chunk)
+
+
+# ===================== MQTT =====================
+def mqtt_client(args):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("publishing needs paho-mqtt (pip install paho-mqtt)")
+    try:
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+    except AttributeError:       # paho-mqtt 1.x
+        client = mqtt.Client()
+    if args.user:
+        client.username_pw_set(args.user, args.password)
+    client.connect(args.host, args.port)
+    return client
+
+
+def device_crc(client, topic, wait_s=1.0):
+    """CRC of the frame the device holds, from its retained state (0 = none)."""
+    state = {}
+    client.on_message = lambda c, u, msg: state.setdefault("crc", msg.payload)
+    client.subscribe(topic)
+    end = time.time() + wait_s
+    while "crc" not in state and time.time() < end:
+        client.loop(0.1)
+    client.unsubscribe(topic)
+    try:
+        return int(state.get("crc", b"0"), 16)
+    except ValueError:
+        return 0
+
+
+def send_frame(client, args, msgs, frame_id, crc):
+    """Publish all chunks, resuming from wherever the device reports a gap.
+
+    The device publishes its state after every complete frame: our CRC, or 0
+    when it streams into panel RAM and keeps no copy. The retained state
+    delivered on subscribing is older than this transfer and is skipped.
+    Without a state update the last chunk is sent again, so a lost tail
+    shows up as a gap (or completes the frame). Returns False when the
+    device does not hold the base of a delta frame; send a key frame then."""
+    ev = {"resend": None, "done": False, "no_base": False}
+    delta = bool(HEADER.unpack_from(msgs[0])[2] & FLAG_DELTA)
+
+    def on_message(c, u, msg):
+        if msg.topic == args.state_topic:
+            if not msg.retain:
+                state = msg.payload.strip().lower()
+                if state == b"%08x" % crc or (state == b"00000000" and not delta):
+                    ev["done"] = True
+                elif delta:
+                    ev["no_base"] = True
+            return
+        parts = msg.payload.split()
+        if len(parts) == 2 and int(parts[0], 16) == frame_id:
+            ev["resend"] = int(parts[1], 16)
+
+    client.on_message = on_message
+    client.subscribe(args.nack_topic)
+    client.subscribe(args.state_topic)
+    client.loop_start()
+    i, resends, tails, quiet_until = 0, 0, 0, 0
+    while True:
+        if ev["no_base"]:
+            client.loop_stop()
+            return False
+        if ev["resend"] is not None:
+            if resends == args.retries:
+                client.loop_stop()
+                sys.exit("giving up after %d resends" % resends)
+            print("device missed chunk %d, resending" % ev["resend"], file=sys.stderr)
+            i, ev["resend"] = ev["resend"], None
+            resends += 1
+        if i < len(msgs):
+            client.publish(args.topic, msgs[i], qos=0).wait_for_publish()
+            i += 1
+            quiet_until = time.time() + args.settle
+            continue
+        if ev["done"]:
+            break
+        if time.time() > quiet_until:
+            if tails == args.retries:
+                print("no confirmation from the device", file=sys.stderr)
+                break
+            i = len(msgs) - 1
+            tails += 1
+            continue
+        time.sleep(min(0.05, args.settle))
+    client.loop_stop()
+    return True
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input")
+    ap.add_argument("--host")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--user")
+    ap.add_argument("--password")
+    ap.add_argument("--topic", default="boiler/epd/frame")
+    ap.add_argument("--state-topic", default="boiler/epd/frame/state")
+    ap.add_argument("--nack-topic", default="boiler/epd/frame/nack")
+    ap.add_argument("--chunk", type=int, default=200,
+                    help="bytes per chunk message incl. header (default 200)")
+    ap.add_argument("--key", action="store_true", help="always send a key frame")
+    ap.add_argument("--settle", type=float, default=3.0,
+                    help="seconds to wait for the device's state after the last chunk")
+    ap.add_argument("--retries", type=int, default=5, help="resend requests to serve")
+    ap.add_argument("--cache", default=os.path.expanduser("~/.cache/boiler-epd-frames"))
+    ap.add_argument("--frame-out", help="write the raw panel frame")
+    ap.add_argument("--chunks-out", help="write the chunks, each prefixed with a u16 length")
+    args = ap.parse_args()
+
+    frame = load_frame(args.input)
+    if args.frame_out:
+        with open(args.frame_out, "wb") as f:
+            f.write(frame)
+
+    client = mqtt_client(args) if args.host else None
+    base = None
+    held = 0
+    if client:
+        held = device_crc(client, args.state_topic)
+        path = os.path.join(args.cache, "%08x.bin" % held)
+        if held and not args.key and os.path.exists(path):
+            with open(path, "rb") as f:
+                base = f.read()
+
+    frame_id = random.randint(0, 0xFFFF)
+    crc, flags, stream, msgs = encode(frame, base, frame_id, args.chunk, args.key)
+    print("%s frame %08x: %d -> %d bytes, %d chunks"
+          % ("delta" if flags & FLAG_DELTA else "key", crc, FRAME_BYTES, len(stream), len(msgs)),
+          file=sys.stderr)
+
+    if args.chunks_out:
+        with open(args.chunks_out, "wb") as f:
+            for m in msgs:
+                f.write(struct.pack("<H", len(m)) + m)
+
+    if client:
+        if held == crc and not args.key:
+            print("device already shows this frame", file=sys.stderr)
+        else:
+            if not send_frame(client, args, msgs, frame_id, crc):
+                print("device does not hold the base frame, sending a key frame", file=sys.stderr)
+                frame_id = (frame_id + 1) & 0xFFFF
+                crc, flags, stream, msgs = encode(frame, None, frame_id, args.chunk, True)
+                send_frame(client, args, msgs, frame_id, crc)
+        client.disconnect()
+        os.makedirs(args.cache, exist_ok=True)
+        with open(os.path.join(args.cache, "%08x.bin" % crc), "wb") as f:
+            f.write(frame)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+// C entry points over src/remote_frame.cpp for rframe_loopback.py (ctypes).
+// One receiver, with a frame buffer or with a sink that collects the bytes.
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "remote_frame.h"
+
+static RFrameRx rx;
+static std::vector<uint8_t> fb;
+static std::vector<uint8_t> sunk;   // sink mode: bytes of the current frame
+
+static void sink_start() { sunk.clear(); }
+
+static void sink_write(const uint8_t* p, size_t n) { sunk.insert(sunk.end(), p, p + n); }
+
+extern "C" {
+
+void lb_begin(unsigned int frame_len, int with_fb) {
+  fb.assign(frame_len, 0);
+  sunk.clear();
+  if (with_fb) {
+    rframe_begin(rx, fb.data(), fb.size());
+  } else {
+    RFrameSink sink = { sink_start, sink_write };
+    rframe_begin_sink(rx, sink, frame_len);
+  }
+}
+
+int lb_chunk(const uint8_t* msg, unsigned int len) { return rframe_chunk(rx, msg, len); }
+
+const char* lb_result_name(int r) { return rframe_result_name((RFrameResult)r); }
+
+unsigned int lb_frame_id() { return rx.frame_id; }
+unsigned int lb_next_chunk() { return rx.next_chunk; }
+unsigned int lb_fb_crc() { return rx.fb_crc; }
+
+// Frame buffer, or what the sink received; returns the byte count.
+unsigned int lb_output(uint8_t* out, unsigned int cap) {
+  const std::vector<uint8_t>& v = rx.fb ? fb : sunk;
+  unsigned int n = v.size() < cap ? (unsigned int)v.size() : cap;
+  memcpy(out, v.data(), n);
+  return n;
+}
+
+}
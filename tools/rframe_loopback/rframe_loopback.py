@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""Loopback test of the remote framebuffer: tools/rframe.py against the
+firmware's decoder (src/remote_frame.cpp) over a lossy link.
+
+Builds remote_frame.cpp with loopback_shim.cpp as a shared library (needs a
+C++ compiler: $CXX, default c++) and loads it with ctypes. A run of frames
+(each a few rectangles changed from the last) is encoded by rframe.encode()
+and sent by rframe.send_frame() through a stand-in for the MQTT client
+that drops, duplicates and delays chunks before handing them to
+rframe_chunk(). The device side answers like src/main.cpp: a gap report on
+the nack topic, its state after a complete frame. The decoded frame must
+match byte for byte and its CRC the one rframe.py computed, once with a
+frame buffer (delta frames) and once in sink mode (key frames, no copy).
+Now and then the sender uses an older frame as the delta base, as with a
+stale cache: the device must reject it and rframe.py fall back to a key
+frame.
+
+Chunks do not cross into the next frame and replies from the device are
+not lost.
+
+No broker is involved: LossyLink stands in for the paho client and calls
+the decoder synchronously. What a real broker adds is not covered here,
+namely paho's network thread delivering nack/state callbacks concurrently
+with publishing, retained state arriving on subscribe, and the broker's
+own queueing. Those are exercised only by running tools/rframe.py against
+a device.
+
+usage: rframe_loopback.py [--frames N] [--seed S] [--drop P] [--dup P] [--delay P]
+                          [--stale P]
+"""
+
+import argparse
+import ctypes
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+
+sys.dont_write_bytecode = True   # no __pycache__ next to rframe.py
+sys.path.insert(0, os.path.join(ROOT, "tools"))
+import rframe  # noqa: E402
+
+# RFrameResult (include/remote_frame.h)
+CHUNK_OK, COMPLETE, IGNORED, NEED_RESEND, BAD_HEADER, OUT_OF_ORDER, BAD_BASE = range(7)
+
+
+def build_decoder(tmp):
+    lib = os.path.join(tmp, "librframe.so")
+    cxx = os.environ.get("CXX", "c++")
+    subprocess.check_call([cxx, "-O2", "-shared", "-fPIC", "-I", os.path.join(ROOT, "include"),
+                           os.path.join(ROOT, "src", "remote_frame.cpp"),
+                           os.path.join(HERE, "loopback_shim.cpp"), "-o", lib])
+    dec = ctypes.CDLL(lib)
+    dec.lb_chunk.argtypes = [ctypes.c_char_p, ctypes.c_uint]
+    dec.lb_output.argtypes = [ctypes.c_char_p, ctypes.c_uint]
+    dec.lb_result_name.restype = ctypes.c_char_p
+    for f in (dec.lb_frame_id, dec.lb_next_chunk, dec.lb_fb_crc, dec.lb_output):
+        f.restype = ctypes.c_uint
+    return dec
+
+
+class Message:
+    def __init__(self, topic, payload, retain=False):
+        self.topic, self.payload, self.retain = topic, payload, retain
+
+
+class LossyLink:
+    """Takes the place of the paho client in rframe.send_frame()."""
+
+    def __init__(self, dec, args, rng, opts):
+        self.dec, self.args, self.rng, self.opts = dec, args, rng, opts
+        self.on_message = None
+        self.held = None            # a delayed chunk, delivered after the next one
+        self.stats = {"sent": 0, "dropped": 0, "duplicated": 0, "delayed": 0, "gaps": 0,
+                      "rejected": 0}
+
+    def subscribe(self, topic):
+        pass
+
+    def loop_start(self):
+        pass
+
+    def loop_stop(self):
+        pass
+
+    def wait_for_publish(self):
+        pass
+
+    def publish(self, topic, payload, qos=0):
+        self.stats["sent"] += 1
+        r = self.rng.random()
+        if r < self.opts.drop:
+            self.stats["dropped"] += 1
+            return self
+        if r < self.opts.drop + self.opts.delay and self.held is None:
+            self.stats["delayed"] += 1
+            self.held = payload
+            return self
+        self.deliver(payload)
+        if self.rng.random() < self.opts.dup:
+            self.stats["duplicated"] += 1
+            self.deliver(payload)
+        if self.held is not None:
+            held, self.held = self.held, None
+            self.deliver(held)
+        return self
+
+    # the device: on_frame_chunk() in src/main.cpp
+    def deliver(self, payload):
+        r = self.dec.lb_chunk(payload, len(payload))
+        if r == NEED_RESEND:
+            self.stats["gaps"] += 1
+            nack = b"%04x %x" % (self.dec.lb_frame_id(), self.dec.lb_next_chunk())
+            self.on_message(self, None, Message(self.args.nack_topic, nack))
+        elif r in (COMPLETE, BAD_BASE):
+            self.stats["rejected"] += r == BAD_BASE
+            state = b"%08x" % self.dec.lb_fb_crc()
+            self.on_message(self, None, Message(self.args.state_topic, state))
+        elif r not in (CHUNK_OK, IGNORED):
+            raise AssertionError("decoder: %s" % self.dec.lb_result_name(r).decode())
+
+
+def next_frame(rng, frame):
+    out = bytearray(frame)
+    for _ in range(rng.randint(1, 6)):
+        y0 = rng.randrange(rframe.PANEL_H)
+        x0 = rng.randrange(rframe.ROW_BYTES)
+        h = rng.randint(1, 80)
+        w = rng.randint(1, rframe.ROW_BYTES - x0)
+        v = rng.choice([0x00, 0x55, 0xAA, 0xFF, rng.randrange(256)])
+        for y in range(y0, min(rframe.PANEL_H, y0 + h)):
+            i = y * rframe.ROW_BYTES + x0
+            out[i:i + w] = bytes([v]) * w
+    if rng.random() < 0.2:   # some noise: literal runs
+        for _ in range(200):
+            out[rng.randrange(len(out))] = rng.randrange(256)
+    return bytes(out)
+
+
+def run(dec, opts, with_fb):
+    rng = random.Random(opts.seed)
+    args = argparse.Namespace(topic="frame", state_topic="frame/state", nack_topic="frame/nack",
+                              settle=0.005, retries=50)
+    link = LossyLink(dec, args, rng, opts)
+    dec.lb_begin(rframe.FRAME_BYTES, 1 if with_fb else 0)
+    sent = {}
+    frame = bytes([0x55]) * rframe.FRAME_BYTES
+    deltas, failures = 0, 0
+    out = ctypes.create_string_buffer(rframe.FRAME_BYTES)
+    for n in range(opts.frames):
+        frame = next_frame(rng, frame)
+        base = sent.get(dec.lb_fb_crc()) if with_fb else None   # what device_crc() reports
+        if base is not None and len(sent) > 1 and rng.random() < opts.stale:
+            base = rng.choice([f for c, f in sent.items() if c != dec.lb_fb_crc()])
+        frame_id = rng.randrange(0x10000)
+        crc, flags, stream, msgs = rframe.encode(frame, base, frame_id, 200, False)
+        if not rframe.send_frame(link, args, msgs, frame_id, crc):   # as rframe.main()
+            frame_id = (frame_id + 1) & 0xFFFF
+            crc, flags, stream, msgs = rframe.encode(frame, None, frame_id, 200, True)
+            rframe.send_frame(link, args, msgs, frame_id, crc)
+        deltas += flags & rframe.FLAG_DELTA
+        link.held = None   # still in flight when the frame is done: lost
+        sent[crc] = frame
+
+        n_out = dec.lb_output(out, len(out))
+        got = out.raw[:n_out]
+        got_crc = zlib.crc32(got) & 0xFFFFFFFF
+        held_crc = dec.lb_fb_crc() if with_fb else got_crc
+        if got != frame or held_crc != crc:
+            failures += 1
+            print("frame %d (%s, %d chunks): decoded crc %08x, sent %08x"
+                  % (n, "delta" if flags else "key", len(msgs), held_crc, crc), file=sys.stderr)
+    s = link.stats
+    print("%-11s %d frames (%d deltas), %d chunks sent: %d dropped, %d duplicated, %d delayed, "
+          "%d gaps reported, %d bases rejected, %d frames wrong"
+          % ("frame buffer" if with_fb else "sink", opts.frames, deltas, s["sent"], s["dropped"],
+             s["duplicated"], s["delayed"], s["gaps"], s["rejected"], failures))
+    return failures
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--frames", type=int, default=60)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--drop", type=float, default=0.1, help="chunk loss probability")
+    ap.add_argument("--dup", type=float, default=0.05, help="duplicate delivery probability")
+    ap.add_argument("--delay", type=float, default=0.05,
+                    help="probability a chunk arrives after the next one")
+    ap.add_argument("--stale", type=float, default=0.1,
+                    help="probability a delta is sent against an older frame")
+    opts = ap.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        dec = build_decoder(tmp)
+        failures = run(dec, opts, True) + run(dec, opts, False)
+    if failures:
+        sys.exit("%d frame(s) did not survive the link" % failures)
+    print("all frames decoded")
+
+
+if __name__ == "__main__":
+    main()
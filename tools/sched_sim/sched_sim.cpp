@@ -0,0 +1,305 @@
+// Host-side replay of a temperature trace through the sleep scheduler.
+//
+// Simulates a deep-sleep device that wakes, reads the current value (the
+// trace at that moment, rounded like the firmware shows it), refreshes if
+// it changed, and sleeps for what sleep_sched picks. Reports, for the
+// adaptive scheduler and for fixed intervals, how many wakes and refreshes
+// that takes and how stale the screen gets: the share of time it shows a
+// value other than the current one, and how long each change took to
+// appear (mean, max, and for theme threshold crossings).
+//
+// The trace is one reading per line, "seconds,value" (a single column is
+// taken as one reading per --step seconds). Without a file a synthetic
+// three-day trace of heating cycles is used.
+//
+// --check replays the synthetic trace with the firmware's settings and exits
+// with 1 unless the adaptive scheduler beats a fixed 900 s sleep on stale
+// time, worst delay and worst theme latency, with at most three times the
+// wakes.
+//
+//   pio run -e sched_sim
+//   .pio/build/sched_sim/program [--awake MS] [--fail PCT] [--step S] [FILE]
+//   .pio/build/sched_sim/program --check
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -Itools/host -DLOG_LEVEL=0 src/sleep_sched.cpp
+//       tools/host/host.cpp tools/sched_sim/sched_sim.cpp -o sched_sim
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "canvas.h"
+#include "sleep_sched.h"
+
+// same values as main.cpp
+static const uint32_t SLEEP_SECONDS = 900;
+static const uint32_t SLEEP_MIN_SECONDS = 120;
+static const uint32_t SLEEP_MAX_SECONDS = 3600;
+static const uint16_t SLEEP_MAX_RATE_X10_PER_H = 300;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+struct Sample {
+  uint32_t t_s;
+  double value;
+};
+
+struct Trace {
+  std::vector<Sample> s;
+
+  // reading in effect at t (the last one at or before it)
+  double at(uint32_t t) const {
+    size_t lo = 0, hi = s.size();
+    while (hi - lo > 1) {
+      size_t mid = (lo + hi) / 2;
+      if (s[mid].t_s <= t) lo = mid;
+      else hi = mid;
+    }
+    return s[lo].value;
+  }
+  uint32_t end() const { return s.back().t_s; }
+};
+
+static int shown_of(double v) { return (int)lround(v); }
+
+static void usage() {
+  fprintf(stderr,
+          "usage: sched_sim [--awake MS] [--fail PCT] [--step S] [FILE]\n"
+          "       sched_sim --check\n");
+  exit(2);
+}
+
+static bool read_trace(FILE* f, uint32_t step, Trace& out) {
+  char line[256];
+  uint32_t n = 0;
+  while (fgets(line, sizeof(line), f)) {
+    const char* comma = strchr(line, ',');
+    char* end = nullptr;
+    Sample smp;
+    if (comma) {
+      smp.t_s = (uint32_t)strtoul(line, &end, 10);
+      if (end == line) continue;
+      const char* p = comma + 1;
+      smp.value = strtod(p, &end);
+      if (end == p) continue;
+    } else {
+      smp.value = strtod(line, &end);
+      if (end == line) continue;
+      smp.t_s = n * step;
+    }
+    if (!out.s.empty() && smp.t_s < out.s.back().t_s) continue;
+    out.s.push_back(smp);
+    n++;
+  }
+  return out.s.size() >= 2;
+}
+
+// Three days of a boiler heating up from ~22 °C to ~58 °C a few times a day
+// and cooling back, one reading a minute.
+static void synthetic_trace(Trace& out) {
+  double v = 22;
+  for (uint32_t t = 0; t <= 3 * 86400; t += 60) {
+    uint32_t day_s = t % 86400;
+    bool heating = (day_s >= 6 * 3600 && day_s < 8 * 3600) || (day_s >= 17 * 3600 && day_s < 18 * 3600 + 1800);
+    if (heating) v += (58 - v) * 0.03;
+    else v += (22 - v) * 0.004;
+    out.s.push_back(Sample{ t, v });
+  }
+}
+
+struct Result {
+  uint32_t wakes;
+  uint32_t refreshes;
+  uint32_t failed;
+  uint64_t awake_ms;
+  uint64_t stale_s;         // time the screen showed another value
+  uint32_t changes;         // shown value changes in the trace
+  uint64_t delay_sum_s;     // change -> shown, summed over changes
+  uint32_t delay_max_s;
+  uint32_t theme_changes;
+  uint32_t theme_delay_max_s;
+};
+
+static int theme_of(int v) {
+  if (v > THEME_HOT_ABOVE) return 2;
+  if (v > THEME_WARM_ABOVE) return 1;
+  return 0;
+}
+
+static Result simulate(const Trace& tr, bool adaptive, uint32_t fixed_s, uint32_t awake_ms,
+                       int fail_pct) {
+  SleepSchedConfig c = {};
+  c.adaptive = adaptive;
+  c.default_s = adaptive ? SLEEP_SECONDS : fixed_s;
+  c.min_s = SLEEP_MIN_SECONDS;
+  c.max_s = SLEEP_MAX_SECONDS;
+  c.thresholds[0] = THEME_WARM_ABOVE;
+  c.thresholds[1] = THEME_HOT_ABOVE;
+  c.threshold_count = 2;
+  c.max_rate_x10_per_h = SLEEP_MAX_RATE_X10_PER_H;
+  sched_reset();   // as after power-up
+  sched_begin(c);
+
+  host_seed_random(1);
+  Result r = {};
+  int shown = INT32_MIN;
+  uint64_t t_ms = 0;
+  std::vector<uint32_t> wake_s;      // when each refresh happened
+  std::vector<int> wake_shown;       // what it showed from then on
+
+  while (t_ms / 1000 <= tr.end()) {
+    // a fresh boot: esp_timer starts at zero
+    host_set_ms(0);
+    host_advance_ms(awake_ms);
+    r.wakes++;
+    r.awake_ms += awake_ms;
+
+    uint32_t now_s = (uint32_t)(t_ms / 1000 + awake_ms / 1000);
+    uint32_t sleep_s;
+    if (fail_pct && (int)(esp_random() % 100) < fail_pct) {
+      r.failed++;
+      sleep_s = sched_end_wake(WAKE_NET_FAILED, 0);
+    } else {
+      int v = shown_of(tr.at(now_s));
+      if (v != shown) {
+        shown = v;
+        r.refreshes++;
+        wake_s.push_back(now_s);
+        wake_shown.push_back(v);
+        sleep_s = sched_end_wake(WAKE_REFRESHED, v);
+      } else {
+        sleep_s = sched_end_wake(WAKE_UNCHANGED, v);
+      }
+    }
+    t_ms += awake_ms + (uint64_t)sleep_s * 1000;
+  }
+
+  // walk the trace against what was on screen
+  size_t w = 0;
+  int on_screen = INT32_MIN;
+  int prev = INT32_MIN;
+  uint32_t changed_at = 0;
+  bool pending = false;
+  uint32_t theme_at = 0;
+  bool theme_pending = false;
+  for (size_t i = 0; i < tr.s.size(); i++) {
+    uint32_t t = tr.s[i].t_s;
+    while (w < wake_s.size() && wake_s[w] <= t) on_screen = wake_shown[w++];
+    int v = shown_of(tr.s[i].value);
+
+    if (prev != INT32_MIN && v != prev) {
+      if (!pending) { pending = true; changed_at = t; }
+      if (theme_of(v) != theme_of(prev) && !theme_pending) {
+        theme_pending = true;
+        theme_at = t;
+        r.theme_changes++;
+      }
+      r.changes++;
+    }
+    prev = v;
+
+    if (pending && on_screen == v) {
+      uint32_t d = t - changed_at;
+      r.delay_sum_s += d;
+      if (d > r.delay_max_s) r.delay_max_s = d;
+      pending = false;
+    }
+    if (theme_pending && theme_of(on_screen) == theme_of(v) && on_screen != INT32_MIN) {
+      uint32_t d = t - theme_at;
+      if (d > r.theme_delay_max_s) r.theme_delay_max_s = d;
+      theme_pending = false;
+    }
+    if (i + 1 < tr.s.size() && on_screen != v) r.stale_s += tr.s[i + 1].t_s - t;
+  }
+  return r;
+}
+
+static void print_row(const char* name, const Result& r, uint32_t span_s) {
+  uint32_t shown_changes = r.refreshes ? r.refreshes : 1;
+  printf("%-14s %6u %6u %6u %7.1f %6.1f%% %7lu %7lu %8lu\n", name, r.wakes, r.refreshes, r.failed,
+         r.awake_ms / 1000.0 / 60.0, 100.0 * (double)r.stale_s / span_s,
+         (unsigned long)(r.delay_sum_s / shown_changes), (unsigned long)r.delay_max_s,
+         (unsigned long)r.theme_delay_max_s);
+}
+
+// ===================== CHECKS =====================
+
+static int run_checks() {
+  Trace tr;
+  synthetic_trace(tr);
+  Result a = simulate(tr, true, 0, 2000, 0);
+  Result f = simulate(tr, false, SLEEP_SECONDS, 2000, 0);
+  CHECK(a.stale_s < f.stale_s);
+  CHECK(a.delay_max_s < f.delay_max_s);
+  CHECK(a.theme_delay_max_s < f.theme_delay_max_s);
+  CHECK(a.wakes <= 3 * f.wakes);
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  uint32_t awake_ms = 2000;
+  int fail_pct = 0;
+  uint32_t step = 60;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--check")) return run_checks();
+    else if (!strcmp(argv[i], "--awake") && i + 1 < argc) awake_ms = (uint32_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--fail") && i + 1 < argc) fail_pct = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--step") && i + 1 < argc) step = (uint32_t)atoi(argv[++i]);
+    else if (argv[i][0] == '-') usage();
+    else path = argv[i];
+  }
+
+  Trace tr;
+  if (path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+      perror(path);
+      return 1;
+    }
+    bool ok = read_trace(f, step ? step : 60, tr);
+    fclose(f);
+    if (!ok) {
+      fprintf(stderr, "%s: need at least two readings\n", path);
+      return 1;
+    }
+  } else {
+    synthetic_trace(tr);
+  }
+  uint32_t span_s = tr.end() - tr.s[0].t_s;
+
+  printf("%u readings over %.1f h, %u ms awake per wake, %d%% failed wakes\n",
+         (unsigned)tr.s.size(), span_s / 3600.0, awake_ms, fail_pct);
+  printf("refr: refreshes; awake_m: minutes awake; stale: time showing an old value;\n"
+         "delay_s/max_s: change -> shown; theme_s: worst threshold crossing -> shown\n\n");
+  printf("%-14s %6s %6s %6s %7s %7s %7s %7s %8s\n", "policy", "wakes", "refr", "failed",
+         "awake_m", "stale", "delay_s", "max_s", "theme_s");
+
+  struct { const char* name; uint32_t s; } fixed[] = {
+    { "fixed 120 s", 120 }, { "fixed 900 s", 900 }, { "fixed 3600 s", 3600 },
+  };
+  Result a = simulate(tr, true, 0, awake_ms, fail_pct);
+  print_row("adaptive", a, span_s);
+  for (auto& f : fixed) print_row(f.name, simulate(tr, false, f.s, awake_ms, fail_pct), span_s);
+  return 0;
+}
@@ -0,0 +1,271 @@
+// Host-side replay of a temperature trace through the speculative render
+// guesses (spec_cache.h).
+//
+// Simulates a deep-sleep device waking every --wake seconds. Before the
+// reading arrives it guesses like speculate() in main.cpp: spec_guesses()
+// from the last reading along the trend, each guess run through copies of
+// the filter, trend and sparkline. Then the reading (the trace at that
+// moment, rounded) goes through the same three the way on_boiler_value()
+// and take_update() handle it. A refresh is a hit when one guess has the
+// same value, header color, arrow and sparkline as the refresh, i.e. the
+// same frame key (battery and side values are taken as unchanged).
+//
+// Reports the hit rate, at which guess the hits land, and why misses
+// missed. Pool space is not modelled: whether all guesses fit the 16 KB
+// pool depends on the firmware's drawing code, not on the trace.
+//
+// The trace is one reading per line, "seconds,value" (a single column is
+// taken as one reading per --step seconds). Without a file a synthetic
+// three-day trace of heating cycles is used.
+//
+//   pio run -e spec_replay
+//   .pio/build/spec_replay/program [--wake S] [--step S] [FILE]
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -DTRACE_ENABLED=0 src/spec_cache.cpp src/trend.cpp src/sparkline.cpp
+//       src/canvas.cpp src/signal_filter.cpp tools/spec_replay/spec_replay.cpp -o spec_replay
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "canvas.h"
+#include "signal_filter.h"
+#include "sparkline.h"
+#include "spec_cache.h"
+#include "trend.h"
+
+// same values as main.cpp
+static const uint32_t SLEEP_SECONDS = 900;
+static const uint8_t FILTER_MEDIAN_N = 1;
+static const uint8_t FILTER_EWMA_ALPHA_X16 = 0;
+static const int FILTER_DEADBAND = 1;
+static const int FILTER_HYSTERESIS = 1;
+static const uint16_t TREND_STEADY_X10_PER_H = 5;
+static const uint16_t TREND_FAST_X10_PER_H = 60;
+static const uint8_t TREND_MIN_T_STAT_X10 = 20;
+static const uint8_t TREND_MIN_SAMPLES = 4;
+
+struct Sample {
+  uint32_t t_s;
+  double value;
+};
+
+struct Trace {
+  std::vector<Sample> s;
+
+  // reading in effect at t (the last one at or before it)
+  double at(uint32_t t) const {
+    size_t lo = 0, hi = s.size();
+    while (hi - lo > 1) {
+      size_t mid = (lo + hi) / 2;
+      if (s[mid].t_s <= t) lo = mid;
+      else hi = mid;
+    }
+    return s[lo].value;
+  }
+  uint32_t end() const { return s.back().t_s; }
+};
+
+static void usage() {
+  fprintf(stderr, "usage: spec_replay [--wake S] [--step S] [FILE]\n");
+  exit(2);
+}
+
+static bool read_trace(FILE* f, uint32_t step, Trace& out) {
+  char line[256];
+  uint32_t n = 0;
+  while (fgets(line, sizeof(line), f)) {
+    const char* comma = strchr(line, ',');
+    char* end = nullptr;
+    Sample smp;
+    if (comma) {
+      smp.t_s = (uint32_t)strtoul(line, &end, 10);
+      if (end == line) continue;
+      const char* p = comma + 1;
+      smp.value = strtod(p, &end);
+      if (end == p) continue;
+    } else {
+      smp.value = strtod(line, &end);
+      if (end == line) continue;
+      smp.t_s = n * step;
+    }
+    if (!out.s.empty() && smp.t_s < out.s.back().t_s) continue;
+    out.s.push_back(smp);
+    n++;
+  }
+  return out.s.size() >= 2;
+}
+
+// Three days of a boiler heating up from ~22 °C to ~58 °C a few times a day
+// and cooling back, one reading a minute (as tools/sched_sim).
+static void synthetic_trace(Trace& out) {
+  double v = 22;
+  for (uint32_t t = 0; t <= 3 * 86400; t += 60) {
+    uint32_t day_s = t % 86400;
+    bool heating = (day_s >= 6 * 3600 && day_s < 8 * 3600) || (day_s >= 17 * 3600 && day_s < 18 * 3600 + 1800);
+    if (heating) v += (58 - v) * 0.03;
+    else v += (22 - v) * 0.004;
+    out.s.push_back(Sample{ t, v });
+  }
+}
+
+// ===================== REPLAY =====================
+enum MissReason { MISS_VALUE, MISS_ARROW, MISS_GRAPH, MISS_REASONS };
+
+struct Result {
+  uint32_t wakes;
+  uint32_t refreshes;        // with guesses made (not the first one)
+  uint32_t hits;
+  uint32_t hit_at[SPEC_MAX_GUESSES];
+  uint32_t misses[MISS_REASONS];
+};
+
+static bool is_falling(ArrowDir d) { return d == ARROW_DOWN || d == ARROW_DOWN_FAST; }
+
+static uint8_t header_of(int theme) { return theme_for_temp(theme).header_bg; }
+
+static Result replay(const Trace& tr, uint32_t wake_s) {
+  FilterConfig fcfg = {};
+  fcfg.median_n = FILTER_MEDIAN_N;
+  fcfg.ewma_alpha_x16 = FILTER_EWMA_ALPHA_X16;
+  fcfg.deadband = FILTER_DEADBAND;
+  fcfg.hysteresis = FILTER_HYSTERESIS;
+  fcfg.thresholds[0] = THEME_WARM_ABOVE;
+  fcfg.thresholds[1] = THEME_HOT_ABOVE;
+  fcfg.threshold_count = 2;
+  TrendConfig tcfg = {};
+  tcfg.steady_x10_per_h = TREND_STEADY_X10_PER_H;
+  tcfg.fast_x10_per_h = TREND_FAST_X10_PER_H;
+  tcfg.min_t_stat_x10 = TREND_MIN_T_STAT_X10;
+  tcfg.min_samples = TREND_MIN_SAMPLES;
+
+  static FilterState filter, cand_filter;
+  static TrendState trend, cand_trend;
+  static SparkState spark, cand_spark;
+  static SparkSpans spans, cand_spans[SPEC_MAX_GUESSES];
+  filter_reset(filter);
+  trend_reset(trend);
+  spark_reset(spark);
+  int shown = FILTER_NO_VALUE, theme = FILTER_NO_VALUE;
+  ArrowDir arrow = ARROW_NONE;
+
+  Result r = {};
+  for (uint32_t now_s = wake_s; now_s <= tr.end(); now_s += wake_s) {
+    r.wakes++;
+
+    // speculate(): guessed readings, and the value, arrow and graph each
+    // would show
+    int guesses[SPEC_MAX_GUESSES];
+    int guess_shown[SPEC_MAX_GUESSES], guess_theme[SPEC_MAX_GUESSES];
+    ArrowDir guess_dir[SPEC_MAX_GUESSES];
+    int guess_count = 0;
+    int last_raw;
+    if (shown != FILTER_NO_VALUE) {
+      if (!trend_last(trend, last_raw)) last_raw = shown;
+      guess_count = spec_guesses(last_raw, is_falling(trend_arrow(tcfg, trend, arrow)), guesses);
+      for (int i = 0; i < guess_count; i++) {
+        cand_filter = filter;
+        int v = filter_input(fcfg, cand_filter, guesses[i]);
+        bool show = filter_decide(fcfg, v, shown, theme) == FILTER_SHOW;
+        guess_shown[i] = show ? v : shown;
+        guess_theme[i] = show ? filter_theme(fcfg, v, theme) : theme;
+        cand_trend = trend;
+        trend_add(cand_trend, now_s, guesses[i]);
+        guess_dir[i] = trend_arrow(tcfg, cand_trend, arrow);
+        cand_spark = spark;
+        spark_add(cand_spark, now_s, guesses[i]);
+        spark_spans(cand_spark, cand_spans[i]);
+      }
+    }
+
+    // on_boiler_value() and take_update()
+    int t = (int)lround(tr.at(now_s));
+    trend_add(trend, now_s, t);
+    spark_add(spark, now_s, t);
+    int v = filter_input(fcfg, filter, t);
+    ArrowDir dir = trend_arrow(tcfg, trend, arrow);
+    FilterVerdict verdict = filter_decide(fcfg, v, shown, theme);
+    if (verdict != FILTER_SHOW && dir == arrow) continue;
+    if (verdict == FILTER_SHOW) {
+      shown = v;
+      theme = filter_theme(fcfg, v, theme);
+    }
+    arrow = dir;
+    if (!guess_count) continue;
+
+    r.refreshes++;
+    spark_spans(spark, spans);
+    MissReason why = MISS_VALUE;
+    int hit = -1;
+    for (int i = 0; i < guess_count && hit < 0; i++) {
+      if (guess_shown[i] != shown || header_of(guess_theme[i]) != header_of(theme)) continue;
+      if (guess_dir[i] != dir) {
+        why = MISS_ARROW;
+      } else if (memcmp(&cand_spans[i], &spans, sizeof(spans)) != 0) {
+        if (why == MISS_VALUE) why = MISS_GRAPH;
+      } else {
+        hit = i;
+      }
+    }
+    if (hit >= 0) {
+      r.hits++;
+      r.hit_at[hit]++;
+    } else {
+      r.misses[why]++;
+    }
+  }
+  return r;
+}
+
+static double pct(uint32_t n, uint32_t of) { return of ? 100.0 * n / of : 0; }
+
+int main(int argc, char** argv) {
+  uint32_t wake_s = SLEEP_SECONDS;
+  uint32_t step = 60;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    bool has_value = i + 1 < argc;
+    if (!strcmp(a, "--wake") && has_value) wake_s = (uint32_t)atoi(argv[++i]);
+    else if (!strcmp(a, "--step") && has_value) step = (uint32_t)atoi(argv[++i]);
+    else if (a[0] == '-' && a[1]) usage();
+    else path = a;
+  }
+  if (wake_s == 0 || step == 0) usage();
+
+  Trace tr;
+  if (path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+      perror(path);
+      return 1;
+    }
+    bool ok = read_trace(f, step, tr);
+    fclose(f);
+    if (!ok) {
+      fprintf(stderr, "%s: need at least two readings\n", path);
+      return 1;
+    }
+  } else {
+    synthetic_trace(tr);
+    printf("synthetic trace: 3 days of heating cycles, 1 reading/min\n");
+  }
+
+  Result r = replay(tr, wake_s);
+  printf("wake every %u s: %u wakes, %u refreshes with guesses\n", (unsigned)wake_s,
+         (unsigned)r.wakes, (unsigned)r.refreshes);
+  printf("hits:   %u (%.1f %%)\n", (unsigned)r.hits, pct(r.hits, r.refreshes));
+  uint32_t within = 0;
+  for (int i = 0; i < SPEC_MAX_GUESSES; i++) {
+    within += r.hit_at[i];
+    printf("  first %d guess%s: %5.1f %%\n", i + 1, i ? "es" : "  ", pct(within, r.refreshes));
+  }
+  printf("misses: value not guessed %u, arrow differs %u, graph differs %u\n",
+         (unsigned)r.misses[MISS_VALUE], (unsigned)r.misses[MISS_ARROW],
+         (unsigned)r.misses[MISS_GRAPH]);
+  return 0;
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Convert a boiler-epd span trace into Chrome/Perfetto trace JSON.
+
+Input is either
+  * a Serial log containing a "#TRACE v1 ... #TRACE end" text dump
+    (send 't' on the serial monitor), or
+  * the binary message published on boiler/epd/trace, e.g.
+        mosquitto_sub -h <broker> -t boiler/epd/trace -C 1 > trace.bin
+
+Open the output in chrome://tracing or https://ui.perfetto.dev.
+Each ESP32 core is shown as its own thread so cross-core overlap is visible.
+
+usage: trace2chrome.py INPUT [-o OUTPUT.json]
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+
+def parse_binary(data):
+    if data[:4] != b"TRC1":
+        raise ValueError("not a TRC1 dump")
+    name_count, event_size, event_count = struct.unpack_from("<BBH", data, 4)
+    off = 8
+    names = []
+    for _ in range(name_count):
+        n = data[off]
+        names.append(data[off + 1:off + 1 + n].decode("ascii"))
+        off += 1 + n
+    events = []
+    for _ in range(event_count):
+        ts, eid, phase, core = struct.unpack_from("<IBBB", data, off)
+        off += event_size
+        if eid == 0xFF:          # overwritten while dumping
+            continue
+        name = names[eid] if eid < len(names) else "id%d" % eid
+        events.append((ts, core, chr(phase), name))
+    return events
+
+
+def parse_text(text):
+    events = []
+    inside = False
+    for line in text.splitlines():
+        line = line.strip()
+        if line.startswith("#TRACE v"):
+            inside = True
+            events = []          # keep the last dump in the log
+            continue
+        if line.startswith("#TRACE end"):
+            inside = False
+            continue
+        if not inside or not line:
+            continue
+        parts = line.split()
+        if len(parts) != 4:
+            continue
+        events.append((int(parts[0]), int(parts[1]), parts[2], parts[3]))
+    return events
+
+
+def unwrap(events):
+    """Device timestamps are the low 32 bits of esp_timer; make them monotonic."""
+    out = []
+    base = 0
+    prev = None
+    for ts, core, phase, name in events:
+        if prev is not None and ts < prev and prev - ts > 0x80000000:
+            base += 1 << 32
+        prev = ts
+        out.append((ts + base, core, phase, name))
+    return out
+
+
+def to_chrome(events):
+    trace = []
+    cores = sorted({core for _, core, _, _ in events})
+    for core in cores:
+        trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": core,
+                      "args": {"name": "core %d" % core}})
+    trace.append({"name": "process_name", "ph": "M", "pid": 1,
+                  "args": {"name": "boiler-epd"}})
+
+    # Pair B/E per (core, name) into complete events: spans from different
+    # tasks on one core need not nest, which strict B/E rendering dislikes.
+    open_spans = {}
+    end_ts = events[-1][0] if events else 0
+    for ts, core, phase, name in events:
+        key = (core, name)
+        if phase == "B":
+            open_spans.setdefault(key, []).append(ts)
+        elif phase == "E":
+            stack = open_spans.get(key)
+            if not stack:
+                continue         # begin fell out of the ring
+            start = stack.pop()
+            trace.append({"name": name, "ph": "X", "pid": 1, "tid": core,
+                          "ts": start, "dur": ts - start})
+        else:
+            trace.append({"name": name, "ph": "i", "s": "p", "pid": 1,
+                          "tid": core, "ts": ts})
+    for (core, name), stack in open_spans.items():
+        for start in stack:
+            trace.append({"name": name + " (unterminated)", "ph": "X", "pid": 1,
+                          "tid": core, "ts": start, "dur": end_ts - start})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input")
+    ap.add_argument("-o", "--output", help="default: stdout")
+    args = ap.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    if data[:4] == b"TRC1":
+        events = parse_binary(data)
+    else:
+        events = parse_text(data.decode("utf-8", errors="replace"))
+    if not events:
+        sys.exit("no trace events found in " + args.input)
+
+    result = to_chrome(unwrap(events))
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(result, f)
+    else:
+        json.dump(result, sys.stdout)
+        sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
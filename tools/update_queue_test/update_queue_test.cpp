@@ -0,0 +1,294 @@
+// Host-side test of the latest-value slot between the MQTT callback and the
+// render task.
+//
+// Checks the rules one by one (last value wins, minimum interval, threshold
+// bypass in both directions), then replays message streams against a
+// simulated panel that is busy for a full refresh after each update,
+// comparing refreshes and lag with rendering every message in order. A
+// final run posts and takes from two real threads (the host CritSection is
+// a std::mutex) to check that nothing is taken twice, out of order or lost.
+// Exits with 1 on the first mismatch.
+//
+//   pio run -e update_queue_test
+//   .pio/build/update_queue_test/program
+//
+// or without PlatformIO:
+//   g++ -O2 -pthread -Iinclude -Itools/host -DLOG_LEVEL=0 src/update_queue.cpp src/metrics.cpp
+//       tools/update_queue_test/update_queue_test.cpp -o update_queue_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "canvas.h"
+#include "metrics.h"
+#include "update_queue.h"
+
+// same values as main.cpp
+static const uint32_t MIN_REFRESH_INTERVAL_MS = 60000;
+static const int NOTHING_SHOWN = -9999;
+
+static const uint32_t PANEL_REFRESH_MS = 18000;   // full 4-color refresh
+static const uint32_t TICK_MS = 10;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static void begin(uint32_t min_interval_ms) {
+  UpdateQueueConfig c = {};
+  c.min_interval_ms = min_interval_ms;
+  c.thresholds[0] = THEME_WARM_ABOVE;
+  c.thresholds[1] = THEME_HOT_ABOVE;
+  c.threshold_count = 2;
+  update_queue_begin(c);
+  metrics_reset();
+}
+
+// ===================== RULES =====================
+static void test_rules() {
+  begin(MIN_REFRESH_INTERVAL_MS);
+  int v = 0;
+
+  // a burst before the render task runs collapses into its last value
+  for (int i = 20; i < 30; i++) update_post(i);
+  CHECK(update_pending());
+  CHECK(update_take(0, NOTHING_SHOWN, v) && v == 29);
+  CHECK(!update_pending());
+  CHECK(metrics_store.counters[M_UPDATES_COALESCED] == 9);
+  update_refreshed(0);
+
+  // nothing posted, nothing taken
+  CHECK(!update_take(1000, 29, v));
+
+  // a change inside the interval waits for it, and is kept meanwhile
+  update_post(30);
+  CHECK(!update_take(5000, 29, v));
+  CHECK(update_pending());
+  CHECK(update_wait_ms(5000) == MIN_REFRESH_INTERVAL_MS - 5000);
+  CHECK(!update_take(MIN_REFRESH_INTERVAL_MS - 1, 29, v));
+  CHECK(update_take(MIN_REFRESH_INTERVAL_MS, 29, v) && v == 30);
+  update_refreshed(MIN_REFRESH_INTERVAL_MS);
+  uint32_t t = MIN_REFRESH_INTERVAL_MS;
+
+  // the value already shown is handed over at once (the caller skips it)
+  update_post(30);
+  CHECK(update_take(t + 1000, 30, v) && v == 30);
+  CHECK(!update_pending());
+
+  // crossing a theme threshold skips the wait, up and down
+  update_post(THEME_WARM_ABOVE + 1);
+  CHECK(update_take(t + 2000, 30, v) && v == THEME_WARM_ABOVE + 1);
+  update_refreshed(t + 2000);
+  update_post(THEME_WARM_ABOVE);
+  CHECK(update_take(t + 3000, THEME_WARM_ABOVE + 1, v) && v == THEME_WARM_ABOVE);
+  update_refreshed(t + 3000);
+  CHECK(metrics_store.counters[M_REFRESH_BYPASSES] == 2);
+
+  // moving within a theme does not
+  update_post(THEME_WARM_ABOVE - 3);
+  CHECK(!update_take(t + 4000, THEME_WARM_ABOVE, v));
+  CHECK(update_due(t + 3000 + MIN_REFRESH_INTERVAL_MS));
+  CHECK(update_take(t + 3000 + MIN_REFRESH_INTERVAL_MS, THEME_WARM_ABOVE, v));
+
+  // no rate limit
+  begin(0);
+  update_refreshed(0);
+  update_post(1);
+  CHECK(update_take(0, 0, v) && v == 1);
+}
+
+// ===================== SIMULATED PANEL =====================
+struct Msg {
+  uint32_t t_ms;
+  int value;
+};
+
+struct RunStats {
+  int refreshes;
+  int bypasses;
+  uint32_t max_lag_ms;   // newest value posted -> its refresh started
+  int final_shown;
+  uint32_t min_gap_ms;   // between refreshes that were not bypasses
+};
+
+// The render task as in main.cpp: runs whenever the panel is free, takes the
+// newest value, refreshes if it differs from what is shown.
+static RunStats run_coalescing(const std::vector<Msg>& msgs, uint32_t end_ms) {
+  begin(MIN_REFRESH_INTERVAL_MS);
+  RunStats s = {};
+  s.min_gap_ms = UINT32_MAX;
+  int shown = NOTHING_SHOWN;
+  uint32_t busy_until = 0;
+  uint32_t last_refresh = 0;
+  bool refreshed = false;
+  uint32_t newest_at = 0;
+  int newest = NOTHING_SHOWN;
+  size_t next = 0;
+
+  for (uint32_t now = 0; now <= end_ms; now += TICK_MS) {
+    while (next < msgs.size() && msgs[next].t_ms <= now) {
+      update_post(msgs[next].value);
+      if (msgs[next].value != newest) {
+        newest = msgs[next].value;
+        newest_at = msgs[next].t_ms;
+      }
+      next++;
+    }
+    if (now < busy_until) continue;
+
+    uint32_t bypass_before = metrics_store.counters[M_REFRESH_BYPASSES];
+    int v;
+    if (!update_take(now, shown, v) || v == shown) continue;
+    bool bypass = metrics_store.counters[M_REFRESH_BYPASSES] != bypass_before;
+    if (refreshed && !bypass && now - last_refresh < s.min_gap_ms) s.min_gap_ms = now - last_refresh;
+    if (bypass) s.bypasses++;
+
+    shown = v;
+    if (v == newest && now - newest_at > s.max_lag_ms) s.max_lag_ms = now - newest_at;
+    busy_until = now + PANEL_REFRESH_MS;
+    update_refreshed(now);
+    refreshed = true;
+    last_refresh = now;
+    s.refreshes++;
+  }
+  s.final_shown = shown;
+  return s;
+}
+
+// Every changed message refreshed in arrival order, one after another.
+static RunStats run_fifo(const std::vector<Msg>& msgs) {
+  RunStats s = {};
+  int last = NOTHING_SHOWN;
+  uint32_t free_at = 0;
+  for (const Msg& m : msgs) {
+    if (m.value == last) continue;
+    last = m.value;
+    uint32_t start = free_at > m.t_ms ? free_at : m.t_ms;
+    if (start - m.t_ms > s.max_lag_ms) s.max_lag_ms = start - m.t_ms;
+    free_at = start + PANEL_REFRESH_MS;
+    s.refreshes++;
+  }
+  s.final_shown = last;
+  return s;
+}
+
+static int count_crossings(const std::vector<Msg>& msgs) {
+  int n = 0;
+  for (size_t i = 1; i < msgs.size(); i++) {
+    int a = msgs[i - 1].value, b = msgs[i].value;
+    if ((a > THEME_WARM_ABOVE) != (b > THEME_WARM_ABOVE) || (a > THEME_HOT_ABOVE) != (b > THEME_HOT_ABOVE)) n++;
+  }
+  return n;
+}
+
+static void replay(const char* name, const std::vector<Msg>& msgs) {
+  uint32_t end = msgs.back().t_ms + 2 * MIN_REFRESH_INTERVAL_MS + PANEL_REFRESH_MS;
+  RunStats c = run_coalescing(msgs, end);
+  RunStats f = run_fifo(msgs);
+
+  CHECK(c.final_shown == msgs.back().value);   // the last value always lands
+  CHECK(c.min_gap_ms == UINT32_MAX || c.min_gap_ms >= MIN_REFRESH_INTERVAL_MS);
+  CHECK(c.bypasses <= count_crossings(msgs));
+  CHECK(c.refreshes <= f.refreshes);
+
+  printf("%-22s %5u msgs | coalescing %4d refr %3d bypass, lag %6.1f s | in order %4d refr, lag %7.1f s\n",
+         name, (unsigned)msgs.size(), c.refreshes, c.bypasses, c.max_lag_ms / 1000.0, f.refreshes,
+         f.max_lag_ms / 1000.0);
+}
+
+static std::vector<Msg> steady_rise() {
+  std::vector<Msg> m;
+  for (uint32_t i = 0; i <= 3600; i++) m.push_back(Msg{ i * 1000, 25 + (int)(i / 120) });
+  return m;
+}
+
+static std::vector<Msg> bursts() {
+  std::vector<Msg> m;
+  srand(3);
+  uint32_t t = 0;
+  int v = 30;
+  for (int b = 0; b < 40; b++) {
+    t += 20000 + (uint32_t)(rand() % 60000);
+    for (int i = 0; i < 25; i++) {   // a broker replaying queued messages
+      v += rand() % 3 - 1;
+      m.push_back(Msg{ t + (uint32_t)i * 15, v });
+    }
+  }
+  return m;
+}
+
+static std::vector<Msg> threshold_flutter() {
+  std::vector<Msg> m;
+  for (uint32_t i = 0; i < 600; i++) {
+    int v = THEME_WARM_ABOVE + ((i / 7) % 2 ? 1 : 0) - ((i / 11) % 2 ? 1 : 0);
+    m.push_back(Msg{ i * 2000, v });
+  }
+  return m;
+}
+
+// ===================== THREADS =====================
+static void test_threads() {
+  begin(0);
+  update_refreshed(0);
+  const int POSTS = 200000;
+  std::atomic<bool> done(false);
+  int taken = 0;
+  int last = 0;
+  bool ordered = true;
+
+  std::thread consumer([&] {
+    int v;
+    for (;;) {
+      bool finished = done.load();
+      while (update_take(0, -1, v)) {
+        if (v <= last) ordered = false;
+        last = v;
+        taken++;
+      }
+      if (finished) break;
+    }
+  });
+  std::thread producer([&] {
+    for (int i = 1; i <= POSTS; i++) {
+      update_post(i);
+      if (i % 16 == 0) std::this_thread::yield();   // let the taker in between
+    }
+    done.store(true);
+  });
+  producer.join();
+  consumer.join();
+
+  uint32_t coalesced = metrics_store.counters[M_UPDATES_COALESCED];
+  CHECK(ordered);
+  CHECK(last == POSTS);
+  CHECK((uint32_t)taken + coalesced == (uint32_t)POSTS);
+  CHECK(!update_pending());
+  printf("threads: %d posts, %d taken, %u coalesced\n", POSTS, taken, (unsigned)coalesced);
+}
+
+int main() {
+  test_rules();
+  printf("panel refresh %.0f s, min interval %.0f s\n", PANEL_REFRESH_MS / 1000.0,
+         MIN_REFRESH_INTERVAL_MS / 1000.0);
+  replay("steady rise, 1 msg/s", steady_rise());
+  replay("bursts of 25", bursts());
+  replay("threshold flutter", threshold_flutter());
+  test_threads();
+  if (failures) {
+    printf("update_queue_test: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("update_queue_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,218 @@
+// Host-side awake-time test of the deep-sleep wake cycle against a broker
+// stand-in that answers SUBSCRIBE with the retained value after a scripted
+// latency (tools/host), on a simulated clock.
+//
+// Runs series of wakes the way the network task does (connect, subscribe,
+// poll every 10 ms, sleep once the retained value is handled, the adaptive
+// timeout passes or the network budget runs out) for several broker
+// behaviours, and reports awake time per wake against the old fixed 15 s
+// wait. Checks that no wake sleeps before a value that arrives within its
+// timeout, that a miss lengthens the next wait, and that waits stay within
+// their bounds. Exits with 1 on the first mismatch.
+//
+//   pio run -e wake_cycle_test
+//   .pio/build/wake_cycle_test/program [--wakes N]
+//
+// or without PlatformIO:
+//   g++ -O2 -Iinclude -Itools/host -DLOG_LEVEL=0 -DTRACE_ENABLED=0
+//       src/wake_cycle.cpp src/netconn.cpp src/metrics.cpp tools/host/host.cpp
+//       tools/wake_cycle_test/wake_cycle_test.cpp -o wake_cycle_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+#include "metrics.h"
+#include "netconn.h"
+#include "wake_cycle.h"
+
+// same values as main.cpp
+static const uint32_t RETAINED_WAIT_MIN_MS = 1000;
+static const uint32_t RETAINED_WAIT_MAX_MS = 15000;
+static const uint32_t RETAINED_WAIT_MARGIN_MS = 300;
+static const uint8_t RETAINED_WAIT_LATENCY_MULT = 3;
+static const uint32_t WAKE_NET_BUDGET_MS = 30000;
+static const uint32_t FIXED_WAIT_MS = 15000;   // before the wake cycle
+static const uint32_t POLL_MS = 10;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static PubSubClient mqtt;
+
+static void on_session_up() {
+  mqtt.subscribe("boiler/temp");
+  wake_cycle_subscribed(millis());
+}
+
+static void on_message(char*, uint8_t*, unsigned int) {
+  wake_cycle_message(millis());
+}
+
+enum WakeEnd { END_MESSAGE, END_TIMEOUT, END_NET };
+
+struct WakeResult {
+  WakeEnd end;
+  uint32_t awake_ms;
+  uint32_t timeout_ms;   // wait budget this wake started with
+};
+
+static WakeResult run_wake(int32_t latency_ms) {
+  host_set_ms(0);
+  WiFi.host_drop_link();
+  mqtt.host_drop();
+  mqtt.retained_after_ms = latency_ms;
+
+  WakeCycleConfig wc = {};
+  wc.min_timeout_ms = RETAINED_WAIT_MIN_MS;
+  wc.max_timeout_ms = RETAINED_WAIT_MAX_MS;
+  wc.margin_ms = RETAINED_WAIT_MARGIN_MS;
+  wc.latency_multiplier = RETAINED_WAIT_LATENCY_MULT;
+  wake_cycle_begin(wc);
+
+  NetConfig nc = {};
+  nc.ssid = "ssid";
+  nc.pass = "pass";
+  nc.mqtt_host = "192.168.1.10";
+  nc.mqtt_port = 1883;
+  nc.mqtt_user = "";
+  nc.mqtt_pass = "";
+  nc.wifi_attempt_ms = 10000;
+  nc.backoff_min_ms = 1000;
+  nc.backoff_max_ms = 60000;
+  nc.wake_budget_ms = WAKE_NET_BUDGET_MS;
+  nc.fast_reconnect = true;
+  nc.fast_attempt_ms = 3000;
+  nc.on_session_up = on_session_up;
+
+  WakeResult r = {};
+  r.timeout_ms = wake_cycle_timeout_ms();
+  net_begin(nc, mqtt);
+  for (;;) {
+    host_advance_ms(POLL_MS);
+    net_poll();
+    if (net_session_up()) mqtt.loop();
+    if (wake_cycle_got_message()) { r.end = END_MESSAGE; break; }
+    if (net_gave_up()) { r.end = END_NET; break; }
+    if (wake_cycle_timed_out(millis())) { r.end = END_TIMEOUT; break; }
+  }
+  r.awake_ms = millis();
+  return r;
+}
+
+struct Scenario {
+  const char* name;
+  int32_t (*latency)(int wake);   // < 0: no retained value
+  bool broker_up;
+};
+
+static int32_t rnd(int32_t lo, int32_t hi) { return lo + (int32_t)(esp_random() % (uint32_t)(hi - lo + 1)); }
+
+static int32_t local_broker(int) { return rnd(5, 40); }
+static int32_t busy_broker(int i) { return (i % 20 == 19) ? 4000 : rnd(200, 800); }
+static int32_t flaky_retained(int) { return (esp_random() % 10 == 0) ? -1 : rnd(20, 60); }
+static int32_t no_retained(int) { return -1; }
+static int32_t retained_lost(int i) { return i < 20 ? rnd(5, 40) : -1; }
+
+static const Scenario SCENARIOS[] = {
+  { "local broker", local_broker, true },
+  { "busy broker", busy_broker, true },
+  { "retained value missing 10%", flaky_retained, true },
+  { "no retained value", no_retained, true },
+  { "retained value lost", retained_lost, true },
+  { "broker down", local_broker, false },
+};
+
+static void run(const Scenario& s, int wakes) {
+  host_seed_random(12345);
+  WiFi.host_reset();
+  mqtt = PubSubClient();
+  mqtt.setCallback(on_message);
+  mqtt.broker_up = s.broker_up;
+  net_forget_cache();
+  metrics_reset();
+  wake_cycle_reset();   // as after power-up
+
+  std::vector<uint32_t> awake;
+  int ended[3] = { 0, 0, 0 };
+  int late = 0;
+  uint64_t fixed_total = 0;
+  uint32_t prev_timeout = 0;
+  bool prev_missed = false;
+
+  for (int i = 0; i < wakes; i++) {
+    int32_t latency = s.latency(i);
+    WakeResult r = run_wake(latency);
+    awake.push_back(r.awake_ms);
+    ended[r.end]++;
+
+    CHECK(r.timeout_ms >= RETAINED_WAIT_MIN_MS && r.timeout_ms <= RETAINED_WAIT_MAX_MS);
+    if (s.broker_up) {
+      // a value inside the wait is always taken, one outside it never is
+      bool in_time = latency >= 0 && (uint32_t)latency + POLL_MS <= r.timeout_ms;
+      if (in_time) CHECK(r.end == END_MESSAGE);
+      if (latency >= 0 && (uint32_t)latency > r.timeout_ms + POLL_MS) {
+        CHECK(r.end == END_TIMEOUT);
+        late++;
+      }
+      if (latency < 0) CHECK(r.end == END_TIMEOUT);
+      // a miss never shortens the next wait
+      if (prev_missed) CHECK(r.timeout_ms >= prev_timeout || r.timeout_ms == RETAINED_WAIT_MAX_MS);
+    } else {
+      CHECK(r.end == END_NET);
+      CHECK(r.awake_ms <= WAKE_NET_BUDGET_MS + mqtt.fail_ms + POLL_MS);
+    }
+    prev_timeout = r.timeout_ms;
+    prev_missed = r.end == END_TIMEOUT;
+
+    // the old loop: connect the same way, then stay up 15 s after boot
+    fixed_total += std::max(FIXED_WAIT_MS, r.end == END_NET ? r.awake_ms : 0u);
+  }
+
+  std::vector<uint32_t> sorted = awake;
+  std::sort(sorted.begin(), sorted.end());
+  uint64_t total = 0;
+  for (uint32_t a : awake) total += a;
+  printf("%-28s %6lu %6lu %6lu %8lu   %4d %4d %4d %4d\n", s.name,
+         (unsigned long)(total / awake.size()), (unsigned long)sorted[sorted.size() * 95 / 100],
+         (unsigned long)sorted.back(), (unsigned long)(fixed_total / awake.size()),
+         ended[END_MESSAGE], ended[END_TIMEOUT], ended[END_NET], late);
+}
+
+int main(int argc, char** argv) {
+  int wakes = 300;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--wakes") && i + 1 < argc) wakes = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: wake_cycle_test [--wakes N]\n");
+      return 2;
+    }
+  }
+  if (wakes < 1) wakes = 1;
+
+  printf("%d wakes per scenario, awake ms per wake\n", wakes);
+  printf("%-28s %6s %6s %6s %8s   %4s %4s %4s %4s\n", "scenario", "mean", "p95", "max",
+         "fixed15s", "msg", "tout", "net", "late");
+  for (const Scenario& s : SCENARIOS) run(s, wakes);
+
+  if (failures) {
+    printf("wake_cycle_test: %d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("wake_cycle_test: ok\n");
+  return 0;
+}